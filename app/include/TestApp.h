@@ -2,6 +2,9 @@
 
 #include <kat/Engine.h>
 #include <kat/Renderer.h>
+#include <kat/RenderThread.h>
+#include <kat/GpuScene.h>
+#include <kat/TripleBuffer.h>
 
 class TestApp : public kat::App {
 public:
@@ -14,11 +17,27 @@ private:
 
     void update(double dt) override;
 
+    void fixedUpdate(double dt) override;
+
     void cleanup() override;
 
 private:
 
     std::shared_ptr<kat::Renderer> m_Renderer;
+    // null renders on the main thread
+    std::unique_ptr<kat::RenderThread> m_RenderThread;
+    std::unique_ptr<kat::GpuScene> m_Scene;
+    uint32_t m_SceneInstances = 0;
+
+    // the two latest fixed steps, interpolated between in update()
+    struct OrbitSteps {
+        float previous = 0.0f;
+        float current = 0.0f;
+    };
+
+    // camera orbit angle, simulated in fixedUpdate() when a fixed rate is set
+    float m_SimulatedOrbit = 0.0f;
+    kat::TripleBuffer<OrbitSteps> m_Orbit;
 
 };
 
@@ -1,12 +1,76 @@
 #include <spdlog/spdlog.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstdlib>
 #include "TestApp.h"
 
+namespace {
+    void buildCube(std::vector<kat::SceneVertex>& vertices, std::vector<uint32_t>& indices) {
+        // normal, then two tangents with cross(u, v) == normal so every face winds counter-clockwise from outside
+        const std::array<std::array<glm::vec3, 3>, 6> faces{{
+            {glm::vec3{1, 0, 0}, glm::vec3{0, 1, 0}, glm::vec3{0, 0, 1}},
+            {glm::vec3{-1, 0, 0}, glm::vec3{0, 0, 1}, glm::vec3{0, 1, 0}},
+            {glm::vec3{0, 1, 0}, glm::vec3{0, 0, 1}, glm::vec3{1, 0, 0}},
+            {glm::vec3{0, -1, 0}, glm::vec3{1, 0, 0}, glm::vec3{0, 0, 1}},
+            {glm::vec3{0, 0, 1}, glm::vec3{1, 0, 0}, glm::vec3{0, 1, 0}},
+            {glm::vec3{0, 0, -1}, glm::vec3{0, 1, 0}, glm::vec3{1, 0, 0}},
+        }};
+
+        for (const auto& [normal, u, v] : faces) {
+            auto base = static_cast<uint32_t>(vertices.size());
+            glm::vec3 center = normal * 0.5f;
+            vertices.push_back({center - u * 0.5f - v * 0.5f, normal});
+            vertices.push_back({center + u * 0.5f - v * 0.5f, normal});
+            vertices.push_back({center + u * 0.5f + v * 0.5f, normal});
+            vertices.push_back({center - u * 0.5f + v * 0.5f, normal});
+            indices.insert(indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+        }
+    }
+}
+
 TestApp::TestApp() : kat::App() {
     m_Configuration.window_mode = kat::WindowedWindowMode{
         .size = {800, 800},
         .resizable = false,
         .floating = false
     };
+
+    if (std::getenv("KAT_LOW_LATENCY")) {
+        m_Configuration.latency = kat::kLowLatencyPolicy;
+    }
+
+    // KAT_HEADLESS=<frames> renders offscreen for that many frames, e.g. on CI machines without a display
+    if (const char* headless = std::getenv("KAT_HEADLESS")) {
+        m_Configuration.window_mode = kat::HeadlessWindowMode{
+            .size = {800, 800},
+            .frame_limit = static_cast<size_t>(std::strtoull(headless, nullptr, 10))
+        };
+    }
+
+    // KAT_GPU_SCENE=<instances> draws a grid of that many cubes through the GPU-driven path
+    if (const char* scene = std::getenv("KAT_GPU_SCENE")) {
+        m_SceneInstances = static_cast<uint32_t>(std::strtoul(scene, nullptr, 10));
+    }
+
+    // KAT_FIXED_RATE=<hz> simulates the camera at that rate and interpolates it, KAT_FIXED_THREADED on its own thread
+    if (const char* rate = std::getenv("KAT_FIXED_RATE")) {
+        m_Configuration.fixed_timestep.rate = std::strtod(rate, nullptr);
+        m_Configuration.fixed_timestep.threaded = std::getenv("KAT_FIXED_THREADED") != nullptr;
+    }
+
+    // KAT_DYNAMIC_RESOLUTION=<ms> scales the rendered resolution to keep GPU frames within that budget
+    if (const char* budget = std::getenv("KAT_DYNAMIC_RESOLUTION")) {
+        m_Configuration.dynamic_resolution.enabled = true;
+        m_Configuration.dynamic_resolution.target_gpu_time = std::strtod(budget, nullptr) / 1000.0;
+    }
+
+    // KAT_CAPTURE=<frames> captures that many frames from KAT_CAPTURE_FIRST (default 1) on, for kat_replay
+    if (const char* frames = std::getenv("KAT_CAPTURE")) {
+        m_Configuration.capture.frame_count = static_cast<uint32_t>(std::strtoul(frames, nullptr, 10));
+        if (const char* first = std::getenv("KAT_CAPTURE_FIRST")) {
+            m_Configuration.capture.first_frame = std::strtoull(first, nullptr, 10);
+        }
+    }
 }
 
 TestApp::~TestApp() {
@@ -14,16 +78,104 @@ TestApp::~TestApp() {
 
 void TestApp::setup() {
     m_Renderer = std::make_shared<kat::Renderer>(m_Engine->getRunningApp());
+
+    if (m_SceneInstances > 0) {
+        m_Scene = std::make_unique<kat::GpuScene>(*m_Engine->getRunningApp());
+
+        std::vector<kat::SceneVertex> vertices;
+        std::vector<uint32_t> indices;
+        buildCube(vertices, indices);
+        const std::array<kat::GpuMeshLod, 1> lods{kat::GpuMeshLod{0, static_cast<uint32_t>(indices.size())}};
+        uint32_t cube = m_Scene->addMesh(vertices, indices, lods);
+
+        auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_SceneInstances))));
+        std::vector<kat::GpuInstance> instances(m_SceneInstances);
+        for (uint32_t i = 0; i < m_SceneInstances; i++) {
+            glm::vec3 position{static_cast<float>(i % side) - side * 0.5f, 0.0f, static_cast<float>(i / side) - side * 0.5f};
+            instances[i].transform = glm::scale(glm::translate(glm::mat4(1.0f), position * 2.0f), glm::vec3(0.8f));
+            instances[i].color = glm::vec4(static_cast<float>(i % side) / side, 0.5f, static_cast<float>(i / side) / side, 1.0f);
+            instances[i].mesh = cube;
+        }
+        m_Scene->addInstances(instances);
+
+        m_Renderer->setScene(m_Scene.get());
+    }
+
+    // KAT_NO_RENDER_THREAD records and presents on the main thread
+    if (!std::getenv("KAT_NO_RENDER_THREAD")) {
+        m_RenderThread = std::make_unique<kat::RenderThread>(*this, *m_Renderer);
+    }
+}
+
+void TestApp::fixedUpdate(double dt) {
+    OrbitSteps& steps = m_Orbit.getWriteBuffer();
+    steps.previous = m_SimulatedOrbit;
+    m_SimulatedOrbit += static_cast<float>(dt) * 0.2f;
+    steps.current = m_SimulatedOrbit;
+    m_Orbit.publish();
 }
 
 void TestApp::update(double dt) {
+    std::optional<kat::SceneView> sceneView;
+    if (m_Scene) {
+        float orbit = static_cast<float>(m_Clock.getUptime().count()) * 0.2f;
+        if (m_Configuration.fixed_timestep.rate > 0.0) {
+            // consecutive steps, however many were published since the last frame
+            m_Orbit.update();
+            const OrbitSteps& steps = m_Orbit.getReadBuffer();
+            orbit = steps.previous + (steps.current - steps.previous) * static_cast<float>(getInterpolationAlpha());
+        }
+        // the swapchain extent belongs to the render thread
+        glm::ivec2 size = glm::max(getFramebufferSize(), glm::ivec2(1));
+
+        kat::SceneView view;
+        glm::vec3 eye{std::cos(orbit) * 30.0f, 15.0f, std::sin(orbit) * 30.0f};
+        view.view = glm::lookAtRH(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        view.projection = glm::perspectiveRH_ZO(glm::radians(60.0f), static_cast<float>(size.x) / static_cast<float>(size.y), 0.1f, 500.0f);
+        // Vulkan clip space points y down
+        view.projection[1][1] *= -1.0f;
+        sceneView = view;
+    }
+
+    if (m_RenderThread) {
+        kat::FramePacket& packet = m_RenderThread->beginPacket();
+        packet.time = m_Clock.getUptime().count();
+        packet.dt = dt;
+        packet.interpolationAlpha = getInterpolationAlpha();
+        packet.view = sceneView;
+        m_RenderThread->submit();
+        return;
+    }
+
+    if (sceneView) {
+        m_Scene->setView(*sceneView);
+    }
     m_Renderer->render();
 }
 
 void TestApp::cleanup() {
+    // already stopped by the app, this just releases it
+    m_RenderThread.reset();
+
+    m_Renderer->getGpuProfiler().forEachScope([](std::string_view name, uint32_t depth, const kat::FrameTimeHistogram& times) {
+        kat::FrameStats stats = times.getStats();
+        spdlog::info("GPU {:>{}}{} (ms): p50 {:.3f}, p95 {:.3f}, p99 {:.3f}, max {:.3f}", "", depth * 2, name, stats.p50 * 1000.0, stats.p95 * 1000.0, stats.p99 * 1000.0, stats.max * 1000.0);
+    });
+
+    if (m_Scene) {
+        m_Scene->cleanup();
+    }
     m_Renderer->cleanup();
 
     spdlog::info("Ran for {} frames, {} seconds; Average FPS: {}", m_Clock.getFrameCount(), m_Clock.getUptime().count(), m_Clock.getAverageFramesPerSecond());
+
+    kat::FrameStats stats = m_Clock.getFrameStats();
+    spdlog::info("Frame times (ms): p50 {:.3f}, p95 {:.3f}, p99 {:.3f}, max {:.3f}; {} hitches", stats.p50 * 1000.0, stats.p95 * 1000.0, stats.p99 * 1000.0, stats.max * 1000.0, stats.hitches);
+
+    const kat::ResolutionController& resolution = m_Clock.getResolutionController();
+    if (resolution.isEnabled()) {
+        spdlog::info("Resolution scale {:.3f} after {} changes; last GPU frame {:.3f} ms", resolution.getScale(), resolution.getChangeCount(), resolution.getGpuTime() * 1000.0);
+    }
 }
 
 
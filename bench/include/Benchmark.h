@@ -0,0 +1,63 @@
+#pragma once
+
+#include <kat/FunctionRef.h>
+#include <cinttypes>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    struct Settings {
+        // untimed runs before the timed ones, to warm caches, pools and the driver
+        uint32_t warmup = 3;
+        uint32_t iterations = 20;
+    };
+
+    // Summary of a scenario's samples, in the scenario's unit.
+    struct Summary {
+        size_t count = 0;
+        double mean = 0.0;
+        double stddev = 0.0;
+        double min = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double max = 0.0;
+    };
+
+    struct ScenarioResult {
+        std::string name;
+        // of every sample, e.g. "ns/job" or "ms/frame"; lower is better for all of them
+        std::string unit;
+        Summary summary;
+    };
+
+    Summary summarize(std::vector<double> samples);
+
+    // Summarizes and logs `samples`.
+    ScenarioResult makeResult(std::string name, std::string unit, std::vector<double> samples);
+
+    // Calls `sample` settings.warmup times and throws the results away, then settings.iterations times; each call
+    // measures one iteration itself and returns it in `unit`.
+    ScenarioResult runScenario(std::string name, std::string unit, const Settings& settings, kat::FunctionRef<double()> sample);
+
+    struct Report {
+        // GPU the scenarios ran on, a baseline from another GPU doesn't compare
+        std::string device;
+        std::vector<ScenarioResult> results;
+    };
+
+    // {"version": 1, "device": "...", "scenarios": [{"name": "...", "unit": "...", "count": n, "mean": x, ...}]}
+    bool writeReport(const std::string& path, const Report& report);
+    std::optional<Report> readReport(const std::string& path);
+
+    struct Regression {
+        std::string name;
+        double baseline;
+        double current;
+    };
+
+    // Scenarios whose median grew by more than `threshold` (0.1 is 10%) over the baseline's. Scenarios missing from
+    // either report are skipped.
+    std::vector<Regression> compare(const Report& baseline, const Report& current, double threshold);
+}
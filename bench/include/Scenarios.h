@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Benchmark.h"
+#include <string>
+#include <string_view>
+
+namespace bench {
+
+    struct ScenarioOptions {
+        Settings settings;
+        // frames rendered per iteration of the frame scenarios
+        uint32_t frames = 100;
+        // draws per frame of the submission scenario
+        uint32_t draws = 10000;
+        // size of the headless swapchain images
+        uint32_t width = 1280;
+        uint32_t height = 720;
+        // only scenarios whose name contains this run
+        std::string filter;
+
+        [[nodiscard]] bool isSelected(std::string_view name) const {
+            return filter.empty() || name.find(filter) != std::string_view::npos;
+        }
+    };
+
+    // Job system and allocator microbenchmarks, no device needed.
+    void runCpuScenarios(const ScenarioOptions& options, Report& report);
+    // Frame throughput and draw submission through Renderer::render(), plus the device allocator, in a headless app.
+    // Sets the report's device.
+    void runRenderScenarios(const ScenarioOptions& options, Report& report);
+    // Engine and app startup up to the first frame, a fresh engine per iteration.
+    void runStartupScenarios(const ScenarioOptions& options, Report& report);
+}
@@ -0,0 +1,13 @@
+#version 460
+
+// One small triangle per draw, placed on a 64x64 grid by the draw's first instance.
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    const vec2 corners[3] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0));
+    uint cell = uint(gl_InstanceIndex) % 4096u;
+    vec2 origin = vec2(float(cell % 64u), float(cell / 64u)) / 32.0 - 1.0;
+    gl_Position = vec4(origin + corners[gl_VertexIndex] / 32.0, 0.0, 1.0);
+    outColor = vec4(origin * 0.5 + 0.5, 0.5, 1.0);
+}
@@ -0,0 +1,153 @@
+#include "Scenarios.h"
+
+#include <spdlog/spdlog.h>
+#include <charconv>
+#include <exception>
+#include <optional>
+#include <string_view>
+
+// Runs the engine's benchmark scenarios, writes their results as JSON and, given a baseline report, fails when a
+// scenario got slower than the threshold allows. Exits with 2 on regressions and 1 on bad options or errors.
+
+namespace {
+
+    struct Options {
+        bench::ScenarioOptions scenarios;
+        std::string output = "kat_bench.json";
+        std::string baseline;
+        // percent the median of a scenario may grow over the baseline's
+        double threshold = 10.0;
+    };
+
+    void printUsage() {
+        spdlog::info("usage: kat_bench [options]");
+        spdlog::info("  --warmup <n>        untimed iterations per scenario (default 3)");
+        spdlog::info("  --iterations <n>    timed iterations per scenario (default 20)");
+        spdlog::info("  --frames <n>        frames per iteration of the frame scenarios (default 100)");
+        spdlog::info("  --draws <n>         draws per frame of the submission scenario (default 10000)");
+        spdlog::info("  --width <n>         headless image width (default 1280)");
+        spdlog::info("  --height <n>        headless image height (default 720)");
+        spdlog::info("  --filter <text>     only run scenarios whose name contains text");
+        spdlog::info("  --output <path>     report to write (default kat_bench.json)");
+        spdlog::info("  --baseline <path>   report to compare against");
+        spdlog::info("  --threshold <pct>   allowed slowdown over the baseline median (default 10)");
+    }
+
+    template<typename T>
+    std::optional<T> parseNumber(std::string_view text) {
+        T value{};
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::optional<Options> parseOptions(int argc, char** argv) {
+        Options options;
+        bench::ScenarioOptions& scenarios = options.scenarios;
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                return std::nullopt;
+            }
+            if (i + 1 >= argc) {
+                spdlog::error("Unknown option {}", arg);
+                return std::nullopt;
+            }
+            std::string_view value = argv[++i];
+
+            uint32_t* number = nullptr;
+            if (arg == "--warmup") {
+                number = &scenarios.settings.warmup;
+            } else if (arg == "--iterations") {
+                number = &scenarios.settings.iterations;
+            } else if (arg == "--frames") {
+                number = &scenarios.frames;
+            } else if (arg == "--draws") {
+                number = &scenarios.draws;
+            } else if (arg == "--width") {
+                number = &scenarios.width;
+            } else if (arg == "--height") {
+                number = &scenarios.height;
+            }
+
+            if (number) {
+                std::optional<uint32_t> parsed = parseNumber<uint32_t>(value);
+                // only the warmup may be zero
+                if (!parsed || (*parsed == 0 && arg != "--warmup")) {
+                    spdlog::error("{} expects a positive number, got {}", arg, value);
+                    return std::nullopt;
+                }
+                *number = *parsed;
+            } else if (arg == "--filter") {
+                scenarios.filter = value;
+            } else if (arg == "--output") {
+                options.output = value;
+            } else if (arg == "--baseline") {
+                options.baseline = value;
+            } else if (arg == "--threshold") {
+                std::optional<double> parsed = parseNumber<double>(value);
+                if (!parsed || *parsed < 0.0) {
+                    spdlog::error("--threshold expects a percentage, got {}", value);
+                    return std::nullopt;
+                }
+                options.threshold = *parsed;
+            } else {
+                spdlog::error("Unknown option {}", arg);
+                return std::nullopt;
+            }
+        }
+        return options;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::optional<Options> options = parseOptions(argc, argv);
+    if (!options) {
+        printUsage();
+        return 1;
+    }
+
+    // read first, a missing baseline shouldn't cost a whole run
+    std::optional<bench::Report> baseline;
+    if (!options->baseline.empty()) {
+        baseline = bench::readReport(options->baseline);
+        if (!baseline) {
+            return 1;
+        }
+    }
+
+    bench::Report report;
+    try {
+        bench::runCpuScenarios(options->scenarios, report);
+        bench::runRenderScenarios(options->scenarios, report);
+        bench::runStartupScenarios(options->scenarios, report);
+    } catch (const std::exception& e) {
+        spdlog::error("Benchmark failed: {}", e.what());
+        return 1;
+    }
+
+    if (!bench::writeReport(options->output, report)) {
+        return 1;
+    }
+    spdlog::info("Wrote {} scenarios to {}", report.results.size(), options->output);
+
+    if (!baseline) {
+        return 0;
+    }
+    if (baseline->device != report.device) {
+        spdlog::warn("Baseline ran on {}, this run on {}; the comparison may not mean much", baseline->device, report.device);
+    }
+
+    std::vector<bench::Regression> regressions = bench::compare(*baseline, report, options->threshold / 100.0);
+    for (const bench::Regression& regression : regressions) {
+        spdlog::error("{} regressed: median {:.3f} -> {:.3f} ({:+.1f}%)", regression.name, regression.baseline,
+                      regression.current, (regression.current / regression.baseline - 1.0) * 100.0);
+    }
+    if (!regressions.empty()) {
+        return 2;
+    }
+    spdlog::info("No regressions over {}% against {}", options->threshold, options->baseline);
+    return 0;
+}
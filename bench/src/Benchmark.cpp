@@ -0,0 +1,348 @@
+#include "Benchmark.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+namespace bench {
+
+    namespace {
+        constexpr int kReportVersion = 1;
+
+        std::string escape(std::string_view text) {
+            std::string out;
+            for (char c : text) {
+                if (c == '"' || c == '\\') {
+                    out += '\\';
+                    out += c;
+                } else if (static_cast<unsigned char>(c) < 0x20) {
+                    out += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+                } else {
+                    out += c;
+                }
+            }
+            return out;
+        }
+
+        // Just enough JSON for reading reports back: objects, arrays, strings (no \u escapes beyond ASCII),
+        // numbers, booleans and null.
+        struct JsonValue {
+            enum class Type { eNull, eBool, eNumber, eString, eArray, eObject };
+
+            Type type = Type::eNull;
+            double number = 0.0;
+            std::string string;
+            // array items, or object values in the order of `keys`
+            std::vector<JsonValue> items;
+            std::vector<std::string> keys;
+
+            [[nodiscard]] const JsonValue* find(std::string_view key) const {
+                for (size_t i = 0; i < keys.size(); i++) {
+                    if (keys[i] == key) {
+                        return &items[i];
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        class JsonParser {
+        public:
+            explicit JsonParser(std::string_view text) : m_Text(text) {}
+
+            std::optional<JsonValue> parse() {
+                JsonValue value;
+                if (!parseValue(value)) {
+                    return std::nullopt;
+                }
+                skipSpace();
+                if (m_Position != m_Text.size()) {
+                    return std::nullopt;
+                }
+                return value;
+            }
+
+        private:
+            void skipSpace() {
+                while (m_Position < m_Text.size() && std::isspace(static_cast<unsigned char>(m_Text[m_Position]))) {
+                    m_Position++;
+                }
+            }
+
+            bool consume(char c) {
+                skipSpace();
+                if (m_Position < m_Text.size() && m_Text[m_Position] == c) {
+                    m_Position++;
+                    return true;
+                }
+                return false;
+            }
+
+            bool consumeWord(std::string_view word) {
+                if (m_Text.substr(m_Position, word.size()) != word) {
+                    return false;
+                }
+                m_Position += word.size();
+                return true;
+            }
+
+            bool parseValue(JsonValue& value) {
+                skipSpace();
+                if (m_Position >= m_Text.size()) {
+                    return false;
+                }
+                char c = m_Text[m_Position];
+                if (c == '{') {
+                    return parseObject(value);
+                }
+                if (c == '[') {
+                    return parseArray(value);
+                }
+                if (c == '"') {
+                    value.type = JsonValue::Type::eString;
+                    return parseString(value.string);
+                }
+                if (consumeWord("true") || consumeWord("false")) {
+                    value.type = JsonValue::Type::eBool;
+                    value.number = c == 't' ? 1.0 : 0.0;
+                    return true;
+                }
+                if (consumeWord("null")) {
+                    value.type = JsonValue::Type::eNull;
+                    return true;
+                }
+                return parseNumber(value);
+            }
+
+            bool parseObject(JsonValue& value) {
+                value.type = JsonValue::Type::eObject;
+                m_Position++;
+                if (consume('}')) {
+                    return true;
+                }
+                do {
+                    skipSpace();
+                    std::string key;
+                    if (!parseString(key) || !consume(':')) {
+                        return false;
+                    }
+                    value.keys.push_back(std::move(key));
+                    if (!parseValue(value.items.emplace_back())) {
+                        return false;
+                    }
+                } while (consume(','));
+                return consume('}');
+            }
+
+            bool parseArray(JsonValue& value) {
+                value.type = JsonValue::Type::eArray;
+                m_Position++;
+                if (consume(']')) {
+                    return true;
+                }
+                do {
+                    if (!parseValue(value.items.emplace_back())) {
+                        return false;
+                    }
+                } while (consume(','));
+                return consume(']');
+            }
+
+            bool parseString(std::string& out) {
+                if (m_Position >= m_Text.size() || m_Text[m_Position] != '"') {
+                    return false;
+                }
+                m_Position++;
+                while (m_Position < m_Text.size()) {
+                    char c = m_Text[m_Position++];
+                    if (c == '"') {
+                        return true;
+                    }
+                    if (c != '\\') {
+                        out += c;
+                        continue;
+                    }
+                    if (m_Position >= m_Text.size()) {
+                        return false;
+                    }
+                    char escaped = m_Text[m_Position++];
+                    switch (escaped) {
+                        case 'n': out += '\n'; break;
+                        case 't': out += '\t'; break;
+                        case 'r': out += '\r'; break;
+                        case 'b': out += '\b'; break;
+                        case 'f': out += '\f'; break;
+                        case 'u': {
+                            if (m_Position + 4 > m_Text.size()) {
+                                return false;
+                            }
+                            unsigned code = 0;
+                            auto [end, error] = std::from_chars(m_Text.data() + m_Position, m_Text.data() + m_Position + 4, code, 16);
+                            if (error != std::errc() || end != m_Text.data() + m_Position + 4) {
+                                return false;
+                            }
+                            m_Position += 4;
+                            out += code < 0x80 ? static_cast<char>(code) : '?';
+                            break;
+                        }
+                        default: out += escaped; break;
+                    }
+                }
+                return false;
+            }
+
+            bool parseNumber(JsonValue& value) {
+                size_t end = m_Position;
+                while (end < m_Text.size() && (std::isdigit(static_cast<unsigned char>(m_Text[end])) || std::string_view("+-.eE").find(m_Text[end]) != std::string_view::npos)) {
+                    end++;
+                }
+                if (end == m_Position) {
+                    return false;
+                }
+                auto [last, error] = std::from_chars(m_Text.data() + m_Position, m_Text.data() + end, value.number);
+                if (error != std::errc() || last != m_Text.data() + end) {
+                    return false;
+                }
+                value.type = JsonValue::Type::eNumber;
+                m_Position = end;
+                return true;
+            }
+
+            std::string_view m_Text;
+            size_t m_Position = 0;
+        };
+
+        double getNumber(const JsonValue& object, std::string_view key) {
+            const JsonValue* value = object.find(key);
+            return value && value->type == JsonValue::Type::eNumber ? value->number : 0.0;
+        }
+
+        std::string getString(const JsonValue& object, std::string_view key) {
+            const JsonValue* value = object.find(key);
+            return value && value->type == JsonValue::Type::eString ? value->string : std::string();
+        }
+    }
+
+    Summary summarize(std::vector<double> samples) {
+        Summary summary{};
+        if (samples.empty()) {
+            return summary;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        auto percentile = [&](double p) {
+            size_t idx = static_cast<size_t>(std::ceil(p * static_cast<double>(samples.size())));
+            return samples[std::clamp<size_t>(idx, 1, samples.size()) - 1];
+        };
+
+        summary.count = samples.size();
+        summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+        double variance = 0.0;
+        for (double sample : samples) {
+            variance += (sample - summary.mean) * (sample - summary.mean);
+        }
+        summary.stddev = samples.size() > 1 ? std::sqrt(variance / static_cast<double>(samples.size() - 1)) : 0.0;
+        summary.min = samples.front();
+        summary.p50 = percentile(0.50);
+        summary.p95 = percentile(0.95);
+        summary.max = samples.back();
+        return summary;
+    }
+
+    ScenarioResult runScenario(std::string name, std::string unit, const Settings &settings, kat::FunctionRef<double()> sample) {
+        for (uint32_t i = 0; i < settings.warmup; i++) {
+            sample();
+        }
+
+        std::vector<double> samples(std::max(settings.iterations, 1U));
+        for (double& value : samples) {
+            value = sample();
+        }
+        return makeResult(std::move(name), std::move(unit), std::move(samples));
+    }
+
+    ScenarioResult makeResult(std::string name, std::string unit, std::vector<double> samples) {
+        ScenarioResult result{std::move(name), std::move(unit), summarize(std::move(samples))};
+        const Summary& s = result.summary;
+        spdlog::info("{:<28} {:>10.3f} {:<9} (mean {:.3f}, sd {:.3f}, min {:.3f}, p95 {:.3f}, max {:.3f}, n {})",
+                     result.name, s.p50, result.unit, s.mean, s.stddev, s.min, s.p95, s.max, s.count);
+        return result;
+    }
+
+    bool writeReport(const std::string &path, const Report &report) {
+        std::ofstream out{std::filesystem::path(path), std::ios::trunc};
+        out << fmt::format("{{\n  \"version\": {},\n  \"device\": \"{}\",\n  \"scenarios\": [", kReportVersion, escape(report.device));
+        for (size_t i = 0; i < report.results.size(); i++) {
+            const ScenarioResult& result = report.results[i];
+            const Summary& s = result.summary;
+            out << fmt::format("{}\n    {{\"name\": \"{}\", \"unit\": \"{}\", \"count\": {}, \"mean\": {}, \"stddev\": {}, \"min\": {}, \"p50\": {}, \"p95\": {}, \"max\": {}}}",
+                               i == 0 ? "" : ",", escape(result.name), escape(result.unit), s.count, s.mean, s.stddev, s.min, s.p50, s.p95, s.max);
+        }
+        out << "\n  ]\n}\n";
+        out.close();
+        if (!out) {
+            spdlog::error("Failed to write {}", path);
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<Report> readReport(const std::string &path) {
+        std::ifstream in{std::filesystem::path(path)};
+        if (!in) {
+            spdlog::error("Failed to open {}", path);
+            return std::nullopt;
+        }
+        std::stringstream text;
+        text << in.rdbuf();
+
+        std::optional<JsonValue> root = JsonParser(text.str()).parse();
+        const JsonValue* scenarios = root ? root->find("scenarios") : nullptr;
+        if (!scenarios || scenarios->type != JsonValue::Type::eArray) {
+            spdlog::error("{} is not a benchmark report", path);
+            return std::nullopt;
+        }
+        if (int version = static_cast<int>(getNumber(*root, "version")); version != kReportVersion) {
+            spdlog::error("{} is a version {} report, expected version {}", path, version, kReportVersion);
+            return std::nullopt;
+        }
+
+        Report report;
+        report.device = getString(*root, "device");
+        for (const JsonValue& scenario : scenarios->items) {
+            ScenarioResult& result = report.results.emplace_back();
+            result.name = getString(scenario, "name");
+            result.unit = getString(scenario, "unit");
+            result.summary.count = static_cast<size_t>(getNumber(scenario, "count"));
+            result.summary.mean = getNumber(scenario, "mean");
+            result.summary.stddev = getNumber(scenario, "stddev");
+            result.summary.min = getNumber(scenario, "min");
+            result.summary.p50 = getNumber(scenario, "p50");
+            result.summary.p95 = getNumber(scenario, "p95");
+            result.summary.max = getNumber(scenario, "max");
+        }
+        return report;
+    }
+
+    std::vector<Regression> compare(const Report &baseline, const Report &current, double threshold) {
+        std::vector<Regression> regressions;
+        for (const ScenarioResult& result : current.results) {
+            auto previous = std::find_if(baseline.results.begin(), baseline.results.end(), [&](const ScenarioResult& r) {
+                return r.name == result.name && r.unit == result.unit;
+            });
+            if (previous == baseline.results.end()) {
+                continue;
+            }
+            if (result.summary.p50 > previous->summary.p50 * (1.0 + threshold)) {
+                regressions.push_back(Regression{result.name, previous->summary.p50, result.summary.p50});
+            }
+        }
+        return regressions;
+    }
+}
@@ -0,0 +1,105 @@
+#include "Scenarios.h"
+
+#include <kat/FrameArena.h>
+#include <kat/GpuAllocator.h>
+#include <kat/JobSystem.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace bench {
+
+    namespace {
+        using clock = std::chrono::steady_clock;
+
+        constexpr size_t kJobCount = 1024;
+        constexpr size_t kParallelForItems = 1 << 20;
+        constexpr size_t kArenaAllocations = 16 * 1024;
+        constexpr size_t kTlsfAllocations = 4096;
+
+        double getNanoseconds(clock::time_point start) {
+            return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        }
+
+        void countJob(void* data, size_t, size_t) {
+            static_cast<std::atomic<uint32_t>*>(data)->fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void runCpuScenarios(const ScenarioOptions &options, Report &report) {
+        kat::JobSystem jobs;
+
+        if (options.isSelected("jobs/schedule_wait")) {
+            std::atomic<uint32_t> ran{0};
+            report.results.push_back(runScenario("jobs/schedule_wait", "ns/job", options.settings, [&] {
+                kat::JobCounter counter;
+                auto start = clock::now();
+                for (size_t i = 0; i < kJobCount; i++) {
+                    jobs.schedule(kat::Job{&countJob, &ran, 0, 0, &counter});
+                }
+                jobs.wait(counter);
+                return getNanoseconds(start) / kJobCount;
+            }));
+        }
+
+        if (options.isSelected("jobs/parallel_for")) {
+            std::vector<float> values(kParallelForItems);
+            report.results.push_back(runScenario("jobs/parallel_for", "ns/item", options.settings, [&] {
+                auto start = clock::now();
+                jobs.parallelFor(0, values.size(), 4096, [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; i++) {
+                        values[i] = std::sqrt(static_cast<float>(i));
+                    }
+                });
+                return getNanoseconds(start) / static_cast<double>(values.size());
+            }));
+        }
+
+        // the same sizes and order every run
+        std::mt19937 random(1234);
+
+        if (options.isSelected("allocator/linear_arena")) {
+            std::uniform_int_distribution<size_t> size(16, 256);
+            std::vector<size_t> sizes(kArenaAllocations);
+            std::generate(sizes.begin(), sizes.end(), [&] { return size(random); });
+
+            kat::LinearArena arena;
+            report.results.push_back(runScenario("allocator/linear_arena", "ns/alloc", options.settings, [&] {
+                auto start = clock::now();
+                for (size_t bytes : sizes) {
+                    arena.allocate(bytes);
+                }
+                arena.reset();
+                return getNanoseconds(start) / static_cast<double>(sizes.size());
+            }));
+        }
+
+        if (options.isSelected("allocator/tlsf")) {
+            // sizes spread over several orders of magnitude, as device allocations are, freed in random order
+            std::uniform_real_distribution<double> exponent(8.0, 20.0);
+            std::vector<uint64_t> sizes(kTlsfAllocations);
+            std::generate(sizes.begin(), sizes.end(), [&] { return static_cast<uint64_t>(std::exp2(exponent(random))); });
+            std::vector<size_t> order(kTlsfAllocations);
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            std::shuffle(order.begin(), order.end(), random);
+
+            kat::TlsfAllocator tlsf(uint64_t{8} * 1024 * 1024 * 1024);
+            std::vector<uint32_t> nodes(kTlsfAllocations);
+            report.results.push_back(runScenario("allocator/tlsf", "ns/alloc+free", options.settings, [&] {
+                auto start = clock::now();
+                for (size_t i = 0; i < sizes.size(); i++) {
+                    nodes[i] = tlsf.allocate(sizes[i], 256)->node;
+                }
+                for (size_t i : order) {
+                    tlsf.free(nodes[i]);
+                }
+                return getNanoseconds(start) / static_cast<double>(sizes.size());
+            }));
+        }
+    }
+}
@@ -0,0 +1,275 @@
+#include "Scenarios.h"
+
+#include <kat/BindlessRegistry.h>
+#include <kat/Engine.h>
+#include <kat/GpuAllocator.h>
+#include <kat/PipelineCache.h>
+#include <kat/Renderer.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace bench {
+
+    namespace {
+        using clock = std::chrono::steady_clock;
+
+        // SPIR-V compiled from bench/shaders at build time
+        constexpr uint32_t kDrawVertexShader[] = {
+#include "draw.vert.inc"
+        };
+        constexpr uint32_t kDrawFragmentShader[] = {
+#include "draw.frag.inc"
+        };
+
+        constexpr size_t kDeviceAllocations = 1024;
+
+        double getMilliseconds(clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        }
+
+        // Headless app that hands itself to `run` on its first update() and stops right after, so scenarios get a
+        // device, offscreen swapchain images and a Renderer.
+        class BenchApp : public kat::App {
+        public:
+            using Run = std::function<void(BenchApp& app)>;
+
+            BenchApp(const ScenarioOptions& options, Run run) : m_Run(std::move(run)) {
+                m_Configuration.app_name = "kat_bench";
+                m_Configuration.window_mode = kat::HeadlessWindowMode{
+                    .size = {static_cast<int>(options.width), static_cast<int>(options.height)}
+                };
+                // every run compiles its pipelines from scratch, so startup times don't depend on earlier runs
+                m_Configuration.pipeline_cache_path.clear();
+            }
+
+            kat::Renderer& getRenderer() {
+                return *m_Renderer;
+            }
+
+        private:
+            void setup() override {
+                m_Renderer = std::make_shared<kat::Renderer>(m_Engine->getRunningApp());
+            }
+
+            void update(double dt) override {
+                if (m_Run) {
+                    Run run = std::move(m_Run);
+                    m_Run = nullptr;
+                    run(*this);
+                }
+                stop();
+            }
+
+            void cleanup() override {
+                m_Renderer->cleanup();
+            }
+
+            Run m_Run;
+            std::shared_ptr<kat::Renderer> m_Renderer;
+        };
+
+        vk::ShaderModule createShaderModule(vk::Device device, std::span<const uint32_t> code) {
+            return device.createShaderModule(vk::ShaderModuleCreateInfo{vk::ShaderModuleCreateFlags(), code.size_bytes(), code.data()});
+        }
+
+        // no vertex input, no depth, for the main pass
+        vk::Pipeline createDrawPipeline(kat::App& app, vk::RenderPass renderPass) {
+            vk::Device device = app.getDevice();
+            vk::ShaderModule vertexModule = createShaderModule(device, kDrawVertexShader);
+            vk::ShaderModule fragmentModule = createShaderModule(device, kDrawFragmentShader);
+            std::array<vk::PipelineShaderStageCreateInfo, 2> stages{
+                vk::PipelineShaderStageCreateInfo{vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, vertexModule, "main"},
+                vk::PipelineShaderStageCreateInfo{vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, fragmentModule, "main"}
+            };
+
+            vk::PipelineVertexInputStateCreateInfo vertexInput{};
+            vk::PipelineInputAssemblyStateCreateInfo inputAssembly{vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList};
+            vk::PipelineViewportStateCreateInfo viewport{vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr};
+
+            vk::PipelineRasterizationStateCreateInfo rasterization{};
+            rasterization.polygonMode = vk::PolygonMode::eFill;
+            rasterization.cullMode = vk::CullModeFlagBits::eNone;
+            rasterization.lineWidth = 1.0f;
+
+            vk::PipelineMultisampleStateCreateInfo multisample{vk::PipelineMultisampleStateCreateFlags(), vk::SampleCountFlagBits::e1};
+
+            vk::PipelineColorBlendAttachmentState blendAttachment{};
+            blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+                | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+            vk::PipelineColorBlendStateCreateInfo colorBlend{vk::PipelineColorBlendStateCreateFlags(), false, vk::LogicOp::eCopy, blendAttachment};
+
+            std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+            vk::PipelineDynamicStateCreateInfo dynamic{vk::PipelineDynamicStateCreateFlags(), dynamicStates};
+
+            vk::GraphicsPipelineCreateInfo createInfo{};
+            createInfo.setStages(stages);
+            createInfo.setPVertexInputState(&vertexInput);
+            createInfo.setPInputAssemblyState(&inputAssembly);
+            createInfo.setPViewportState(&viewport);
+            createInfo.setPRasterizationState(&rasterization);
+            createInfo.setPMultisampleState(&multisample);
+            createInfo.setPColorBlendState(&colorBlend);
+            createInfo.setPDynamicState(&dynamic);
+            createInfo.setLayout(app.getBindlessRegistry().getPipelineLayout());
+            createInfo.setRenderPass(renderPass);
+
+            vk::Pipeline pipeline = app.getPipelineCache().createGraphicsPipeline(createInfo);
+
+            device.destroyShaderModule(vertexModule);
+            device.destroyShaderModule(fragmentModule);
+            return pipeline;
+        }
+
+        // average time per frame of `frames` calls to `frame`, which keeps frames in flight as the app would
+        template<typename Frame>
+        double timeFrames(uint32_t frames, Frame&& frame) {
+            auto start = clock::now();
+            for (uint32_t i = 0; i < frames; i++) {
+                frame();
+            }
+            return getMilliseconds(start) / frames;
+        }
+
+        void runFrameScenarios(const ScenarioOptions& options, BenchApp& app, Report& report) {
+            kat::Renderer& renderer = app.getRenderer();
+            const uint32_t frames = std::max(options.frames, 1U);
+
+            if (options.isSelected("render/empty_frame")) {
+                // GPU time of the frames read back during each timed iteration, averaged
+                std::vector<double> gpuTimes;
+                uint32_t iteration = 0;
+                report.results.push_back(runScenario("render/empty_frame", "ms/frame", options.settings, [&] {
+                    double gpuTime = 0.0;
+                    uint32_t gpuFrames = 0;
+                    double time = timeFrames(frames, [&] {
+                        renderer.render();
+                        if (std::optional<double> collected = renderer.getGpuProfiler().getCollectedFrameTime()) {
+                            gpuTime += *collected;
+                            gpuFrames++;
+                        }
+                    });
+                    if (iteration++ >= options.settings.warmup && gpuFrames > 0) {
+                        gpuTimes.push_back(gpuTime * 1000.0 / gpuFrames);
+                    }
+                    return time;
+                }));
+                if (!gpuTimes.empty()) {
+                    report.results.push_back(makeResult("render/empty_frame_gpu", "ms/frame", std::move(gpuTimes)));
+                }
+            }
+
+            std::string drawsName = fmt::format("render/draws_{}", options.draws);
+            if (options.isSelected(drawsName)) {
+                vk::Pipeline pipeline = createDrawPipeline(app, renderer.getRenderPass());
+                auto record = [&](const kat::RecordContext& chunk) {
+                    vk::Extent2D extent = renderer.getRenderExtent();
+                    chunk.commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+                    chunk.commandBuffer.setViewport(0, vk::Viewport{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f});
+                    chunk.commandBuffer.setScissor(0, vk::Rect2D{vk::Offset2D{0, 0}, extent});
+                    for (size_t i = chunk.begin; i < chunk.end; i++) {
+                        chunk.commandBuffer.draw(3, 1, 0, static_cast<uint32_t>(i));
+                    }
+                };
+
+                report.results.push_back(runScenario(drawsName, "ms/frame", options.settings, [&] {
+                    return timeFrames(frames, [&] {
+                        renderer.render(options.draws, record);
+                    });
+                }));
+
+                app.getDevice().waitIdle();
+                app.getDevice().destroyPipeline(pipeline);
+            }
+        }
+
+        void runDeviceAllocatorScenario(const ScenarioOptions& options, BenchApp& app, Report& report) {
+            if (!options.isSelected("allocator/device")) {
+                return;
+            }
+
+            // the memory types a storage buffer may use
+            vk::Device device = app.getDevice();
+            vk::Buffer probe = device.createBuffer(vk::BufferCreateInfo{
+                vk::BufferCreateFlags(), 64 * 1024, vk::BufferUsageFlagBits::eStorageBuffer, vk::SharingMode::eExclusive
+            });
+            vk::MemoryRequirements probeRequirements = device.getBufferMemoryRequirements(probe);
+            device.destroyBuffer(probe);
+
+            std::mt19937 random(1234);
+            std::uniform_int_distribution<vk::DeviceSize> pages(1, 64);
+            std::vector<vk::MemoryRequirements> requirements(kDeviceAllocations);
+            for (vk::MemoryRequirements& r : requirements) {
+                r = vk::MemoryRequirements{pages(random) * 4096, probeRequirements.alignment, probeRequirements.memoryTypeBits};
+            }
+            std::vector<size_t> order(kDeviceAllocations);
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            std::shuffle(order.begin(), order.end(), random);
+
+            kat::DeviceAllocator& allocator = app.getDeviceAllocator();
+            std::vector<kat::GpuAllocation*> allocations(kDeviceAllocations);
+            report.results.push_back(runScenario("allocator/device", "ns/alloc+free", options.settings, [&] {
+                auto start = clock::now();
+                for (size_t i = 0; i < requirements.size(); i++) {
+                    allocations[i] = allocator.allocate(requirements[i], kat::ResourceKind::eLinear);
+                }
+                for (size_t i : order) {
+                    allocator.free(allocations[i]);
+                }
+                return getMilliseconds(start) * 1e6 / static_cast<double>(requirements.size());
+            }));
+        }
+    }
+
+    void runRenderScenarios(const ScenarioOptions &options, Report &report) {
+        auto app = std::make_shared<BenchApp>(options, [&](BenchApp& app) {
+            report.device = app.getEngine()->getGpuProperties().deviceName.data();
+            spdlog::info("Rendering {}x{} headless on {}", options.width, options.height, report.device);
+            runFrameScenarios(options, app, report);
+            runDeviceAllocatorScenario(options, app, report);
+        });
+
+        kat::Engine engine;
+        engine.runApp(app);
+    }
+
+    void runStartupScenarios(const ScenarioOptions &options, Report &report) {
+        if (!options.isSelected("startup/first_frame") && !options.isSelected("startup/timeline")) {
+            return;
+        }
+
+        // the engine's own account of its startup, from its timeline, alongside the wall time to the first frame
+        std::vector<double> timelineTotals;
+        uint32_t iteration = 0;
+        ScenarioResult firstFrame = runScenario("startup/first_frame", "ms", options.settings, [&] {
+            double time = 0.0;
+            auto start = clock::now();
+
+            kat::Engine engine;
+            engine.runApp(std::make_shared<BenchApp>(options, [&](BenchApp& app) {
+                app.getRenderer().render();
+                app.getDevice().waitIdle();
+                time = getMilliseconds(start);
+            }));
+
+            if (iteration++ >= options.settings.warmup) {
+                timelineTotals.push_back(engine.getStartupTimeline().getTotal() * 1000.0);
+            }
+            return time;
+        });
+
+        if (options.isSelected("startup/first_frame")) {
+            report.results.push_back(std::move(firstFrame));
+        }
+        if (options.isSelected("startup/timeline")) {
+            report.results.push_back(makeResult("startup/timeline", "ms", std::move(timelineTotals)));
+        }
+    }
+}
@@ -0,0 +1,371 @@
+#include "Benchmark.h"
+
+#include <kat/Engine.h>
+#include <kat/FrameCapture.h>
+#include <kat/GpuScene.h>
+#include <kat/Renderer.h>
+#include <kat/UploadService.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Re-executes a frame capture (AppConfig::capture) headless on whatever GPU this runs on and times every pass of it.
+// The GPU scenes, their updates and the uploads are replayed as they were captured; the app's own draw list is
+// recorded by app code and can't be, so it's only reported. Pipeline state isn't captured either: the engine's
+// passes build their pipelines from this build's shaders, so the replay fails when the passes it runs aren't the
+// captured ones and warns when their extents differ. Writes the timings as a kat_bench report, which --baseline
+// compares like kat_bench does: exits with 2 on regressions and 1 on bad options or errors.
+
+namespace {
+
+    struct Options {
+        std::string capture;
+        // times the captured frames are replayed; the first time warms up and isn't timed
+        uint32_t loops = 10;
+        std::string output;
+        std::string baseline;
+        double threshold = 10.0;
+    };
+
+    void printUsage() {
+        spdlog::info("usage: kat_replay <capture> [options]");
+        spdlog::info("  --loops <n>         times the captured frames are replayed (default 10)");
+        spdlog::info("  --output <path>     report to write");
+        spdlog::info("  --baseline <path>   report to compare against");
+        spdlog::info("  --threshold <pct>   allowed slowdown over the baseline median (default 10)");
+    }
+
+    template<typename T>
+    std::optional<T> parseNumber(std::string_view text) {
+        T value{};
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::optional<Options> parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            if (!arg.starts_with("--")) {
+                if (!options.capture.empty()) {
+                    spdlog::error("Only one capture can be replayed at a time");
+                    return std::nullopt;
+                }
+                options.capture = arg;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                spdlog::error("Unknown option {}", arg);
+                return std::nullopt;
+            }
+            std::string_view value = argv[++i];
+
+            if (arg == "--loops") {
+                std::optional<uint32_t> parsed = parseNumber<uint32_t>(value);
+                if (!parsed || *parsed == 0) {
+                    spdlog::error("--loops expects a positive number, got {}", value);
+                    return std::nullopt;
+                }
+                options.loops = *parsed;
+            } else if (arg == "--output") {
+                options.output = value;
+            } else if (arg == "--baseline") {
+                options.baseline = value;
+            } else if (arg == "--threshold") {
+                std::optional<double> parsed = parseNumber<double>(value);
+                if (!parsed || *parsed < 0.0) {
+                    spdlog::error("--threshold expects a percentage, got {}", value);
+                    return std::nullopt;
+                }
+                options.threshold = *parsed;
+            } else {
+                spdlog::error("Unknown option {}", arg);
+                return std::nullopt;
+            }
+        }
+        if (options.capture.empty()) {
+            spdlog::error("No capture given");
+            return std::nullopt;
+        }
+        return options;
+    }
+
+    // Replays the capture from its first update() and stops right after.
+    class ReplayApp : public kat::App {
+    public:
+        ReplayApp(const kat::CaptureFile& capture, uint32_t loops, bench::Report& report)
+            : m_Capture(capture), m_Loops(loops), m_Report(report) {
+            const kat::CaptureHeader& header = capture.header;
+            m_Configuration.app_name = "kat_replay";
+            m_Configuration.window_mode = kat::HeadlessWindowMode{
+                .size = {static_cast<int>(header.extent.width), static_cast<int>(header.extent.height)}
+            };
+            m_Configuration.pipeline_cache_path.clear();
+            // frames are held at their captured scales, so the controller's own settings don't matter beyond these
+            if (header.maxScale > 0.0f) {
+                m_Configuration.dynamic_resolution.enabled = true;
+                m_Configuration.dynamic_resolution.min_scale = kat::ResolutionController::kMinScale;
+                m_Configuration.dynamic_resolution.max_scale = header.maxScale;
+            }
+        }
+
+    private:
+        void setup() override {
+            m_Renderer = std::make_shared<kat::Renderer>(m_Engine->getRunningApp());
+
+            // every captured upload goes into one scratch buffer, moving the same amount of data
+            uint64_t largestUpload = 0;
+            for (const kat::CapturedFrame& frame : m_Capture.frames) {
+                for (const kat::CapturedCommand& command : frame.commands) {
+                    if (const auto* upload = std::get_if<kat::CapturedUpload>(&command)) {
+                        largestUpload = std::max(largestUpload, upload->size);
+                    }
+                }
+            }
+            if (largestUpload > 0) {
+                m_Scratch = getDeviceAllocator().createBuffer(vk::BufferCreateInfo{
+                    vk::BufferCreateFlags(), largestUpload, vk::BufferUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive
+                });
+                m_ScratchData.resize(largestUpload);
+            }
+        }
+
+        void update(double dt) override {
+            if (!m_Replayed) {
+                m_Replayed = true;
+                replay();
+            }
+            stop();
+        }
+
+        void cleanup() override {
+            m_Renderer->cleanup();
+            for (std::unique_ptr<kat::GpuScene>& scene : m_Scenes) {
+                if (scene) {
+                    scene->cleanup();
+                }
+            }
+            if (m_Scratch.buffer) {
+                getDeviceAllocator().destroyBuffer(m_Scratch);
+            }
+        }
+
+        void replay() {
+            const kat::CaptureHeader& header = m_Capture.header;
+            std::string device = getEngine()->getGpuProperties().deviceName.data();
+            m_Report.device = device;
+            spdlog::info("Replaying {} frames captured on {} at {}x{}, {} times on {}", m_Capture.frames.size(), header.device,
+                         header.extent.width, header.extent.height, m_Loops, device);
+            if (header.format != getSwapchainFormat()) {
+                spdlog::info("Captured frames went to {} images, replayed ones go to {}", vk::to_string(header.format), vk::to_string(getSwapchainFormat()));
+            }
+
+            kat::ResolutionController& resolution = getClock().getResolutionController();
+            std::vector<double> cpuTimes;
+            uint64_t skippedItems = 0;
+            uint32_t extentMismatches = 0;
+            for (uint32_t loop = 0; loop < m_Loops; loop++) {
+                for (const kat::CapturedFrame& frame : m_Capture.frames) {
+                    for (const kat::CapturedCommand& command : frame.commands) {
+                        apply(command, loop == 0);
+                    }
+
+                    kat::GpuScene* scene = frame.scene < m_Scenes.size() ? m_Scenes[frame.scene].get() : nullptr;
+                    if (scene != m_Renderer->getScene()) {
+                        m_Renderer->setScene(scene);
+                    }
+                    resolution.hold(frame.resolutionScale);
+
+                    auto start = std::chrono::steady_clock::now();
+                    m_Renderer->render();
+                    if (loop > 0) {
+                        cpuTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                    }
+                    if (loop == 0) {
+                        skippedItems += frame.drawItems;
+                        extentMismatches += checkPasses(frame) ? 0 : 1;
+                    }
+                }
+                if (loop == 0) {
+                    // the first loop creates the scenes and warms caches up, keep its GPU times out of the stats
+                    m_Renderer->getGpuProfiler().resetStats();
+                }
+            }
+            getDevice().waitIdle();
+
+            if (skippedItems > 0) {
+                spdlog::warn("The app drew {} draw list items over the captured frames, they aren't part of the replay", skippedItems);
+            }
+            if (extentMismatches > 0) {
+                spdlog::warn("{} of {} frames ran passes at other extents than captured", extentMismatches, m_Capture.frames.size());
+            }
+
+            double capturedCpu = 0.0;
+            for (const kat::CapturedFrame& frame : m_Capture.frames) {
+                capturedCpu += frame.cpuTime * 1000.0;
+            }
+            if (!m_Capture.frames.empty()) {
+                spdlog::info("Captured frames took {:.3f} ms of CPU on average", capturedCpu / static_cast<double>(m_Capture.frames.size()));
+            }
+            if (!cpuTimes.empty()) {
+                m_Report.results.push_back(bench::makeResult("replay/cpu/frame", "ms", std::move(cpuTimes)));
+            }
+
+            // the profiler keeps histograms rather than samples, so there is no minimum or deviation to report
+            m_Renderer->getGpuProfiler().forEachScope([&](std::string_view name, uint32_t depth, const kat::FrameTimeHistogram& times) {
+                kat::FrameStats stats = times.getStats();
+                if (stats.count == 0) {
+                    return;
+                }
+                bench::ScenarioResult& result = m_Report.results.emplace_back();
+                result.name = fmt::format("replay/gpu/{}", name);
+                result.unit = "ms";
+                result.summary.count = stats.count;
+                result.summary.mean = stats.mean * 1000.0;
+                result.summary.p50 = stats.p50 * 1000.0;
+                result.summary.p95 = stats.p95 * 1000.0;
+                result.summary.max = stats.max * 1000.0;
+                spdlog::info("{:<28} {:>10.3f} ms        (mean {:.3f}, p95 {:.3f}, max {:.3f}, n {})", result.name,
+                             result.summary.p50, result.summary.mean, result.summary.p95, result.summary.max, stats.count);
+            });
+        }
+
+        // Throws when the frame just rendered ran other passes than the captured one, whose timings wouldn't compare.
+        // Returns false when only their extents differ.
+        bool checkPasses(const kat::CapturedFrame& frame) {
+            std::vector<kat::CapturedPass> live;
+            m_Renderer->getRenderGraph().forEachLivePass([&](const char* name, kat::PassType type, vk::Extent2D extent) {
+                live.push_back(kat::CapturedPass{name, type, extent});
+            });
+
+            bool samePasses = std::equal(live.begin(), live.end(), frame.passes.begin(), frame.passes.end(),
+                                         [](const kat::CapturedPass& a, const kat::CapturedPass& b) {
+                                             return a.name == b.name && a.type == b.type;
+                                         });
+            if (!samePasses) {
+                spdlog::error("Captured frame {} ran passes {}, the replay runs {}", frame.number, describePasses(frame.passes), describePasses(live));
+                throw std::runtime_error("Replayed passes don't match the capture");
+            }
+
+            return std::equal(live.begin(), live.end(), frame.passes.begin(), [](const kat::CapturedPass& a, const kat::CapturedPass& b) {
+                return a.extent == b.extent;
+            });
+        }
+
+        static std::string describePasses(const std::vector<kat::CapturedPass>& passes) {
+            std::string names;
+            for (const kat::CapturedPass& pass : passes) {
+                names += names.empty() ? pass.name : ", " + pass.name;
+            }
+            return names.empty() ? "none" : names;
+        }
+
+        // Scenes, meshes and added instances accumulate, so they're only replayed the first time through.
+        void apply(const kat::CapturedCommand& command, bool first) {
+            if (const auto* upload = std::get_if<kat::CapturedUpload>(&command)) {
+                getUploadService().uploadBuffer(m_Scratch.buffer, 0, std::span<const std::byte>(m_ScratchData).first(upload->size));
+            } else if (const auto* create = std::get_if<kat::CapturedSceneCreate>(&command)) {
+                if (first) {
+                    m_Scenes.resize(std::max<size_t>(m_Scenes.size(), create->scene + 1));
+                    m_Scenes[create->scene] = std::make_unique<kat::GpuScene>(*this, create->config);
+                }
+            } else if (const auto* mesh = std::get_if<kat::CapturedMesh>(&command)) {
+                if (first) {
+                    getScene(mesh->scene).addMesh(mesh->vertices, mesh->indices, mesh->lods);
+                }
+            } else if (const auto* instances = std::get_if<kat::CapturedInstances>(&command)) {
+                if (!instances->add) {
+                    getScene(instances->scene).updateInstances(instances->first, instances->instances);
+                } else if (first) {
+                    getScene(instances->scene).addInstances(instances->instances);
+                }
+            } else if (const auto* view = std::get_if<kat::CapturedView>(&command)) {
+                getScene(view->scene).setView(view->view);
+            }
+        }
+
+        kat::GpuScene& getScene(uint32_t id) {
+            if (id >= m_Scenes.size() || !m_Scenes[id]) {
+                spdlog::error("Capture refers to GPU scene {} before creating it", id);
+                throw std::runtime_error("Invalid frame capture");
+            }
+            return *m_Scenes[id];
+        }
+
+        const kat::CaptureFile& m_Capture;
+        uint32_t m_Loops;
+        bench::Report& m_Report;
+        bool m_Replayed = false;
+
+        std::shared_ptr<kat::Renderer> m_Renderer;
+        // by capture ID
+        std::vector<std::unique_ptr<kat::GpuScene>> m_Scenes;
+        kat::AllocatedBuffer m_Scratch;
+        std::vector<std::byte> m_ScratchData;
+    };
+}
+
+int main(int argc, char** argv) {
+    std::optional<Options> options = parseOptions(argc, argv);
+    if (!options) {
+        printUsage();
+        return 1;
+    }
+
+    std::optional<bench::Report> baseline;
+    if (!options->baseline.empty()) {
+        baseline = bench::readReport(options->baseline);
+        if (!baseline) {
+            return 1;
+        }
+    }
+
+    bench::Report report;
+    try {
+        kat::CaptureFile capture = kat::loadFrameCapture(options->capture);
+        if (capture.frames.empty()) {
+            spdlog::error("{} holds no frames", options->capture);
+            return 1;
+        }
+
+        kat::Engine engine;
+        engine.runApp(std::make_shared<ReplayApp>(capture, options->loops, report));
+    } catch (const std::exception& e) {
+        spdlog::error("Replay failed: {}", e.what());
+        return 1;
+    }
+
+    if (!options->output.empty()) {
+        if (!bench::writeReport(options->output, report)) {
+            return 1;
+        }
+        spdlog::info("Wrote {} timings to {}", report.results.size(), options->output);
+    }
+
+    if (!baseline) {
+        return 0;
+    }
+    if (baseline->device != report.device) {
+        spdlog::warn("Baseline ran on {}, this run on {}; the comparison may not mean much", baseline->device, report.device);
+    }
+
+    std::vector<bench::Regression> regressions = bench::compare(*baseline, report, options->threshold / 100.0);
+    for (const bench::Regression& regression : regressions) {
+        spdlog::error("{} regressed: median {:.3f} -> {:.3f} ({:+.1f}%)", regression.name, regression.baseline,
+                      regression.current, (regression.current / regression.baseline - 1.0) * 100.0);
+    }
+    if (!regressions.empty()) {
+        return 2;
+    }
+    spdlog::info("No regressions over {}% against {}", options->threshold, options->baseline);
+    return 0;
+}
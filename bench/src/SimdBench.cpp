@@ -0,0 +1,212 @@
+#include <kat/SimdMath.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+// Times the batch kernels in kat/SimdMath.h at every SIMD level this CPU supports, against the loops over glm
+// types (array of structures) they replace.
+
+namespace {
+
+    struct Options {
+        uint32_t count = 64 * 1024;
+        uint32_t iterations = 200;
+    };
+
+    struct Box {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    void printUsage() {
+        spdlog::info("usage: kat_simd_bench [options]");
+        spdlog::info("  --count <n>       instances per batch (default 65536)");
+        spdlog::info("  --iterations <n>  timed runs per kernel (default 200)");
+    }
+
+    std::optional<uint32_t> parseNumber(std::string_view text) {
+        uint32_t value = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size() || value == 0) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::optional<Options> parseOptions(int argc, char** argv) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            if ((arg == "--count" || arg == "--iterations") && i + 1 < argc) {
+                std::optional<uint32_t> value = parseNumber(argv[++i]);
+                if (!value) {
+                    spdlog::error("{} expects a positive number, got {}", arg, argv[i]);
+                    return std::nullopt;
+                }
+                (arg == "--count" ? options.count : options.iterations) = *value;
+            } else {
+                spdlog::error("Unknown option {}", arg);
+                return std::nullopt;
+            }
+        }
+        return options;
+    }
+
+    // median time of one run in nanoseconds per instance, after a few untimed runs
+    double measure(const Options& options, const std::function<void()>& run) {
+        for (int i = 0; i < 3; i++) {
+            run();
+        }
+
+        std::vector<double> times(options.iterations);
+        for (double& time : times) {
+            auto start = std::chrono::steady_clock::now();
+            run();
+            time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+        std::nth_element(times.begin(), times.begin() + static_cast<ptrdiff_t>(times.size() / 2), times.end());
+        return times[times.size() / 2] / options.count;
+    }
+
+    void report(const Options& options, std::string_view name, const std::function<void()>& glmLoop, const std::function<void()>& kernel) {
+        double baseline = measure(options, glmLoop);
+        spdlog::info("{:<16} {:>7} {:8.3f} ns/instance", name, "glm", baseline);
+
+        for (int level = 0; level <= static_cast<int>(kat::getSupportedSimdLevel()); level++) {
+            kat::setSimdLevel(static_cast<kat::SimdLevel>(level));
+            double time = measure(options, kernel);
+            spdlog::info("{:<16} {:>7} {:8.3f} ns/instance  {:5.2f}x", "", kat::getSimdLevelName(kat::getSimdLevel()), time, baseline / time);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::optional<Options> options = parseOptions(argc, argv);
+    if (!options) {
+        printUsage();
+        return 1;
+    }
+    const size_t count = options->count;
+
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    // affine transforms, as scene graphs produce them
+    std::vector<glm::mat4> parents(count);
+    std::vector<glm::mat4> locals(count);
+    for (std::vector<glm::mat4>* matrices : {&parents, &locals}) {
+        for (glm::mat4& matrix : *matrices) {
+            matrix = glm::mat4(1.0f);
+            for (int c = 0; c < 3; c++) {
+                for (int r = 0; r < 3; r++) {
+                    matrix[c][r] = size(random) - 1.0f;
+                }
+            }
+            matrix[3] = glm::vec4(position(random), position(random), position(random), 1.0f);
+        }
+    }
+
+    std::vector<glm::vec4> spheres(count);
+    std::vector<Box> boxes(count);
+    kat::SphereArray sphereArray;
+    kat::AabbArray boxArray;
+    sphereArray.resize(count);
+    boxArray.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 center{position(random), position(random), position(random)};
+        glm::vec3 extent{size(random), size(random), size(random)};
+        spheres[i] = glm::vec4(center, glm::length(extent));
+        boxes[i] = Box{center - extent, center + extent};
+        sphereArray.set(i, spheres[i]);
+        boxArray.set(i, boxes[i].min, boxes[i].max);
+    }
+
+    // a camera at the origin looking down -z with a 90 degree field of view, seeing about a sixth of the instances
+    glm::mat4 viewProjection(0.0f);
+    viewProjection[0][0] = 1.0f;
+    viewProjection[1][1] = -1.0f;
+    viewProjection[2][2] = 200.0f / (0.1f - 200.0f);
+    viewProjection[2][3] = -1.0f;
+    viewProjection[3][2] = 0.1f * 200.0f / (0.1f - 200.0f);
+    const kat::FrustumPlanes planes = kat::getFrustumPlanes(viewProjection);
+
+    std::vector<glm::mat4> worldMatrices(count);
+    std::vector<glm::vec4> worldSpheres(count);
+    std::vector<Box> worldBoxes(count);
+    std::vector<uint8_t> visibleFlags(count);
+    kat::SphereArray worldSphereArray;
+    kat::AabbArray worldBoxArray;
+    std::vector<uint8_t> visibleMasks(kat::getSimdGroupCount(count));
+
+    spdlog::info("{} instances, median of {} runs", count, options->iterations);
+
+    report(*options, "mat4 * mat4", [&] {
+        for (size_t i = 0; i < count; i++) {
+            worldMatrices[i] = parents[i] * locals[i];
+        }
+    }, [&] {
+        kat::multiplyMatrices(parents, locals, worldMatrices);
+    });
+
+    report(*options, "sphere transform", [&] {
+        for (size_t i = 0; i < count; i++) {
+            const glm::mat4& m = locals[i];
+            float scale = std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])), glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))});
+            worldSpheres[i] = glm::vec4(glm::vec3(m * glm::vec4(glm::vec3(spheres[i]), 1.0f)), spheres[i].w * std::sqrt(scale));
+        }
+    }, [&] {
+        kat::transformSpheres(locals, sphereArray, worldSphereArray);
+    });
+
+    report(*options, "aabb transform", [&] {
+        for (size_t i = 0; i < count; i++) {
+            const glm::mat4& m = locals[i];
+            glm::vec3 center = glm::vec3(m * glm::vec4((boxes[i].min + boxes[i].max) * 0.5f, 1.0f));
+            glm::vec3 extent = glm::abs(glm::mat3(m)) * ((boxes[i].max - boxes[i].min) * 0.5f);
+            worldBoxes[i] = Box{center - extent, center + extent};
+        }
+    }, [&] {
+        kat::transformAabbs(locals, boxArray, worldBoxArray);
+    });
+
+    report(*options, "sphere cull", [&] {
+        for (size_t i = 0; i < count; i++) {
+            bool visible = true;
+            for (const glm::vec4& plane : planes) {
+                visible = visible && glm::dot(glm::vec3(plane), glm::vec3(spheres[i])) + plane.w >= -spheres[i].w;
+            }
+            visibleFlags[i] = visible;
+        }
+    }, [&] {
+        kat::cullSpheres(planes, sphereArray, visibleMasks);
+    });
+
+    report(*options, "aabb cull", [&] {
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 center = (boxes[i].min + boxes[i].max) * 0.5f;
+            glm::vec3 extent = (boxes[i].max - boxes[i].min) * 0.5f;
+            bool visible = true;
+            for (const glm::vec4& plane : planes) {
+                visible = visible && glm::dot(glm::vec3(plane), center) + plane.w >= -glm::dot(glm::abs(glm::vec3(plane)), extent);
+            }
+            visibleFlags[i] = visible;
+        }
+    }, [&] {
+        kat::cullAabbs(planes, boxArray, visibleMasks);
+    });
+
+    size_t visible = 0;
+    for (uint8_t mask : visibleMasks) {
+        visible += std::popcount(mask);
+    }
+    spdlog::info("{} of {} boxes visible", visible, count);
+    return 0;
+}
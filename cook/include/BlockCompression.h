@@ -0,0 +1,24 @@
+#pragma once
+
+#include <kat/TextureContainer.h>
+#include <kat/JobSystem.h>
+#include <cinttypes>
+#include <vector>
+
+namespace cook {
+
+    // Block encoders. Each takes a 4x4 block of RGBA8 texels, row by row, and writes one compressed block.
+    void encodeBc1(const uint8_t* texels, uint8_t* out);
+    // alpha from channel 3, colour from channels 0-2
+    void encodeBc3(const uint8_t* texels, uint8_t* out);
+    // channel 0
+    void encodeBc4(const uint8_t* texels, uint8_t* out);
+    // channels 0 and 1
+    void encodeBc5(const uint8_t* texels, uint8_t* out);
+    // mode 6: one subset, RGBA endpoints with 7 bits and a shared-per-endpoint p-bit, 4-bit indices
+    void encodeBc7(const uint8_t* texels, uint8_t* out);
+
+    // Encodes a width x height RGBA8 image into `format`, block rows spread over the job system. Edge blocks of
+    // images that aren't multiples of four repeat the last row and column.
+    std::vector<std::byte> encodeImage(kat::TextureFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, kat::JobSystem& jobs);
+}
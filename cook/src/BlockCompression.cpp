@@ -0,0 +1,399 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace cook {
+
+    namespace {
+        // Principal axis of `channels` channels of the block, by power iteration on the covariance matrix. Returns
+        // false when the block has no usable axis.
+        template<size_t channels>
+        bool fitLine(const uint8_t* texels, std::array<float, channels>& mean, std::array<float, channels>& axis) {
+            mean.fill(0.0f);
+            for (int i = 0; i < 16; i++) {
+                for (size_t c = 0; c < channels; c++) {
+                    mean[c] += texels[i * 4 + c] / 16.0f;
+                }
+            }
+
+            std::array<std::array<float, channels>, channels> covariance{};
+            for (int i = 0; i < 16; i++) {
+                std::array<float, channels> d;
+                for (size_t c = 0; c < channels; c++) {
+                    d[c] = texels[i * 4 + c] - mean[c];
+                }
+                for (size_t a = 0; a < channels; a++) {
+                    for (size_t b = 0; b < channels; b++) {
+                        covariance[a][b] += d[a] * d[b];
+                    }
+                }
+            }
+
+            // start from the row of largest norm, it always has a component along the principal axis; a fixed
+            // seed like (1, 1, 1) can be orthogonal to it (a red/green block)
+            float seedNorm = 0.0f;
+            for (const auto& row : covariance) {
+                float norm = 0.0f;
+                for (float v : row) {
+                    norm += v * v;
+                }
+                if (norm > seedNorm) {
+                    seedNorm = norm;
+                    axis = row;
+                }
+            }
+            if (seedNorm < 1e-6f) {
+                return false;
+            }
+
+            for (int iteration = 0; iteration < 8; iteration++) {
+                std::array<float, channels> next{};
+                for (size_t a = 0; a < channels; a++) {
+                    for (size_t b = 0; b < channels; b++) {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                }
+
+                float length = 0.0f;
+                for (float v : next) {
+                    length = std::max(length, std::abs(v));
+                }
+                if (length < 1e-6f) {
+                    break;
+                }
+                for (size_t c = 0; c < channels; c++) {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            float length = 0.0f;
+            for (float v : axis) {
+                length += v * v;
+            }
+            length = std::sqrt(length);
+            if (!(length > 1e-6f)) {
+                return false;
+            }
+            for (float& v : axis) {
+                v /= length;
+            }
+            return true;
+        }
+
+        // Endpoints at the extremes of the block's projection on its principal axis, pulled in by 1/16 of the range
+        // to spend less error on outliers. Blocks without a principal axis get the corners of their bounding box.
+        template<size_t channels>
+        void fitEndpoints(const uint8_t* texels, std::array<float, channels>& low, std::array<float, channels>& high) {
+            std::array<float, channels> mean;
+            std::array<float, channels> axis;
+            if (!fitLine(texels, mean, axis)) {
+                low.fill(255.0f);
+                high.fill(0.0f);
+                for (int i = 0; i < 16; i++) {
+                    for (size_t c = 0; c < channels; c++) {
+                        low[c] = std::min<float>(low[c], texels[i * 4 + c]);
+                        high[c] = std::max<float>(high[c], texels[i * 4 + c]);
+                    }
+                }
+                return;
+            }
+
+            float minT = std::numeric_limits<float>::max();
+            float maxT = std::numeric_limits<float>::lowest();
+            for (int i = 0; i < 16; i++) {
+                float t = 0.0f;
+                for (size_t c = 0; c < channels; c++) {
+                    t += (texels[i * 4 + c] - mean[c]) * axis[c];
+                }
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+
+            float inset = (maxT - minT) / 16.0f;
+            minT += inset;
+            maxT -= inset;
+            for (size_t c = 0; c < channels; c++) {
+                low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+                high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+            }
+        }
+
+        uint16_t packRgb565(const std::array<float, 3>& color) {
+            auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+            auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+            auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+            return static_cast<uint16_t>(r << 11 | g << 5 | b);
+        }
+
+        std::array<int, 3> unpackRgb565(uint16_t color) {
+            int r = color >> 11 & 31;
+            int g = color >> 5 & 63;
+            int b = color & 31;
+            return {r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2};
+        }
+
+        void writeLittleEndian(uint8_t* out, uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; i++) {
+                out[i] = static_cast<uint8_t>(value >> (i * 8));
+            }
+        }
+
+        // LSB-first bit writer for 128-bit blocks
+        class BitWriter {
+        public:
+            void write(uint32_t value, int bits) {
+                for (int i = 0; i < bits; i++) {
+                    if (value >> i & 1) {
+                        m_Bytes[(m_Position + i) / 8] |= static_cast<uint8_t>(1 << ((m_Position + i) % 8));
+                    }
+                }
+                m_Position += bits;
+            }
+
+            void store(uint8_t* out) const {
+                std::memcpy(out, m_Bytes.data(), m_Bytes.size());
+            }
+
+        private:
+            std::array<uint8_t, 16> m_Bytes{};
+            int m_Position = 0;
+        };
+
+        // BC4 block of channel `channel`
+        void encodeChannel(const uint8_t* texels, int channel, uint8_t* out) {
+            int low = 255;
+            int high = 0;
+            for (int i = 0; i < 16; i++) {
+                low = std::min<int>(low, texels[i * 4 + channel]);
+                high = std::max<int>(high, texels[i * 4 + channel]);
+            }
+
+            out[0] = static_cast<uint8_t>(high);
+            out[1] = static_cast<uint8_t>(low);
+            if (high == low) {
+                std::memset(out + 2, 0, 6);
+                return;
+            }
+
+            // high > low selects the eight value palette: the endpoints, then six steps from high to low
+            std::array<int, 8> palette{high, low};
+            for (int i = 1; i < 7; i++) {
+                palette[i + 1] = ((7 - i) * high + i * low) / 7;
+            }
+
+            uint64_t indices = 0;
+            for (int i = 0; i < 16; i++) {
+                int value = texels[i * 4 + channel];
+                int best = 0;
+                for (int p = 1; p < 8; p++) {
+                    if (std::abs(palette[p] - value) < std::abs(palette[best] - value)) {
+                        best = p;
+                    }
+                }
+                indices |= static_cast<uint64_t>(best) << (i * 3);
+            }
+            writeLittleEndian(out + 2, indices, 6);
+        }
+
+        void encodeColor(const uint8_t* texels, uint8_t* out) {
+            std::array<float, 3> low;
+            std::array<float, 3> high;
+            fitEndpoints<3>(texels, low, high);
+
+            uint16_t color0 = packRgb565(high);
+            uint16_t color1 = packRgb565(low);
+            if (color0 < color1) {
+                std::swap(color0, color1);
+            }
+
+            writeLittleEndian(out, color0, 2);
+            writeLittleEndian(out + 2, color1, 2);
+            if (color0 == color1) {
+                // every index picks color0
+                writeLittleEndian(out + 4, 0, 4);
+                return;
+            }
+
+            // color0 > color1 selects four colours: the endpoints and the two thirds between them
+            std::array<std::array<int, 3>, 4> palette{unpackRgb565(color0), unpackRgb565(color1)};
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            uint32_t indices = 0;
+            for (int i = 0; i < 16; i++) {
+                int best = 0;
+                int bestError = std::numeric_limits<int>::max();
+                for (int p = 0; p < 4; p++) {
+                    int error = 0;
+                    for (int c = 0; c < 3; c++) {
+                        int d = palette[p][c] - texels[i * 4 + c];
+                        error += d * d;
+                    }
+                    if (error < bestError) {
+                        bestError = error;
+                        best = p;
+                    }
+                }
+                indices |= static_cast<uint32_t>(best) << (i * 2);
+            }
+            writeLittleEndian(out + 4, indices, 4);
+        }
+
+        constexpr std::array<int, 16> kBc7Weights4{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    }
+
+    void encodeBc1(const uint8_t *texels, uint8_t *out) {
+        encodeColor(texels, out);
+    }
+
+    void encodeBc3(const uint8_t *texels, uint8_t *out) {
+        encodeChannel(texels, 3, out);
+        encodeColor(texels, out + 8);
+    }
+
+    void encodeBc4(const uint8_t *texels, uint8_t *out) {
+        encodeChannel(texels, 0, out);
+    }
+
+    void encodeBc5(const uint8_t *texels, uint8_t *out) {
+        encodeChannel(texels, 0, out);
+        encodeChannel(texels, 1, out + 8);
+    }
+
+    void encodeBc7(const uint8_t *texels, uint8_t *out) {
+        std::array<float, 4> low;
+        std::array<float, 4> high;
+        fitEndpoints<4>(texels, low, high);
+
+        // try every p-bit pair, the endpoints are 7 bits plus the p-bit
+        std::array<std::array<int, 4>, 2> bestQuantized{};
+        std::array<int, 2> bestPBits{};
+        std::array<int, 16> bestIndices{};
+        int64_t bestError = std::numeric_limits<int64_t>::max();
+
+        for (int pBits = 0; pBits < 4; pBits++) {
+            std::array<int, 2> p{pBits & 1, pBits >> 1};
+            std::array<std::array<int, 4>, 2> quantized;
+            std::array<std::array<int, 4>, 2> endpoints;
+            for (int c = 0; c < 4; c++) {
+                quantized[0][c] = std::clamp(static_cast<int>(std::lround((low[c] - p[0]) / 2.0f)), 0, 127);
+                quantized[1][c] = std::clamp(static_cast<int>(std::lround((high[c] - p[1]) / 2.0f)), 0, 127);
+                endpoints[0][c] = quantized[0][c] << 1 | p[0];
+                endpoints[1][c] = quantized[1][c] << 1 | p[1];
+            }
+
+            std::array<std::array<int, 4>, 16> palette;
+            for (int w = 0; w < 16; w++) {
+                for (int c = 0; c < 4; c++) {
+                    palette[w][c] = ((64 - kBc7Weights4[w]) * endpoints[0][c] + kBc7Weights4[w] * endpoints[1][c] + 32) >> 6;
+                }
+            }
+
+            int64_t error = 0;
+            std::array<int, 16> indices;
+            for (int i = 0; i < 16; i++) {
+                int best = 0;
+                int bestTexelError = std::numeric_limits<int>::max();
+                for (int w = 0; w < 16; w++) {
+                    int texelError = 0;
+                    for (int c = 0; c < 4; c++) {
+                        int d = palette[w][c] - texels[i * 4 + c];
+                        texelError += d * d;
+                    }
+                    if (texelError < bestTexelError) {
+                        bestTexelError = texelError;
+                        best = w;
+                    }
+                }
+                indices[i] = best;
+                error += bestTexelError;
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                bestQuantized = quantized;
+                bestPBits = p;
+                bestIndices = indices;
+            }
+        }
+
+        // the first index is stored without its top bit, so it has to be below 8
+        if (bestIndices[0] >= 8) {
+            std::swap(bestQuantized[0], bestQuantized[1]);
+            std::swap(bestPBits[0], bestPBits[1]);
+            for (int& index : bestIndices) {
+                index = 15 - index;
+            }
+        }
+
+        BitWriter bits;
+        bits.write(1 << 6, 7);
+        for (int c = 0; c < 4; c++) {
+            bits.write(static_cast<uint32_t>(bestQuantized[0][c]), 7);
+            bits.write(static_cast<uint32_t>(bestQuantized[1][c]), 7);
+        }
+        bits.write(static_cast<uint32_t>(bestPBits[0]), 1);
+        bits.write(static_cast<uint32_t>(bestPBits[1]), 1);
+        bits.write(static_cast<uint32_t>(bestIndices[0]), 3);
+        for (int i = 1; i < 16; i++) {
+            bits.write(static_cast<uint32_t>(bestIndices[i]), 4);
+        }
+        bits.store(out);
+    }
+
+    std::vector<std::byte> encodeImage(kat::TextureFormat format, const uint8_t *rgba, uint32_t width, uint32_t height, kat::JobSystem &jobs) {
+        std::vector<std::byte> output(kat::getTextureLevelSize(format, width, height));
+        if (format == kat::TextureFormat::eRGBA8) {
+            std::memcpy(output.data(), rgba, output.size());
+            return output;
+        }
+
+        void (*encodeBlock)(const uint8_t*, uint8_t*) = nullptr;
+        switch (format) {
+            case kat::TextureFormat::eBC1:
+                encodeBlock = &encodeBc1;
+                break;
+            case kat::TextureFormat::eBC3:
+                encodeBlock = &encodeBc3;
+                break;
+            case kat::TextureFormat::eBC4:
+                encodeBlock = &encodeBc4;
+                break;
+            case kat::TextureFormat::eBC5:
+                encodeBlock = &encodeBc5;
+                break;
+            case kat::TextureFormat::eBC7:
+                encodeBlock = &encodeBc7;
+                break;
+            case kat::TextureFormat::eRGBA8:
+                break;
+        }
+
+        uint32_t blocksWide = (width + 3) / 4;
+        uint32_t blocksHigh = (height + 3) / 4;
+        uint32_t blockSize = kat::getTextureFormatBlockSize(format);
+
+        jobs.parallelFor(0, blocksHigh, 0, [&](size_t begin, size_t end) {
+            std::array<uint8_t, 64> texels;
+            for (size_t by = begin; by < end; by++) {
+                for (uint32_t bx = 0; bx < blocksWide; bx++) {
+                    for (uint32_t y = 0; y < 4; y++) {
+                        uint32_t sy = std::min(static_cast<uint32_t>(by) * 4 + y, height - 1);
+                        for (uint32_t x = 0; x < 4; x++) {
+                            uint32_t sx = std::min(bx * 4 + x, width - 1);
+                            std::memcpy(&texels[(y * 4 + x) * 4], rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                        }
+                    }
+                    encodeBlock(texels.data(), reinterpret_cast<uint8_t*>(output.data()) + (by * blocksWide + bx) * blockSize);
+                }
+            }
+        });
+        return output;
+    }
+}
@@ -0,0 +1,209 @@
+#include "BlockCompression.h"
+
+#include <kat/JobSystem.h>
+#include <kat/MappedFile.h>
+#include <kat/MipChain.h>
+#include <kat/TextureContainer.h>
+#include <spdlog/spdlog.h>
+#include <stb_image.h>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+    struct Options {
+        kat::TextureFormat format = kat::TextureFormat::eBC7;
+        bool srgb = true;
+        bool normalMap = false;
+        bool fallback = false;
+        uint32_t maxSize = UINT32_MAX;
+        uint32_t threads = 0;
+        std::string_view input;
+        std::string_view output;
+    };
+
+    void printUsage() {
+        spdlog::info("usage: kat_cook [options] <input image> <output .ktex>");
+        spdlog::info("  --format bc1|bc3|bc4|bc5|bc7|rgba8  texel format (default bc7)");
+        spdlog::info("  --normal                            normal map: bc5, linear");
+        spdlog::info("  --linear                            not colour data, no sRGB");
+        spdlog::info("  --fallback                          add an rgba8 variant for GPUs without BC support");
+        spdlog::info("  --max-size <n>                      drop mips larger than n");
+        spdlog::info("  --threads <n>                       encoder threads (default: all)");
+    }
+
+    std::optional<kat::TextureFormat> parseFormat(std::string_view name) {
+        if (name == "bc1") {
+            return kat::TextureFormat::eBC1;
+        }
+        if (name == "bc3") {
+            return kat::TextureFormat::eBC3;
+        }
+        if (name == "bc4") {
+            return kat::TextureFormat::eBC4;
+        }
+        if (name == "bc5") {
+            return kat::TextureFormat::eBC5;
+        }
+        if (name == "bc7") {
+            return kat::TextureFormat::eBC7;
+        }
+        if (name == "rgba8") {
+            return kat::TextureFormat::eRGBA8;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<uint32_t> parseNumber(std::string_view text) {
+        uint32_t value = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::optional<Options> parseOptions(int argc, char** argv) {
+        Options options;
+        std::vector<std::string_view> positional;
+
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--format" && hasValue) {
+                std::optional<kat::TextureFormat> format = parseFormat(argv[++i]);
+                if (!format) {
+                    spdlog::error("Unknown format {}", argv[i]);
+                    return std::nullopt;
+                }
+                options.format = *format;
+            } else if (arg == "--normal") {
+                options.normalMap = true;
+                options.format = kat::TextureFormat::eBC5;
+                options.srgb = false;
+            } else if (arg == "--linear") {
+                options.srgb = false;
+            } else if (arg == "--fallback") {
+                options.fallback = true;
+            } else if ((arg == "--max-size" || arg == "--threads") && hasValue) {
+                std::optional<uint32_t> value = parseNumber(argv[++i]);
+                if (!value) {
+                    spdlog::error("{} expects a number, got {}", arg, argv[i]);
+                    return std::nullopt;
+                }
+                (arg == "--max-size" ? options.maxSize : options.threads) = *value;
+            } else if (arg.starts_with("--")) {
+                spdlog::error("Unknown option {}", arg);
+                return std::nullopt;
+            } else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.size() != 2) {
+            return std::nullopt;
+        }
+        options.input = positional[0];
+        options.output = positional[1];
+
+        // single and dual channel formats hold data, never colour
+        if (options.format == kat::TextureFormat::eBC4 || options.format == kat::TextureFormat::eBC5) {
+            options.srgb = false;
+        }
+        return options;
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::optional<Options> options = parseOptions(argc, argv);
+    if (!options) {
+        printUsage();
+        return 1;
+    }
+
+    try {
+        kat::MappedFile file{std::filesystem::path(options->input)};
+        std::span<const std::byte> source = file.getData();
+
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(source.data()), static_cast<int>(source.size()),
+                                                &width, &height, &channels, 4);
+        if (!pixels) {
+            spdlog::error("Failed to decode {}: {}", options->input, stbi_failure_reason());
+            return 1;
+        }
+
+        std::span<const std::byte> rgba(reinterpret_cast<const std::byte*>(pixels), static_cast<size_t>(width) * height * 4);
+        kat::MipChain mips = kat::buildMipChain(rgba, static_cast<uint32_t>(width), static_cast<uint32_t>(height), options->srgb, options->maxSize);
+        stbi_image_free(pixels);
+
+        std::vector<kat::TextureFormat> formats{options->format};
+        if (options->fallback && options->format != kat::TextureFormat::eRGBA8) {
+            formats.push_back(kat::TextureFormat::eRGBA8);
+        }
+
+        kat::JobSystem jobs(options->threads);
+        auto start = std::chrono::steady_clock::now();
+
+        kat::TextureFileHeader header;
+        header.width = mips.levels[0].width;
+        header.height = mips.levels[0].height;
+        header.mipCount = static_cast<uint32_t>(mips.levels.size());
+        header.variantCount = static_cast<uint32_t>(formats.size());
+        header.flags = (options->srgb ? kat::kTextureFileSrgb : 0) | (options->normalMap ? kat::kTextureFileNormalMap : 0);
+
+        std::vector<kat::TextureFileVariant> variants;
+        std::vector<kat::TextureFileMip> mipTable;
+        std::vector<std::vector<std::byte>> levels;
+
+        uint64_t offset = alignUp(sizeof(kat::TextureFileHeader) + sizeof(kat::TextureFileVariant) * formats.size()
+                                  + sizeof(kat::TextureFileMip) * formats.size() * mips.levels.size(), kat::kTextureFileAlignment);
+        for (kat::TextureFormat format : formats) {
+            variants.push_back(kat::TextureFileVariant{format});
+            for (size_t level = 0; level < mips.levels.size(); level++) {
+                const kat::MipLevel& mip = mips.levels[level];
+                levels.push_back(cook::encodeImage(format, reinterpret_cast<const uint8_t*>(mips.getLevel(level).data()), mip.width, mip.height, jobs));
+                mipTable.push_back(kat::TextureFileMip{offset, levels.back().size(), mip.width, mip.height});
+                offset = alignUp(offset + levels.back().size(), kat::kTextureFileAlignment);
+            }
+        }
+
+        std::ofstream out(std::filesystem::path(options->output), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(variants.data()), static_cast<std::streamsize>(sizeof(kat::TextureFileVariant) * variants.size()));
+        out.write(reinterpret_cast<const char*>(mipTable.data()), static_cast<std::streamsize>(sizeof(kat::TextureFileMip) * mipTable.size()));
+        for (size_t i = 0; i < levels.size(); i++) {
+            // zero padding up to the aligned offset of the level
+            std::vector<char> padding(mipTable[i].offset - static_cast<uint64_t>(out.tellp()), 0);
+            out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+            out.write(reinterpret_cast<const char*>(levels[i].data()), static_cast<std::streamsize>(levels[i].size()));
+        }
+        out.close();
+        if (!out) {
+            spdlog::error("Failed to write {}", options->output);
+            return 1;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        spdlog::info("Cooked {} ({}x{}, {} mips) to {} as {}{} in {:.2f}s, {} KiB", options->input, header.width, header.height,
+                     header.mipCount, options->output, kat::toString(options->format), options->fallback ? " + RGBA8" : "",
+                     seconds, offset / 1024);
+    } catch (const std::exception& e) {
+        spdlog::error("Cooking {} failed: {}", options->input, e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace kat::debug {
+
+#ifdef NDEBUG
+    constexpr bool kAllocationCountingEnabled = false;
+#else
+    constexpr bool kAllocationCountingEnabled = true;
+#endif
+
+    // Number of global operator new calls made by the calling thread so far (always 0 in release builds).
+    size_t getThreadAllocationCount() noexcept;
+}
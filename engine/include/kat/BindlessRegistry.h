@@ -0,0 +1,130 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace kat {
+
+    constexpr uint32_t kInvalidBindlessIndex = UINT32_MAX;
+
+    // Indices into the bindless arrays, passed to shaders through push constants.
+    struct BindlessImage {
+        uint32_t index = kInvalidBindlessIndex;
+    };
+
+    struct BindlessSampler {
+        uint32_t index = kInvalidBindlessIndex;
+    };
+
+    struct BindlessBuffer {
+        uint32_t index = kInvalidBindlessIndex;
+    };
+
+    // Lock-free allocator of descriptor array slots. A released slot is parked in the bucket of the last frame that
+    // may read it and only handed out again once that frame has left the GPU.
+    class BindlessSlots {
+    public:
+        explicit BindlessSlots(uint32_t capacity);
+
+        std::optional<uint32_t> allocate();
+        void release(uint32_t slot, uint64_t frame);
+        // Makes the slots released for `frame` allocatable again; the GPU must be done with that frame. Every frame
+        // must be reclaimed, in order.
+        void reclaim(uint64_t frame);
+
+        [[nodiscard]] uint32_t getCapacity() const noexcept;
+
+    private:
+        static constexpr uint32_t kEnd = UINT32_MAX;
+        // releases name frames from the oldest one in flight up to the last packet a RenderThread has queued, and
+        // each of those needs its own bucket
+        static constexpr size_t kBuckets = kMaxFramesInFlight + kMaxQueuedFrames + 1;
+
+        void push(uint32_t slot);
+
+        uint32_t m_Capacity;
+        // slots below it have been handed out at least once
+        std::atomic<uint32_t> m_Bump{0};
+        // free list head: (ABA tag << 32) | slot
+        std::atomic<uint64_t> m_FreeHead{kEnd};
+        // push-only lists, taken whole by reclaim()
+        std::array<std::atomic<uint32_t>, kBuckets> m_Released;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_Next;
+    };
+
+    // One update-after-bind descriptor set holding every sampled image, sampler and storage buffer, bound once per
+    // command buffer with a shared pipeline layout. Draws select their resources by index through push constants:
+    //
+    //     layout(set = 0, binding = 0) uniform texture2D textures[];
+    //     layout(set = 0, binding = 1) uniform sampler samplers[];
+    //     layout(set = 0, binding = 2) buffer Buffers { uint data[]; } buffers[];
+    //
+    // Registering and releasing are safe from any thread. Released slots are reused only after the frames that might
+    // still read them have completed.
+    class BindlessRegistry {
+    public:
+        static constexpr uint32_t kSampledImageBinding = 0;
+        static constexpr uint32_t kSamplerBinding = 1;
+        static constexpr uint32_t kStorageBufferBinding = 2;
+
+        static constexpr uint32_t kMaxSampledImages = 16384;
+        static constexpr uint32_t kMaxSamplers = 256;
+        static constexpr uint32_t kMaxStorageBuffers = 8192;
+        // the minimum maxPushConstantsSize every implementation supports
+        static constexpr uint32_t kPushConstantSize = 128;
+
+        explicit BindlessRegistry(App& app);
+
+        BindlessRegistry(const BindlessRegistry&) = delete;
+        BindlessRegistry& operator=(const BindlessRegistry&) = delete;
+
+        void cleanup();
+
+        BindlessImage registerImage(vk::ImageView view, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+        BindlessSampler registerSampler(vk::Sampler sampler);
+        BindlessBuffer registerBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+
+        // The resource itself may be destroyed once the frame being recorded has completed.
+        void release(BindlessImage image);
+        void release(BindlessSampler sampler);
+        void release(BindlessBuffer buffer);
+
+        // Called by App::beginFrame() once the GPU is done with the frame that last used the new frame's slot.
+        void beginFrame(uint64_t frameNumber);
+
+        void bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint);
+
+        template<typename T>
+        void pushConstants(vk::CommandBuffer commandBuffer, const T& constants) {
+            static_assert(sizeof(T) <= kPushConstantSize, "push constants larger than the bindless pipeline layout allows");
+            commandBuffer.pushConstants(m_PipelineLayout, vk::ShaderStageFlagBits::eAll, 0, sizeof(T), &constants);
+        }
+
+        vk::DescriptorSetLayout getSetLayout();
+        // Pipelines indexing bindless resources are created with this layout.
+        vk::PipelineLayout getPipelineLayout();
+        vk::DescriptorSet getDescriptorSet();
+
+    private:
+        uint32_t allocateSlot(BindlessSlots& slots, const char* kind);
+        void write(const vk::WriteDescriptorSet& write);
+
+        App& m_App;
+        vk::Device m_Device;
+
+        vk::DescriptorSetLayout m_SetLayout;
+        vk::PipelineLayout m_PipelineLayout;
+        vk::DescriptorPool m_Pool;
+        vk::DescriptorSet m_Set;
+
+        std::unique_ptr<BindlessSlots> m_Images;
+        std::unique_ptr<BindlessSlots> m_Samplers;
+        std::unique_ptr<BindlessSlots> m_Buffers;
+
+        // vkUpdateDescriptorSets needs the set externally synchronized, even for update-after-bind descriptors
+        std::mutex m_WriteMutex;
+    };
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "kat/FunctionRef.h"
+#include "kat/JobSystem.h"
+#include "kat/SimdMath.h"
+#include <glm/glm.hpp>
+#include <cinttypes>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    struct Aabb {
+        glm::vec3 min{std::numeric_limits<float>::max()};
+        glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+        void grow(const Aabb& other) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        [[nodiscard]] bool overlaps(const Aabb& other) const {
+            return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+        }
+
+        // half the surface area, which is all the SAH needs
+        [[nodiscard]] float getHalfArea() const {
+            glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+            return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+    };
+
+    struct Ray {
+        glm::vec3 origin{0.0f};
+        glm::vec3 direction{0.0f, 0.0f, -1.0f};
+        float maxDistance = std::numeric_limits<float>::infinity();
+    };
+
+    struct RayHit {
+        uint32_t item;
+        float distance;
+    };
+
+    // Handle to one object in a Bvh.
+    using BvhProxy = uint32_t;
+    constexpr BvhProxy kNullProxy = UINT32_MAX;
+
+    // Dynamic bounding volume hierarchy over axis aligned boxes, for visibility and proximity queries on the CPU.
+    //
+    // Nodes live in one array in depth-first order, 32 bytes each: a node's left child follows it, and every node
+    // stores the index just past its subtree. Queries walk the array forwards without a stack, skipping culled
+    // subtrees, and a subtree found entirely inside a query emits its objects as one contiguous range.
+    //
+    // Adding and removing objects, or setting new bounds, only takes effect on commit(). Moves refit the boxes of
+    // the nodes above the moved objects, keeping the tree's shape; added or removed objects, or a refitted tree
+    // that has grown too loose, get a full binned-SAH rebuild with subtrees built in parallel on the job system.
+    //
+    // Queries append the `item` of every object they find, and may run concurrently with each other but not with
+    // the calls that change the tree. The items a frustum query appends are a draw list as is:
+    //
+    //     visible.clear();
+    //     bvh.queryFrustum(getFrustumPlanes(viewProjection), visible);
+    //     renderer.render(visible.size(), [&](const RecordContext& chunk) {
+    //         for (size_t i = chunk.begin; i < chunk.end; i++) { draw(chunk.commandBuffer, visible[i]); }
+    //     });
+    class Bvh {
+    public:
+        static constexpr uint32_t kMaxLeafSize = 4;
+        // ranges at least this big are split off into their own build job
+        static constexpr uint32_t kParallelBuildSize = 4096;
+        // a refitted tree whose SAH cost grows past this factor of its cost when built gets rebuilt
+        static constexpr float kRebuildCostRatio = 1.5f;
+
+        explicit Bvh(JobSystem& jobs);
+
+        Bvh(const Bvh&) = delete;
+        Bvh& operator=(const Bvh&) = delete;
+
+        BvhProxy add(const Aabb& bounds, uint32_t item);
+        void remove(BvhProxy proxy);
+        void setBounds(BvhProxy proxy, const Aabb& bounds);
+        [[nodiscard]] const Aabb& getBounds(BvhProxy proxy) const;
+
+        // Applies the changes made since the last commit, refitting or rebuilding as needed.
+        void commit();
+        // Rebuilds from scratch regardless.
+        void rebuild();
+
+        void queryFrustum(const FrustumPlanes& planes, std::vector<uint32_t>& items) const;
+        void queryAabb(const Aabb& bounds, std::vector<uint32_t>& items) const;
+        // every object whose box the ray crosses within its max distance, in no particular order
+        void queryRay(const Ray& ray, std::vector<uint32_t>& items) const;
+        // Closest hit: `intersect` is called with the items whose boxes the ray reaches before the closest hit so
+        // far and returns the distance along the ray of its own hit, or nothing.
+        [[nodiscard]] std::optional<RayHit> raycast(const Ray& ray, FunctionRef<std::optional<float>(uint32_t item)> intersect) const;
+
+        [[nodiscard]] uint32_t getObjectCount() const noexcept;
+        [[nodiscard]] uint32_t getNodeCount() const noexcept;
+        // sum of node surface areas relative to the root's, lower is better
+        [[nodiscard]] float getCost() const;
+
+    private:
+        // leaf when `skip` is the next node; a node's objects are objects [first, nodes[skip].first)
+        struct Node {
+            glm::vec3 min;
+            uint32_t first;
+            glm::vec3 max;
+            uint32_t skip;
+        };
+        static_assert(sizeof(Node) == 32);
+
+        struct Object {
+            Aabb bounds;
+            uint32_t item = 0;
+            // where the last rebuild put the object, UINT32_MAX if it came after it
+            uint32_t position = UINT32_MAX;
+            uint32_t leaf = UINT32_MAX;
+            bool alive = false;
+        };
+
+        struct BuildNode {
+            Aabb bounds;
+            uint32_t first;
+            uint32_t count;
+            // children are allocated in pairs, left and left + 1; 0 for leaves
+            uint32_t left = 0;
+        };
+
+        class Builder;
+
+        // throws for proxies that were never added or are removed
+        void checkProxy(BvhProxy proxy) const;
+        void refit(uint32_t node);
+        [[nodiscard]] bool isLeaf(uint32_t node) const noexcept {
+            return m_Nodes[node].skip == node + 1;
+        }
+        [[nodiscard]] uint32_t getNodeEnd(uint32_t node) const noexcept {
+            return m_Nodes[m_Nodes[node].skip].first;
+        }
+
+        JobSystem& m_Jobs;
+
+        std::vector<Object> m_Objects;
+        std::vector<BvhProxy> m_FreeProxies;
+        uint32_t m_ObjectCount = 0;
+
+        // depth-first, followed by a sentinel whose `first` is the object count
+        std::vector<Node> m_Nodes;
+        std::vector<uint32_t> m_Parents;
+        // the objects' bounds and items in leaf order, which node ranges index
+        std::vector<Aabb> m_LeafBounds;
+        std::vector<uint32_t> m_LeafItems;
+
+        bool m_StructureChanged = false;
+        std::vector<BvhProxy> m_Moved;
+        std::vector<uint8_t> m_RefitMarks;
+        std::vector<uint32_t> m_RefitNodes;
+        // objects moved since the last rebuild, and the tree's cost right after it
+        size_t m_MovedSinceBuild = 0;
+        float m_BuiltCost = 0.0f;
+    };
+}
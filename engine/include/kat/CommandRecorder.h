@@ -0,0 +1,58 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include "kat/FunctionRef.h"
+
+namespace kat {
+
+    // What one job records: the items [begin, end) of the frame's draw list into a secondary command buffer that
+    // continues the current render pass. `worker` is the recording thread's job system worker index (or
+    // getWorkerCount() for a thread outside the job system), handy for indexing per-thread scratch data.
+    struct RecordContext {
+        vk::CommandBuffer commandBuffer;
+        uint32_t worker;
+        uint32_t chunk;
+        uint32_t chunkCount;
+        size_t begin;
+        size_t end;
+    };
+
+    using RecordFunction = FunctionRef<void(const RecordContext&)>;
+
+    // Splits a draw list into chunks recorded in parallel on the job system. Every worker thread owns a command
+    // pool per frame in flight and records its chunks into secondary buffers from it; a frame's pools are reset in
+    // bulk by beginFrame().
+    class ParallelCommandRecorder {
+    public:
+        static constexpr size_t kMinItemsPerChunk = 64;
+
+        ParallelCommandRecorder(std::shared_ptr<App> app, size_t framesInFlight);
+
+        void cleanup();
+
+        // The GPU must have finished the frame that last used this slot.
+        void beginFrame(size_t frameIndex);
+
+        // Returns once every chunk is recorded, with the secondary buffers to execute in draw list order.
+        std::span<const vk::CommandBuffer> record(const vk::CommandBufferInheritanceInfo& inheritance, size_t itemCount, RecordFunction fn);
+
+    private:
+        struct ThreadCommandPool {
+            vk::CommandPool pool;
+            std::vector<vk::CommandBuffer> buffers;
+            size_t used = 0;
+        };
+
+        vk::CommandBuffer acquireBuffer(uint32_t worker);
+
+        std::shared_ptr<App> m_App;
+        JobSystem& m_Jobs;
+        uint32_t m_ThreadSlots;
+
+        // [frame][worker], plus one trailing slot for a recording thread outside the job system
+        std::vector<std::vector<ThreadCommandPool>> m_Frames;
+        size_t m_CurrentFrame = 0;
+
+        std::vector<vk::CommandBuffer> m_Recorded;
+    };
+}
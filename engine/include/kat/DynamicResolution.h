@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cinttypes>
+#include "vulkan/vulkan.hpp"
+
+namespace kat {
+
+    // Renders the scene at a fraction of the swapchain resolution that follows the GPU frame time, then upscales it
+    // to the swapchain. The scale drops as soon as frames run over budget and only creeps back up once they have been
+    // comfortably under it for a while, so it doesn't bounce between two scales either side of the budget.
+    struct DynamicResolution {
+        bool enabled = false;
+        // per axis, of the swapchain extent
+        float min_scale = 0.5f;
+        float max_scale = 1.0f;
+        // GPU time a frame may take, in seconds
+        double target_gpu_time = 1.0 / 60.0;
+        // the scale only rises while frames take less than this fraction of the target
+        double raise_threshold = 0.8;
+        // consecutive frames over the target before dropping, and under the raise threshold before raising
+        uint32_t drop_frames = 3;
+        uint32_t raise_frames = 60;
+    };
+
+    // Picks the resolution scale from GPU frame times. The renderer feeds it every frame's GPU time as it's read
+    // back, from a single thread; any thread may read the scale and the stats.
+    class ResolutionController {
+    public:
+        static constexpr float kMinScale = 0.1f;
+        static constexpr float kMaxScale = 2.0f;
+        // scales are multiples of this, so noise in the frame times doesn't change the extent every time
+        static constexpr float kScaleQuantum = 1.0f / 64.0f;
+        // biggest rise in one change; drops go straight to the estimate
+        static constexpr float kMaxRaiseStep = 0.125f;
+
+        // `latency` is the number of frames between a change and the first GPU time measured at the new scale.
+        // Call before the renderer starts.
+        void configure(const DynamicResolution& config, uint32_t latency);
+        // For renderers that can't scale; the scale reads 1 from then on.
+        void disable();
+
+        [[nodiscard]] bool isEnabled() const noexcept;
+        [[nodiscard]] const DynamicResolution& getConfig() const noexcept;
+
+        // Fixes the scale (clamped to the configured range) until the next configure(); update() only records GPU
+        // times meanwhile. For replaying frames at the scale they were captured at.
+        void hold(float scale);
+
+        // Returns true when the scale changed.
+        bool update(double gpuTime);
+
+        // 1 when disabled
+        [[nodiscard]] float getScale() const noexcept;
+        // `extent` at the current scale, at least 1x1
+        [[nodiscard]] vk::Extent2D getScaledExtent(vk::Extent2D extent) const noexcept;
+        // `extent` at the maximum scale, which no scaled extent exceeds
+        [[nodiscard]] vk::Extent2D getMaxExtent(vk::Extent2D extent) const noexcept;
+        // GPU time of the last frame update() was given, in seconds
+        [[nodiscard]] double getGpuTime() const noexcept;
+        [[nodiscard]] uint64_t getChangeCount() const noexcept;
+
+        [[nodiscard]] static vk::Extent2D scaleExtent(vk::Extent2D extent, float scale) noexcept;
+
+    private:
+        void resetStreaks();
+
+        DynamicResolution m_Config{};
+        uint32_t m_Latency = 0;
+
+        std::atomic<bool> m_Enabled{false};
+        bool m_Held = false;
+        std::atomic<float> m_Scale{1.0f};
+        std::atomic<double> m_GpuTime{0.0};
+        std::atomic<uint64_t> m_Changes{0};
+
+        // samples still recorded at the previous scale
+        uint32_t m_IgnoredFrames = 0;
+        // the current run of frames over the target (drop) or under the raise threshold (raise), and its total time
+        uint32_t m_DropStreak = 0;
+        uint32_t m_RaiseStreak = 0;
+        double m_StreakTime = 0.0;
+    };
+}
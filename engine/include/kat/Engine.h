@@ -8,9 +8,20 @@
 #include <concepts>
 #include <glm/glm.hpp>
 #include <variant>
+#include <span>
 #include <unordered_set>
+#include <mutex>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <thread>
 #include "vulkan/vulkan.hpp"
 #include <GLFW/glfw3.h>
+#include "kat/Stats.h"
+#include "kat/DynamicResolution.h"
+#include "kat/JobSystem.h"
+#include "kat/GpuAllocator.h"
+#include "kat/StartupTimeline.h"
 
 namespace kat {
 
@@ -37,6 +48,18 @@ namespace kat {
         double getAverageFramesPerSecond();
         size_t getFrameCount();
 
+        // Safe to call from any thread while the app is running.
+        FrameStats getFrameStats();
+        FrameStats getRecentFrameStats();
+        const FrameTimeHistogram& getFrameTimeHistogram();
+
+        void setHitchBudget(duration budget);
+
+        // Configured from AppConfig::dynamic_resolution and fed GPU frame times by the renderer.
+        ResolutionController& getResolutionController();
+        // of the swapchain extent, per axis, the scene renders at; 1 without dynamic resolution
+        float getResolutionScale();
+
         void nextFrame();
 
     private:
@@ -44,10 +67,13 @@ namespace kat {
         static constexpr double kSmoothingConstant = 0.9;
 
         time_point startTime, lastFrame;
-        duration lastFrameTime;
+        duration lastFrameTime{0.0};
         size_t frameCount = 0;
-        double lastFpsExact;
-        double lastFpsSmooth;
+        double lastFpsExact = 0.0;
+        double lastFpsSmooth = 0.0;
+
+        FrameTimeHistogram frameTimes;
+        ResolutionController resolution;
     };
 
     struct WindowedWindowMode {
@@ -62,14 +88,80 @@ namespace kat {
         size_t monitor_id = 0;
     };
 
+    // Renders into offscreen images instead of a window/swapchain, so no display or surface support is needed.
+    // frame_limit stops the app after that many frames (0 runs until stop() is called).
+    struct HeadlessWindowMode {
+        glm::ivec2 size{800, 800};
+        uint32_t image_count = 3;
+        size_t frame_limit = 0;
+    };
+
+    // How frames reach the display. Immediate tears but has the lowest latency, Mailbox replaces queued frames
+    // instead of blocking, FIFO is vsync and FIFO relaxed tears only when a frame misses vblank. Unsupported modes
+    // fall back towards FIFO, which is always available.
+    struct LatencyPolicy {
+        vk::PresentModeKHR present_mode = vk::PresentModeKHR::eMailbox;
+        // swapchain images, 0 picks one more than the minimum; fewer images queue less latency
+        uint32_t image_count = 0;
+    };
+
+    // Lowest input latency for competitive play, at the cost of tearing.
+    constexpr LatencyPolicy kLowLatencyPolicy{vk::PresentModeKHR::eImmediate, 2};
+
+    // Simulation at a fixed rate, decoupled from rendering: App::fixedUpdate() runs `rate` times a second while
+    // update() still runs once per frame and draws between the last two steps with App::getInterpolationAlpha().
+    struct FixedTimestep {
+        // steps per second, 0 disables fixedUpdate()
+        double rate = 0.0;
+        // when the simulation falls more than this many steps behind, the time is dropped rather than caught up on,
+        // so a slow step can't make every later frame slower still
+        uint32_t max_steps = 8;
+        // runs fixedUpdate() on its own thread; hand its results to update() through a TripleBuffer
+        bool threaded = false;
+    };
+
+    // Records frame_count frames, from frame first_frame on, into a capture file kat_replay re-executes headless: the
+    // passes of every frame, GPU scene contents and changes, and uploads. 0 frames captures nothing.
+    struct FrameCaptureConfig {
+        std::string path = "frame_capture.kcap";
+        uint64_t first_frame = 1;
+        uint32_t frame_count = 0;
+    };
+
+    // Upper bound for AppConfig::frames_in_flight.
+    constexpr uint32_t kMaxFramesInFlight = 4;
+    // Upper bound for the frame packets a RenderThread holds that the render thread hasn't finished.
+    constexpr uint32_t kMaxQueuedFrames = 2;
+
     struct AppConfig {
         std::string app_name = "App";
         version app_version{0, 0, 1};
 
-        std::variant<WindowedWindowMode, FullscreenWindowMode> window_mode = FullscreenWindowMode(0);
+        std::variant<WindowedWindowMode, FullscreenWindowMode, HeadlessWindowMode> window_mode = FullscreenWindowMode(0);
+
+        LatencyPolicy latency{};
+        // frames the CPU may record ahead of the GPU (1-4); more overlap for more latency
+        uint32_t frames_in_flight = 2;
+
+        // where compiled pipelines are kept between runs, empty keeps them in memory only
+        std::string pipeline_cache_path = "pipeline_cache.bin";
+
+        FixedTimestep fixed_timestep{};
+
+        DynamicResolution dynamic_resolution{};
+
+        FrameCaptureConfig capture{};
     };
 
     class Engine;
+    class UploadService;
+    class PipelineCache;
+    class BindlessRegistry;
+    class TextureStreamer;
+    class World;
+    class SystemScheduler;
+    class RenderThread;
+    class FrameCapture;
 
     class App {
     public:
@@ -78,14 +170,34 @@ namespace kat {
         virtual ~App();
 
         void setEngine(Engine* engine);
+        Engine* getEngine();
+        JobSystem& getJobSystem();
 
         [[nodiscard]] bool isRunning() const noexcept;
+        [[nodiscard]] bool isHeadless() const noexcept;
 
         void stop();
 
+        // Runs on a worker while the swapchain is created, before setup(): the place to read files and compile
+        // pipelines. The device, the job system, the pipeline cache and the upload service are ready; the swapchain
+        // and anything that is main thread only (the texture streamer, the world) aren't.
+        virtual void preload() {}
         virtual void setup() = 0;
         virtual void update(double dt) = 0;
         virtual void cleanup() = 0;
+        // With AppConfig::fixed_timestep set, runs that many times a second with dt = 1 / rate: before update() on
+        // the main thread, or on the simulation thread when it's threaded, started after setup() and stopped
+        // before cleanup().
+        virtual void fixedUpdate(double dt) {}
+
+        // How far this frame is from the last fixed step towards the next one (0-1), to draw the state in between:
+        // previous + (latest - previous) * alpha. Threaded, it's measured from the step the simulation thread
+        // finished last.
+        [[nodiscard]] double getInterpolationAlpha() const;
+        // fixed steps run so far
+        [[nodiscard]] uint64_t getSimulationStep() const noexcept;
+
+        AppClock& getClock();
 
         vk::Device getDevice();
         vk::SwapchainKHR getSwapchain();
@@ -93,12 +205,72 @@ namespace kat {
         vk::Queue getPresentQueue();
         uint32_t getGraphicsFamily();
         uint32_t getPresentFamily();
-        std::vector<vk::Image> getSwapchainImages();
-        std::vector<vk::ImageView> getSwapchainImageViews();
+        vk::Queue getTransferQueue();
+        uint32_t getTransferFamily();
+        // True when uploads have to go through the graphics queue itself.
+        [[nodiscard]] bool isTransferQueueShared() const noexcept;
+        // Held around every submit to the graphics and present queues, which uploads may share.
+        std::mutex& getGraphicsQueueMutex();
+        const vk::QueueFamilyProperties& getQueueFamilyProperties(uint32_t family);
+        std::span<const vk::Image> getSwapchainImages();
+        std::span<const vk::ImageView> getSwapchainImageViews();
         vk::Format getSwapchainFormat();
+        // always includes eColorAttachment, and eTransferDst where the surface allows it
+        vk::ImageUsageFlags getSwapchainImageUsage();
+        // Belongs to the thread that renders; others use getFramebufferSize().
         vk::Extent2D getSwapchainExtent();
+        // Size of the window's framebuffer in pixels (of the offscreen images when headless), safe from any thread.
+        [[nodiscard]] glm::ivec2 getFramebufferSize() const noexcept;
         vk::PresentModeKHR getPresentMode();
-
+        vk::ImageLayout getFinalImageLayout();
+
+        // Recreates the swapchain first if it went out of date. Returns nothing when there is no image to render to
+        // this frame (out of date or minimized), in which case the semaphore isn't signalled.
+        std::optional<uint32_t> acquireNextImage(vk::Semaphore signalSemaphore);
+        void presentImage(uint32_t imageIndex, vk::Semaphore waitSemaphore);
+        // Bumped whenever the swapchain, and with it the image views, is recreated.
+        [[nodiscard]] uint64_t getSwapchainGeneration() const noexcept;
+
+        // The frame timeline: the submit of frame N signals value N. Waiting on it is how anything tied to the frame
+        // loop (deletions, per-frame resources, query readback) learns that the GPU is done with a frame.
+        vk::Semaphore getFrameTimeline();
+        [[nodiscard]] uint32_t getFramesInFlight() const noexcept;
+        // the frame being recorded, starting at 1
+        [[nodiscard]] uint64_t getFrameNumber() const noexcept;
+        uint64_t getCompletedFrame();
+        void waitForFrame(uint64_t frame);
+
+        // Starts the next frame: waits until the GPU has finished the frame that last used its frame-in-flight slot,
+        // then runs the deletions that became safe. Returns the new frame number.
+        uint64_t beginFrame();
+        // Signals the current frame's timeline value without any work, for a frame that had nothing to present to.
+        void skipFrame();
+
+        // The last frame that may still use what the calling thread lets go of now: the frame being recorded, or on
+        // the main thread while a RenderThread runs, the frame that will render the packet being built.
+        [[nodiscard]] uint64_t getRetireFrame() const noexcept;
+        // Runs `deleter` once the GPU has finished getRetireFrame(). Safe from any thread.
+        void deferDeletion(std::function<void()> deleter);
+
+        uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties);
+        DeviceAllocator& getDeviceAllocator();
+        UploadService& getUploadService();
+        PipelineCache& getPipelineCache();
+        BindlessRegistry& getBindlessRegistry();
+        // updated every frame before update()
+        TextureStreamer& getTextureStreamer();
+        // null unless AppConfig::capture asks for frames; stays around after the capture is written
+        FrameCapture* getFrameCapture();
+
+        // Set by RenderThread: the app stops it before idling the device for cleanup(), the GPU queues belong to it
+        // until then.
+        void setRenderThread(RenderThread* renderThread);
+
+        // Systems added in setup() run over the world every frame, before update().
+        World& getWorld();
+        SystemScheduler& getSystems();
+
+        [[nodiscard]] bool isExtensionEnabled(const std::string& name) const;
 
     protected:
         AppConfig m_Configuration{};
@@ -112,23 +284,74 @@ namespace kat {
         AppClock m_Clock;
 
     private:
-        GLFWwindow* m_Window;
+        void createWindow();
+        void createDevice();
+        void createSwapchain(vk::SwapchainKHR oldSwapchain = {});
+        bool recreateSwapchain();
+        void runDeferredDeletions(bool all);
+        static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+        void createOffscreenImages();
+        void createSwapchainImageViews();
+        void runFixedSteps(double dt);
+        void startSimulationThread();
+        void stopSimulationThread();
+
+        GLFWwindow* m_Window = nullptr;
         bool m_Running = false;
         vk::SurfaceKHR m_Surface;
         vk::Device m_Device;
         vk::SwapchainKHR m_Swapchain;
         vk::Queue m_GraphicsQueue;
         vk::Queue m_PresentQueue;
+        vk::Queue m_TransferQueue;
         std::optional<uint32_t> m_GraphicsFamily;
         std::optional<uint32_t> m_PresentFamily;
+        std::optional<uint32_t> m_TransferFamily;
+        std::mutex m_GraphicsQueueMutex;
         bool m_SameQueueFamily;
+        std::vector<vk::QueueFamilyProperties> m_QueueFamilies;
+        std::unique_ptr<DeviceAllocator> m_DeviceAllocator;
+        std::unique_ptr<UploadService> m_UploadService;
+        std::unique_ptr<PipelineCache> m_PipelineCache;
+        std::unique_ptr<BindlessRegistry> m_BindlessRegistry;
+        std::unique_ptr<TextureStreamer> m_TextureStreamer;
+        std::unique_ptr<FrameCapture> m_FrameCapture;
+        std::unique_ptr<World> m_World;
+        std::unique_ptr<SystemScheduler> m_Systems;
+        std::unordered_set<std::string> m_EnabledDeviceExtensions;
 
         std::vector<vk::Image> m_SwapchainImages;
         std::vector<vk::ImageView> m_SwapchainImageViews;
+        std::vector<AllocatedImage> m_OffscreenImages;
+        uint32_t m_OffscreenImageIndex = 0;
 
         vk::PresentModeKHR m_PresentMode;
         vk::Format m_SwapchainFormat;
+        vk::ImageUsageFlags m_SwapchainImageUsage;
         vk::Extent2D m_SwapchainExtent;
+        // written by the GLFW callback on the main thread, read by whichever thread renders
+        std::atomic<glm::ivec2> m_FramebufferSize{glm::ivec2{0, 0}};
+        std::atomic<bool> m_SwapchainDirty{false};
+        uint64_t m_SwapchainGeneration = 0;
+
+        vk::Semaphore m_FrameTimeline;
+        uint32_t m_FramesInFlight = 2;
+        std::atomic<uint64_t> m_FrameNumber{0};
+        std::mutex m_DeletionMutex;
+        std::deque<std::pair<uint64_t, std::function<void()>>> m_DeferredDeletions;
+        std::thread::id m_MainThread;
+        RenderThread* m_RenderThread = nullptr;
+
+        double m_FixedStep = 0.0;
+        double m_Accumulator = 0.0;
+        std::atomic<uint64_t> m_SimulationStep{0};
+        // threaded: when the last finished step was due, in steady_clock ticks
+        std::atomic<int64_t> m_LastStepDue{0};
+        std::thread m_SimulationThread;
+        std::atomic<bool> m_SimulationRunning{false};
+        // set by the simulation thread when fixedUpdate() throws, rethrown by the next updateApp()
+        std::exception_ptr m_SimulationError;
+        std::atomic<bool> m_SimulationFailed{false};
     };
 
     template<typename T>
@@ -152,21 +375,33 @@ namespace kat {
         [[nodiscard]] bool supportsLayer(const std::string& name) const;
 
         vk::Instance getInstance();
+        JobSystem& getJobSystem();
+        // Stages of init() and App::setupApp(), reported once the app is set up.
+        StartupTimeline& getStartupTimeline();
         [[nodiscard]] const vk::PhysicalDevice &getGpu() const;
 
+        [[nodiscard]] const vk::PhysicalDeviceProperties &getGpuProperties() const;
         [[nodiscard]] const vk::PhysicalDeviceFeatures &getGpuFeatures() const;
+        [[nodiscard]] const vk::PhysicalDeviceVulkan12Features &getGpuFeatures12() const;
 
     private:
 
         std::shared_ptr<App> m_RunningApp;
+        std::unique_ptr<JobSystem> m_JobSystem;
 
         vk::Instance m_Instance;
         vk::PhysicalDevice m_Gpu;
         vk::PhysicalDeviceProperties m_GpuProperties;
         vk::PhysicalDeviceFeatures m_GpuFeatures;
+        vk::PhysicalDeviceVulkan12Features m_GpuFeatures12;
 
         void init();
         void cleanup();
+        // every limit, feature, extension and layer of the GPU, at debug level
+        void logCapabilities() const;
+
+        StartupTimeline m_Startup;
+        JobCounter m_CapabilityLog;
 
         std::vector<vk::ExtensionProperties> m_SupportedDeviceExtensions;
         std::vector<vk::LayerProperties> m_SupportedDeviceLayers;
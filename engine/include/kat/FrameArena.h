@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kat {
+
+    // Bump allocator for transient data whose lifetime ends at a known point (e.g. when the GPU finishes a frame).
+    // Nothing allocated from it is destroyed, so only trivially destructible types may be placed in it.
+    // Running out of space falls back to extra heap blocks, which are folded into one larger block on the
+    // next reset(), so a steady-state workload stops allocating after its first few frames.
+    class LinearArena {
+    public:
+        explicit LinearArena(size_t capacity = kDefaultCapacity);
+
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        template<typename T, typename... Args>
+        T* create(Args&&... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "LinearArena never runs destructors");
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        template<typename T>
+        std::span<T> allocateArray(size_t count) {
+            static_assert(std::is_trivially_destructible_v<T>, "LinearArena never runs destructors");
+            T* data = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+            for (size_t i = 0; i < count; i++) {
+                new (data + i) T();
+            }
+            return {data, count};
+        }
+
+        template<typename T>
+        std::span<T> copyArray(std::span<const T> source) {
+            std::span<T> dest = allocateArray<T>(source.size());
+            std::copy(source.begin(), source.end(), dest.begin());
+            return dest;
+        }
+
+        void reset();
+
+        [[nodiscard]] size_t getUsed() const noexcept;
+        [[nodiscard]] size_t getCapacity() const noexcept;
+        [[nodiscard]] size_t getHighWaterMark() const noexcept;
+
+        static constexpr size_t kDefaultCapacity = 64 * 1024;
+
+    private:
+        std::unique_ptr<std::byte[]> m_Memory;
+        size_t m_Capacity;
+        size_t m_Offset = 0;
+        size_t m_HighWaterMark = 0;
+
+        std::vector<std::unique_ptr<std::byte[]>> m_Overflow;
+        size_t m_OverflowBytes = 0;
+    };
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include "kat/GpuScene.h"
+#include "kat/RenderGraph.h"
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace kat {
+
+    // A capture file is a header followed by records, each a type byte and a 32 bit payload size, so readers skip
+    // records they don't know. Everything is little endian, in the layout of this build's structs. Records issued
+    // between two frame records belong to the later frame; the records before the first frame are the state the
+    // capture started from (a snapshot of every GPU scene). Pipeline state isn't recorded: the engine's passes build
+    // their pipelines from the running build's shaders, so only the passes each frame ran are kept to check a replay
+    // against.
+    enum class CaptureRecord : uint8_t {
+        eFrame = 1,
+        eUpload,
+        eSceneCreate,
+        eSceneMesh,
+        eSceneInstances,
+        eSceneView,
+    };
+
+    struct CaptureHeader {
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent2D extent;
+        // dynamic resolution's maximum scale, 0 when it was off
+        float maxScale = 0.0f;
+        uint32_t frameCount = 0;
+        std::string device;
+    };
+
+    struct CapturedPass {
+        std::string name;
+        PassType type;
+        // the render area graphics passes ran at
+        vk::Extent2D extent;
+    };
+
+    // Only the size of an upload is kept; its contents don't change what moving it costs.
+    struct CapturedUpload {
+        bool image;
+        uint64_t size;
+    };
+
+    struct CapturedSceneCreate {
+        uint32_t scene;
+        GpuSceneConfig config;
+    };
+
+    struct CapturedMesh {
+        uint32_t scene;
+        std::vector<SceneVertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<GpuMeshLod> lods;
+    };
+
+    struct CapturedInstances {
+        uint32_t scene;
+        // added at the end of the scene, otherwise overwriting from `first` on
+        bool add;
+        uint32_t first;
+        std::vector<GpuInstance> instances;
+    };
+
+    struct CapturedView {
+        uint32_t scene;
+        SceneView view;
+    };
+
+    using CapturedCommand = std::variant<CapturedUpload, CapturedSceneCreate, CapturedMesh, CapturedInstances, CapturedView>;
+
+    struct CapturedFrame {
+        uint64_t number = 0;
+        // CPU time of Renderer::render()
+        double cpuTime = 0.0;
+        float resolutionScale = 1.0f;
+        // items of the app's draw list; they are recorded by app code straight into command buffers, so only their
+        // number is known
+        uint64_t drawItems = 0;
+        // the scene the renderer drew, FrameCapture::kNoScene for none
+        uint32_t scene = UINT32_MAX;
+        std::vector<CapturedPass> passes;
+        // issued since the previous frame, in order
+        std::vector<CapturedCommand> commands;
+    };
+
+    struct CaptureFile {
+        CaptureHeader header;
+        std::vector<CapturedFrame> frames;
+    };
+
+    // Throws when the file can't be read or isn't a capture of this version.
+    CaptureFile loadFrameCapture(const std::filesystem::path& path);
+
+    // Records what the engine does over a few frames (AppConfig::capture) and writes it to a file once the last one is
+    // rendered. GPU scenes are followed from their creation so the capture can start from a snapshot of them; uploads
+    // are only recorded once the capture window is open. Any thread may record.
+    class FrameCapture {
+    public:
+        static constexpr uint32_t kFileMagic = 0x5041434B; // "KCAP"
+        static constexpr uint32_t kFileVersion = 1;
+        static constexpr uint32_t kNoScene = UINT32_MAX;
+
+        FrameCapture(App& app, const FrameCaptureConfig& config);
+
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        // Writes the frames captured so far when the capture didn't get to all of them.
+        void cleanup();
+
+        [[nodiscard]] bool isFinished() const;
+
+        // Called by GpuScene; returns the scene's ID in the capture.
+        uint32_t addScene(const GpuScene* scene, const GpuSceneConfig& config);
+        void addMesh(const GpuScene* scene, std::span<const SceneVertex> vertices, std::span<const uint32_t> indices, std::span<const GpuMeshLod> lods);
+        void setInstances(const GpuScene* scene, bool add, uint32_t first, std::span<const GpuInstance> instances);
+        void setView(const GpuScene* scene, const SceneView& view);
+        // kNoScene for a scene the capture doesn't know
+        [[nodiscard]] uint32_t getSceneId(const GpuScene* scene) const;
+
+        // Uploads into `buffer` are already described by other records (a scene's), so they aren't recorded again.
+        void excludeBuffer(vk::Buffer buffer);
+        // Called by UploadService, with a null buffer for image uploads.
+        void recordUpload(vk::Buffer buffer, vk::DeviceSize size);
+
+        // Called by Renderer once a frame is submitted; frame records how its passes ran.
+        void recordFrame(const CapturedFrame& frame);
+
+    private:
+        // Scene state followed until the capture window opens.
+        struct SceneSnapshot {
+            const GpuScene* scene;
+            GpuSceneConfig config;
+            // encoded mesh records, in order
+            std::vector<std::byte> meshes;
+            std::vector<GpuInstance> instances;
+            std::optional<SceneView> view;
+        };
+
+        void open();
+        void write();
+        uint32_t findScene(const GpuScene* scene) const;
+
+        App& m_App;
+        FrameCaptureConfig m_Config;
+
+        mutable std::mutex m_Mutex;
+        bool m_Open = false;
+        bool m_Finished = false;
+        uint32_t m_Frames = 0;
+        // of the first captured frame
+        vk::Format m_Format = vk::Format::eUndefined;
+        vk::Extent2D m_Extent;
+        float m_MaxScale = 0.0f;
+
+        std::vector<SceneSnapshot> m_Scenes;
+        std::vector<vk::Buffer> m_ExcludedBuffers;
+        std::vector<std::byte> m_Records;
+    };
+}
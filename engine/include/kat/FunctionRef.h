@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace kat {
+
+    template<typename Fn>
+    class FunctionRef;
+
+    // Non-owning, non-allocating reference to a callable. The callable must outlive every call through it.
+    template<typename R, typename... Args>
+    class FunctionRef<R(Args...)> {
+    public:
+        FunctionRef() = default;
+
+        template<typename F>
+            requires (!std::is_same_v<std::remove_cvref_t<F>, FunctionRef> && std::is_invocable_r_v<R, F&, Args...>)
+        FunctionRef(F&& f) noexcept
+            : m_Object(const_cast<void*>(static_cast<const void*>(std::addressof(f)))),
+              m_Call([](void* object, Args... args) -> R {
+                  return std::invoke(*static_cast<std::remove_reference_t<F>*>(object), std::forward<Args>(args)...);
+              }) {
+        }
+
+        R operator()(Args... args) const {
+            return m_Call(m_Object, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept {
+            return m_Call != nullptr;
+        }
+
+    private:
+        void* m_Object = nullptr;
+        R (*m_Call)(void*, Args...) = nullptr;
+    };
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "vulkan/vulkan.hpp"
+#include <array>
+#include <cinttypes>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace kat {
+
+    // Two-level segregated fit allocator over an abstract range [0, size); only bookkeeping, no memory of its own.
+    // Allocation and free are O(1). Offsets and sizes are in bytes, kept at multiples of kGranularity.
+    class TlsfAllocator {
+    public:
+        static constexpr uint64_t kGranularity = 256;
+        static constexpr uint32_t kInvalidNode = UINT32_MAX;
+
+        struct Allocation {
+            uint64_t offset;
+            uint32_t node;
+        };
+
+        explicit TlsfAllocator(uint64_t size);
+
+        // Size of an empty allocator that is sure to fit one allocation of `size` bytes at `alignment`; free ranges
+        // are searched by bucket, so that is more than the aligned size.
+        static uint64_t getRequiredSize(uint64_t size, uint64_t alignment);
+
+        std::optional<Allocation> allocate(uint64_t size, uint64_t alignment);
+        void free(uint32_t node);
+
+        [[nodiscard]] uint64_t getSize() const noexcept;
+        [[nodiscard]] uint64_t getUsed() const noexcept;
+        [[nodiscard]] uint64_t getLargestFreeRange() const noexcept;
+        [[nodiscard]] bool isEmpty() const noexcept;
+
+    private:
+        static constexpr uint32_t kSecondLevelLog2 = 5;
+        static constexpr uint32_t kSecondLevelCount = 1U << kSecondLevelLog2;
+        static constexpr uint32_t kFirstLevelCount = 40;
+
+        struct Node {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint32_t prevPhysical = kInvalidNode;
+            uint32_t nextPhysical = kInvalidNode;
+            uint32_t prevFree = kInvalidNode;
+            uint32_t nextFree = kInvalidNode;
+            bool free = false;
+        };
+
+        static void mapping(uint64_t units, uint32_t& fl, uint32_t& sl);
+        uint32_t createNode();
+        void releaseNode(uint32_t node);
+        void insertFree(uint32_t node);
+        void removeFree(uint32_t node);
+        uint32_t findFree(uint64_t units);
+        void split(uint32_t node, uint64_t units);
+
+        uint64_t m_Size;
+        uint64_t m_Used = 0;
+        std::vector<Node> m_Nodes;
+        std::vector<uint32_t> m_UnusedNodes;
+        uint64_t m_FirstLevelBitmap = 0;
+        std::array<uint32_t, kFirstLevelCount> m_SecondLevelBitmaps{};
+        std::array<std::array<uint32_t, kSecondLevelCount>, kFirstLevelCount> m_FreeHeads{};
+    };
+
+    enum class AllocationStrategy {
+        // long-lived resources, freed individually (TLSF)
+        eGeneral,
+        // transient resources, freed all at once by DeviceAllocator::resetLinear()
+        eLinear
+    };
+
+    enum class ResourceKind {
+        // buffers and linear-tiling images
+        eLinear,
+        eOptimalImage
+    };
+
+    struct AllocationDesc {
+        vk::MemoryPropertyFlags required = vk::MemoryPropertyFlagBits::eDeviceLocal;
+        vk::MemoryPropertyFlags preferred = {};
+        AllocationStrategy strategy = AllocationStrategy::eGeneral;
+        // may be relocated by defragmentation
+        bool movable = false;
+    };
+
+    struct GpuAllocation;
+
+    // One vkAllocateMemory, sub-allocated with TLSF (eGeneral) or bumped linearly (eLinear).
+    struct MemoryBlock {
+        vk::DeviceMemory memory;
+        vk::DeviceSize size = 0;
+        uint32_t memoryType = 0;
+        ResourceKind kind = ResourceKind::eLinear;
+        AllocationStrategy strategy = AllocationStrategy::eGeneral;
+        bool dedicated = false;
+        void* mapped = nullptr;
+        std::optional<TlsfAllocator> tlsf;
+        vk::DeviceSize linearOffset = 0;
+        std::vector<GpuAllocation*> allocations;
+    };
+
+    struct GpuAllocation {
+        vk::DeviceMemory memory;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        // persistently mapped pointer for host-visible memory, otherwise null
+        void* mapped = nullptr;
+        uint32_t memoryType = 0;
+
+    private:
+        friend class DeviceAllocator;
+
+        MemoryBlock* block = nullptr;
+        uint32_t node = TlsfAllocator::kInvalidNode;
+        size_t indexInBlock = 0;
+        // from the resource's memory requirements, kept for relocating it
+        vk::DeviceSize alignment = 1;
+        bool movable = false;
+    };
+
+    struct AllocatedBuffer {
+        vk::Buffer buffer;
+        GpuAllocation* allocation = nullptr;
+    };
+
+    struct AllocatedImage {
+        vk::Image image;
+        GpuAllocation* allocation = nullptr;
+    };
+
+    struct GpuMemoryStats {
+        size_t deviceMemoryCount = 0;
+        size_t allocationCount = 0;
+        vk::DeviceSize reservedBytes = 0;
+        vk::DeviceSize usedBytes = 0;
+    };
+
+    // Planned relocation of an allocation. The caller creates a new resource at the destination, copies the
+    // contents on the GPU and, once that copy has completed, calls endDefragmentation().
+    struct DefragmentationMove {
+        GpuAllocation* allocation;
+        vk::DeviceMemory srcMemory;
+        vk::DeviceSize srcOffset;
+        vk::DeviceMemory dstMemory;
+        vk::DeviceSize dstOffset;
+        vk::DeviceSize size;
+    };
+
+    // Sub-allocates device memory out of large blocks, one set of blocks per memory type, resource kind and
+    // strategy. Linear resources and optimal images never share a block, which satisfies bufferImageGranularity.
+    class DeviceAllocator {
+    public:
+        static constexpr vk::DeviceSize kDefaultBlockSize = 64ULL * 1024 * 1024;
+
+        DeviceAllocator(vk::PhysicalDevice gpu, vk::Device device, vk::DeviceSize blockSize = kDefaultBlockSize);
+        ~DeviceAllocator();
+
+        DeviceAllocator(const DeviceAllocator&) = delete;
+        DeviceAllocator& operator=(const DeviceAllocator&) = delete;
+
+        GpuAllocation* allocate(const vk::MemoryRequirements& requirements, ResourceKind kind, const AllocationDesc& desc = {});
+        void free(GpuAllocation* allocation);
+
+        // Frees every eLinear allocation (calling free() on them is optional); the GPU must be done with all of them.
+        void resetLinear();
+
+        AllocatedBuffer createBuffer(const vk::BufferCreateInfo& createInfo, const AllocationDesc& desc = {});
+        AllocatedImage createImage(const vk::ImageCreateInfo& createInfo, const AllocationDesc& desc = {});
+        void destroyBuffer(AllocatedBuffer& buffer);
+        void destroyImage(AllocatedImage& image);
+
+        // Plans up to maxMoves relocations of movable allocations out of the emptiest blocks. The previous plan has to
+        // be ended first. Freeing an allocation drops its planned move.
+        std::vector<DefragmentationMove> beginDefragmentation(size_t maxMoves);
+        // Commits the planned moves and releases blocks that became empty.
+        void endDefragmentation();
+
+        [[nodiscard]] GpuMemoryStats getStats();
+        void logStats();
+
+    private:
+        struct Pool {
+            std::vector<std::unique_ptr<MemoryBlock>> blocks;
+            size_t lastUsedBlock = 0;
+        };
+
+        static constexpr size_t kResourceKinds = 2;
+        static constexpr size_t kStrategies = 2;
+
+        Pool& getPool(uint32_t memoryType, ResourceKind kind, AllocationStrategy strategy);
+        std::optional<uint32_t> findMemoryType(uint32_t typeBits, const AllocationDesc& desc) const;
+        MemoryBlock* createBlock(Pool& pool, uint32_t memoryType, vk::DeviceSize size, ResourceKind kind, AllocationStrategy strategy);
+        bool allocateFromBlock(MemoryBlock& block, const vk::MemoryRequirements& requirements, GpuAllocation& out);
+        void attach(MemoryBlock& block, GpuAllocation* allocation);
+        void detach(GpuAllocation* allocation);
+        GpuAllocation* newAllocation();
+        void recycle(GpuAllocation* allocation);
+        // destroys empty blocks, keeping at most `keepEmpty` of them around for reuse
+        void releaseEmptyBlocks(Pool& pool, size_t keepEmpty);
+
+        vk::Device m_Device;
+        vk::PhysicalDeviceMemoryProperties m_MemoryProperties;
+        vk::DeviceSize m_BlockSize;
+        uint32_t m_MaxMemoryAllocations;
+
+        std::mutex m_Mutex;
+        std::array<Pool, VK_MAX_MEMORY_TYPES * kResourceKinds * kStrategies> m_Pools;
+        std::deque<GpuAllocation> m_AllocationStorage;
+        std::vector<GpuAllocation*> m_FreeAllocations;
+        size_t m_DeviceMemoryCount = 0;
+        size_t m_LiveAllocations = 0;
+
+        std::vector<DefragmentationMove> m_PendingMoves;
+        std::vector<GpuAllocation> m_PendingDestinations;
+    };
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include "kat/Stats.h"
+#include <array>
+#include <functional>
+#include <optional>
+#include <string_view>
+
+namespace kat {
+
+    // Times named, nestable scopes on the GPU with timestamp queries.
+    // Each frame in flight owns one query pool; its results are read back (without waiting) the next time that
+    // frame slot is begun, which is after the frame timeline has passed the frame that last used it.
+    class GpuProfiler {
+    public:
+        static constexpr uint32_t kMaxScopesPerFrame = 64;
+        static constexpr uint32_t kMaxScopeDepth = 16;
+        static constexpr uint32_t kInvalidScope = UINT32_MAX;
+
+        GpuProfiler(std::shared_ptr<App> app, size_t framesInFlight);
+
+        void cleanup();
+
+        [[nodiscard]] bool isSupported() const noexcept;
+
+        // Must be recorded outside of a render pass, before any scope of this frame.
+        void beginFrame(vk::CommandBuffer commandBuffer, size_t frameIndex);
+
+        // `name` must outlive the profiler (string literals are the intended use).
+        uint32_t beginScope(vk::CommandBuffer commandBuffer, const char* name);
+        void endScope(vk::CommandBuffer commandBuffer, uint32_t scope);
+
+        // Call from the recording thread; the histograms themselves may be read from anywhere.
+        FrameStats getScopeStats(std::string_view name) const;
+        void forEachScope(const std::function<void(std::string_view name, uint32_t depth, const FrameTimeHistogram& times)>& fn) const;
+        // Forgets every scope's times, including those of frames not read back yet. Call from the recording thread.
+        void resetStats();
+        // GPU time of the frame the last beginFrame() read back, its outermost scopes added up, in seconds. Nothing
+        // when that frame's results weren't ready.
+        [[nodiscard]] std::optional<double> getCollectedFrameTime() const noexcept;
+
+    private:
+        struct ScopeTimings {
+            const char* name;
+            uint32_t depth;
+            FrameTimeHistogram times;
+        };
+
+        struct ScopeRecord {
+            uint32_t timings;
+            uint32_t query;
+            bool closed;
+        };
+
+        struct FrameQueries {
+            vk::QueryPool pool;
+            std::array<ScopeRecord, kMaxScopesPerFrame> scopes;
+            uint32_t scopeCount = 0;
+        };
+
+        void collect(FrameQueries& frame);
+        uint32_t findTimings(const char* name, uint32_t depth);
+
+        std::shared_ptr<App> m_App;
+
+        bool m_Supported = false;
+        double m_TimestampPeriod = 1.0;
+        uint64_t m_TimestampMask = UINT64_MAX;
+
+        std::vector<FrameQueries> m_Frames;
+        size_t m_CurrentFrame = 0;
+        std::optional<double> m_CollectedFrameTime;
+
+        std::array<uint32_t, kMaxScopeDepth> m_OpenScopes{};
+        uint32_t m_OpenScopeCount = 0;
+
+        std::vector<std::unique_ptr<ScopeTimings>> m_Timings;
+    };
+
+    class GpuScope {
+    public:
+        GpuScope(GpuProfiler& profiler, vk::CommandBuffer commandBuffer, const char* name);
+        ~GpuScope();
+
+        GpuScope(const GpuScope&) = delete;
+        GpuScope& operator=(const GpuScope&) = delete;
+
+    private:
+        GpuProfiler& m_Profiler;
+        vk::CommandBuffer m_CommandBuffer;
+        uint32_t m_Scope;
+    };
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include "kat/BindlessRegistry.h"
+#include "kat/RenderGraph.h"
+#include <array>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    struct SceneVertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+
+    struct GpuMeshLod {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+    };
+
+    // Mirrors `Instance` in shaders/gpu_scene.glsl.
+    struct GpuInstance {
+        glm::mat4 transform{1.0f};
+        glm::vec4 color{1.0f};
+        uint32_t mesh = 0;
+        std::array<uint32_t, 3> padding{};
+    };
+    static_assert(sizeof(GpuInstance) == 96);
+
+    struct GpuSceneConfig {
+        uint32_t max_instances = 1024 * 1024;
+        uint32_t max_meshes = 1024;
+        uint32_t max_vertices = 1024 * 1024;
+        uint32_t max_indices = 4 * 1024 * 1024;
+    };
+
+    struct SceneView {
+        glm::mat4 view{1.0f};
+        glm::mat4 projection{1.0f};
+        // LOD 0 is drawn up to this distance, every further LOD covers twice the distance of the one before
+        float lod_distance = 20.0f;
+    };
+
+    // GPU-driven instanced drawing. Meshes and instances live in device buffers; every frame a compute pass frustum
+    // culls the instances, picks a LOD per instance and writes compacted indirect draws, which a graphics pass then
+    // draws with a single vkCmdDrawIndexedIndirectCount. The CPU work per frame is the same for any instance count.
+    //
+    // Without drawIndirectCount the cull pass writes one draw per instance instead (culled ones with no instances),
+    // drawn with vkCmdDrawIndexedIndirect; without multiDrawIndirect those draws are issued one by one.
+    class GpuScene {
+    public:
+        static constexpr uint32_t kMaxLods = 4;
+
+        explicit GpuScene(App& app, const GpuSceneConfig& config = {});
+
+        GpuScene(const GpuScene&) = delete;
+        GpuScene& operator=(const GpuScene&) = delete;
+
+        void cleanup();
+
+        // `lods` index into `indices`, finest first. Returns the mesh index instances refer to.
+        uint32_t addMesh(std::span<const SceneVertex> vertices, std::span<const uint32_t> indices, std::span<const GpuMeshLod> lods);
+        // Returns the index of the first instance added. Instances reach the GPU in the next frame's scene_update
+        // pass, ordered against the frames still reading the instance buffer; any thread may add or update them.
+        uint32_t addInstances(std::span<const GpuInstance> instances);
+        // Overwrites instances [first, first + instances.size()), which must have been added.
+        void updateInstances(uint32_t first, std::span<const GpuInstance> instances);
+
+        void setView(const SceneView& view);
+
+        // Adds the instance update, cull and draw passes, drawing over `color` after what earlier passes rendered
+        // into it.
+        void addPasses(RenderGraph& graph, GraphImage color, GraphImage depth);
+
+        [[nodiscard]] uint32_t getInstanceCount() const noexcept;
+        [[nodiscard]] uint32_t getMeshCount() const noexcept;
+        // bindless index of the instance buffer, for custom shaders
+        [[nodiscard]] BindlessBuffer getInstanceBuffer() const noexcept;
+
+    private:
+        // Mirrors `Mesh` in shaders/gpu_scene.glsl.
+        struct GpuMesh {
+            glm::vec4 sphere;
+            std::array<GpuMeshLod, kMaxLods> lods;
+            uint32_t lodCount;
+            int32_t vertexOffset;
+            std::array<uint32_t, 2> padding;
+        };
+        static_assert(sizeof(GpuMesh) == 64);
+
+        // Mirrors `View` in shaders/gpu_scene.glsl.
+        struct GpuView {
+            glm::mat4 viewProjection;
+            std::array<glm::vec4, 6> planes;
+            glm::vec4 camera;
+            uint32_t instanceCount;
+            uint32_t compact;
+            std::array<uint32_t, 2> padding;
+        };
+        static_assert(sizeof(GpuView) == 192);
+
+        // Mirrors `SceneConstants` in shaders/gpu_scene.glsl.
+        struct SceneConstants {
+            uint32_t viewBuffer;
+            uint32_t instanceBuffer;
+            uint32_t meshBuffer;
+            uint32_t drawBuffer;
+            uint32_t countBuffer;
+        };
+
+        AllocatedBuffer createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, const AllocationDesc& desc = {});
+        void writeInstances(uint32_t first, std::span<const GpuInstance> instances);
+        void copyInstances(vk::CommandBuffer commandBuffer);
+        void createCullPipeline();
+        void createDrawPipeline(vk::RenderPass renderPass);
+        void cull(vk::CommandBuffer commandBuffer);
+        void draw(vk::CommandBuffer commandBuffer, vk::RenderPass renderPass, vk::Extent2D extent);
+        SceneConstants getConstants();
+
+        App& m_App;
+        vk::Device m_Device;
+        BindlessRegistry& m_Bindless;
+        GpuSceneConfig m_Config;
+        bool m_Compact;
+        bool m_MultiDraw;
+
+        AllocatedBuffer m_Vertices;
+        AllocatedBuffer m_Indices;
+        AllocatedBuffer m_Meshes;
+        AllocatedBuffer m_Instances;
+        AllocatedBuffer m_Draws;
+        AllocatedBuffer m_Count;
+        // host-visible, one per frame in flight
+        std::vector<AllocatedBuffer> m_Views;
+        // host-visible, one per frame in flight, grown to the largest update
+        std::vector<AllocatedBuffer> m_InstanceStaging;
+
+        BindlessBuffer m_MeshBinding;
+        BindlessBuffer m_InstanceBinding;
+        BindlessBuffer m_DrawBinding;
+        BindlessBuffer m_CountBinding;
+        std::vector<BindlessBuffer> m_ViewBindings;
+
+        uint32_t m_VertexCount = 0;
+        uint32_t m_IndexCount = 0;
+        uint32_t m_MeshCount = 0;
+        // instances the frame being recorded draws, set by its scene_update pass
+        uint32_t m_InstanceCount = 0;
+        SceneView m_View;
+
+        // instances as the next frame will see them, and the range of them the GPU doesn't have yet
+        mutable std::mutex m_InstanceMutex;
+        std::vector<GpuInstance> m_InstanceData;
+        uint32_t m_DirtyBegin = UINT32_MAX;
+        uint32_t m_DirtyEnd = 0;
+
+        vk::Pipeline m_CullPipeline;
+        vk::Pipeline m_DrawPipeline;
+    };
+}
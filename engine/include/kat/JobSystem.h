@@ -0,0 +1,130 @@
+#pragma once
+
+#include "kat/FunctionRef.h"
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kat {
+
+    class JobSystem;
+
+    struct Job {
+        void (*function)(void* data, size_t begin, size_t end) = nullptr;
+        void* data = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+        class JobCounter* counter = nullptr;
+        bool heapAllocated = false;
+    };
+
+    // Counts unfinished jobs. Jobs scheduled with a counter increment it and decrement it when they finish; other
+    // jobs can be scheduled to start once it reaches zero, and JobSystem::wait() helps run jobs until it does.
+    // The first exception thrown by one of its jobs is rethrown by wait(); jobs without a counter have their exceptions
+    // logged and dropped.
+    class JobCounter {
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        [[nodiscard]] bool isDone() const noexcept;
+        [[nodiscard]] uint32_t getValue() const noexcept;
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> m_Value{0};
+        std::atomic_flag m_Failed;
+        std::exception_ptr m_Error;
+    };
+
+    // Fixed-capacity Chase-Lev deque: the owning worker pushes and pops at the bottom, thieves steal from the top.
+    class WorkStealingDeque {
+    public:
+        static constexpr size_t kCapacity = 4096;
+
+        bool push(Job* job);
+        Job* pop();
+        Job* steal();
+
+    private:
+        static constexpr size_t kMask = kCapacity - 1;
+
+        alignas(64) std::atomic<int64_t> m_Top{0};
+        alignas(64) std::atomic<int64_t> m_Bottom{0};
+        std::array<std::atomic<Job*>, kCapacity> m_Items{};
+    };
+
+    // Work-stealing scheduler. The thread that constructs it becomes worker 0 and runs jobs whenever it waits;
+    // the remaining workers are background threads. Threads that aren't workers may schedule jobs too, they go
+    // through a shared queue instead of a worker's deque.
+    class JobSystem {
+    public:
+        static constexpr uint32_t kNotAWorker = UINT32_MAX;
+
+        // workerThreads = 0 creates one background worker per remaining hardware thread.
+        explicit JobSystem(uint32_t workerThreads = 0);
+        // Jobs that haven't started by then never run; their tasks are destroyed.
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        void schedule(const Job& job);
+        void schedule(std::function<void()> task, JobCounter* counter = nullptr);
+        // Runs `task` once `dependency` reaches zero; `dependency` must stay alive until then.
+        void scheduleAfter(JobCounter& dependency, std::function<void()> task, JobCounter* counter = nullptr);
+
+        // Calls fn(chunkBegin, chunkEnd) over [begin, end) in chunks of `grain` items (0 picks a size from the
+        // worker count) and returns once every chunk has run. The calling thread takes part.
+        void parallelFor(size_t begin, size_t end, size_t grain, FunctionRef<void(size_t, size_t)> fn);
+
+        // Runs other jobs until `counter` reaches zero.
+        void wait(JobCounter& counter);
+
+        [[nodiscard]] uint32_t getWorkerCount() const noexcept;
+        [[nodiscard]] static uint32_t getCurrentWorkerIndex() noexcept;
+
+    private:
+        struct Worker {
+            WorkStealingDeque deque;
+            std::array<Job, WorkStealingDeque::kCapacity> jobs{};
+            // set by the owner when it fills a slot, cleared once the job is copied out by whoever takes it
+            std::array<std::atomic<bool>, WorkStealingDeque::kCapacity> occupied{};
+            size_t nextJob = 0;
+        };
+
+        uint32_t currentWorker() const noexcept;
+        void push(const Job& job);
+        bool runOne(uint32_t worker);
+        bool takeJob(uint32_t worker, Job& out);
+        void execute(const Job& job);
+        static void fail(const Job& job, const char* what);
+        void releaseDeferred();
+        void workerLoop(uint32_t worker);
+
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+        std::vector<std::thread> m_Threads;
+        std::atomic<bool> m_Stop{false};
+        std::atomic<uint32_t> m_WorkSignal{0};
+        std::atomic<uint32_t> m_Sleeping{0};
+
+        // jobs scheduled from threads that aren't workers
+        std::mutex m_SharedMutex;
+        std::deque<Job*> m_SharedQueue;
+        std::atomic<size_t> m_SharedCount{0};
+
+        // jobs waiting for a counter to reach zero
+        std::mutex m_DeferredMutex;
+        std::vector<std::pair<JobCounter*, Job>> m_Deferred;
+        std::atomic<size_t> m_DeferredCount{0};
+    };
+}
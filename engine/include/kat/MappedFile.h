@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace kat {
+
+    // Read-only memory mapping of a whole file. Pages are faulted in on first access, so reading a file costs no
+    // copy into a heap buffer.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        // Throws when the file can't be opened or mapped.
+        explicit MappedFile(const std::filesystem::path& path);
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        [[nodiscard]] std::span<const std::byte> getData() const noexcept;
+        [[nodiscard]] bool isOpen() const noexcept;
+
+    private:
+        void close() noexcept;
+
+        const std::byte* m_Data = nullptr;
+        size_t m_Size = 0;
+        bool m_Open = false;
+#ifdef _WIN32
+        void* m_File = nullptr;
+        void* m_Mapping = nullptr;
+#endif
+    };
+}
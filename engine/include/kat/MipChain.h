@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    struct MipLevel {
+        uint32_t width;
+        uint32_t height;
+        size_t offset;
+        size_t size;
+    };
+
+    // RGBA8 image with its full mip chain packed into one allocation, finest level first.
+    struct MipChain {
+        std::vector<MipLevel> levels;
+        std::vector<std::byte> data;
+
+        [[nodiscard]] std::span<const std::byte> getLevel(size_t level) const {
+            return std::span(data).subspan(levels[level].offset, levels[level].size);
+        }
+    };
+
+    [[nodiscard]] uint32_t getMipCount(uint32_t width, uint32_t height);
+
+    // 2x2 box filter from `src` (width x height RGBA8) into `dst` (max(width / 2, 1) x max(height / 2, 1)), the
+    // extents Vulkan gives mip levels; an odd last row or column is dropped. With `srgb`, colour is decoded to linear
+    // and re-encoded around the average, so mips don't darken; alpha is always filtered as stored.
+    void downsampleRgba8(const uint8_t* src, uint32_t width, uint32_t height, bool srgb, uint8_t* dst);
+
+    // Builds every level below `rgba`. Levels wider or taller than `maxSize` are skipped, so the chain starts at the
+    // first level that fits.
+    [[nodiscard]] MipChain buildMipChain(std::span<const std::byte> rgba, uint32_t width, uint32_t height, bool srgb, uint32_t maxSize = UINT32_MAX);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include <atomic>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    struct PipelineCacheStats {
+        uint64_t pipelines = 0;
+        // hits and misses are only known with VK_EXT_pipeline_creation_feedback, otherwise pipelines count as unreported
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t unreported = 0;
+        double compileSeconds = 0.0;
+    };
+
+    // Creates pipelines through a vk::PipelineCache that persists on disk. A cache file is only loaded if its header
+    // matches this GPU's vendor ID, device ID and pipelineCacheUUID, so a driver update or a different GPU starts
+    // over instead of handing the driver stale data.
+    class PipelineCache {
+    public:
+        PipelineCache(App& app, std::filesystem::path path);
+
+        PipelineCache(const PipelineCache&) = delete;
+        PipelineCache& operator=(const PipelineCache&) = delete;
+
+        // Saves the cache and destroys it; pipelines created from it stay valid.
+        void cleanup();
+        void save();
+
+        // Safe to call from any thread.
+        vk::Pipeline createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo& createInfo);
+        vk::Pipeline createComputePipeline(const vk::ComputePipelineCreateInfo& createInfo);
+
+        // Compiles the pipelines in parallel on the job system; out[i] is created from createInfos[i].
+        void createGraphicsPipelines(std::span<const vk::GraphicsPipelineCreateInfo> createInfos, std::span<vk::Pipeline> out);
+        void createComputePipelines(std::span<const vk::ComputePipelineCreateInfo> createInfos, std::span<vk::Pipeline> out);
+
+        [[nodiscard]] PipelineCacheStats getStats() const;
+        vk::PipelineCache getCache();
+
+    private:
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t dataSize;
+            uint64_t checksum;
+        };
+
+        static constexpr uint32_t kFileMagic = 0x4350414B; // "KAPC"
+        static constexpr uint32_t kFileVersion = 1;
+        static constexpr uint32_t kMaxFeedbackStages = 8;
+
+        std::vector<uint8_t> load();
+        bool isCompatible(std::span<const uint8_t> data) const;
+
+        template<typename CreateInfo>
+        vk::Pipeline create(const CreateInfo& createInfo, uint32_t stageCount);
+
+        App& m_App;
+        vk::Device m_Device;
+        std::filesystem::path m_Path;
+        vk::PipelineCache m_Cache;
+        bool m_CreationFeedback;
+
+        std::atomic<uint64_t> m_Pipelines{0};
+        std::atomic<uint64_t> m_Hits{0};
+        std::atomic<uint64_t> m_Misses{0};
+        std::atomic<uint64_t> m_Unreported{0};
+        std::atomic<uint64_t> m_CompileNanoseconds{0};
+    };
+}
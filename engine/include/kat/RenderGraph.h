@@ -0,0 +1,276 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include "kat/GpuAllocator.h"
+#include <array>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace kat {
+
+    class GpuProfiler;
+    class RenderGraph;
+
+    // How a pass touches a resource. Each access implies the pipeline stages, access mask, image layout and usage
+    // flags the graph derives barriers and transient resource creation from.
+    enum class GraphAccess {
+        eColorAttachment,
+        eDepthAttachment,
+        // depth testing without depth writes
+        eDepthRead,
+        eFragmentSampled,
+        eComputeSampled,
+        eComputeStorageRead,
+        eComputeStorageWrite,
+        // storage buffers read by vertex shaders
+        eVertexStorageRead,
+        eTransferRead,
+        eTransferWrite,
+        eVertexBuffer,
+        eIndexBuffer,
+        eIndirectBuffer,
+        eUniformBuffer,
+    };
+
+    enum class PassType {
+        // runs inside a render pass built from its attachments
+        eGraphics,
+        eCompute,
+        eTransfer
+    };
+
+    struct GraphImage {
+        uint32_t index = UINT32_MAX;
+    };
+
+    struct GraphBuffer {
+        uint32_t index = UINT32_MAX;
+    };
+
+    struct GraphImageDesc {
+        vk::Format format = vk::Format::eR8G8B8A8Unorm;
+        vk::Extent2D extent;
+        vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+    };
+
+    struct PassContext {
+        vk::CommandBuffer commandBuffer;
+        // null for compute and transfer passes
+        vk::RenderPass renderPass;
+        vk::Framebuffer framebuffer;
+        vk::Extent2D extent;
+        const RenderGraph& graph;
+    };
+
+    using PassFunction = std::function<void(const PassContext&)>;
+
+    class PassBuilder {
+    public:
+        PassBuilder& use(GraphImage image, GraphAccess access);
+        PassBuilder& use(GraphBuffer buffer, GraphAccess access);
+
+        // Attachments are bound in the order they're added; eLoad keeps the previous contents.
+        PassBuilder& colorAttachment(GraphImage image, vk::AttachmentLoadOp load = vk::AttachmentLoadOp::eClear,
+                                     vk::ClearValue clear = vk::ClearColorValue{std::array<float,4>{0.0f, 0.0f, 0.0f, 1.0f}});
+        PassBuilder& depthAttachment(GraphImage image, vk::AttachmentLoadOp load = vk::AttachmentLoadOp::eClear,
+                                     vk::ClearValue clear = vk::ClearDepthStencilValue{1.0f, 0});
+
+        // The pass records its draws into secondary command buffers.
+        PassBuilder& secondaryCommandBuffers();
+        // Never culled, even when nothing reads what it writes.
+        PassBuilder& sideEffect();
+
+    private:
+        friend class RenderGraph;
+
+        PassBuilder(RenderGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+        RenderGraph& m_Graph;
+        uint32_t m_Pass;
+    };
+
+    // Frame graph of passes declaring the images and buffers they use. compile() culls passes that contribute
+    // nothing to an imported resource, computes the barriers and layout transitions between passes, builds a render
+    // pass per graphics pass and places transient resources whose lifetimes don't overlap into the same memory.
+    // Passes run in declaration order, which is always a valid order since a pass only sees what earlier passes wrote.
+    //
+    // The graph is declared once and executed every frame; imported resources (the swapchain image) are rebound
+    // per frame. Declare it again with reset() when the shape of the frame or the size of its targets changes.
+    class RenderGraph {
+    public:
+        explicit RenderGraph(App& app);
+
+        RenderGraph(const RenderGraph&) = delete;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+
+        // Destroys the compiled graph right away; the GPU must be done with it.
+        void cleanup();
+        // Forgets every pass and resource. Compiled objects are destroyed once frames in flight are done with them.
+        void reset();
+
+        // `name` must outlive the graph, as with GpuProfiler scopes.
+        GraphImage createImage(const char* name, const GraphImageDesc& desc);
+        GraphBuffer createBuffer(const char* name, vk::DeviceSize size);
+        // The contents are expected in `initialLayout` and left in `finalLayout` (unless that is eUndefined).
+        GraphImage importImage(const char* name, const GraphImageDesc& desc, vk::ImageLayout initialLayout, vk::ImageLayout finalLayout);
+        GraphBuffer importBuffer(const char* name, vk::DeviceSize size);
+
+        PassBuilder addPass(const char* name, PassType type, PassFunction execute);
+
+        void compile();
+
+        // Binds the physical resource behind an import for the next execute().
+        void bindImage(GraphImage image, vk::Image handle, vk::ImageView view);
+        void bindBuffer(GraphBuffer buffer, vk::Buffer handle);
+        // Passes whose first attachment is `image` render to its top left `area` only, from the next execute() on,
+        // and see it as their extent; the rest of the image is left as it was. Lets a target change size every
+        // frame (dynamic resolution) without declaring the graph again. Defaults to the whole image.
+        void setRenderArea(GraphImage image, vk::Extent2D area);
+        [[nodiscard]] vk::Extent2D getRenderArea(GraphImage image) const;
+
+        // Records every live pass into `commandBuffer`, in a GPU profiler scope per pass when `profiler` is set.
+        void execute(vk::CommandBuffer commandBuffer, GpuProfiler* profiler = nullptr);
+
+        [[nodiscard]] vk::Image getImage(GraphImage image) const;
+        [[nodiscard]] vk::ImageView getImageView(GraphImage image) const;
+        [[nodiscard]] vk::Buffer getBuffer(GraphBuffer buffer) const;
+        // Null until compiled, or when the pass was culled.
+        [[nodiscard]] vk::RenderPass getRenderPass(const char* pass) const;
+
+        [[nodiscard]] size_t getLivePassCount() const;
+        // In execution order, with the extent each ran at in the last execute().
+        void forEachLivePass(const std::function<void(const char* name, PassType type, vk::Extent2D extent)>& fn) const;
+        [[nodiscard]] vk::DeviceSize getTransientMemorySize() const;
+
+    private:
+        friend class PassBuilder;
+
+        struct AccessInfo {
+            vk::PipelineStageFlags stages;
+            vk::AccessFlags access;
+            vk::ImageLayout layout;
+            bool write;
+        };
+
+        struct Resource {
+            const char* name;
+            bool image;
+            bool imported;
+            GraphImageDesc desc;
+            vk::Extent2D renderArea;
+            vk::DeviceSize size = 0;
+            vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+            vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+
+            vk::ImageUsageFlags imageUsage;
+            vk::BufferUsageFlags bufferUsage;
+            // first and last live pass using it, UINT32_MAX when unused
+            uint32_t firstPass = UINT32_MAX;
+            uint32_t lastPass = 0;
+            uint32_t slot = UINT32_MAX;
+
+            vk::Image imageHandle;
+            vk::ImageView view;
+            vk::Buffer bufferHandle;
+        };
+
+        struct Use {
+            uint32_t resource;
+            GraphAccess access;
+            // attachments loaded with eLoad and storage writes also read the previous contents
+            bool reads;
+        };
+
+        struct Attachment {
+            uint32_t resource;
+            vk::AttachmentLoadOp load;
+            bool depth;
+        };
+
+        struct Barrier {
+            uint32_t resource;
+            vk::AccessFlags srcAccess;
+            vk::AccessFlags dstAccess;
+            vk::ImageLayout oldLayout;
+            vk::ImageLayout newLayout;
+        };
+
+        struct BarrierBatch {
+            vk::PipelineStageFlags srcStages;
+            vk::PipelineStageFlags dstStages;
+            std::vector<Barrier> barriers;
+        };
+
+        struct FramebufferEntry {
+            std::vector<vk::ImageView> views;
+            vk::Framebuffer framebuffer;
+        };
+
+        struct Pass {
+            const char* name;
+            PassType type;
+            PassFunction execute;
+            std::vector<Use> uses;
+            std::vector<Attachment> attachments;
+            bool secondary = false;
+            bool sideEffect = false;
+            bool live = false;
+
+            BarrierBatch barriers;
+            vk::RenderPass renderPass;
+            vk::Extent2D extent;
+            std::vector<vk::ClearValue> clearValues;
+            // one per combination of imported views, found by a linear search
+            std::vector<FramebufferEntry> framebuffers;
+        };
+
+        // Memory shared by transient resources with disjoint lifetimes, occupants ordered by first use.
+        struct MemorySlot {
+            bool image;
+            vk::MemoryRequirements requirements;
+            std::vector<uint32_t> occupants;
+            GpuAllocation* allocation = nullptr;
+        };
+
+        // Synchronization state of a resource while walking the passes.
+        struct ResourceState {
+            vk::PipelineStageFlags writeStages;
+            vk::AccessFlags writeAccess;
+            // readers since the last write, whose stages have seen the write already
+            vk::PipelineStageFlags readStages;
+            vk::AccessFlags readAccess;
+            vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+            bool used = false;
+        };
+
+        static AccessInfo describe(GraphAccess access);
+
+        uint32_t addResource(Resource resource);
+        void addUse(uint32_t pass, uint32_t resource, GraphAccess access, bool reads);
+
+        void cull();
+        void computeLifetimes();
+        void createTransients();
+        void computeBarriers();
+        void createRenderPasses();
+        bool needsStore(uint32_t resource, uint32_t pass) const;
+        vk::Framebuffer getFramebuffer(Pass& pass);
+        void recordBarriers(vk::CommandBuffer commandBuffer, const BarrierBatch& batch);
+        void destroyCompiled(bool deferred);
+
+        App& m_App;
+        vk::Device m_Device;
+
+        std::vector<Resource> m_Resources;
+        std::vector<Pass> m_Passes;
+        std::vector<MemorySlot> m_Slots;
+        BarrierBatch m_FinalBarriers;
+        bool m_Compiled = false;
+
+        // reused by execute() so recording a frame doesn't allocate
+        std::vector<vk::ImageMemoryBarrier> m_ImageBarriers;
+        std::vector<vk::BufferMemoryBarrier> m_BufferBarriers;
+        std::vector<vk::ImageView> m_Views;
+    };
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "kat/Renderer.h"
+#include <array>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace kat {
+
+    // Everything the render thread needs for one frame. The main thread fills it in and never touches it again
+    // once submitted; the render thread reads nothing but the packet (and the renderer) while it renders.
+    struct FramePacket {
+        // packets submitted before this one plus one, set by submit()
+        uint64_t sequence = 0;
+        double time = 0.0;
+        double dt = 0.0;
+        double interpolationAlpha = 1.0;
+
+        // camera of the renderer's scene, if it has one
+        std::optional<SceneView> view;
+
+        // main pass draw list: `itemCount` items recorded by `record` on the job system. `record` must only read
+        // what it captured.
+        size_t itemCount = 0;
+        std::function<void(const RecordContext&)> record;
+
+        // run on the render thread before the frame is recorded, for renderer changes such as setScene()
+        std::vector<std::function<void(Renderer&)>> commands;
+    };
+
+    // Runs a Renderer on its own thread, so waiting for the GPU and for presentation no longer holds up input and
+    // game logic. The main thread fills a packet while the render thread renders the previous one; the packets go
+    // through a bounded ring without locks and beginPacket() only blocks when the render thread is kPacketCount
+    // frames behind.
+    //
+    // While it runs the renderer belongs to the render thread: change it through FramePacket::commands, or stop()
+    // first. Packets and their vectors are reused, so filling one doesn't allocate in steady state.
+    class RenderThread {
+    public:
+        // double buffered: one packet being built, one being rendered
+        static constexpr uint32_t kPacketCount = kMaxQueuedFrames;
+
+        // `app` stops the thread before it idles the device for cleanup.
+        RenderThread(App& app, Renderer& renderer);
+        ~RenderThread();
+
+        RenderThread(const RenderThread&) = delete;
+        RenderThread& operator=(const RenderThread&) = delete;
+
+        // Main thread: the next packet to fill, reset to defaults. Rethrows what the render thread threw.
+        [[nodiscard]] FramePacket& beginPacket();
+        // Main thread: hands the packet from beginPacket() to the render thread.
+        void submit();
+
+        // Renders the packets already submitted and joins the thread.
+        void stop();
+
+        // packets submitted and not yet rendered
+        [[nodiscard]] uint32_t getQueuedCount() const noexcept;
+
+    private:
+        struct Slot {
+            FramePacket packet;
+            bool quit = false;
+        };
+
+        // waits until the render thread is done with the next slot
+        Slot& acquireSlot();
+        void submitSlot();
+        void run();
+
+        App& m_App;
+        Renderer& m_Renderer;
+        std::array<Slot, kPacketCount> m_Slots;
+
+        // counts of packets submitted and rendered; each is written by one side only
+        alignas(64) std::atomic<uint64_t> m_Submitted{0};
+        alignas(64) std::atomic<uint64_t> m_Rendered{0};
+
+        std::thread m_Thread;
+        std::exception_ptr m_Error;
+        std::atomic<bool> m_Failed{false};
+    };
+}
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "kat/Engine.h"
+#include "kat/GpuProfiler.h"
+#include "kat/FrameArena.h"
+#include "kat/CommandRecorder.h"
+#include "kat/RenderGraph.h"
+#include "kat/GpuScene.h"
 #include <array>
 
 namespace kat {
-    constexpr size_t kMaxFramesInFlight = 2;
 
     class Renderer {
     public:
@@ -14,24 +18,76 @@ namespace kat {
         ~Renderer();
 
         void render();
+        // Records `itemCount` draw list items inside the main render pass, split into chunks across the job system.
+        void render(size_t itemCount, RecordFunction recordFn);
         void cleanup();
 
+        GpuProfiler& getGpuProfiler();
+
+        // Pipelines drawing in the main pass are created against this (through App::getPipelineCache()), with the
+        // layout of App::getBindlessRegistry(); the bindless set is bound in every chunk before `recordFn` runs.
+        vk::RenderPass getRenderPass();
+
+        RenderGraph& getRenderGraph();
+
+        // Size the main pass and the scene render at this frame: the swapchain extent scaled by dynamic resolution
+        // (AppConfig::dynamic_resolution), upscaled to the swapchain at the end of the frame. Draws set their
+        // viewports from this rather than from the swapchain extent. Belongs to the thread that renders.
+        [[nodiscard]] vk::Extent2D getRenderExtent() const noexcept;
+
+        // Draws `scene` (GPU culled) over the main pass every frame; null removes it. The scene must outlive its use.
+        void setScene(GpuScene* scene);
+        [[nodiscard]] GpuScene* getScene() const noexcept;
+
+        // Scratch memory for the frame currently being recorded; it is reclaimed once the GPU has finished that frame.
+        // Only valid inside render(), from the record callbacks and passes it runs: between frames the slot belongs to
+        // a frame the GPU may still be reading, and the next render() resets it.
+        LinearArena& getFrameArena();
+
     private:
+        // required to support depth attachments, alongside eX8D24UnormPack32
+        static constexpr vk::Format kSceneDepthFormat = vk::Format::eD32Sfloat;
+
+        // Declares the frame's passes against the current swapchain and compiles them.
+        void buildGraph();
+        // whether the scene target can be blitted into the swapchain images
+        bool supportsUpscale();
+        void upscale(vk::CommandBuffer commandBuffer);
+        void captureFrame(FrameCapture& capture, uint64_t frameNumber, size_t itemCount, double cpuTime);
 
         std::shared_ptr<App> m_App;
+        uint32_t m_FramesInFlight;
 
+        // binary, swapchain acquire and present can't use the frame timeline
         std::vector<vk::Semaphore> m_RenderFinishedSemaphores;
         std::vector<vk::Semaphore> m_ImageAvailableSemaphores;
-        std::vector<vk::Fence> m_InFlightFences;
-        std::vector<vk::Fence> m_ImagesInFlight;
         size_t m_CurrentFrame = 0;
+        // set while render() records, the only time the frame arena may be used
+        bool m_Recording = false;
 
         std::vector<vk::CommandBuffer> m_RenderCommandBuffers;
         vk::CommandPool m_RenderCommandPool;
-        vk::RenderPass m_RenderPass;
         vk::Pipeline m_Pipeline;
-        vk::PipelineLayout m_PipelineLayout;
-        std::vector<vk::Framebuffer> m_Framebuffers;
+        uint64_t m_SwapchainGeneration = 0;
+
+        RenderGraph m_Graph;
+        GraphImage m_Backbuffer;
+        // the backbuffer itself unless dynamic resolution renders offscreen and upscales
+        GraphImage m_SceneColor;
+        bool m_Upscaling = false;
+        vk::Extent2D m_RenderExtent;
+        GpuScene* m_Scene = nullptr;
+        // draw list of the frame being recorded, for the main pass
+        size_t m_PendingItemCount = 0;
+        RecordFunction m_PendingRecordFn;
+
+        GpuProfiler m_GpuProfiler;
+        ParallelCommandRecorder m_CommandRecorder;
+        std::vector<LinearArena> m_FrameArenas;
+
+        static constexpr size_t kAllocationCheckWarmupFrames = 16;
+        size_t m_RenderedFrames = 0;
+        bool m_ReportedFrameAllocations = false;
 
         vk::ClearValue m_ClearValue = vk::ClearColorValue{std::array<float,4>{1.0f, 0.11f, 0.0f, 1.0f}};
     };
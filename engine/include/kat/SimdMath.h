@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace kat {
+
+    // Instruction sets the batch kernels below are built for. The best one the CPU supports is picked at startup,
+    // the engine itself keeps targeting the baseline.
+    enum class SimdLevel {
+        eScalar,
+        // SSE4.1, 4 lanes
+        eSse4,
+        // AVX2 and FMA, 8 lanes
+        eAvx2,
+    };
+
+    [[nodiscard]] SimdLevel getSupportedSimdLevel() noexcept;
+    [[nodiscard]] SimdLevel getSimdLevel() noexcept;
+    // Clamped to getSupportedSimdLevel(). Meant for benchmarks and for comparing results between levels.
+    void setSimdLevel(SimdLevel level) noexcept;
+    [[nodiscard]] std::string_view getSimdLevelName(SimdLevel level) noexcept;
+
+    // the culling kernels test this many instances at once and write one visibility bit for each
+    constexpr size_t kSimdGroupSize = 8;
+
+    [[nodiscard]] constexpr size_t getSimdGroupCount(size_t count) noexcept {
+        return (count + kSimdGroupSize - 1) / kSimdGroupSize;
+    }
+
+    // Bounding spheres with one array per component.
+    struct SphereArray {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+
+        void resize(size_t count);
+        [[nodiscard]] size_t size() const noexcept {
+            return radius.size();
+        }
+
+        // xyz is the center, w the radius
+        void set(size_t index, glm::vec4 sphere);
+        [[nodiscard]] glm::vec4 get(size_t index) const;
+    };
+
+    // Axis aligned boxes as center and half extent, one array per component.
+    struct AabbArray {
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> extentX;
+        std::vector<float> extentY;
+        std::vector<float> extentZ;
+
+        void resize(size_t count);
+        [[nodiscard]] size_t size() const noexcept {
+            return centerX.size();
+        }
+
+        void set(size_t index, glm::vec3 min, glm::vec3 max);
+        [[nodiscard]] glm::vec3 getMin(size_t index) const;
+        [[nodiscard]] glm::vec3 getMax(size_t index) const;
+    };
+
+    // Left, right, bottom, top, near and far planes of a Vulkan (0 to 1 depth) view projection, normalized and
+    // pointing inwards: a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them.
+    using FrustumPlanes = std::array<glm::vec4, 6>;
+
+    [[nodiscard]] FrustumPlanes getFrustumPlanes(const glm::mat4& viewProjection);
+
+    // out[i] = parents[i] * locals[i]; all three the same size, `out` may alias either input.
+    void multiplyMatrices(std::span<const glm::mat4> parents, std::span<const glm::mat4> locals, std::span<glm::mat4> out);
+
+    // Moves `local` into world space, resizing `world` to match. Transforms are affine, one per sphere; radii grow
+    // by the largest axis scale.
+    void transformSpheres(std::span<const glm::mat4> transforms, const SphereArray& local, SphereArray& world);
+    // Moves `local` into world space, resizing `world` to match, as the smallest boxes around the transformed ones.
+    void transformAabbs(std::span<const glm::mat4> transforms, const AabbArray& local, AabbArray& world);
+
+    // Bit i % 8 of visible[i / 8] is set when volume i touches the frustum. `visible` needs
+    // getSimdGroupCount(size()) bytes; bits past the last volume are cleared.
+    void cullSpheres(const FrustumPlanes& planes, const SphereArray& spheres, std::span<uint8_t> visible);
+    void cullAabbs(const FrustumPlanes& planes, const AabbArray& aabbs, std::span<uint8_t> visible);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cinttypes>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kat {
+
+    struct StartupStage {
+        std::string name;
+        // seconds since the timeline started
+        double start = 0.0;
+        double duration = 0.0;
+        // job system worker that ran the stage, JobSystem::kNotAWorker for other threads
+        uint32_t worker = 0;
+    };
+
+    // How long each stage of engine and app startup took, and which stages overlapped. Stages may be recorded from
+    // any thread.
+    class StartupTimeline {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        // Records a stage from its construction to its destruction.
+        class Scope {
+        public:
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            friend class StartupTimeline;
+            Scope(StartupTimeline& timeline, std::string name);
+
+            StartupTimeline& m_Timeline;
+            std::string m_Name;
+            clock::time_point m_Start;
+        };
+
+        StartupTimeline();
+
+        [[nodiscard]] Scope stage(std::string name);
+        void record(std::string name, clock::time_point start, clock::time_point end);
+
+        // Stops the clock; stages recorded later still show up but don't count towards the total.
+        void finish();
+
+        // ordered by start
+        [[nodiscard]] std::vector<StartupStage> getStages() const;
+        // seconds from construction to finish()
+        [[nodiscard]] double getTotal() const;
+
+        // Logs every stage with a bar showing where it falls in the total.
+        void report() const;
+
+    private:
+        static constexpr size_t kBarWidth = 40;
+
+        clock::time_point m_Start;
+        clock::time_point m_End;
+        mutable std::mutex m_Mutex;
+        std::vector<StartupStage> m_Stages;
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+
+namespace kat {
+
+    // Summary of a set of durations, all in seconds.
+    struct FrameStats {
+        size_t count = 0;
+        double mean = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        size_t hitches = 0;
+    };
+
+    // HDR-style log-linear histogram of durations with microsecond resolution and ~3% relative error,
+    // plus a ring of the most recent samples.
+    // There must be a single recording thread; record() never allocates or locks, and any thread may read
+    // the stats at any time (a reader may miss the sample that is being recorded concurrently).
+    class FrameTimeHistogram {
+    public:
+        static constexpr uint32_t kSubBucketBits = 5;
+        static constexpr uint32_t kSubBucketCount = 1U << kSubBucketBits;
+        static constexpr uint32_t kMaxExponent = 32 - kSubBucketBits;
+        static constexpr size_t kBucketCount = (kMaxExponent + 1) * kSubBucketCount;
+        static constexpr size_t kRecentCount = 512;
+        static constexpr double kDefaultHitchBudget = 2.0 / 60.0;
+
+        void record(double seconds);
+
+        // Only call from the recording thread.
+        void reset();
+
+        void setHitchBudget(double seconds);
+        [[nodiscard]] double getHitchBudget() const;
+
+        // Stats over every sample since the last reset.
+        [[nodiscard]] FrameStats getStats() const;
+        // Exact stats over the last kRecentCount samples.
+        [[nodiscard]] FrameStats getRecentStats() const;
+
+    private:
+        static size_t bucketIndex(uint64_t micros);
+        static uint64_t bucketValue(size_t index);
+
+        std::array<std::atomic<uint32_t>, kBucketCount> m_Buckets{};
+        std::array<std::atomic<uint32_t>, kRecentCount> m_Recent{};
+        std::atomic<uint64_t> m_Count{0};
+        std::atomic<uint64_t> m_TotalMicros{0};
+        std::atomic<uint64_t> m_MaxMicros{0};
+        std::atomic<uint64_t> m_Hitches{0};
+        std::atomic<uint64_t> m_HitchBudgetMicros{static_cast<uint64_t>(kDefaultHitchBudget * 1e6)};
+    };
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "kat/World.h"
+#include "kat/JobSystem.h"
+#include <functional>
+#include <vector>
+
+namespace kat {
+
+    class SystemScheduler;
+
+    // What a system gets to work with. The query helpers check in debug builds that the system declared access to
+    // the components it asks for; mutable component types need write access.
+    class SystemContext {
+    public:
+        World& world;
+        // structural changes go here, they are applied after the systems that could observe them have run
+        EntityCommands& commands;
+        JobSystem& jobs;
+        double dt;
+
+        template<typename... Ts, typename F>
+        void each(F&& fn) {
+            checkAccess<Ts...>();
+            world.each<Ts...>(std::forward<F>(fn));
+        }
+
+        template<typename... Ts, typename F>
+        void eachChunk(F&& fn) {
+            checkAccess<Ts...>();
+            world.eachChunk<Ts...>(std::forward<F>(fn));
+        }
+
+        template<typename... Ts, typename F>
+        void parallelEach(F&& fn) {
+            checkAccess<Ts...>();
+            world.parallelEach<Ts...>(jobs, std::forward<F>(fn));
+        }
+
+    private:
+        friend class SystemScheduler;
+
+        SystemContext(World& world, EntityCommands& commands, JobSystem& jobs, double dt, const char* name,
+                      const ComponentMask& reads, const ComponentMask& writes, bool exclusive);
+
+        template<typename... Ts>
+        void checkAccess() const {
+#ifndef NDEBUG
+            ComponentMask writes;
+            ((std::is_const_v<Ts> ? void() : void(writes.set(componentId<std::remove_const_t<Ts>>()))), ...);
+            checkAccess(componentMask<Ts...>(), writes);
+#endif
+        }
+
+        void checkAccess(const ComponentMask& used, const ComponentMask& written) const;
+
+        const char* m_Name;
+        const ComponentMask& m_Reads;
+        const ComponentMask& m_Writes;
+        bool m_Exclusive;
+    };
+
+    using SystemFunction = std::function<void(SystemContext&)>;
+
+    class SystemBuilder {
+    public:
+        template<Component... Ts>
+        SystemBuilder& reads() {
+            (m_Reads->set(componentId<Ts>()), ...);
+            return *this;
+        }
+
+        template<Component... Ts>
+        SystemBuilder& writes() {
+            (m_Writes->set(componentId<Ts>()), ...);
+            return *this;
+        }
+
+        // Runs alone, after the commands of every system added before it were applied, and may change the world
+        // directly.
+        SystemBuilder& exclusive();
+
+    private:
+        friend class SystemScheduler;
+
+        SystemBuilder(ComponentMask* reads, ComponentMask* writes, bool* exclusive);
+
+        ComponentMask* m_Reads;
+        ComponentMask* m_Writes;
+        bool* m_Exclusive;
+    };
+
+    // Runs systems over a world once per run(). A system may run concurrently with any system it doesn't conflict
+    // with (one writes a component the other reads or writes); conflicting systems run in the order they were
+    // added. Each system records structural changes into its own EntityCommands, applied in the order the systems
+    // were added once the last system finished (or before an exclusive system).
+    class SystemScheduler {
+    public:
+        SystemScheduler(World& world, JobSystem& jobs);
+
+        SystemScheduler(const SystemScheduler&) = delete;
+        SystemScheduler& operator=(const SystemScheduler&) = delete;
+
+        // The builder is only valid until the next addSystem().
+        SystemBuilder addSystem(const char* name, SystemFunction function);
+
+        void run(double dt);
+
+        [[nodiscard]] size_t getSystemCount() const noexcept;
+        // Systems run in waves of mutually non-conflicting systems, one wave after the other.
+        [[nodiscard]] size_t getWaveCount();
+
+    private:
+        struct System {
+            const char* name;
+            SystemFunction function;
+            ComponentMask reads;
+            ComponentMask writes;
+            bool exclusive = false;
+            EntityCommands commands;
+        };
+
+        static bool conflicts(const System& a, const System& b);
+        static void runJob(void* data, size_t begin, size_t end);
+        void buildWaves();
+        void runSystem(size_t index);
+        void applyCommands();
+
+        World& m_World;
+        JobSystem& m_Jobs;
+        std::vector<System> m_Systems;
+        // system indices grouped by wave, m_WaveStarts[i] is where wave i begins
+        std::vector<uint32_t> m_WaveOrder;
+        std::vector<uint32_t> m_WaveStarts;
+        bool m_Dirty = true;
+        double m_Dt = 0.0;
+    };
+}
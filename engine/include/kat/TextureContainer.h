@@ -0,0 +1,90 @@
+#pragma once
+
+#include "kat/MappedFile.h"
+#include "vulkan/vulkan.hpp"
+#include <cinttypes>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+namespace kat {
+
+    // Texel encodings of a .ktex file. The values are part of the file format.
+    enum class TextureFormat : uint32_t {
+        eRGBA8 = 1,
+        eBC1 = 2,
+        eBC3 = 3,
+        eBC4 = 4,
+        eBC5 = 5,
+        eBC7 = 6,
+    };
+
+    enum TextureFileFlags : uint32_t {
+        // color data, sampled through an sRGB view
+        kTextureFileSrgb = 1 << 0,
+        kTextureFileNormalMap = 1 << 1,
+    };
+
+    // .ktex layout, little endian: the header, `variantCount` variants, `variantCount * mipCount` mip entries (the
+    // mips of each variant finest first, variant by variant), then the texel data with every mip aligned to
+    // kTextureFileAlignment so mapped bytes can go to the GPU as they are. Variants hold the same image in different
+    // formats, best first; readers take the first one the device can sample.
+    constexpr uint32_t kTextureFileMagic = 0x5845544B; // "KTEX"
+    constexpr uint32_t kTextureFileVersion = 1;
+    constexpr uint64_t kTextureFileAlignment = 16;
+
+    struct TextureFileHeader {
+        uint32_t magic = kTextureFileMagic;
+        uint32_t version = kTextureFileVersion;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipCount = 0;
+        uint32_t variantCount = 0;
+        uint32_t flags = 0;
+        uint32_t reserved = 0;
+    };
+    static_assert(sizeof(TextureFileHeader) == 32);
+
+    struct TextureFileVariant {
+        TextureFormat format;
+        uint32_t reserved = 0;
+    };
+    static_assert(sizeof(TextureFileVariant) == 8);
+
+    struct TextureFileMip {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t width;
+        uint32_t height;
+    };
+    static_assert(sizeof(TextureFileMip) == 24);
+
+    // Bytes per 4x4 block for block-compressed formats, per texel otherwise.
+    [[nodiscard]] uint32_t getTextureFormatBlockSize(TextureFormat format);
+    [[nodiscard]] bool isBlockCompressed(TextureFormat format);
+    [[nodiscard]] uint64_t getTextureLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+    [[nodiscard]] vk::Format toVkFormat(TextureFormat format, bool srgb);
+    [[nodiscard]] const char* toString(TextureFormat format);
+
+    // Memory-mapped, validated .ktex file.
+    class TextureContainer {
+    public:
+        // Throws when the file can't be read or isn't a valid container.
+        explicit TextureContainer(const std::filesystem::path& path);
+
+        [[nodiscard]] const TextureFileHeader& getHeader() const noexcept;
+        [[nodiscard]] std::span<const TextureFileVariant> getVariants() const noexcept;
+        [[nodiscard]] std::span<const TextureFileMip> getMips(uint32_t variant) const;
+        [[nodiscard]] std::span<const std::byte> getMipData(uint32_t variant, uint32_t level) const;
+        [[nodiscard]] bool isSrgb() const noexcept;
+
+        // Index of the first variant whose format `gpu` can sample with optimal tiling.
+        [[nodiscard]] std::optional<uint32_t> selectVariant(vk::PhysicalDevice gpu) const;
+
+    private:
+        MappedFile m_File;
+        const TextureFileHeader* m_Header = nullptr;
+        std::span<const TextureFileVariant> m_Variants;
+        std::span<const TextureFileMip> m_Mips;
+    };
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include "kat/BindlessRegistry.h"
+#include "kat/GpuAllocator.h"
+#include "kat/MipChain.h"
+#include "kat/TextureContainer.h"
+#include "kat/UploadService.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace kat {
+
+    struct TextureHandle {
+        uint32_t index = UINT32_MAX;
+    };
+
+    enum class TextureState {
+        // waiting for a decode slot
+        eQueued,
+        eDecoding,
+        // decoded, mips being uploaded; getImage() shows the finest mip that arrived so far
+        eStreaming,
+        eResident,
+        eFailed
+    };
+
+    struct TextureStreamerConfig {
+        // decodes running on the job system at once, 0 uses one per worker
+        uint32_t max_concurrent_decodes = 0;
+        // bytes handed to the upload service per update(), the coarse mip tail of a texture always goes in one piece
+        vk::DeviceSize upload_budget = 8ULL * 1024 * 1024;
+        // textures larger than this start at the first mip that fits
+        uint32_t max_resolution = 2048;
+    };
+
+    // Loads textures in the background. load() returns right away; the file is memory mapped and decoded (stb_image)
+    // on the job system, its mip chain box-filtered on the CPU, and the mips uploaded through the UploadService
+    // within a per-frame budget, coarsest first, highest priority first. Until a texture has any mip on the GPU,
+    // getImage() returns a 1x1 white placeholder.
+    //
+    // Cooked .ktex files (see kat_cook) skip the decode: the best variant the GPU supports is picked and its mapped
+    // mips are uploaded as they are, block compressed or not. Their sRGB flag overrides the one passed to load().
+    //
+    // A texture's bindless index changes whenever finer mips become visible, so look it up when recording (it's
+    // cheap) instead of caching it. load(), update() and the getters belong to the main thread.
+    class TextureStreamer {
+    public:
+        explicit TextureStreamer(App& app, const TextureStreamerConfig& config = {});
+
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        // Waits for running decodes and frees every texture; the GPU must be done with them.
+        void cleanup();
+
+        // Higher priorities decode and upload first.
+        TextureHandle load(const std::filesystem::path& path, float priority = 0.0f, bool srgb = true);
+        void setPriority(TextureHandle texture, float priority);
+
+        // Once per frame, before recording: starts decodes, uploads mips and publishes the ones that completed.
+        // Never waits on the disk, the decoders or the GPU.
+        void update();
+
+        [[nodiscard]] BindlessImage getImage(TextureHandle texture) const;
+        [[nodiscard]] TextureState getState(TextureHandle texture) const;
+        // trilinear, repeating
+        [[nodiscard]] BindlessSampler getSampler() const noexcept;
+        // textures not yet resident or failed
+        [[nodiscard]] size_t getPendingCount() const;
+
+    private:
+        struct Texture {
+            std::filesystem::path path;
+            float priority = 0.0f;
+            bool srgb = true;
+            TextureState state = TextureState::eQueued;
+
+            // written by the decode job, read by update() once the state is eStreaming. For cooked textures `mips`
+            // only describes the levels, their bytes stay in the mapped container.
+            MipChain mips;
+            std::unique_ptr<TextureContainer> container;
+            uint32_t variant = 0;
+            // container mip the image's mip 0 comes from
+            uint32_t baseMip = 0;
+            vk::Format format = vk::Format::eR8G8B8A8Srgb;
+
+            AllocatedImage image;
+            // mips at and above this one have been handed to the upload service, the mip count before any were
+            uint32_t uploadedMip = 0;
+            // uploads not yet visible, coarsest first
+            std::vector<std::pair<uint32_t, UploadToken>> pendingMips;
+            // mips at and above this one are visible through `view`
+            uint32_t visibleMip = 0;
+            vk::ImageView view;
+            BindlessImage binding;
+        };
+
+        // coarse mips up to this size go up together, with the first upload of a texture
+        static constexpr vk::DeviceSize kMipTailSize = 64 * 1024;
+
+        bool decode(Texture& texture) const;
+        bool openContainer(Texture& texture) const;
+        [[nodiscard]] static std::span<const std::byte> getLevelData(const Texture& texture, uint32_t mip);
+        void startDecodes();
+        void uploadMips();
+        void publishMips();
+        void createImage(Texture& texture);
+        void destroyTexture(Texture& texture);
+
+        App& m_App;
+        vk::Device m_Device;
+        TextureStreamerConfig m_Config;
+
+        // guards the state and mips of textures while decodes may be running
+        mutable std::mutex m_Mutex;
+        std::vector<std::unique_ptr<Texture>> m_Textures;
+        std::vector<uint32_t> m_Queued;
+        // finished decodes, picked up by the next update()
+        std::vector<uint32_t> m_Decoded;
+        uint32_t m_RunningDecodes = 0;
+        uint32_t m_MaxDecodes;
+        JobCounter m_Decodes;
+
+        // main thread only: textures with mips left to upload or publish
+        std::vector<uint32_t> m_Streaming;
+
+        AllocatedImage m_Placeholder;
+        vk::ImageView m_PlaceholderView;
+        BindlessImage m_PlaceholderBinding;
+        vk::Sampler m_Sampler;
+        BindlessSampler m_SamplerBinding;
+    };
+}
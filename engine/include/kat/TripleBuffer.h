@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+
+namespace kat {
+
+    // Hands values from one writer thread to one reader thread without locking or waiting. The writer fills
+    // getWriteBuffer() and publishes it; the reader calls update() to swap in the latest published value, skipping
+    // any it missed, and reads it through getReadBuffer(). Each side keeps its own buffer, the third is in between.
+    template<typename T>
+    class TripleBuffer {
+    public:
+        TripleBuffer() = default;
+        explicit TripleBuffer(const T& initial) : m_Buffers{Slot{initial}, Slot{initial}, Slot{initial}} {}
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        // writer only
+        [[nodiscard]] T& getWriteBuffer() noexcept {
+            return m_Buffers[m_Write].value;
+        }
+
+        // writer only: makes the write buffer the latest value and hands the writer a free one. Its contents are
+        // whatever was written to it some time ago.
+        void publish() noexcept {
+            uint8_t previous = m_Shared.exchange(static_cast<uint8_t>(m_Write | kFresh), std::memory_order_acq_rel);
+            m_Write = previous & kIndexMask;
+        }
+
+        // reader only: returns whether a value was published since the last call
+        bool update() noexcept {
+            if (!(m_Shared.load(std::memory_order_relaxed) & kFresh)) {
+                return false;
+            }
+            uint8_t previous = m_Shared.exchange(m_Read, std::memory_order_acq_rel);
+            m_Read = previous & kIndexMask;
+            return true;
+        }
+
+        // reader only
+        [[nodiscard]] const T& getReadBuffer() const noexcept {
+            return m_Buffers[m_Read].value;
+        }
+
+    private:
+        static constexpr uint8_t kIndexMask = 0x3;
+        static constexpr uint8_t kFresh = 0x4;
+
+        // the two sides write neighbouring buffers constantly, keep them off each other's cache lines
+        struct alignas(64) Slot {
+            T value{};
+        };
+
+        std::array<Slot, 3> m_Buffers{};
+        alignas(64) uint8_t m_Write = 0;
+        alignas(64) std::atomic<uint8_t> m_Shared{1};
+        alignas(64) uint8_t m_Read = 2;
+    };
+}
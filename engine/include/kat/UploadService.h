@@ -0,0 +1,104 @@
+#pragma once
+
+#include "kat/Engine.h"
+#include "kat/GpuAllocator.h"
+#include <deque>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace kat {
+
+    // Timeline value of the batch carrying an upload; the upload is complete once the service's timeline semaphore
+    // reaches it. 0 is never issued and is always complete.
+    using UploadToken = uint64_t;
+
+    struct ImageUpload {
+        vk::Image image;
+        vk::ImageSubresourceLayers subresource{vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+        vk::Offset3D offset{0, 0, 0};
+        vk::Extent3D extent;
+        vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        // layout the subresource is in when the upload runs. eUndefined discards its texels, so only an upload that
+        // covers the whole subresource may leave it; anything else keeps the texels outside the copied region, and
+        // when the service transfers ownership the image has to have been released to the transfer family first.
+        vk::ImageLayout currentLayout = vk::ImageLayout::eUndefined;
+    };
+
+    // Streams data to the GPU on the transfer queue. Data is copied into a persistently mapped staging ring and the
+    // copies are batched into one submit per flush(). Batches signal a timeline semaphore; when the transfer family
+    // differs from the graphics family, ownership of every uploaded resource is released to the graphics family and
+    // recordAcquireBarriers() records the matching acquire. Any thread may upload.
+    class UploadService {
+    public:
+        static constexpr vk::DeviceSize kDefaultStagingSize = 64ULL * 1024 * 1024;
+
+        explicit UploadService(App& app, vk::DeviceSize stagingSize = kDefaultStagingSize);
+
+        UploadService(const UploadService&) = delete;
+        UploadService& operator=(const UploadService&) = delete;
+
+        // Waits for every batch in flight.
+        void cleanup();
+
+        UploadToken uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, std::span<const std::byte> data);
+        // `data` holds tightly packed texels and has to fit into the staging ring at once.
+        UploadToken uploadImage(const ImageUpload& upload, std::span<const std::byte> data);
+
+        // Submits the pending copies and returns the token of the last submitted batch.
+        UploadToken flush();
+
+        [[nodiscard]] bool isComplete(UploadToken token);
+        void wait(UploadToken token);
+
+        // Records the acquire half of the ownership transfers of everything flushed so far into a graphics command
+        // buffer (outside a render pass). Returns the token the submit of that command buffer must wait on.
+        UploadToken recordAcquireBarriers(vk::CommandBuffer commandBuffer);
+
+        vk::Semaphore getTimelineSemaphore();
+
+    private:
+        static constexpr vk::DeviceSize kStagingAlignment = 16;
+
+        struct Batch {
+            vk::CommandBuffer commandBuffer;
+            UploadToken token = 0;
+            // staging ring position once the batch is retired
+            vk::DeviceSize stagingEnd = 0;
+        };
+
+        vk::DeviceSize reserveStaging(vk::DeviceSize size, vk::DeviceSize alignment);
+        vk::CommandBuffer currentCommandBuffer();
+        void submitBatch();
+        void retireCompleted();
+
+        App& m_App;
+        vk::Device m_Device;
+        bool m_OwnershipTransfer;
+
+        std::mutex m_Mutex;
+
+        AllocatedBuffer m_Staging;
+        std::byte* m_StagingMemory;
+        vk::DeviceSize m_StagingSize;
+        // monotonic byte counters, the ring position is the counter modulo the size
+        vk::DeviceSize m_StagingHead = 0;
+        vk::DeviceSize m_StagingTail = 0;
+        vk::DeviceSize m_CopyAlignment;
+
+        vk::Semaphore m_Timeline;
+        UploadToken m_LastSubmitted = 0;
+
+        vk::CommandPool m_CommandPool;
+        std::vector<vk::CommandBuffer> m_FreeCommandBuffers;
+        std::optional<Batch> m_Current;
+        std::deque<Batch> m_InFlight;
+
+        // barriers of the open batch, recorded when it's submitted
+        std::vector<vk::BufferMemoryBarrier> m_BufferReleases;
+        std::vector<vk::ImageMemoryBarrier> m_ImageReleases;
+        // acquires for the graphics queue, of batches already submitted
+        std::vector<vk::BufferMemoryBarrier> m_BufferAcquires;
+        std::vector<vk::ImageMemoryBarrier> m_ImageAcquires;
+    };
+}
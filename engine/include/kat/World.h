@@ -0,0 +1,321 @@
+#pragma once
+
+#include "kat/JobSystem.h"
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+namespace kat {
+
+    struct Entity {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+
+        bool operator==(const Entity&) const = default;
+    };
+
+    constexpr Entity kNullEntity{};
+
+    using ComponentId = uint32_t;
+
+    constexpr uint32_t kMaxComponents = 256;
+    constexpr size_t kCacheLineSize = 64;
+
+    using ComponentMask = std::bitset<kMaxComponents>;
+
+    // Components are plain data: the world moves them between chunks with memcpy and never runs destructors.
+    template<typename T>
+    concept Component = std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>
+                        && !std::is_const_v<T> && !std::is_reference_v<T> && alignof(T) <= kCacheLineSize;
+
+    struct ComponentInfo {
+        uint32_t size = 0;
+        const char* name = nullptr;
+    };
+
+    namespace detail {
+        ComponentId registerComponent(uint32_t size, const char* name);
+    }
+
+    template<Component T>
+    ComponentId componentId() {
+        static const ComponentId id = detail::registerComponent(sizeof(T), typeid(T).name());
+        return id;
+    }
+
+    const ComponentInfo& getComponentInfo(ComponentId id);
+
+    // Mask of the components in a query; const-qualified types count the same as mutable ones.
+    template<typename... Ts>
+    ComponentMask componentMask() {
+        ComponentMask mask;
+        (mask.set(componentId<std::remove_const_t<Ts>>()), ...);
+        return mask;
+    }
+
+    // Every entity with exactly the same set of components. They live in fixed-size chunks laid out as one cache
+    // line aligned array per component (SoA) plus the entity handles, so iterating a component streams memory.
+    // Rows stay dense: removing one moves the archetype's last row into the hole.
+    class Archetype {
+    public:
+        static constexpr size_t kChunkSize = 16 * 1024;
+
+        struct Chunk {
+            std::byte* data = nullptr;
+            uint32_t count = 0;
+        };
+
+        explicit Archetype(const ComponentMask& mask);
+        ~Archetype();
+
+        Archetype(const Archetype&) = delete;
+        Archetype& operator=(const Archetype&) = delete;
+
+        [[nodiscard]] const ComponentMask& getMask() const noexcept { return m_Mask; }
+        [[nodiscard]] std::span<const ComponentId> getComponents() const noexcept { return m_Components; }
+        [[nodiscard]] std::span<const Chunk> getChunks() const noexcept { return m_Chunks; }
+        [[nodiscard]] uint32_t getChunkCapacity() const noexcept { return m_Capacity; }
+        [[nodiscard]] size_t getEntityCount() const noexcept { return m_Count; }
+
+        [[nodiscard]] Entity* getEntities(const Chunk& chunk) const noexcept {
+            return reinterpret_cast<Entity*>(chunk.data);
+        }
+
+        // `id` must be one of the archetype's components.
+        [[nodiscard]] std::byte* getColumn(const Chunk& chunk, ComponentId id) const noexcept {
+            return chunk.data + m_Offsets[id];
+        }
+
+    private:
+        friend class World;
+
+        // Appends a row for `entity` with uninitialized components.
+        uint32_t allocateRow(Entity entity);
+        // Returns the entity moved into `row`, or kNullEntity when it was the last row.
+        Entity removeRow(uint32_t row);
+        std::byte* getComponent(uint32_t row, ComponentId id);
+
+        ComponentMask m_Mask;
+        std::vector<ComponentId> m_Components;
+        std::array<uint32_t, kMaxComponents> m_Offsets{};
+        uint32_t m_Capacity = 0;
+        std::vector<Chunk> m_Chunks;
+        size_t m_Count = 0;
+
+        // archetypes one component away, filled in as entities move between them
+        std::unordered_map<ComponentId, Archetype*> m_AddEdges;
+        std::unordered_map<ComponentId, Archetype*> m_RemoveEdges;
+    };
+
+    // Entity storage. Entities are handles into archetype chunks; queries walk the chunks of every archetype that
+    // has the queried components.
+    //
+    // Structural changes (creating and destroying entities, adding and removing components) move rows between
+    // chunks, so they must not happen while the world is being iterated or from more than one thread. Systems
+    // record them in EntityCommands instead. Component values themselves may be written from any thread that owns
+    // them, which is what the scheduler's access declarations are for.
+    class World {
+    public:
+        World();
+        ~World();
+
+        World(const World&) = delete;
+        World& operator=(const World&) = delete;
+
+        Entity create();
+        template<Component T, Component... Ts>
+        Entity create(const T& component, const Ts&... components);
+        void destroy(Entity entity);
+        [[nodiscard]] bool isAlive(Entity entity) const noexcept;
+
+        // Thread-safe. Hands out an entity that becomes alive, without components, at the next structural change
+        // or flushReserved().
+        Entity reserve();
+        void flushReserved();
+
+        // Overwrites the component if the entity already has one.
+        template<Component T>
+        void add(Entity entity, const T& component) {
+            addRaw(entity, componentId<T>(), &component);
+        }
+
+        template<Component T>
+        void remove(Entity entity) {
+            removeRaw(entity, componentId<T>());
+        }
+
+        // Null when the entity isn't alive or doesn't have the component.
+        template<Component T>
+        [[nodiscard]] T* get(Entity entity) {
+            return static_cast<T*>(getRaw(entity, componentId<T>()));
+        }
+
+        template<Component T>
+        [[nodiscard]] bool has(Entity entity) {
+            return getRaw(entity, componentId<T>()) != nullptr;
+        }
+
+        // fn(Ts&...) or fn(Entity, Ts&...) for every entity with all of Ts; request const Ts for read-only access.
+        template<typename... Ts, typename F>
+        void each(F&& fn);
+        // fn(std::span<const Entity>, std::span<Ts>...) once per chunk.
+        template<typename... Ts, typename F>
+        void eachChunk(F&& fn);
+        // Like each(), with the chunks spread over the job system. fn must be safe to call concurrently.
+        template<typename... Ts, typename F>
+        void parallelEach(JobSystem& jobs, F&& fn);
+
+        void addRaw(Entity entity, ComponentId id, const void* data);
+        void removeRaw(Entity entity, ComponentId id);
+        [[nodiscard]] void* getRaw(Entity entity, ComponentId id);
+
+        [[nodiscard]] size_t getEntityCount() const noexcept;
+        [[nodiscard]] size_t getArchetypeCount() const noexcept;
+
+    private:
+        struct EntityRecord {
+            Archetype* archetype = nullptr;
+            uint32_t row = 0;
+            uint32_t generation = 0;
+        };
+
+        EntityRecord& getRecord(Entity entity);
+        Archetype* getArchetype(const ComponentMask& mask);
+        Archetype* getAddTarget(Archetype* archetype, ComponentId id);
+        Archetype* getRemoveTarget(Archetype* archetype, ComponentId id);
+        void moveEntity(Entity entity, EntityRecord& record, Archetype* target);
+        void place(Entity entity);
+        void insertRaw(Entity entity, std::span<const ComponentId> ids, std::span<const void* const> data);
+
+        template<typename... Ts, typename F>
+        void eachArchetype(F&& fn);
+
+        std::unordered_map<ComponentMask, std::unique_ptr<Archetype>> m_ArchetypeMap;
+        std::vector<Archetype*> m_Archetypes;
+        Archetype* m_EmptyArchetype = nullptr;
+
+        std::vector<EntityRecord> m_Records;
+        std::vector<uint32_t> m_FreeIndices;
+        // m_FreeIndices.size() minus the entities reserved since the last flush; below zero the reservations
+        // continue past the end of m_Records
+        std::atomic<int64_t> m_FreeCursor{0};
+        size_t m_EntityCount = 0;
+    };
+
+    // Structural changes recorded while the world can't take them, applied in order by apply(). Commands for
+    // entities that died in the meantime are dropped. A recorder is used by one thread at a time; its buffer keeps
+    // its capacity across apply() calls.
+    class EntityCommands {
+    public:
+        explicit EntityCommands(World& world);
+
+        // The entity is usable in later commands right away and alive once they're applied.
+        Entity create();
+        void destroy(Entity entity);
+
+        template<Component T>
+        void add(Entity entity, const T& component) {
+            push(Op::eAdd, entity, componentId<T>(), &component, sizeof(T));
+        }
+
+        template<Component T>
+        void remove(Entity entity) {
+            push(Op::eRemove, entity, componentId<T>(), nullptr, 0);
+        }
+
+        void apply();
+        [[nodiscard]] bool isEmpty() const noexcept;
+
+    private:
+        enum class Op : uint32_t {
+            eAdd,
+            eRemove,
+            eDestroy
+        };
+
+        struct Header {
+            Op op;
+            ComponentId component;
+            Entity entity;
+            uint32_t size;
+        };
+
+        void push(Op op, Entity entity, ComponentId component, const void* data, uint32_t size);
+
+        World* m_World;
+        std::vector<std::byte> m_Data;
+    };
+
+    template<Component T, Component... Ts>
+    Entity World::create(const T &component, const Ts &... components) {
+        Entity entity = create();
+        const std::array<ComponentId, 1 + sizeof...(Ts)> ids{componentId<T>(), componentId<Ts>()...};
+        const std::array<const void*, 1 + sizeof...(Ts)> data{&component, &components...};
+        insertRaw(entity, ids, data);
+        return entity;
+    }
+
+    template<typename... Ts, typename F>
+    void World::eachArchetype(F &&fn) {
+        const ComponentMask mask = componentMask<Ts...>();
+        for (Archetype* archetype : m_Archetypes) {
+            if (archetype->getEntityCount() > 0 && (archetype->getMask() & mask) == mask) {
+                fn(*archetype);
+            }
+        }
+    }
+
+    template<typename... Ts, typename F>
+    void World::eachChunk(F &&fn) {
+        eachArchetype<Ts...>([&](const Archetype& archetype) {
+            for (const Archetype::Chunk& chunk : archetype.getChunks()) {
+                fn(std::span<const Entity>(archetype.getEntities(chunk), chunk.count),
+                   std::span<Ts>(reinterpret_cast<Ts*>(archetype.getColumn(chunk, componentId<std::remove_const_t<Ts>>())), chunk.count)...);
+            }
+        });
+    }
+
+    template<typename... Ts, typename F>
+    void World::each(F &&fn) {
+        eachChunk<Ts...>([&](std::span<const Entity> entities, std::span<Ts>... columns) {
+            for (size_t i = 0; i < entities.size(); i++) {
+                if constexpr (std::is_invocable_v<F&, Entity, Ts&...>) {
+                    fn(entities[i], columns[i]...);
+                } else {
+                    fn(columns[i]...);
+                }
+            }
+        });
+    }
+
+    template<typename... Ts, typename F>
+    void World::parallelEach(JobSystem &jobs, F &&fn) {
+        eachArchetype<Ts...>([&](const Archetype& archetype) {
+            std::span<const Archetype::Chunk> chunks = archetype.getChunks();
+            jobs.parallelFor(0, chunks.size(), 0, [&](size_t begin, size_t end) {
+                for (size_t c = begin; c < end; c++) {
+                    const Archetype::Chunk& chunk = chunks[c];
+                    const Entity* entities = archetype.getEntities(chunk);
+                    std::tuple<Ts*...> columns{reinterpret_cast<Ts*>(archetype.getColumn(chunk, componentId<std::remove_const_t<Ts>>()))...};
+                    for (uint32_t i = 0; i < chunk.count; i++) {
+                        if constexpr (std::is_invocable_v<F&, Entity, Ts&...>) {
+                            fn(entities[i], std::get<Ts*>(columns)[i]...);
+                        } else {
+                            fn(std::get<Ts*>(columns)[i]...);
+                        }
+                    }
+                }
+            });
+        });
+    }
+}
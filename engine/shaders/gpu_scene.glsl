@@ -0,0 +1,63 @@
+// Shared between the GPU scene shaders; mirrors the structs in kat/GpuScene.h (std430).
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define KAT_MAX_LODS 4
+
+struct Instance {
+    mat4 transform;
+    vec4 color;
+    uint mesh;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+struct MeshLod {
+    uint firstIndex;
+    uint indexCount;
+};
+
+struct Mesh {
+    // bounding sphere in mesh space, radius in w
+    vec4 sphere;
+    MeshLod lods[KAT_MAX_LODS];
+    uint lodCount;
+    int vertexOffset;
+    uint padding0;
+    uint padding1;
+};
+
+struct View {
+    mat4 viewProjection;
+    // normalized, inside where dot(plane.xyz, p) + plane.w >= 0
+    vec4 planes[6];
+    // camera position in xyz, distance covered by LOD 0 in w
+    vec4 camera;
+    uint instanceCount;
+    // 1: append visible draws and count them, 0: one draw per instance with culled ones zeroed
+    uint compact;
+    uint padding0;
+    uint padding1;
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+// bindless storage buffers (BindlessRegistry::kStorageBufferBinding), indexed by SceneConstants
+layout(set = 0, binding = 2) readonly buffer Views { View view; } views[];
+layout(set = 0, binding = 2) readonly buffer Instances { Instance instances[]; } instanceBuffers[];
+layout(set = 0, binding = 2) readonly buffer Meshes { Mesh meshes[]; } meshBuffers[];
+
+layout(push_constant) uniform SceneConstants {
+    uint viewBuffer;
+    uint instanceBuffer;
+    uint meshBuffer;
+    uint drawBuffer;
+    uint countBuffer;
+} scene;
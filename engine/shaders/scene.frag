@@ -0,0 +1,12 @@
+#version 460
+
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    const vec3 lightDirection = normalize(vec3(0.4, 1.0, 0.3));
+    float diffuse = max(dot(normalize(inNormal), lightDirection), 0.0);
+    outColor = vec4(inColor.rgb * (0.2 + 0.8 * diffuse), inColor.a);
+}
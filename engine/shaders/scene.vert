@@ -0,0 +1,19 @@
+#version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "gpu_scene.glsl"
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec4 outColor;
+
+void main() {
+    // firstInstance of the indirect draw is the instance index
+    Instance instance = instanceBuffers[scene.instanceBuffer].instances[gl_InstanceIndex];
+
+    gl_Position = views[scene.viewBuffer].view.viewProjection * instance.transform * vec4(inPosition, 1.0);
+    outNormal = mat3(instance.transform) * inNormal;
+    outColor = instance.color;
+}
@@ -0,0 +1,66 @@
+#include "kat/AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace kat::debug {
+    namespace {
+        thread_local size_t t_AllocationCount = 0;
+    }
+
+    size_t getThreadAllocationCount() noexcept {
+        return t_AllocationCount;
+    }
+}
+
+#ifndef NDEBUG
+
+// Replaces the global (non-aligned) allocation functions so debug builds can assert the frame loop doesn't allocate.
+// This translation unit is only linked in when getThreadAllocationCount() is referenced.
+
+void* operator new(std::size_t size) {
+    kat::debug::t_AllocationCount++;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    kat::debug::t_AllocationCount++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+#endif
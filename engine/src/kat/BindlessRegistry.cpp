@@ -0,0 +1,196 @@
+#include "kat/BindlessRegistry.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace kat {
+
+    BindlessSlots::BindlessSlots(uint32_t capacity)
+        : m_Capacity(capacity), m_Next(std::make_unique<std::atomic<uint32_t>[]>(capacity)) {
+        for (auto& head : m_Released) {
+            head.store(kEnd, std::memory_order_relaxed);
+        }
+    }
+
+    std::optional<uint32_t> BindlessSlots::allocate() {
+        uint64_t head = m_FreeHead.load(std::memory_order_acquire);
+        while (static_cast<uint32_t>(head) != kEnd) {
+            uint32_t slot = static_cast<uint32_t>(head);
+            // may read a stale link if the slot was taken meanwhile, the tag makes that exchange fail
+            uint64_t next = ((head >> 32) + 1) << 32 | m_Next[slot].load(std::memory_order_relaxed);
+            if (m_FreeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+
+        uint32_t slot = m_Bump.load(std::memory_order_relaxed);
+        while (slot < m_Capacity) {
+            if (m_Bump.compare_exchange_weak(slot, slot + 1, std::memory_order_relaxed)) {
+                return slot;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void BindlessSlots::release(uint32_t slot, uint64_t frame) {
+        std::atomic<uint32_t>& head = m_Released[frame % kBuckets];
+        uint32_t next = head.load(std::memory_order_relaxed);
+        do {
+            m_Next[slot].store(next, std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(next, slot, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void BindlessSlots::reclaim(uint64_t frame) {
+        uint32_t slot = m_Released[frame % kBuckets].exchange(kEnd, std::memory_order_acquire);
+        while (slot != kEnd) {
+            uint32_t next = m_Next[slot].load(std::memory_order_relaxed);
+            push(slot);
+            slot = next;
+        }
+    }
+
+    uint32_t BindlessSlots::getCapacity() const noexcept {
+        return m_Capacity;
+    }
+
+    void BindlessSlots::push(uint32_t slot) {
+        uint64_t head = m_FreeHead.load(std::memory_order_relaxed);
+        uint64_t next;
+        do {
+            m_Next[slot].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            next = ((head >> 32) + 1) << 32 | slot;
+        } while (!m_FreeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    BindlessRegistry::BindlessRegistry(App &app) : m_App(app), m_Device(app.getDevice()) {
+        auto properties = app.getEngine()->getGpu().getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+        const vk::PhysicalDeviceVulkan12Properties& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+
+        uint32_t imageCount = std::min({kMaxSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSampledImages});
+        uint32_t samplerCount = std::min({kMaxSamplers, limits.maxPerStageDescriptorUpdateAfterBindSamplers, limits.maxDescriptorSetUpdateAfterBindSamplers});
+        uint32_t bufferCount = std::min({kMaxStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+
+        std::array<vk::DescriptorSetLayoutBinding, 3> bindings{
+            vk::DescriptorSetLayoutBinding{kSampledImageBinding, vk::DescriptorType::eSampledImage, imageCount, vk::ShaderStageFlagBits::eAll},
+            vk::DescriptorSetLayoutBinding{kSamplerBinding, vk::DescriptorType::eSampler, samplerCount, vk::ShaderStageFlagBits::eAll},
+            vk::DescriptorSetLayoutBinding{kStorageBufferBinding, vk::DescriptorType::eStorageBuffer, bufferCount, vk::ShaderStageFlagBits::eAll}
+        };
+
+        // slots that were never written (or were released) are never read, and writes don't wait for the GPU
+        vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound
+            | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        std::array<vk::DescriptorBindingFlags, 3> flags{bindingFlags, bindingFlags, bindingFlags};
+        vk::DescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{flags};
+
+        vk::DescriptorSetLayoutCreateInfo layoutInfo{vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings};
+        layoutInfo.setPNext(&flagsInfo);
+        m_SetLayout = m_Device.createDescriptorSetLayout(layoutInfo);
+
+        vk::PushConstantRange pushConstants{vk::ShaderStageFlagBits::eAll, 0, kPushConstantSize};
+        m_PipelineLayout = m_Device.createPipelineLayout(vk::PipelineLayoutCreateInfo{
+            vk::PipelineLayoutCreateFlags(), m_SetLayout, pushConstants
+        });
+
+        std::array<vk::DescriptorPoolSize, 3> poolSizes{
+            vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, imageCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eSampler, samplerCount},
+            vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, bufferCount}
+        };
+        m_Pool = m_Device.createDescriptorPool(vk::DescriptorPoolCreateInfo{
+            vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, poolSizes
+        });
+        m_Set = m_Device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{m_Pool, m_SetLayout})[0];
+
+        m_Images = std::make_unique<BindlessSlots>(imageCount);
+        m_Samplers = std::make_unique<BindlessSlots>(samplerCount);
+        m_Buffers = std::make_unique<BindlessSlots>(bufferCount);
+
+        spdlog::info("Created bindless registry: {} sampled images, {} samplers, {} storage buffers", imageCount, samplerCount, bufferCount);
+    }
+
+    void BindlessRegistry::cleanup() {
+        m_Device.destroyDescriptorPool(m_Pool);
+        m_Device.destroyPipelineLayout(m_PipelineLayout);
+        m_Device.destroyDescriptorSetLayout(m_SetLayout);
+    }
+
+    BindlessImage BindlessRegistry::registerImage(vk::ImageView view, vk::ImageLayout layout) {
+        uint32_t slot = allocateSlot(*m_Images, "sampled image");
+        vk::DescriptorImageInfo info{nullptr, view, layout};
+        write(vk::WriteDescriptorSet{m_Set, kSampledImageBinding, slot, vk::DescriptorType::eSampledImage, info});
+        return BindlessImage{slot};
+    }
+
+    BindlessSampler BindlessRegistry::registerSampler(vk::Sampler sampler) {
+        uint32_t slot = allocateSlot(*m_Samplers, "sampler");
+        vk::DescriptorImageInfo info{sampler};
+        write(vk::WriteDescriptorSet{m_Set, kSamplerBinding, slot, vk::DescriptorType::eSampler, info});
+        return BindlessSampler{slot};
+    }
+
+    BindlessBuffer BindlessRegistry::registerBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+        uint32_t slot = allocateSlot(*m_Buffers, "storage buffer");
+        vk::DescriptorBufferInfo info{buffer, offset, range};
+        write(vk::WriteDescriptorSet{m_Set, kStorageBufferBinding, slot, vk::DescriptorType::eStorageBuffer, nullptr, info});
+        return BindlessBuffer{slot};
+    }
+
+    void BindlessRegistry::release(BindlessImage image) {
+        if (image.index != kInvalidBindlessIndex) {
+            m_Images->release(image.index, m_App.getRetireFrame());
+        }
+    }
+
+    void BindlessRegistry::release(BindlessSampler sampler) {
+        if (sampler.index != kInvalidBindlessIndex) {
+            m_Samplers->release(sampler.index, m_App.getRetireFrame());
+        }
+    }
+
+    void BindlessRegistry::release(BindlessBuffer buffer) {
+        if (buffer.index != kInvalidBindlessIndex) {
+            m_Buffers->release(buffer.index, m_App.getRetireFrame());
+        }
+    }
+
+    void BindlessRegistry::beginFrame(uint64_t frameNumber) {
+        // App::beginFrame() just waited for this frame's slot to be done with the frame that last used it
+        uint32_t framesInFlight = m_App.getFramesInFlight();
+        if (frameNumber < framesInFlight) {
+            return;
+        }
+        m_Images->reclaim(frameNumber - framesInFlight);
+        m_Samplers->reclaim(frameNumber - framesInFlight);
+        m_Buffers->reclaim(frameNumber - framesInFlight);
+    }
+
+    void BindlessRegistry::bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint) {
+        commandBuffer.bindDescriptorSets(bindPoint, m_PipelineLayout, 0, m_Set, nullptr);
+    }
+
+    vk::DescriptorSetLayout BindlessRegistry::getSetLayout() {
+        return m_SetLayout;
+    }
+
+    vk::PipelineLayout BindlessRegistry::getPipelineLayout() {
+        return m_PipelineLayout;
+    }
+
+    vk::DescriptorSet BindlessRegistry::getDescriptorSet() {
+        return m_Set;
+    }
+
+    uint32_t BindlessRegistry::allocateSlot(BindlessSlots &slots, const char *kind) {
+        std::optional<uint32_t> slot = slots.allocate();
+        if (!slot.has_value()) {
+            spdlog::error("Out of bindless {} slots (all {} in use)", kind, slots.getCapacity());
+            throw std::runtime_error("Bindless registry is full");
+        }
+        return slot.value();
+    }
+
+    void BindlessRegistry::write(const vk::WriteDescriptorSet &write) {
+        std::lock_guard lock(m_WriteMutex);
+        m_Device.updateDescriptorSets(write, nullptr);
+    }
+}
@@ -0,0 +1,532 @@
+#include "kat/Bvh.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+
+namespace kat {
+
+    namespace {
+        constexpr uint32_t kBinCount = 16;
+
+        // plane normals' absolute values alongside the planes, for the box extent along each normal
+        struct FrustumTest {
+            FrustumPlanes planes;
+            std::array<glm::vec3, 6> absNormals;
+
+            explicit FrustumTest(const FrustumPlanes& frustum) : planes(frustum) {
+                for (size_t p = 0; p < planes.size(); p++) {
+                    absNormals[p] = glm::abs(glm::vec3(planes[p]));
+                }
+            }
+
+            enum class Result { eOutside, eIntersecting, eInside };
+
+            [[nodiscard]] Result test(glm::vec3 min, glm::vec3 max) const {
+                glm::vec3 center = (min + max) * 0.5f;
+                glm::vec3 extent = (max - min) * 0.5f;
+                Result result = Result::eInside;
+                for (size_t p = 0; p < planes.size(); p++) {
+                    float distance = glm::dot(glm::vec3(planes[p]), center) + planes[p].w;
+                    float reach = glm::dot(absNormals[p], extent);
+                    if (distance + reach < 0.0f) {
+                        return Result::eOutside;
+                    }
+                    if (distance - reach < 0.0f) {
+                        result = Result::eIntersecting;
+                    }
+                }
+                return result;
+            }
+        };
+
+        struct RayTest {
+            glm::vec3 origin;
+            glm::vec3 inverseDirection;
+
+            explicit RayTest(const Ray& ray) : origin(ray.origin), inverseDirection(1.0f / ray.direction) {}
+
+            // distance along the ray where it enters the box, if it does before `maxDistance`
+            [[nodiscard]] std::optional<float> test(glm::vec3 min, glm::vec3 max, float maxDistance) const {
+                glm::vec3 t0 = (min - origin) * inverseDirection;
+                glm::vec3 t1 = (max - origin) * inverseDirection;
+                glm::vec3 entries = glm::min(t0, t1);
+                glm::vec3 exits = glm::max(t0, t1);
+                float entry = std::max({entries.x, entries.y, entries.z, 0.0f});
+                float exit = std::min({exits.x, exits.y, exits.z, maxDistance});
+                if (entry > exit) {
+                    return std::nullopt;
+                }
+                return entry;
+            }
+        };
+
+        bool contains(const Aabb& outer, glm::vec3 min, glm::vec3 max) {
+            return glm::all(glm::lessThanEqual(outer.min, min)) && glm::all(glm::lessThanEqual(max, outer.max));
+        }
+    }
+
+    // Builds the tree top-down into BuildNodes, splitting every range at the best of kBinCount SAH buckets along
+    // each axis. Ranges of at least kParallelBuildSize objects become jobs of their own.
+    class Bvh::Builder {
+    public:
+        Builder(Bvh& bvh, std::span<const BvhProxy> proxies)
+            : m_Bvh(bvh), m_Objects(proxies.size()), m_Nodes(std::max<size_t>(proxies.size() * 2, 2) - 1) {
+            m_Bvh.m_Jobs.parallelFor(0, proxies.size(), 0, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    const Aabb& bounds = m_Bvh.m_Objects[proxies[i]].bounds;
+                    m_Objects[i] = BuildObject{bounds, (bounds.min + bounds.max) * 0.5f, proxies[i]};
+                }
+            });
+        }
+
+        // Returns the nodes, root first; node ranges index the objects in the order getProxy() returns them.
+        const std::vector<BuildNode>& build() {
+            m_Nodes[0] = BuildNode{Aabb{}, 0, static_cast<uint32_t>(m_Objects.size())};
+            buildRange(0);
+            m_Bvh.m_Jobs.wait(m_Counter);
+            return m_Nodes;
+        }
+
+        [[nodiscard]] BvhProxy getProxy(uint32_t index) const {
+            return m_Objects[index].proxy;
+        }
+
+    private:
+        // what the build needs of an object, copied so the ranges it splits are contiguous memory
+        struct BuildObject {
+            Aabb bounds;
+            glm::vec3 centroid;
+            BvhProxy proxy;
+        };
+
+        struct Bin {
+            Aabb bounds;
+            uint32_t count = 0;
+        };
+
+        // builds the subtree under `root`, handing large ranges to other jobs
+        void buildRange(uint32_t root) {
+            std::vector<uint32_t> stack{root};
+            while (!stack.empty()) {
+                uint32_t index = stack.back();
+                stack.pop_back();
+
+                if (!split(index)) {
+                    continue;
+                }
+                for (uint32_t child : {m_Nodes[index].left, m_Nodes[index].left + 1}) {
+                    if (m_Nodes[child].count >= kParallelBuildSize) {
+                        m_Bvh.m_Jobs.schedule([this, child] { buildRange(child); }, &m_Counter);
+                    } else {
+                        stack.push_back(child);
+                    }
+                }
+            }
+        }
+
+        // Computes the node's bounds and splits its range in two, or returns false to keep it a leaf.
+        bool split(uint32_t index) {
+            BuildNode& node = m_Nodes[index];
+            const auto begin = m_Objects.begin() + node.first;
+            const auto end = begin + node.count;
+
+            Aabb centroidBounds;
+            for (auto it = begin; it != end; ++it) {
+                node.bounds.grow(it->bounds);
+                centroidBounds.grow(Aabb{it->centroid, it->centroid});
+            }
+            if (node.count <= 1) {
+                return false;
+            }
+
+            // every axis at once: bins[axis][bin]
+            std::array<std::array<Bin, kBinCount>, 3> bins{};
+            glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+            glm::vec3 scale{0.0f};
+            for (int axis = 0; axis < 3; axis++) {
+                if (extent[axis] > 0.0f) {
+                    scale[axis] = kBinCount * 0.9999f / extent[axis];
+                }
+            }
+            auto getBin = [&](const BuildObject& object, int axis) {
+                return std::min(static_cast<uint32_t>((object.centroid[axis] - centroidBounds.min[axis]) * scale[axis]), kBinCount - 1);
+            };
+            for (auto it = begin; it != end; ++it) {
+                for (int axis = 0; axis < 3; axis++) {
+                    Bin& bin = bins[axis][getBin(*it, axis)];
+                    bin.bounds.grow(it->bounds);
+                    bin.count++;
+                }
+            }
+
+            // cost of a split relative to intersecting every object: one traversal step plus the children's
+            // objects weighted by the chance a query that reaches this node reaches them
+            float area = node.bounds.getHalfArea();
+            float bestCost = std::numeric_limits<float>::max();
+            int bestAxis = -1;
+            uint32_t bestSplit = 0;
+            for (int axis = 0; axis < 3; axis++) {
+                if (scale[axis] == 0.0f) {
+                    continue;
+                }
+                // right to left sweep first, so the left to right one can price every split directly
+                std::array<float, kBinCount> rightCosts{};
+                Aabb right;
+                uint32_t rightCount = 0;
+                for (uint32_t b = kBinCount - 1; b > 0; b--) {
+                    right.grow(bins[axis][b].bounds);
+                    rightCount += bins[axis][b].count;
+                    rightCosts[b] = rightCount > 0 ? right.getHalfArea() * static_cast<float>(rightCount) : 0.0f;
+                }
+                Aabb left;
+                uint32_t leftCount = 0;
+                for (uint32_t b = 1; b < kBinCount; b++) {
+                    left.grow(bins[axis][b - 1].bounds);
+                    leftCount += bins[axis][b - 1].count;
+                    float cost = left.getHalfArea() * static_cast<float>(leftCount) + rightCosts[b];
+                    if (leftCount > 0 && leftCount < node.count && cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b;
+                    }
+                }
+            }
+
+            uint32_t leftCount = 0;
+            if (bestAxis >= 0) {
+                float splitCost = area > 0.0f ? 1.0f + bestCost / area : 1.0f;
+                if (node.count <= kMaxLeafSize && splitCost >= static_cast<float>(node.count)) {
+                    return false;
+                }
+                auto middle = std::partition(begin, end, [&](const BuildObject& object) {
+                    return getBin(object, bestAxis) < bestSplit;
+                });
+                leftCount = static_cast<uint32_t>(middle - begin);
+            } else if (node.count <= kMaxLeafSize) {
+                return false;
+            } else {
+                // every centroid in one spot, any halving is as good as another
+                leftCount = node.count / 2;
+            }
+
+            uint32_t left = m_Next.fetch_add(2, std::memory_order_relaxed);
+            m_Nodes[left] = BuildNode{Aabb{}, node.first, leftCount};
+            m_Nodes[left + 1] = BuildNode{Aabb{}, node.first + leftCount, node.count - leftCount};
+            node.left = left;
+            return true;
+        }
+
+        Bvh& m_Bvh;
+        std::vector<BuildObject> m_Objects;
+        // a binary tree over n leaves has 2n - 1 nodes, and no leaf is empty
+        std::vector<BuildNode> m_Nodes;
+        std::atomic<uint32_t> m_Next{1};
+        JobCounter m_Counter;
+    };
+
+    Bvh::Bvh(JobSystem &jobs) : m_Jobs(jobs), m_Nodes{Node{glm::vec3(0.0f), 0, glm::vec3(0.0f), 0}} {
+    }
+
+    BvhProxy Bvh::add(const Aabb &bounds, uint32_t item) {
+        BvhProxy proxy;
+        if (!m_FreeProxies.empty()) {
+            proxy = m_FreeProxies.back();
+            m_FreeProxies.pop_back();
+        } else {
+            proxy = static_cast<BvhProxy>(m_Objects.size());
+            m_Objects.emplace_back();
+        }
+        m_Objects[proxy] = Object{bounds, item, UINT32_MAX, UINT32_MAX, true};
+        m_ObjectCount++;
+        m_StructureChanged = true;
+        return proxy;
+    }
+
+    void Bvh::remove(BvhProxy proxy) {
+        checkProxy(proxy);
+        Object& object = m_Objects[proxy];
+        object.alive = false;
+        // its leaf slot is gone with the rebuild this forces
+        object.position = UINT32_MAX;
+        object.leaf = UINT32_MAX;
+        m_FreeProxies.push_back(proxy);
+        m_ObjectCount--;
+        m_StructureChanged = true;
+    }
+
+    void Bvh::setBounds(BvhProxy proxy, const Aabb &bounds) {
+        checkProxy(proxy);
+        Object& object = m_Objects[proxy];
+        object.bounds = bounds;
+        if (object.position != UINT32_MAX) {
+            m_LeafBounds[object.position] = bounds;
+            m_Moved.push_back(proxy);
+        }
+    }
+
+    const Aabb &Bvh::getBounds(BvhProxy proxy) const {
+        checkProxy(proxy);
+        return m_Objects[proxy].bounds;
+    }
+
+    void Bvh::commit() {
+        if (m_StructureChanged) {
+            rebuild();
+            return;
+        }
+        if (m_Moved.empty()) {
+            return;
+        }
+
+        auto nodeCount = static_cast<uint32_t>(m_Nodes.size() - 1);
+        if (m_Moved.size() * 4 >= m_ObjectCount) {
+            // most of the tree is dirty, one backwards pass over all of it is cheaper than finding the dirty parts
+            for (uint32_t node = nodeCount; node-- > 0;) {
+                refit(node);
+            }
+        } else {
+            // every node above a moved object, children before their parents: depth-first order puts them after
+            m_RefitMarks.assign(nodeCount, 0);
+            m_RefitNodes.clear();
+            for (BvhProxy proxy : m_Moved) {
+                for (uint32_t node = m_Objects[proxy].leaf; node != UINT32_MAX && !m_RefitMarks[node]; node = m_Parents[node]) {
+                    m_RefitMarks[node] = 1;
+                    m_RefitNodes.push_back(node);
+                }
+            }
+            std::sort(m_RefitNodes.begin(), m_RefitNodes.end(), std::greater<>());
+            for (uint32_t node : m_RefitNodes) {
+                refit(node);
+            }
+        }
+
+        m_MovedSinceBuild += m_Moved.size();
+        m_Moved.clear();
+
+        // refitting only grows boxes apart; once about every object has moved, check whether it's gone too far
+        if (m_MovedSinceBuild >= m_ObjectCount) {
+            m_MovedSinceBuild = 0;
+            if (getCost() > m_BuiltCost * kRebuildCostRatio) {
+                rebuild();
+            }
+        }
+    }
+
+    void Bvh::rebuild() {
+        std::vector<BvhProxy> proxies;
+        proxies.reserve(m_ObjectCount);
+        for (BvhProxy proxy = 0; proxy < m_Objects.size(); proxy++) {
+            if (m_Objects[proxy].alive) {
+                proxies.push_back(proxy);
+            }
+        }
+
+        m_Nodes.clear();
+        m_Parents.clear();
+        m_StructureChanged = false;
+        m_Moved.clear();
+        m_MovedSinceBuild = 0;
+
+        if (proxies.empty()) {
+            m_Nodes.push_back(Node{glm::vec3(0.0f), 0, glm::vec3(0.0f), 0});
+            m_LeafBounds.clear();
+            m_LeafItems.clear();
+            m_BuiltCost = 0.0f;
+            return;
+        }
+
+        Builder builder(*this, proxies);
+        const std::vector<BuildNode>& built = builder.build();
+
+        // depth first, left before right, which is also the order of the object ranges
+        m_Nodes.reserve(built.size() + 1);
+        m_Parents.reserve(built.size());
+        std::vector<std::pair<uint32_t, uint32_t>> stack{{0, UINT32_MAX}};
+        while (!stack.empty()) {
+            auto [index, parent] = stack.back();
+            stack.pop_back();
+
+            const BuildNode& node = built[index];
+            auto flat = static_cast<uint32_t>(m_Nodes.size());
+            // interior nodes get their skip below, once their subtrees are laid out
+            m_Nodes.push_back(Node{node.bounds.min, node.first, node.bounds.max, node.left == 0 ? flat + 1 : 0});
+            m_Parents.push_back(parent);
+            if (node.left == 0) {
+                for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                    Object& object = m_Objects[builder.getProxy(i)];
+                    object.position = i;
+                    object.leaf = flat;
+                }
+            } else {
+                stack.emplace_back(node.left + 1, flat);
+                stack.emplace_back(node.left, flat);
+            }
+        }
+        m_Nodes.push_back(Node{glm::vec3(0.0f), static_cast<uint32_t>(proxies.size()), glm::vec3(0.0f), 0});
+
+        // an interior node's subtree ends where its right child's does, and the right child follows the left's
+        for (auto node = static_cast<uint32_t>(m_Nodes.size() - 1); node-- > 0;) {
+            if (m_Nodes[node].skip == 0) {
+                m_Nodes[node].skip = m_Nodes[m_Nodes[node + 1].skip].skip;
+            }
+        }
+
+        m_LeafBounds.resize(proxies.size());
+        m_LeafItems.resize(proxies.size());
+        for (uint32_t i = 0; i < proxies.size(); i++) {
+            const Object& object = m_Objects[builder.getProxy(i)];
+            m_LeafBounds[i] = object.bounds;
+            m_LeafItems[i] = object.item;
+        }
+        m_BuiltCost = getCost();
+    }
+
+    void Bvh::checkProxy(BvhProxy proxy) const {
+        if (proxy >= m_Objects.size() || !m_Objects[proxy].alive) {
+            spdlog::error("ERROR: BVH PROXY {} DOES NOT EXIST", proxy);
+            throw std::runtime_error("Invalid BVH proxy");
+        }
+    }
+
+    void Bvh::refit(uint32_t node) {
+        Aabb bounds;
+        if (isLeaf(node)) {
+            for (uint32_t i = m_Nodes[node].first; i < getNodeEnd(node); i++) {
+                bounds.grow(m_LeafBounds[i]);
+            }
+        } else {
+            uint32_t right = m_Nodes[node + 1].skip;
+            bounds.grow(Aabb{m_Nodes[node + 1].min, m_Nodes[node + 1].max});
+            bounds.grow(Aabb{m_Nodes[right].min, m_Nodes[right].max});
+        }
+        m_Nodes[node].min = bounds.min;
+        m_Nodes[node].max = bounds.max;
+    }
+
+    void Bvh::queryFrustum(const FrustumPlanes &planes, std::vector<uint32_t> &items) const {
+        const FrustumTest frustum(planes);
+        const auto nodeCount = static_cast<uint32_t>(m_Nodes.size() - 1);
+        uint32_t node = 0;
+        while (node < nodeCount) {
+            const Node& current = m_Nodes[node];
+            FrustumTest::Result result = frustum.test(current.min, current.max);
+            if (result == FrustumTest::Result::eOutside) {
+                node = current.skip;
+            } else if (result == FrustumTest::Result::eInside) {
+                items.insert(items.end(), m_LeafItems.begin() + current.first, m_LeafItems.begin() + getNodeEnd(node));
+                node = current.skip;
+            } else if (isLeaf(node)) {
+                for (uint32_t i = current.first; i < getNodeEnd(node); i++) {
+                    if (frustum.test(m_LeafBounds[i].min, m_LeafBounds[i].max) != FrustumTest::Result::eOutside) {
+                        items.push_back(m_LeafItems[i]);
+                    }
+                }
+                node = current.skip;
+            } else {
+                node++;
+            }
+        }
+    }
+
+    void Bvh::queryAabb(const Aabb &bounds, std::vector<uint32_t> &items) const {
+        const auto nodeCount = static_cast<uint32_t>(m_Nodes.size() - 1);
+        uint32_t node = 0;
+        while (node < nodeCount) {
+            const Node& current = m_Nodes[node];
+            if (!bounds.overlaps(Aabb{current.min, current.max})) {
+                node = current.skip;
+            } else if (contains(bounds, current.min, current.max)) {
+                items.insert(items.end(), m_LeafItems.begin() + current.first, m_LeafItems.begin() + getNodeEnd(node));
+                node = current.skip;
+            } else if (isLeaf(node)) {
+                for (uint32_t i = current.first; i < getNodeEnd(node); i++) {
+                    if (bounds.overlaps(m_LeafBounds[i])) {
+                        items.push_back(m_LeafItems[i]);
+                    }
+                }
+                node = current.skip;
+            } else {
+                node++;
+            }
+        }
+    }
+
+    void Bvh::queryRay(const Ray &ray, std::vector<uint32_t> &items) const {
+        const RayTest test(ray);
+        const auto nodeCount = static_cast<uint32_t>(m_Nodes.size() - 1);
+        uint32_t node = 0;
+        while (node < nodeCount) {
+            const Node& current = m_Nodes[node];
+            if (!test.test(current.min, current.max, ray.maxDistance)) {
+                node = current.skip;
+            } else if (isLeaf(node)) {
+                for (uint32_t i = current.first; i < getNodeEnd(node); i++) {
+                    if (test.test(m_LeafBounds[i].min, m_LeafBounds[i].max, ray.maxDistance)) {
+                        items.push_back(m_LeafItems[i]);
+                    }
+                }
+                node = current.skip;
+            } else {
+                node++;
+            }
+        }
+    }
+
+    std::optional<RayHit> Bvh::raycast(const Ray &ray, FunctionRef<std::optional<float>(uint32_t)> intersect) const {
+        const RayTest test(ray);
+        std::optional<RayHit> closest;
+        float maxDistance = ray.maxDistance;
+
+        const auto nodeCount = static_cast<uint32_t>(m_Nodes.size() - 1);
+        uint32_t node = 0;
+        while (node < nodeCount) {
+            const Node& current = m_Nodes[node];
+            if (!test.test(current.min, current.max, maxDistance)) {
+                node = current.skip;
+            } else if (isLeaf(node)) {
+                for (uint32_t i = current.first; i < getNodeEnd(node); i++) {
+                    if (!test.test(m_LeafBounds[i].min, m_LeafBounds[i].max, maxDistance)) {
+                        continue;
+                    }
+                    std::optional<float> distance = intersect(m_LeafItems[i]);
+                    if (distance && *distance >= 0.0f && *distance <= maxDistance) {
+                        // farther boxes are skipped from here on
+                        maxDistance = *distance;
+                        closest = RayHit{m_LeafItems[i], *distance};
+                    }
+                }
+                node = current.skip;
+            } else {
+                node++;
+            }
+        }
+        return closest;
+    }
+
+    uint32_t Bvh::getObjectCount() const noexcept {
+        return m_ObjectCount;
+    }
+
+    uint32_t Bvh::getNodeCount() const noexcept {
+        return static_cast<uint32_t>(m_Nodes.size() - 1);
+    }
+
+    float Bvh::getCost() const {
+        if (m_Nodes.size() <= 1) {
+            return 0.0f;
+        }
+        float rootArea = Aabb{m_Nodes[0].min, m_Nodes[0].max}.getHalfArea();
+        if (rootArea <= 0.0f) {
+            return 0.0f;
+        }
+        float total = 0.0f;
+        for (size_t node = 0; node + 1 < m_Nodes.size(); node++) {
+            total += Aabb{m_Nodes[node].min, m_Nodes[node].max}.getHalfArea();
+        }
+        return total / rootArea;
+    }
+}
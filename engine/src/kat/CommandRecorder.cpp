@@ -0,0 +1,76 @@
+#include "kat/CommandRecorder.h"
+
+#include <algorithm>
+
+namespace kat {
+
+    ParallelCommandRecorder::ParallelCommandRecorder(std::shared_ptr<App> app, size_t framesInFlight)
+        : m_App(app), m_Jobs(app->getJobSystem()), m_ThreadSlots(m_Jobs.getWorkerCount() + 1) {
+        m_Frames.resize(framesInFlight);
+        for (auto& frame : m_Frames) {
+            frame.resize(m_ThreadSlots);
+            for (auto& threadPool : frame) {
+                threadPool.pool = m_App->getDevice().createCommandPool(vk::CommandPoolCreateInfo{
+                    vk::CommandPoolCreateFlagBits::eTransient, m_App->getGraphicsFamily()
+                });
+            }
+        }
+
+        m_Recorded.reserve(m_ThreadSlots);
+    }
+
+    void ParallelCommandRecorder::cleanup() {
+        for (auto& frame : m_Frames) {
+            for (auto& threadPool : frame) {
+                // destroying the pool frees its command buffers
+                m_App->getDevice().destroyCommandPool(threadPool.pool);
+            }
+        }
+        m_Frames.clear();
+    }
+
+    void ParallelCommandRecorder::beginFrame(size_t frameIndex) {
+        m_CurrentFrame = frameIndex;
+        for (auto& threadPool : m_Frames[frameIndex]) {
+            m_App->getDevice().resetCommandPool(threadPool.pool);
+            threadPool.used = 0;
+        }
+    }
+
+    std::span<const vk::CommandBuffer> ParallelCommandRecorder::record(const vk::CommandBufferInheritanceInfo &inheritance, size_t itemCount, RecordFunction fn) {
+        size_t chunks = std::clamp<size_t>((itemCount + kMinItemsPerChunk - 1) / kMinItemsPerChunk, 1, m_Jobs.getWorkerCount());
+        size_t grain = std::max<size_t>(1, (itemCount + chunks - 1) / chunks);
+        chunks = std::max<size_t>(1, (itemCount + grain - 1) / grain);
+
+        m_Recorded.resize(chunks);
+
+        m_Jobs.parallelFor(0, itemCount, grain, [&](size_t begin, size_t end) {
+            uint32_t worker = std::min(JobSystem::getCurrentWorkerIndex(), m_ThreadSlots - 1);
+            uint32_t chunk = static_cast<uint32_t>(begin / grain);
+
+            vk::CommandBuffer commandBuffer = acquireBuffer(worker);
+            commandBuffer.begin(vk::CommandBufferBeginInfo{
+                vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritance
+            });
+            fn(RecordContext{commandBuffer, worker, chunk, static_cast<uint32_t>(chunks), begin, end});
+            commandBuffer.end();
+
+            m_Recorded[chunk] = commandBuffer;
+        });
+
+        return m_Recorded;
+    }
+
+    vk::CommandBuffer ParallelCommandRecorder::acquireBuffer(uint32_t worker) {
+        ThreadCommandPool& threadPool = m_Frames[m_CurrentFrame][worker];
+
+        // only grows while the draw list's chunking settles, after that buffers are reused every frame
+        if (threadPool.used == threadPool.buffers.size()) {
+            threadPool.buffers.push_back(m_App->getDevice().allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+                threadPool.pool, vk::CommandBufferLevel::eSecondary, 1
+            })[0]);
+        }
+
+        return threadPool.buffers[threadPool.used++];
+    }
+}
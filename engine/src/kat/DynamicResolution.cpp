@@ -0,0 +1,142 @@
+#include "kat/DynamicResolution.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+
+namespace kat {
+
+    void ResolutionController::configure(const DynamicResolution &config, uint32_t latency) {
+        m_Config = config;
+        m_Config.max_scale = std::clamp(config.max_scale, kMinScale, kMaxScale);
+        m_Config.min_scale = std::clamp(config.min_scale, kMinScale, m_Config.max_scale);
+        m_Config.raise_threshold = std::clamp(config.raise_threshold, 0.0, 1.0);
+        m_Config.drop_frames = std::max(config.drop_frames, 1U);
+        m_Config.raise_frames = std::max(config.raise_frames, 1U);
+        if (m_Config.min_scale != config.min_scale || m_Config.max_scale != config.max_scale) {
+            spdlog::warn("Dynamic resolution scales must be between {} and {}, using {} to {}", kMinScale, kMaxScale, m_Config.min_scale, m_Config.max_scale);
+        }
+        m_Latency = latency;
+
+        m_Enabled.store(m_Config.enabled, std::memory_order_relaxed);
+        m_Scale.store(m_Config.enabled ? m_Config.max_scale : 1.0f, std::memory_order_relaxed);
+        m_IgnoredFrames = 0;
+        m_Held = false;
+        resetStreaks();
+    }
+
+    void ResolutionController::hold(float scale) {
+        if (!isEnabled()) {
+            return;
+        }
+        m_Held = true;
+        m_Scale.store(std::clamp(scale, m_Config.min_scale, m_Config.max_scale), std::memory_order_relaxed);
+    }
+
+    void ResolutionController::disable() {
+        m_Enabled.store(false, std::memory_order_relaxed);
+        m_Scale.store(1.0f, std::memory_order_relaxed);
+    }
+
+    bool ResolutionController::isEnabled() const noexcept {
+        return m_Enabled.load(std::memory_order_relaxed);
+    }
+
+    const DynamicResolution &ResolutionController::getConfig() const noexcept {
+        return m_Config;
+    }
+
+    bool ResolutionController::update(double gpuTime) {
+        m_GpuTime.store(gpuTime, std::memory_order_relaxed);
+        if (!isEnabled() || m_Held) {
+            return false;
+        }
+        // frames recorded before the last change say nothing about the new scale
+        if (m_IgnoredFrames > 0) {
+            m_IgnoredFrames--;
+            return false;
+        }
+
+        const double target = m_Config.target_gpu_time;
+        float scale = getScale();
+        bool drop;
+        if (gpuTime > target) {
+            if (m_DropStreak == 0) {
+                resetStreaks();
+            }
+            m_StreakTime += gpuTime;
+            if (++m_DropStreak < m_Config.drop_frames) {
+                return false;
+            }
+            drop = true;
+        } else if (gpuTime < target * m_Config.raise_threshold) {
+            if (m_RaiseStreak == 0) {
+                resetStreaks();
+            }
+            m_StreakTime += gpuTime;
+            if (++m_RaiseStreak < m_Config.raise_frames) {
+                return false;
+            }
+            drop = false;
+        } else {
+            resetStreaks();
+            return false;
+        }
+
+        // the pixel count, and with it most of the GPU time, goes with the square of the scale; aim for the middle
+        // of the band between the raise threshold and the target
+        double average = m_StreakTime / (m_DropStreak + m_RaiseStreak);
+        double goal = target * (1.0 + m_Config.raise_threshold) * 0.5;
+        float estimate = scale * static_cast<float>(std::sqrt(goal / std::max(average, 1e-6)));
+        estimate = std::round(estimate / kScaleQuantum) * kScaleQuantum;
+        float next;
+        if (drop) {
+            next = std::min(estimate, scale - kScaleQuantum);
+        } else {
+            next = std::clamp(estimate, scale + kScaleQuantum, scale + kMaxRaiseStep);
+        }
+        next = std::clamp(next, m_Config.min_scale, m_Config.max_scale);
+        resetStreaks();
+
+        if (next == scale) {
+            return false;
+        }
+        m_Scale.store(next, std::memory_order_relaxed);
+        m_Changes.store(m_Changes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_IgnoredFrames = m_Latency;
+        return true;
+    }
+
+    float ResolutionController::getScale() const noexcept {
+        return m_Scale.load(std::memory_order_relaxed);
+    }
+
+    vk::Extent2D ResolutionController::getScaledExtent(vk::Extent2D extent) const noexcept {
+        return scaleExtent(extent, getScale());
+    }
+
+    vk::Extent2D ResolutionController::getMaxExtent(vk::Extent2D extent) const noexcept {
+        return scaleExtent(extent, isEnabled() ? m_Config.max_scale : 1.0f);
+    }
+
+    double ResolutionController::getGpuTime() const noexcept {
+        return m_GpuTime.load(std::memory_order_relaxed);
+    }
+
+    uint64_t ResolutionController::getChangeCount() const noexcept {
+        return m_Changes.load(std::memory_order_relaxed);
+    }
+
+    vk::Extent2D ResolutionController::scaleExtent(vk::Extent2D extent, float scale) noexcept {
+        return vk::Extent2D{
+            std::max(static_cast<uint32_t>(std::lround(extent.width * scale)), 1U),
+            std::max(static_cast<uint32_t>(std::lround(extent.height * scale)), 1U)
+        };
+    }
+
+    void ResolutionController::resetStreaks() {
+        m_DropStreak = 0;
+        m_RaiseStreak = 0;
+        m_StreakTime = 0.0;
+    }
+}
@@ -1,8 +1,17 @@
 #include "kat/Engine.h"
+#include "kat/UploadService.h"
+#include "kat/PipelineCache.h"
+#include "kat/BindlessRegistry.h"
+#include "kat/SystemScheduler.h"
+#include "kat/TextureStreamer.h"
+#include "kat/RenderThread.h"
+#include "kat/FrameCapture.h"
 
 #include <iostream>
 #include <spdlog/spdlog.h>
 #include <algorithm>
+#include <array>
+#include <cmath>
 
 void error_callback(int error, const char* description) {
     spdlog::error("Error: {}", description);
@@ -28,13 +37,21 @@ namespace kat {
 
         m_RunningApp->setupApp();
 
+        m_Startup.finish();
+        m_JobSystem->wait(m_CapabilityLog);
+        m_Startup.report();
+
         while (m_RunningApp->isRunning()) {
-            glfwPollEvents();
+            if (!m_RunningApp->isHeadless()) {
+                glfwPollEvents();
+            }
             m_RunningApp->updateApp();
         }
 
         m_RunningApp->cleanupApp();
 
+        // the instance goes with the app, so a process can run more than one (the startup benchmark does)
+        cleanup();
     }
 
     const std::shared_ptr<App> &Engine::getRunningApp() const noexcept {
@@ -42,10 +59,20 @@ namespace kat {
     }
 
     void Engine::init() {
-        glfwSetErrorCallback(error_callback);
+        {
+            auto stage = m_Startup.stage("job system");
+            m_JobSystem = std::make_unique<JobSystem>();
+        }
 
-        if (!glfwInit()) {
-            spdlog::error("Failed to initialize GLFW");
+        bool headless = m_RunningApp && m_RunningApp->isHeadless();
+
+        if (!headless) {
+            auto stage = m_Startup.stage("glfw");
+            glfwSetErrorCallback(error_callback);
+
+            if (!glfwInit()) {
+                spdlog::error("Failed to initialize GLFW");
+            }
         }
 
         vk::InstanceCreateInfo icreateInfo{};
@@ -57,209 +84,242 @@ namespace kat {
         appInfo.pEngineName = "KatEngine";
 
         std::vector<const char*> extensions;
-        uint32_t req_count;
-        const char** req_exts = glfwGetRequiredInstanceExtensions(&req_count);
-        for (uint32_t i = 0 ; i < req_count ; i++) {
-            extensions.push_back(req_exts[i]);
+        if (!headless) {
+            uint32_t req_count;
+            const char** req_exts = glfwGetRequiredInstanceExtensions(&req_count);
+            for (uint32_t i = 0 ; i < req_count ; i++) {
+                extensions.push_back(req_exts[i]);
+            }
         }
 
         icreateInfo.setPEnabledExtensionNames(extensions).setPApplicationInfo(&appInfo);
 
-        m_Instance = vk::createInstance(icreateInfo);
+        {
+            auto stage = m_Startup.stage("instance");
+            m_Instance = vk::createInstance(icreateInfo);
+        }
         spdlog::info("Created Instance!");
 
-        m_Gpu = m_Instance.enumeratePhysicalDevices()[0];
-        m_GpuProperties = m_Gpu.getProperties();
-        m_GpuFeatures = m_Gpu.getFeatures();
-        spdlog::info("Found GPU: {}", m_GpuProperties.deviceName);
-        spdlog::info("GPU Type: {}", vk::to_string(m_GpuProperties.deviceType));
-        spdlog::info("GPU Vendor ID: {}", m_GpuProperties.vendorID);
-        spdlog::info("GPU Device ID: {}", m_GpuProperties.deviceID);
-        spdlog::info("GPU Supported API Version : {}", m_GpuProperties.apiVersion);
-        spdlog::info("GPU Driver Version: {}", m_GpuProperties.driverVersion);
-        spdlog::info("Max 1D image size: {}", m_GpuProperties.limits.maxImageDimension1D);
-        spdlog::info("Max 2D image size: {}", m_GpuProperties.limits.maxImageDimension2D);
-        spdlog::info("Max 3D image size: {}", m_GpuProperties.limits.maxImageDimension3D);
-        spdlog::info("Max Cube image size: {}", m_GpuProperties.limits.maxImageDimensionCube);
-        spdlog::info("Max image array layers: {}", m_GpuProperties.limits.maxImageArrayLayers);
-        spdlog::info("Max texel buffer elements: {}", m_GpuProperties.limits.maxTexelBufferElements);
-        spdlog::info("Max uniform buffer range: {}", m_GpuProperties.limits.maxUniformBufferRange);
-        spdlog::info("Max storage buffer range: {}", m_GpuProperties.limits.maxStorageBufferRange);
-        spdlog::info("Max push constants size: {}", m_GpuProperties.limits.maxPushConstantsSize);
-        spdlog::info("Max memory allocation count: {}", m_GpuProperties.limits.maxMemoryAllocationCount);
-        spdlog::info("Max sampler allocation count: {}", m_GpuProperties.limits.maxSamplerAllocationCount);
-        spdlog::info("Buffer image granularity: {}", m_GpuProperties.limits.bufferImageGranularity);
-        spdlog::info("Sparse address space size: {}", m_GpuProperties.limits.sparseAddressSpaceSize);
-        spdlog::info("Max bound descriptor sets: {}", m_GpuProperties.limits.maxBoundDescriptorSets);
-        spdlog::info("Max per stage descriptor samplers: {}", m_GpuProperties.limits.maxPerStageDescriptorSamplers);
-        spdlog::info("Max per stage descriptor uniform buffers: {}", m_GpuProperties.limits.maxPerStageDescriptorUniformBuffers);
-        spdlog::info("Max per stage descriptor storage buffers: {}", m_GpuProperties.limits.maxPerStageDescriptorStorageBuffers);
-        spdlog::info("Max per stage descriptor sampled images: {}", m_GpuProperties.limits.maxPerStageDescriptorSampledImages);
-        spdlog::info("Max per stage descriptor storage images: {}", m_GpuProperties.limits.maxPerStageDescriptorStorageImages);
-        spdlog::info("Max per stage descriptor input attachments: {}", m_GpuProperties.limits.maxPerStageDescriptorInputAttachments);
-        spdlog::info("Max per stage resources: {}", m_GpuProperties.limits.maxPerStageResources);
-        spdlog::info("Max descriptor set samplers: {}", m_GpuProperties.limits.maxDescriptorSetSamplers);
-        spdlog::info("Max descriptor set uniform buffers: {}", m_GpuProperties.limits.maxDescriptorSetUniformBuffers);
-        spdlog::info("Max descriptor set uniform buffers dynamic: {}", m_GpuProperties.limits.maxDescriptorSetUniformBuffersDynamic);
-        spdlog::info("Max descriptor set storage buffers: {}", m_GpuProperties.limits.maxDescriptorSetStorageBuffers);
-        spdlog::info("Max descriptor set storage buffers dynamic: {}", m_GpuProperties.limits.maxDescriptorSetStorageBuffersDynamic);
-        spdlog::info("Max descriptor set sampled images: {}", m_GpuProperties.limits.maxDescriptorSetSampledImages);
-        spdlog::info("Max descriptor set storage images: {}", m_GpuProperties.limits.maxDescriptorSetStorageImages);
-        spdlog::info("Max descriptor set input attachments: {}", m_GpuProperties.limits.maxDescriptorSetInputAttachments);
-        spdlog::info("Max vertex input attributes: {}", m_GpuProperties.limits.maxVertexInputAttributes);
-        spdlog::info("Max vertex input bindings: {}", m_GpuProperties.limits.maxVertexInputBindings);
-        spdlog::info("Max vertex input attribute offset: {}", m_GpuProperties.limits.maxVertexInputAttributeOffset);
-        spdlog::info("Max vertex input binding stride: {}", m_GpuProperties.limits.maxVertexInputBindingStride);
-        spdlog::info("Max vertex output components: {}", m_GpuProperties.limits.maxVertexOutputComponents);
-        spdlog::info("Max tessellation generation level: {}", m_GpuProperties.limits.maxTessellationGenerationLevel);
-        spdlog::info("Max tessellation patch size: {}", m_GpuProperties.limits.maxTessellationPatchSize);
-        spdlog::info("Max tessellation control per vertex input components: {}", m_GpuProperties.limits.maxTessellationControlPerVertexInputComponents);
-        spdlog::info("Max tessellation control per vertex output components: {}", m_GpuProperties.limits.maxTessellationControlPerVertexOutputComponents);
-        spdlog::info("Max tessellation control per patch output components: {}", m_GpuProperties.limits.maxTessellationControlPerPatchOutputComponents);
-        spdlog::info("Max tessellation control total output components: {}", m_GpuProperties.limits.maxTessellationControlTotalOutputComponents);
-        spdlog::info("Max tessellation evaluation input components: {}", m_GpuProperties.limits.maxTessellationEvaluationInputComponents);
-        spdlog::info("Max tessellation evaluation output components: {}", m_GpuProperties.limits.maxTessellationEvaluationOutputComponents);
-        spdlog::info("Max geometry shader invocations: {}", m_GpuProperties.limits.maxGeometryShaderInvocations);
-        spdlog::info("Max geometry input components: {}", m_GpuProperties.limits.maxGeometryInputComponents);
-        spdlog::info("Max geometry output components: {}", m_GpuProperties.limits.maxGeometryOutputComponents);
-        spdlog::info("Max geometry output vertices: {}", m_GpuProperties.limits.maxGeometryOutputVertices);
-        spdlog::info("Max geometry total output components: {}", m_GpuProperties.limits.maxGeometryTotalOutputComponents);
-        spdlog::info("Max fragment input components: {}", m_GpuProperties.limits.maxFragmentInputComponents);
-        spdlog::info("Max fragment output attachments: {}", m_GpuProperties.limits.maxFragmentOutputAttachments);
-        spdlog::info("Max fragment dual source attachments: {}", m_GpuProperties.limits.maxFragmentDualSrcAttachments);
-        spdlog::info("Max fragment combined output resources: {}", m_GpuProperties.limits.maxFragmentCombinedOutputResources);
-        spdlog::info("Max compute shared memory size: {}", m_GpuProperties.limits.maxComputeSharedMemorySize);
-        spdlog::info("Max compute work group count: {} x {} x {}", m_GpuProperties.limits.maxComputeWorkGroupCount[0],m_GpuProperties.limits.maxComputeWorkGroupCount[1],m_GpuProperties.limits.maxComputeWorkGroupCount[2]);
-        spdlog::info("Max compute work group invocations: {}", m_GpuProperties.limits.maxComputeWorkGroupInvocations);
-        spdlog::info("Max compute work group size: {} x {} x {}", m_GpuProperties.limits.maxComputeWorkGroupSize[0],m_GpuProperties.limits.maxComputeWorkGroupSize[1],m_GpuProperties.limits.maxComputeWorkGroupSize[2]);
-        spdlog::info("Sub-pixel precision bits : {}", m_GpuProperties.limits.subPixelPrecisionBits);
-        spdlog::info("Sub-texel precision bits : {}", m_GpuProperties.limits.subTexelPrecisionBits);
-        spdlog::info("Mipmap precision bits : {}", m_GpuProperties.limits.mipmapPrecisionBits);
-        spdlog::info("Max draw indexed index value: {}", m_GpuProperties.limits.maxDrawIndexedIndexValue);
-        spdlog::info("Max draw indirect count: {}", m_GpuProperties.limits.maxDrawIndirectCount);
-        spdlog::info("Max sampler LOD bias: {}", m_GpuProperties.limits.maxSamplerLodBias);
-        spdlog::info("Max sampler anisotropy: {}", m_GpuProperties.limits.maxSamplerAnisotropy);
-        spdlog::info("Max viewports: {}", m_GpuProperties.limits.maxViewports);
-        spdlog::info("Max viewport size: {} x {}", m_GpuProperties.limits.maxViewportDimensions[0], m_GpuProperties.limits.maxViewportDimensions[1]);
-        spdlog::info("Viewport bounds: {} -> {}", m_GpuProperties.limits.viewportBoundsRange[0], m_GpuProperties.limits.viewportBoundsRange[1]);
-        spdlog::info("Viewport sub-pixel bits : {}", m_GpuProperties.limits.viewportSubPixelBits);
-        spdlog::info("Min memory map alignment : {}", m_GpuProperties.limits.minMemoryMapAlignment);
-        spdlog::info("Min texel buffer offset alignment : {}", m_GpuProperties.limits.minTexelBufferOffsetAlignment);
-        spdlog::info("Min uniform buffer offset alignment : {}", m_GpuProperties.limits.minUniformBufferOffsetAlignment);
-        spdlog::info("Min storage buffer offset alignment : {}", m_GpuProperties.limits.minStorageBufferOffsetAlignment);
-        spdlog::info("Min texel offset: {}", m_GpuProperties.limits.minTexelOffset);
-        spdlog::info("Max texel offset: {}", m_GpuProperties.limits.maxTexelOffset);
-        spdlog::info("Min texel gather offset: {}", m_GpuProperties.limits.minTexelGatherOffset);
-        spdlog::info("Max texel gather offset: {}", m_GpuProperties.limits.maxTexelGatherOffset);
-        spdlog::info("Min interpolation offset: {}", m_GpuProperties.limits.minInterpolationOffset);
-        spdlog::info("Max interpolation offset: {}", m_GpuProperties.limits.maxInterpolationOffset);
-        spdlog::info("Sub-pixel interpolation offset bits: {}", m_GpuProperties.limits.subPixelInterpolationOffsetBits);
-        spdlog::info("Max framebuffer width: {}", m_GpuProperties.limits.maxFramebufferWidth);
-        spdlog::info("Max framebuffer height: {}", m_GpuProperties.limits.maxFramebufferHeight);
-        spdlog::info("Max framebuffer layers: {}", m_GpuProperties.limits.maxFramebufferLayers);
-        spdlog::info("Framebuffer color sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferColorSampleCounts));
-        spdlog::info("Framebuffer depth sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferDepthSampleCounts));
-        spdlog::info("Framebuffer stencil sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferStencilSampleCounts));
-        spdlog::info("Framebuffer no attachments sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferNoAttachmentsSampleCounts));
-        spdlog::info("Max color attachments: {}", m_GpuProperties.limits.maxColorAttachments);
-        spdlog::info("Sampled image color sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageColorSampleCounts));
-        spdlog::info("Sampled image integer sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageIntegerSampleCounts));
-        spdlog::info("Sampled image depth sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageDepthSampleCounts));
-        spdlog::info("Sampled image stencil sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageStencilSampleCounts));
-        spdlog::info("Storage image sample counts: {}", vk::to_string(m_GpuProperties.limits.storageImageSampleCounts));
-        spdlog::info("Max sample mask words: {}", m_GpuProperties.limits.maxSampleMaskWords);
-        spdlog::info("Timestamp compute and graphics: {}", m_GpuProperties.limits.timestampComputeAndGraphics ? "True" : "False");
-        spdlog::info("Timestamp period: {}", m_GpuProperties.limits.timestampPeriod);
-        spdlog::info("Max clip distances: {}", m_GpuProperties.limits.maxClipDistances);
-        spdlog::info("Max cull distances: {}", m_GpuProperties.limits.maxCullDistances);
-        spdlog::info("Max combined clip and cull distances: {}", m_GpuProperties.limits.maxCombinedClipAndCullDistances);
-        spdlog::info("Max point size: {} -> {}", m_GpuProperties.limits.pointSizeRange[0], m_GpuProperties.limits.pointSizeRange[1]);
-        spdlog::info("Max line width: {} -> {}", m_GpuProperties.limits.lineWidthRange[0], m_GpuProperties.limits.lineWidthRange[1]);
-        spdlog::info("Point size granularity: {}", m_GpuProperties.limits.pointSizeGranularity);
-        spdlog::info("Line width granularity: {}", m_GpuProperties.limits.lineWidthGranularity);
-        spdlog::info("Strict lines: {}", m_GpuProperties.limits.strictLines ? "True" : "False");
-        spdlog::info("Standard sample locations: {}", m_GpuProperties.limits.standardSampleLocations ? "True" : "False");
-        spdlog::info("Discrete queue priorities: {}", m_GpuProperties.limits.discreteQueuePriorities);
-        spdlog::info("Optimal buffer copy offset alignment: {}", m_GpuProperties.limits.optimalBufferCopyOffsetAlignment);
-        spdlog::info("Optimal buffer copy row pitch alignment: {}", m_GpuProperties.limits.optimalBufferCopyRowPitchAlignment);
-        spdlog::info("Non-coherent atom size: {}", m_GpuProperties.limits.nonCoherentAtomSize);
-        spdlog::info("GPU Features:");
-        spdlog::info("- Robust buffer access: {}", m_GpuFeatures.robustBufferAccess ? "True" : "False");
-        spdlog::info("- Full draw index uint32: {}", m_GpuFeatures.fullDrawIndexUint32 ? "True" : "False");
-        spdlog::info("- Image cube array: {}", m_GpuFeatures.imageCubeArray ? "True" : "False");
-        spdlog::info("- Independent blend: {}", m_GpuFeatures.independentBlend ? "True" : "False");
-        spdlog::info("- Geometry shader: {}", m_GpuFeatures.geometryShader ? "True" : "False");
-        spdlog::info("- Tessellation shader: {}", m_GpuFeatures.tessellationShader ? "True" : "False");
-        spdlog::info("- Sample rate shading: {}", m_GpuFeatures.sampleRateShading ? "True" : "False");
-        spdlog::info("- Dual source blend: {}", m_GpuFeatures.dualSrcBlend ? "True" : "False");
-        spdlog::info("- Logic Ops: {}", m_GpuFeatures.logicOp ? "True" : "False");
-        spdlog::info("- Multi draw indirect: {}", m_GpuFeatures.multiDrawIndirect ? "True" : "False");
-        spdlog::info("- Draw indirect first instance: {}", m_GpuFeatures.drawIndirectFirstInstance ? "True" : "False");
-        spdlog::info("- Depth clamp: {}", m_GpuFeatures.depthClamp ? "True" : "False");
-        spdlog::info("- Depth bias clamp: {}", m_GpuFeatures.depthBiasClamp ? "True" : "False");
-        spdlog::info("- Fill mode non solid: {}", m_GpuFeatures.fillModeNonSolid ? "True" : "False");
-        spdlog::info("- Depth bounds: {}", m_GpuFeatures.depthBounds ? "True" : "False");
-        spdlog::info("- Wide lines: {}", m_GpuFeatures.wideLines ? "True" : "False");
-        spdlog::info("- Large points: {}", m_GpuFeatures.largePoints ? "True" : "False");
-        spdlog::info("- Alpha to one: {}", m_GpuFeatures.alphaToOne ? "True" : "False");
-        spdlog::info("- Multi viewport: {}", m_GpuFeatures.multiViewport ? "True" : "False");
-        spdlog::info("- Sampler anisotropy: {}", m_GpuFeatures.samplerAnisotropy ? "True" : "False");
-        spdlog::info("- Texture compression ETC2: {}", m_GpuFeatures.textureCompressionETC2 ? "True" : "False");
-        spdlog::info("- Texture compression ASTC_LDR: {}", m_GpuFeatures.textureCompressionASTC_LDR ? "True" : "False");
-        spdlog::info("- Texture Compression BC: {}", m_GpuFeatures.textureCompressionBC ? "True" : "False");
-        spdlog::info("- Occlusion query precise: {}", m_GpuFeatures.occlusionQueryPrecise ? "True" : "False");
-        spdlog::info("- Pipeline statistics query: {}", m_GpuFeatures.pipelineStatisticsQuery ? "True" : "False");
-        spdlog::info("- Vertex pipeline stores and atomics: {}", m_GpuFeatures.vertexPipelineStoresAndAtomics ? "True" : "False");
-        spdlog::info("- Fragment stores and atomics: {}", m_GpuFeatures.fragmentStoresAndAtomics ? "True" : "False");
-        spdlog::info("- Shader tessellation and geometry point size: {}", m_GpuFeatures.shaderTessellationAndGeometryPointSize ? "True" : "False");
-        spdlog::info("- Shader image gather extended: {}", m_GpuFeatures.shaderImageGatherExtended ? "True" : "False");
-        spdlog::info("- Shader storage image extended formats: {}", m_GpuFeatures.shaderStorageImageExtendedFormats ? "True" : "False");
-        spdlog::info("- Shader storage image multisample: {}", m_GpuFeatures.shaderStorageImageMultisample ? "True" : "False");
-        spdlog::info("- Shader storage image read without format: {}", m_GpuFeatures.shaderStorageImageReadWithoutFormat ? "True" : "False");
-        spdlog::info("- Shader storage image write without format: {}", m_GpuFeatures.shaderStorageImageWriteWithoutFormat ? "True" : "False");
-        spdlog::info("- Shader uniform buffer array dynamic indexing: {}", m_GpuFeatures.shaderUniformBufferArrayDynamicIndexing ? "True" : "False");
-        spdlog::info("- Shader sampled image array dynamic indexing: {}", m_GpuFeatures.shaderSampledImageArrayDynamicIndexing ? "True" : "False");
-        spdlog::info("- Shader storage buffer array dynamic indexing: {}", m_GpuFeatures.shaderStorageBufferArrayDynamicIndexing ? "True" : "False");
-        spdlog::info("- Shader storage image array dynamic indexing: {}", m_GpuFeatures.shaderStorageImageArrayDynamicIndexing ? "True" : "False");
-        spdlog::info("- Shader clip distance: {}", m_GpuFeatures.shaderClipDistance ? "True" : "False");
-        spdlog::info("- Shader cull distance: {}", m_GpuFeatures.shaderCullDistance ? "True" : "False");
-        spdlog::info("- Shader doubles: {}", m_GpuFeatures.shaderFloat64 ? "True" : "False");
-        spdlog::info("- Shader longs: {}", m_GpuFeatures.shaderInt64 ? "True" : "False");
-        spdlog::info("- Shader shorts: {}", m_GpuFeatures.shaderInt16 ? "True" : "False");
-        spdlog::info("- Shader resource residency: {}", m_GpuFeatures.shaderResourceResidency ? "True" : "False");
-        spdlog::info("- Shader resource min LODs: {}", m_GpuFeatures.shaderResourceMinLod ? "True" : "False");
-        spdlog::info("- Sparse binding: {}", m_GpuFeatures.sparseBinding ? "True" : "False");
-        spdlog::info("- Sparse residency buffer: {}", m_GpuFeatures.sparseResidencyBuffer ? "True" : "False");
-        spdlog::info("- Sparse residency image 2D: {}", m_GpuFeatures.sparseResidencyImage2D ? "True" : "False");
-        spdlog::info("- Sparse residency image 3D: {}", m_GpuFeatures.sparseResidencyImage3D ? "True" : "False");
-        spdlog::info("- Sparse residency 2x samples: {}", m_GpuFeatures.sparseResidency2Samples ? "True" : "False");
-        spdlog::info("- Sparse residency 4x samples: {}", m_GpuFeatures.sparseResidency4Samples ? "True" : "False");
-        spdlog::info("- Sparse residency 8x samples: {}", m_GpuFeatures.sparseResidency8Samples ? "True" : "False");
-        spdlog::info("- Sparse residency 16x samples: {}", m_GpuFeatures.sparseResidency16Samples ? "True" : "False");
-        spdlog::info("- Sparse residency aliased: {}", m_GpuFeatures.sparseResidencyAliased ? "True" : "False");
-        spdlog::info("- Variable multisample rate: {}", m_GpuFeatures.variableMultisampleRate ? "True" : "False");
-        spdlog::info("- Inherited queries: {}", m_GpuFeatures.inheritedQueries ? "True" : "False");
-
-        m_SupportedDeviceExtensions = m_Gpu.enumerateDeviceExtensionProperties();
-        m_SupportedDeviceLayers = m_Gpu.enumerateDeviceLayerProperties();
-
-        spdlog::info("Supported Device Extensions:");
+        {
+            auto stage = m_Startup.stage("gpu query");
+            m_Gpu = m_Instance.enumeratePhysicalDevices()[0];
+            m_GpuProperties = m_Gpu.getProperties();
+            m_GpuFeatures = m_Gpu.getFeatures();
+
+            auto features2 = m_Gpu.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+            m_GpuFeatures12 = features2.get<vk::PhysicalDeviceVulkan12Features>();
+            m_GpuFeatures12.pNext = nullptr;
+
+            m_SupportedDeviceExtensions = m_Gpu.enumerateDeviceExtensionProperties();
+            m_SupportedDeviceLayers = m_Gpu.enumerateDeviceLayerProperties();
+            for (const auto& ext : m_SupportedDeviceExtensions) {
+                m_SupportedDeviceExtensionNames.insert(ext.extensionName);
+            }
+            for (const auto& lyr : m_SupportedDeviceLayers) {
+                m_SupportedDeviceLayerNames.insert(lyr.layerName);
+            }
+        }
+        spdlog::info("Found GPU: {} ({})", m_GpuProperties.deviceName, vk::to_string(m_GpuProperties.deviceType));
+
+        // a couple hundred lines nobody reads unless they asked for them, and then they're formatted off the
+        // startup path
+        if (spdlog::should_log(spdlog::level::debug)) {
+            m_JobSystem->schedule([this]() {
+                auto stage = m_Startup.stage("capability log");
+                logCapabilities();
+            }, &m_CapabilityLog);
+        }
+    }
+
+    void Engine::logCapabilities() const {
+        spdlog::debug("GPU Vendor ID: {}", m_GpuProperties.vendorID);
+        spdlog::debug("GPU Device ID: {}", m_GpuProperties.deviceID);
+        spdlog::debug("GPU Supported API Version : {}", m_GpuProperties.apiVersion);
+        spdlog::debug("GPU Driver Version: {}", m_GpuProperties.driverVersion);
+        spdlog::debug("Max 1D image size: {}", m_GpuProperties.limits.maxImageDimension1D);
+        spdlog::debug("Max 2D image size: {}", m_GpuProperties.limits.maxImageDimension2D);
+        spdlog::debug("Max 3D image size: {}", m_GpuProperties.limits.maxImageDimension3D);
+        spdlog::debug("Max Cube image size: {}", m_GpuProperties.limits.maxImageDimensionCube);
+        spdlog::debug("Max image array layers: {}", m_GpuProperties.limits.maxImageArrayLayers);
+        spdlog::debug("Max texel buffer elements: {}", m_GpuProperties.limits.maxTexelBufferElements);
+        spdlog::debug("Max uniform buffer range: {}", m_GpuProperties.limits.maxUniformBufferRange);
+        spdlog::debug("Max storage buffer range: {}", m_GpuProperties.limits.maxStorageBufferRange);
+        spdlog::debug("Max push constants size: {}", m_GpuProperties.limits.maxPushConstantsSize);
+        spdlog::debug("Max memory allocation count: {}", m_GpuProperties.limits.maxMemoryAllocationCount);
+        spdlog::debug("Max sampler allocation count: {}", m_GpuProperties.limits.maxSamplerAllocationCount);
+        spdlog::debug("Buffer image granularity: {}", m_GpuProperties.limits.bufferImageGranularity);
+        spdlog::debug("Sparse address space size: {}", m_GpuProperties.limits.sparseAddressSpaceSize);
+        spdlog::debug("Max bound descriptor sets: {}", m_GpuProperties.limits.maxBoundDescriptorSets);
+        spdlog::debug("Max per stage descriptor samplers: {}", m_GpuProperties.limits.maxPerStageDescriptorSamplers);
+        spdlog::debug("Max per stage descriptor uniform buffers: {}", m_GpuProperties.limits.maxPerStageDescriptorUniformBuffers);
+        spdlog::debug("Max per stage descriptor storage buffers: {}", m_GpuProperties.limits.maxPerStageDescriptorStorageBuffers);
+        spdlog::debug("Max per stage descriptor sampled images: {}", m_GpuProperties.limits.maxPerStageDescriptorSampledImages);
+        spdlog::debug("Max per stage descriptor storage images: {}", m_GpuProperties.limits.maxPerStageDescriptorStorageImages);
+        spdlog::debug("Max per stage descriptor input attachments: {}", m_GpuProperties.limits.maxPerStageDescriptorInputAttachments);
+        spdlog::debug("Max per stage resources: {}", m_GpuProperties.limits.maxPerStageResources);
+        spdlog::debug("Max descriptor set samplers: {}", m_GpuProperties.limits.maxDescriptorSetSamplers);
+        spdlog::debug("Max descriptor set uniform buffers: {}", m_GpuProperties.limits.maxDescriptorSetUniformBuffers);
+        spdlog::debug("Max descriptor set uniform buffers dynamic: {}", m_GpuProperties.limits.maxDescriptorSetUniformBuffersDynamic);
+        spdlog::debug("Max descriptor set storage buffers: {}", m_GpuProperties.limits.maxDescriptorSetStorageBuffers);
+        spdlog::debug("Max descriptor set storage buffers dynamic: {}", m_GpuProperties.limits.maxDescriptorSetStorageBuffersDynamic);
+        spdlog::debug("Max descriptor set sampled images: {}", m_GpuProperties.limits.maxDescriptorSetSampledImages);
+        spdlog::debug("Max descriptor set storage images: {}", m_GpuProperties.limits.maxDescriptorSetStorageImages);
+        spdlog::debug("Max descriptor set input attachments: {}", m_GpuProperties.limits.maxDescriptorSetInputAttachments);
+        spdlog::debug("Max vertex input attributes: {}", m_GpuProperties.limits.maxVertexInputAttributes);
+        spdlog::debug("Max vertex input bindings: {}", m_GpuProperties.limits.maxVertexInputBindings);
+        spdlog::debug("Max vertex input attribute offset: {}", m_GpuProperties.limits.maxVertexInputAttributeOffset);
+        spdlog::debug("Max vertex input binding stride: {}", m_GpuProperties.limits.maxVertexInputBindingStride);
+        spdlog::debug("Max vertex output components: {}", m_GpuProperties.limits.maxVertexOutputComponents);
+        spdlog::debug("Max tessellation generation level: {}", m_GpuProperties.limits.maxTessellationGenerationLevel);
+        spdlog::debug("Max tessellation patch size: {}", m_GpuProperties.limits.maxTessellationPatchSize);
+        spdlog::debug("Max tessellation control per vertex input components: {}", m_GpuProperties.limits.maxTessellationControlPerVertexInputComponents);
+        spdlog::debug("Max tessellation control per vertex output components: {}", m_GpuProperties.limits.maxTessellationControlPerVertexOutputComponents);
+        spdlog::debug("Max tessellation control per patch output components: {}", m_GpuProperties.limits.maxTessellationControlPerPatchOutputComponents);
+        spdlog::debug("Max tessellation control total output components: {}", m_GpuProperties.limits.maxTessellationControlTotalOutputComponents);
+        spdlog::debug("Max tessellation evaluation input components: {}", m_GpuProperties.limits.maxTessellationEvaluationInputComponents);
+        spdlog::debug("Max tessellation evaluation output components: {}", m_GpuProperties.limits.maxTessellationEvaluationOutputComponents);
+        spdlog::debug("Max geometry shader invocations: {}", m_GpuProperties.limits.maxGeometryShaderInvocations);
+        spdlog::debug("Max geometry input components: {}", m_GpuProperties.limits.maxGeometryInputComponents);
+        spdlog::debug("Max geometry output components: {}", m_GpuProperties.limits.maxGeometryOutputComponents);
+        spdlog::debug("Max geometry output vertices: {}", m_GpuProperties.limits.maxGeometryOutputVertices);
+        spdlog::debug("Max geometry total output components: {}", m_GpuProperties.limits.maxGeometryTotalOutputComponents);
+        spdlog::debug("Max fragment input components: {}", m_GpuProperties.limits.maxFragmentInputComponents);
+        spdlog::debug("Max fragment output attachments: {}", m_GpuProperties.limits.maxFragmentOutputAttachments);
+        spdlog::debug("Max fragment dual source attachments: {}", m_GpuProperties.limits.maxFragmentDualSrcAttachments);
+        spdlog::debug("Max fragment combined output resources: {}", m_GpuProperties.limits.maxFragmentCombinedOutputResources);
+        spdlog::debug("Max compute shared memory size: {}", m_GpuProperties.limits.maxComputeSharedMemorySize);
+        spdlog::debug("Max compute work group count: {} x {} x {}", m_GpuProperties.limits.maxComputeWorkGroupCount[0],m_GpuProperties.limits.maxComputeWorkGroupCount[1],m_GpuProperties.limits.maxComputeWorkGroupCount[2]);
+        spdlog::debug("Max compute work group invocations: {}", m_GpuProperties.limits.maxComputeWorkGroupInvocations);
+        spdlog::debug("Max compute work group size: {} x {} x {}", m_GpuProperties.limits.maxComputeWorkGroupSize[0],m_GpuProperties.limits.maxComputeWorkGroupSize[1],m_GpuProperties.limits.maxComputeWorkGroupSize[2]);
+        spdlog::debug("Sub-pixel precision bits : {}", m_GpuProperties.limits.subPixelPrecisionBits);
+        spdlog::debug("Sub-texel precision bits : {}", m_GpuProperties.limits.subTexelPrecisionBits);
+        spdlog::debug("Mipmap precision bits : {}", m_GpuProperties.limits.mipmapPrecisionBits);
+        spdlog::debug("Max draw indexed index value: {}", m_GpuProperties.limits.maxDrawIndexedIndexValue);
+        spdlog::debug("Max draw indirect count: {}", m_GpuProperties.limits.maxDrawIndirectCount);
+        spdlog::debug("Max sampler LOD bias: {}", m_GpuProperties.limits.maxSamplerLodBias);
+        spdlog::debug("Max sampler anisotropy: {}", m_GpuProperties.limits.maxSamplerAnisotropy);
+        spdlog::debug("Max viewports: {}", m_GpuProperties.limits.maxViewports);
+        spdlog::debug("Max viewport size: {} x {}", m_GpuProperties.limits.maxViewportDimensions[0], m_GpuProperties.limits.maxViewportDimensions[1]);
+        spdlog::debug("Viewport bounds: {} -> {}", m_GpuProperties.limits.viewportBoundsRange[0], m_GpuProperties.limits.viewportBoundsRange[1]);
+        spdlog::debug("Viewport sub-pixel bits : {}", m_GpuProperties.limits.viewportSubPixelBits);
+        spdlog::debug("Min memory map alignment : {}", m_GpuProperties.limits.minMemoryMapAlignment);
+        spdlog::debug("Min texel buffer offset alignment : {}", m_GpuProperties.limits.minTexelBufferOffsetAlignment);
+        spdlog::debug("Min uniform buffer offset alignment : {}", m_GpuProperties.limits.minUniformBufferOffsetAlignment);
+        spdlog::debug("Min storage buffer offset alignment : {}", m_GpuProperties.limits.minStorageBufferOffsetAlignment);
+        spdlog::debug("Min texel offset: {}", m_GpuProperties.limits.minTexelOffset);
+        spdlog::debug("Max texel offset: {}", m_GpuProperties.limits.maxTexelOffset);
+        spdlog::debug("Min texel gather offset: {}", m_GpuProperties.limits.minTexelGatherOffset);
+        spdlog::debug("Max texel gather offset: {}", m_GpuProperties.limits.maxTexelGatherOffset);
+        spdlog::debug("Min interpolation offset: {}", m_GpuProperties.limits.minInterpolationOffset);
+        spdlog::debug("Max interpolation offset: {}", m_GpuProperties.limits.maxInterpolationOffset);
+        spdlog::debug("Sub-pixel interpolation offset bits: {}", m_GpuProperties.limits.subPixelInterpolationOffsetBits);
+        spdlog::debug("Max framebuffer width: {}", m_GpuProperties.limits.maxFramebufferWidth);
+        spdlog::debug("Max framebuffer height: {}", m_GpuProperties.limits.maxFramebufferHeight);
+        spdlog::debug("Max framebuffer layers: {}", m_GpuProperties.limits.maxFramebufferLayers);
+        spdlog::debug("Framebuffer color sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferColorSampleCounts));
+        spdlog::debug("Framebuffer depth sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferDepthSampleCounts));
+        spdlog::debug("Framebuffer stencil sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferStencilSampleCounts));
+        spdlog::debug("Framebuffer no attachments sample counts: {}", vk::to_string(m_GpuProperties.limits.framebufferNoAttachmentsSampleCounts));
+        spdlog::debug("Max color attachments: {}", m_GpuProperties.limits.maxColorAttachments);
+        spdlog::debug("Sampled image color sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageColorSampleCounts));
+        spdlog::debug("Sampled image integer sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageIntegerSampleCounts));
+        spdlog::debug("Sampled image depth sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageDepthSampleCounts));
+        spdlog::debug("Sampled image stencil sample counts: {}", vk::to_string(m_GpuProperties.limits.sampledImageStencilSampleCounts));
+        spdlog::debug("Storage image sample counts: {}", vk::to_string(m_GpuProperties.limits.storageImageSampleCounts));
+        spdlog::debug("Max sample mask words: {}", m_GpuProperties.limits.maxSampleMaskWords);
+        spdlog::debug("Timestamp compute and graphics: {}", m_GpuProperties.limits.timestampComputeAndGraphics ? "True" : "False");
+        spdlog::debug("Timestamp period: {}", m_GpuProperties.limits.timestampPeriod);
+        spdlog::debug("Max clip distances: {}", m_GpuProperties.limits.maxClipDistances);
+        spdlog::debug("Max cull distances: {}", m_GpuProperties.limits.maxCullDistances);
+        spdlog::debug("Max combined clip and cull distances: {}", m_GpuProperties.limits.maxCombinedClipAndCullDistances);
+        spdlog::debug("Max point size: {} -> {}", m_GpuProperties.limits.pointSizeRange[0], m_GpuProperties.limits.pointSizeRange[1]);
+        spdlog::debug("Max line width: {} -> {}", m_GpuProperties.limits.lineWidthRange[0], m_GpuProperties.limits.lineWidthRange[1]);
+        spdlog::debug("Point size granularity: {}", m_GpuProperties.limits.pointSizeGranularity);
+        spdlog::debug("Line width granularity: {}", m_GpuProperties.limits.lineWidthGranularity);
+        spdlog::debug("Strict lines: {}", m_GpuProperties.limits.strictLines ? "True" : "False");
+        spdlog::debug("Standard sample locations: {}", m_GpuProperties.limits.standardSampleLocations ? "True" : "False");
+        spdlog::debug("Discrete queue priorities: {}", m_GpuProperties.limits.discreteQueuePriorities);
+        spdlog::debug("Optimal buffer copy offset alignment: {}", m_GpuProperties.limits.optimalBufferCopyOffsetAlignment);
+        spdlog::debug("Optimal buffer copy row pitch alignment: {}", m_GpuProperties.limits.optimalBufferCopyRowPitchAlignment);
+        spdlog::debug("Non-coherent atom size: {}", m_GpuProperties.limits.nonCoherentAtomSize);
+
+        spdlog::debug("GPU Features:");
+        spdlog::debug("- Robust buffer access: {}", m_GpuFeatures.robustBufferAccess ? "True" : "False");
+        spdlog::debug("- Full draw index uint32: {}", m_GpuFeatures.fullDrawIndexUint32 ? "True" : "False");
+        spdlog::debug("- Image cube array: {}", m_GpuFeatures.imageCubeArray ? "True" : "False");
+        spdlog::debug("- Independent blend: {}", m_GpuFeatures.independentBlend ? "True" : "False");
+        spdlog::debug("- Geometry shader: {}", m_GpuFeatures.geometryShader ? "True" : "False");
+        spdlog::debug("- Tessellation shader: {}", m_GpuFeatures.tessellationShader ? "True" : "False");
+        spdlog::debug("- Sample rate shading: {}", m_GpuFeatures.sampleRateShading ? "True" : "False");
+        spdlog::debug("- Dual source blend: {}", m_GpuFeatures.dualSrcBlend ? "True" : "False");
+        spdlog::debug("- Logic Ops: {}", m_GpuFeatures.logicOp ? "True" : "False");
+        spdlog::debug("- Multi draw indirect: {}", m_GpuFeatures.multiDrawIndirect ? "True" : "False");
+        spdlog::debug("- Draw indirect first instance: {}", m_GpuFeatures.drawIndirectFirstInstance ? "True" : "False");
+        spdlog::debug("- Depth clamp: {}", m_GpuFeatures.depthClamp ? "True" : "False");
+        spdlog::debug("- Depth bias clamp: {}", m_GpuFeatures.depthBiasClamp ? "True" : "False");
+        spdlog::debug("- Fill mode non solid: {}", m_GpuFeatures.fillModeNonSolid ? "True" : "False");
+        spdlog::debug("- Depth bounds: {}", m_GpuFeatures.depthBounds ? "True" : "False");
+        spdlog::debug("- Wide lines: {}", m_GpuFeatures.wideLines ? "True" : "False");
+        spdlog::debug("- Large points: {}", m_GpuFeatures.largePoints ? "True" : "False");
+        spdlog::debug("- Alpha to one: {}", m_GpuFeatures.alphaToOne ? "True" : "False");
+        spdlog::debug("- Multi viewport: {}", m_GpuFeatures.multiViewport ? "True" : "False");
+        spdlog::debug("- Sampler anisotropy: {}", m_GpuFeatures.samplerAnisotropy ? "True" : "False");
+        spdlog::debug("- Texture compression ETC2: {}", m_GpuFeatures.textureCompressionETC2 ? "True" : "False");
+        spdlog::debug("- Texture compression ASTC_LDR: {}", m_GpuFeatures.textureCompressionASTC_LDR ? "True" : "False");
+        spdlog::debug("- Texture Compression BC: {}", m_GpuFeatures.textureCompressionBC ? "True" : "False");
+        spdlog::debug("- Occlusion query precise: {}", m_GpuFeatures.occlusionQueryPrecise ? "True" : "False");
+        spdlog::debug("- Pipeline statistics query: {}", m_GpuFeatures.pipelineStatisticsQuery ? "True" : "False");
+        spdlog::debug("- Vertex pipeline stores and atomics: {}", m_GpuFeatures.vertexPipelineStoresAndAtomics ? "True" : "False");
+        spdlog::debug("- Fragment stores and atomics: {}", m_GpuFeatures.fragmentStoresAndAtomics ? "True" : "False");
+        spdlog::debug("- Shader tessellation and geometry point size: {}", m_GpuFeatures.shaderTessellationAndGeometryPointSize ? "True" : "False");
+        spdlog::debug("- Shader image gather extended: {}", m_GpuFeatures.shaderImageGatherExtended ? "True" : "False");
+        spdlog::debug("- Shader storage image extended formats: {}", m_GpuFeatures.shaderStorageImageExtendedFormats ? "True" : "False");
+        spdlog::debug("- Shader storage image multisample: {}", m_GpuFeatures.shaderStorageImageMultisample ? "True" : "False");
+        spdlog::debug("- Shader storage image read without format: {}", m_GpuFeatures.shaderStorageImageReadWithoutFormat ? "True" : "False");
+        spdlog::debug("- Shader storage image write without format: {}", m_GpuFeatures.shaderStorageImageWriteWithoutFormat ? "True" : "False");
+        spdlog::debug("- Shader uniform buffer array dynamic indexing: {}", m_GpuFeatures.shaderUniformBufferArrayDynamicIndexing ? "True" : "False");
+        spdlog::debug("- Shader sampled image array dynamic indexing: {}", m_GpuFeatures.shaderSampledImageArrayDynamicIndexing ? "True" : "False");
+        spdlog::debug("- Shader storage buffer array dynamic indexing: {}", m_GpuFeatures.shaderStorageBufferArrayDynamicIndexing ? "True" : "False");
+        spdlog::debug("- Shader storage image array dynamic indexing: {}", m_GpuFeatures.shaderStorageImageArrayDynamicIndexing ? "True" : "False");
+        spdlog::debug("- Shader clip distance: {}", m_GpuFeatures.shaderClipDistance ? "True" : "False");
+        spdlog::debug("- Shader cull distance: {}", m_GpuFeatures.shaderCullDistance ? "True" : "False");
+        spdlog::debug("- Shader doubles: {}", m_GpuFeatures.shaderFloat64 ? "True" : "False");
+        spdlog::debug("- Shader longs: {}", m_GpuFeatures.shaderInt64 ? "True" : "False");
+        spdlog::debug("- Shader shorts: {}", m_GpuFeatures.shaderInt16 ? "True" : "False");
+        spdlog::debug("- Shader resource residency: {}", m_GpuFeatures.shaderResourceResidency ? "True" : "False");
+        spdlog::debug("- Shader resource min LODs: {}", m_GpuFeatures.shaderResourceMinLod ? "True" : "False");
+        spdlog::debug("- Sparse binding: {}", m_GpuFeatures.sparseBinding ? "True" : "False");
+        spdlog::debug("- Sparse residency buffer: {}", m_GpuFeatures.sparseResidencyBuffer ? "True" : "False");
+        spdlog::debug("- Sparse residency image 2D: {}", m_GpuFeatures.sparseResidencyImage2D ? "True" : "False");
+        spdlog::debug("- Sparse residency image 3D: {}", m_GpuFeatures.sparseResidencyImage3D ? "True" : "False");
+        spdlog::debug("- Sparse residency 2x samples: {}", m_GpuFeatures.sparseResidency2Samples ? "True" : "False");
+        spdlog::debug("- Sparse residency 4x samples: {}", m_GpuFeatures.sparseResidency4Samples ? "True" : "False");
+        spdlog::debug("- Sparse residency 8x samples: {}", m_GpuFeatures.sparseResidency8Samples ? "True" : "False");
+        spdlog::debug("- Sparse residency 16x samples: {}", m_GpuFeatures.sparseResidency16Samples ? "True" : "False");
+        spdlog::debug("- Sparse residency aliased: {}", m_GpuFeatures.sparseResidencyAliased ? "True" : "False");
+        spdlog::debug("- Variable multisample rate: {}", m_GpuFeatures.variableMultisampleRate ? "True" : "False");
+        spdlog::debug("- Inherited queries: {}", m_GpuFeatures.inheritedQueries ? "True" : "False");
+        spdlog::debug("- Timeline semaphores: {}", m_GpuFeatures12.timelineSemaphore ? "True" : "False");
+        spdlog::debug("- Descriptor indexing: {}", m_GpuFeatures12.descriptorIndexing ? "True" : "False");
+        spdlog::debug("- Draw indirect count: {}", m_GpuFeatures12.drawIndirectCount ? "True" : "False");
+
+        spdlog::debug("Supported Device Extensions:");
         for (const auto& ext : m_SupportedDeviceExtensions) {
-            spdlog::info("- {}", ext.extensionName);
-            m_SupportedDeviceExtensionNames.insert(ext.extensionName);
+            spdlog::debug("- {}", ext.extensionName);
         }
 
-        spdlog::info("Supported Device Layers:");
+        spdlog::debug("Supported Device Layers:");
         for (const auto& lyr : m_SupportedDeviceLayers) {
-            spdlog::info("- {}", lyr.layerName);
-            m_SupportedDeviceLayerNames.insert(lyr.layerName);
+            spdlog::debug("- {}", lyr.layerName);
         }
     }
 
     void Engine::cleanup() {
         m_Instance.destroy();
 
-        glfwTerminate();
+        if (!(m_RunningApp && m_RunningApp->isHeadless())) {
+            glfwTerminate();
+        }
     }
 
     bool Engine::supportsExtension(const std::string &name) const {
@@ -274,14 +334,30 @@ namespace kat {
         return m_Instance;
     }
 
+    JobSystem &Engine::getJobSystem() {
+        return *m_JobSystem;
+    }
+
+    StartupTimeline &Engine::getStartupTimeline() {
+        return m_Startup;
+    }
+
     const vk::PhysicalDevice &Engine::getGpu() const {
         return m_Gpu;
     }
 
+    const vk::PhysicalDeviceProperties &Engine::getGpuProperties() const {
+        return m_GpuProperties;
+    }
+
     const vk::PhysicalDeviceFeatures &Engine::getGpuFeatures() const {
         return m_GpuFeatures;
     }
 
+    const vk::PhysicalDeviceVulkan12Features &Engine::getGpuFeatures12() const {
+        return m_GpuFeatures12;
+    }
+
     std::string to_string(const version &ver) {
         return std::to_string(ver.major) + "." + std::to_string(ver.minor) + "." + std::to_string(ver.patch);
     }
@@ -290,20 +366,110 @@ namespace kat {
         m_Engine = engine;
     }
 
+    Engine *App::getEngine() {
+        return m_Engine;
+    }
+
+    JobSystem &App::getJobSystem() {
+        return m_Engine->getJobSystem();
+    }
+
     App::App() {
     }
 
     App::~App() {
-
+        stopSimulationThread();
     }
 
 
 
     void App::setupApp() {
         m_Running = true;
+        m_MainThread = std::this_thread::get_id();
+        StartupTimeline& startup = m_Engine->getStartupTimeline();
+        JobSystem& jobs = getJobSystem();
+
+        m_World = std::make_unique<World>();
+        m_Systems = std::make_unique<SystemScheduler>(*m_World, jobs);
+
+        // GLFW wants the window on the main thread; the device doesn't need it, so it's created alongside
+        JobCounter deviceCreated;
+        jobs.schedule([this, &startup]() {
+            auto stage = startup.stage("device");
+            createDevice();
+        }, &deviceCreated);
+
+        try {
+            auto stage = startup.stage("window");
+            createWindow();
+        } catch (...) {
+            jobs.wait(deviceCreated);
+            throw;
+        }
+        jobs.wait(deviceCreated);
 
-        glfwDefaultWindowHints();
-        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        if (m_Surface && !m_Engine->getGpu().getSurfaceSupportKHR(m_PresentFamily.value(), m_Surface)) {
+            spdlog::error("Queue family #{} can't present to the window surface", m_PresentFamily.value());
+            throw std::runtime_error("Failed to find required queue families");
+        }
+
+        {
+            auto stage = startup.stage("services");
+            if (m_Configuration.capture.frame_count > 0) {
+                m_FrameCapture = std::make_unique<FrameCapture>(*this, m_Configuration.capture);
+            }
+            m_UploadService = std::make_unique<UploadService>(*this);
+            m_BindlessRegistry = std::make_unique<BindlessRegistry>(*this);
+            m_TextureStreamer = std::make_unique<TextureStreamer>(*this);
+        }
+
+        // reading the pipeline cache and whatever the app preloads overlap swapchain creation
+        JobCounter preloaded;
+        jobs.schedule([this, &startup]() {
+            {
+                auto stage = startup.stage("pipeline cache");
+                m_PipelineCache = std::make_unique<PipelineCache>(*this, m_Configuration.pipeline_cache_path);
+            }
+            auto stage = startup.stage("preload");
+            preload();
+        }, &preloaded);
+
+        try {
+            auto stage = startup.stage("swapchain");
+            if (isHeadless()) {
+                createOffscreenImages();
+            } else {
+                createSwapchain();
+            }
+
+            createSwapchainImageViews();
+        } catch (...) {
+            jobs.wait(preloaded);
+            throw;
+        }
+        jobs.wait(preloaded);
+
+        m_Clock.getResolutionController().configure(m_Configuration.dynamic_resolution, m_FramesInFlight);
+
+        {
+            auto stage = startup.stage("setup");
+            setup();
+        }
+
+        const FixedTimestep& fixed = m_Configuration.fixed_timestep;
+        if (fixed.rate > 0.0) {
+            m_FixedStep = 1.0 / fixed.rate;
+            if (fixed.threaded) {
+                startSimulationThread();
+            }
+        }
+    }
+
+    void App::createWindow() {
+        if (!isHeadless()) {
+            glfwDefaultWindowHints();
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        }
 
         switch (m_Configuration.window_mode.index()) {
             case 0: {
@@ -331,15 +497,30 @@ namespace kat {
                 m_Window = glfwCreateWindow(vmode->width, vmode->height, m_Configuration.app_name.c_str(), monitor, nullptr);
             }
             break;
+            case 2:
+                spdlog::info("Running headless, rendering to offscreen images");
+                m_FramebufferSize.store(std::get<HeadlessWindowMode>(m_Configuration.window_mode).size);
+                break;
         }
 
-        VkSurfaceKHR srf_;
-        glfwCreateWindowSurface(m_Engine->getInstance(), m_Window, nullptr, &srf_);
-        m_Surface = srf_;
+        if (m_Window) {
+            glfwSetWindowUserPointer(m_Window, this);
+            glfwSetFramebufferSizeCallback(m_Window, &App::framebufferSizeCallback);
+            glm::ivec2 framebufferSize;
+            glfwGetFramebufferSize(m_Window, &framebufferSize.x, &framebufferSize.y);
+            m_FramebufferSize.store(framebufferSize);
+
+            VkSurfaceKHR srf_;
+            glfwCreateWindowSurface(m_Engine->getInstance(), m_Window, nullptr, &srf_);
+            m_Surface = srf_;
+        }
+    }
 
-        std::vector<const char*> dev_exts = {
-                VK_KHR_SWAPCHAIN_EXTENSION_NAME
-        };
+    void App::createDevice() {
+        std::vector<const char*> dev_exts;
+        if (!isHeadless()) {
+            dev_exts.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
 
         for (const char*& ext_ : dev_exts) {
             if (!m_Engine->supportsExtension(ext_)) {
@@ -348,27 +529,42 @@ namespace kat {
             }
         }
 
+        // optional extensions
+        for (const char* ext_ : {VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME}) {
+            if (m_Engine->supportsExtension(ext_)) {
+                dev_exts.push_back(ext_);
+            }
+        }
+
+        for (const char* ext_ : dev_exts) {
+            m_EnabledDeviceExtensions.insert(ext_);
+        }
+
         vk::DeviceCreateInfo dci{};
         dci.setPEnabledExtensionNames(dev_exts);
 
         auto qfps = m_Engine->getGpu().getQueueFamilyProperties();
+        m_QueueFamilies = qfps;
 
         size_t i = 0;
         for (const auto& qf : qfps) {
-            spdlog::info("Queue Family #{}:", i);
+            spdlog::debug("Queue Family #{}:", i);
 
-            spdlog::info("- Compute: {}", qf.queueFlags & vk::QueueFlagBits::eCompute ? "True" : "False");
-            spdlog::info("- Graphics: {}", qf.queueFlags & vk::QueueFlagBits::eGraphics ? "True" : "False");
-            spdlog::info("- Protected: {}", qf.queueFlags & vk::QueueFlagBits::eProtected ? "True" : "False");
-            spdlog::info("- Sparse Binding: {}", qf.queueFlags & vk::QueueFlagBits::eSparseBinding ? "True" : "False");
-            spdlog::info("- Transfer: {}", qf.queueFlags & vk::QueueFlagBits::eTransfer ? "True" : "False");
+            spdlog::debug("- Compute: {}", qf.queueFlags & vk::QueueFlagBits::eCompute ? "True" : "False");
+            spdlog::debug("- Graphics: {}", qf.queueFlags & vk::QueueFlagBits::eGraphics ? "True" : "False");
+            spdlog::debug("- Protected: {}", qf.queueFlags & vk::QueueFlagBits::eProtected ? "True" : "False");
+            spdlog::debug("- Sparse Binding: {}", qf.queueFlags & vk::QueueFlagBits::eSparseBinding ? "True" : "False");
+            spdlog::debug("- Transfer: {}", qf.queueFlags & vk::QueueFlagBits::eTransfer ? "True" : "False");
 
-            spdlog::info("- Queue Count: {}", qf.queueCount);
-            spdlog::info("- Min Image Transfer Granularity: {} x {} x {}", qf.minImageTransferGranularity.width, qf.minImageTransferGranularity.height, qf.minImageTransferGranularity.depth);
-            spdlog::info("- Timestamp Valid Bits: {}", qf.timestampValidBits);
+            spdlog::debug("- Queue Count: {}", qf.queueCount);
+            spdlog::debug("- Min Image Transfer Granularity: {} x {} x {}", qf.minImageTransferGranularity.width, qf.minImageTransferGranularity.height, qf.minImageTransferGranularity.depth);
+            spdlog::debug("- Timestamp Valid Bits: {}", qf.timestampValidBits);
 
-            bool supportsPresentation = m_Engine->getGpu().getSurfaceSupportKHR(i, m_Surface);
-            spdlog::info("- Presentation: {}", supportsPresentation ? "True" : "False");
+            // asked without a surface, the window may not exist yet; offscreen images are "presented" on the graphics queue
+            bool supportsPresentation = isHeadless()
+                ? static_cast<bool>(qf.queueFlags & vk::QueueFlagBits::eGraphics)
+                : glfwGetPhysicalDevicePresentationSupport(m_Engine->getInstance(), m_Engine->getGpu(), static_cast<uint32_t>(i)) == GLFW_TRUE;
+            spdlog::debug("- Presentation: {}", supportsPresentation ? "True" : "False");
 
             if (!(m_GraphicsFamily.has_value() && m_PresentFamily.has_value())) {
                 if (qf.queueFlags & vk::QueueFlagBits::eGraphics) {
@@ -390,33 +586,105 @@ namespace kat {
 
         m_SameQueueFamily = m_GraphicsFamily.value() == m_PresentFamily.value();
 
+        // prefer a transfer-only family (the copy engine), then an async compute family
+        for (uint32_t family = 0; family < qfps.size(); family++) {
+            vk::QueueFlags flags = qfps[family].queueFlags;
+            if (family == m_PresentFamily.value() || flags & vk::QueueFlagBits::eGraphics) {
+                continue;
+            }
+
+            if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & vk::QueueFlagBits::eCompute)) {
+                m_TransferFamily = family;
+                break;
+            }
+            if ((flags & vk::QueueFlagBits::eCompute) && !m_TransferFamily.has_value()) {
+                m_TransferFamily = family;
+            }
+        }
+        if (!m_TransferFamily.has_value()) {
+            m_TransferFamily = m_GraphicsFamily;
+        }
+
         std::vector<vk::DeviceQueueCreateInfo> dqcis;
 
-        float qp = 1.0f;
+        std::array<float, 2> qps{1.0f, 0.5f};
 
-        if (m_SameQueueFamily) {
-            dqcis.emplace_back(
-                vk::DeviceQueueCreateFlags(), m_GraphicsFamily.value(), 1, &qp
-            );
-        } else {
+        // without a separate family uploads get their own graphics queue if there's a second one
+        uint32_t graphicsQueueCount = 1;
+        uint32_t transferQueueIndex = 0;
+        if (m_TransferFamily.value() == m_GraphicsFamily.value() && qfps[m_GraphicsFamily.value()].queueCount > 1) {
+            graphicsQueueCount = 2;
+            transferQueueIndex = 1;
+        }
+
+        dqcis.emplace_back(
+            vk::DeviceQueueCreateFlags(), m_GraphicsFamily.value(), graphicsQueueCount, qps.data()
+        );
+        if (!m_SameQueueFamily) {
             dqcis.emplace_back(
-                    vk::DeviceQueueCreateFlags(), m_GraphicsFamily.value(), 1, &qp
+                    vk::DeviceQueueCreateFlags(), m_PresentFamily.value(), 1, qps.data()
             );
+        }
+        if (m_TransferFamily.value() != m_GraphicsFamily.value()) {
             dqcis.emplace_back(
-                    vk::DeviceQueueCreateFlags(), m_PresentFamily.value(), 1, &qp
+                    vk::DeviceQueueCreateFlags(), m_TransferFamily.value(), 1, &qps[1]
             );
         }
 
+        if (!m_Engine->getGpuFeatures12().timelineSemaphore) {
+            spdlog::error("ERROR: GPU DOES NOT SUPPORT TIMELINE SEMAPHORES");
+            throw std::runtime_error("Unsupported device feature requested");
+        }
+
+        // what the bindless registry relies on
+        const vk::PhysicalDeviceVulkan12Features& supported12 = m_Engine->getGpuFeatures12();
+        if (!supported12.runtimeDescriptorArray || !supported12.descriptorBindingPartiallyBound
+            || !supported12.descriptorBindingSampledImageUpdateAfterBind || !supported12.descriptorBindingStorageBufferUpdateAfterBind
+            || !supported12.descriptorBindingUpdateUnusedWhilePending || !supported12.shaderSampledImageArrayNonUniformIndexing
+            || !supported12.shaderStorageBufferArrayNonUniformIndexing) {
+            spdlog::error("ERROR: GPU DOES NOT SUPPORT BINDLESS DESCRIPTOR INDEXING");
+            throw std::runtime_error("Unsupported device feature requested");
+        }
+
+        vk::PhysicalDeviceVulkan12Features features12{};
+        features12.timelineSemaphore = true;
+        features12.runtimeDescriptorArray = true;
+        features12.descriptorBindingPartiallyBound = true;
+        features12.descriptorBindingSampledImageUpdateAfterBind = true;
+        features12.descriptorBindingStorageBufferUpdateAfterBind = true;
+        features12.descriptorBindingUpdateUnusedWhilePending = true;
+        features12.shaderSampledImageArrayNonUniformIndexing = true;
+        features12.shaderStorageBufferArrayNonUniformIndexing = true;
+        features12.drawIndirectCount = supported12.drawIndirectCount;
+
         dci.setQueueCreateInfos(dqcis);
         dci.setPEnabledFeatures(&m_Engine->getGpuFeatures());
+        dci.setPNext(&features12);
 
         m_Device = m_Engine->getGpu().createDevice(dci);
         spdlog::info("Created logical device");
 
+        m_DeviceAllocator = std::make_unique<DeviceAllocator>(m_Engine->getGpu(), m_Device);
+
+        m_FramesInFlight = std::clamp(m_Configuration.frames_in_flight, 1U, kMaxFramesInFlight);
+        if (m_FramesInFlight != m_Configuration.frames_in_flight) {
+            spdlog::warn("frames_in_flight must be between 1 and {}, using {}", kMaxFramesInFlight, m_FramesInFlight);
+        }
+
+        vk::SemaphoreTypeCreateInfo timelineInfo{vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo frameTimelineInfo{};
+        frameTimelineInfo.setPNext(&timelineInfo);
+        m_FrameTimeline = m_Device.createSemaphore(frameTimelineInfo);
+
         m_GraphicsQueue = m_Device.getQueue(m_GraphicsFamily.value(), 0);
         m_PresentQueue = m_Device.getQueue(m_PresentFamily.value(), 0);
+        m_TransferQueue = m_Device.getQueue(m_TransferFamily.value(), transferQueueIndex);
+        spdlog::info("Using queue family #{} for transfers{}", m_TransferFamily.value(), isTransferQueueShared() ? " (shared with graphics)" : "");
+    }
 
+    void App::createSwapchain(vk::SwapchainKHR oldSwapchain) {
         vk::SwapchainCreateInfoKHR sci{};
+        sci.oldSwapchain = oldSwapchain;
 
         vk::SurfaceCapabilitiesKHR scaps = m_Engine->getGpu().getSurfaceCapabilitiesKHR(m_Surface);
 
@@ -428,9 +696,12 @@ namespace kat {
         if (!m_SameQueueFamily) {
             sci.setQueueFamilyIndices(qfs_sc);
         }
-        sci.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
+        // transfers in let the renderer upscale a dynamic resolution frame straight into the swapchain image
+        sci.imageUsage = vk::ImageUsageFlagBits::eColorAttachment | (scaps.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst);
+        m_SwapchainImageUsage = sci.imageUsage;
         sci.preTransform = scaps.currentTransform;
-        sci.minImageCount = scaps.maxImageCount == 0 ? scaps.minImageCount + 1 : std::min(scaps.minImageCount + 1, scaps.maxImageCount);
+        uint32_t imageCount = m_Configuration.latency.image_count == 0 ? scaps.minImageCount + 1 : std::max(m_Configuration.latency.image_count, scaps.minImageCount);
+        sci.minImageCount = scaps.maxImageCount == 0 ? imageCount : std::min(imageCount, scaps.maxImageCount);
         sci.surface = m_Surface;
 
         auto fmts = m_Engine->getGpu().getSurfaceFormatsKHR(m_Surface);
@@ -448,32 +719,117 @@ namespace kat {
         sci.imageFormat = fm.format;
         sci.imageColorSpace = fm.colorSpace;
 
+        // walk from the requested mode towards FIFO, which every surface supports
+        auto supported = [&](vk::PresentModeKHR mode) { return std::find(pms.begin(), pms.end(), mode) != pms.end(); };
         sci.presentMode = vk::PresentModeKHR::eFifo;
+        switch (m_Configuration.latency.present_mode) {
+            case vk::PresentModeKHR::eImmediate:
+                if (supported(vk::PresentModeKHR::eImmediate)) {
+                    sci.presentMode = vk::PresentModeKHR::eImmediate;
+                    break;
+                }
+                [[fallthrough]];
+            case vk::PresentModeKHR::eMailbox:
+                if (supported(vk::PresentModeKHR::eMailbox)) {
+                    sci.presentMode = vk::PresentModeKHR::eMailbox;
+                }
+                break;
+            case vk::PresentModeKHR::eFifoRelaxed:
+                if (supported(vk::PresentModeKHR::eFifoRelaxed)) {
+                    sci.presentMode = vk::PresentModeKHR::eFifoRelaxed;
+                }
+                break;
+            default:
+                break;
+        }
 
-        for (const auto& pm : pms) {
-            if (pm == vk::PresentModeKHR::eMailbox) {
-                sci.presentMode = pm;
-            }
+        if (sci.presentMode != m_Configuration.latency.present_mode) {
+            spdlog::warn("Present mode {} is unsupported, using {}", vk::to_string(m_Configuration.latency.present_mode), vk::to_string(sci.presentMode));
         }
 
         m_PresentMode = sci.presentMode;
 
-        int fw, fh;
-        glfwGetFramebufferSize(m_Window, &fw, &fh);
-
+        glm::ivec2 framebufferSize = m_FramebufferSize.load();
         sci.imageExtent = scaps.currentExtent.width == UINT32_MAX ? vk::Extent2D{
-                std::clamp(static_cast<uint32_t>(fw), scaps.minImageExtent.width, scaps.maxImageExtent.width),
-                std::clamp(static_cast<uint32_t>(fh), scaps.minImageExtent.height, scaps.maxImageExtent.height)
+                std::clamp(static_cast<uint32_t>(framebufferSize.x), scaps.minImageExtent.width, scaps.maxImageExtent.width),
+                std::clamp(static_cast<uint32_t>(framebufferSize.y), scaps.minImageExtent.height, scaps.maxImageExtent.height)
         } : scaps.currentExtent;
 
         m_SwapchainExtent = sci.imageExtent;
 
         m_Swapchain = m_Device.createSwapchainKHR(sci);
-        spdlog::info("Created Swapchain");
+        spdlog::info("Created Swapchain ({} x {}, {})", m_SwapchainExtent.width, m_SwapchainExtent.height, vk::to_string(m_PresentMode));
 
         m_SwapchainImages = m_Device.getSwapchainImagesKHR(m_Swapchain);
         spdlog::info("Obtained {} images from swapchain", m_SwapchainImages.size());
+    }
+
+    bool App::recreateSwapchain() {
+        vk::SurfaceCapabilitiesKHR scaps = m_Engine->getGpu().getSurfaceCapabilitiesKHR(m_Surface);
+        glm::ivec2 framebufferSize = m_FramebufferSize.load();
+        if (scaps.currentExtent.width == 0 || scaps.currentExtent.height == 0 || framebufferSize.x == 0 || framebufferSize.y == 0) {
+            // minimized, try again once there's something to present to
+            return false;
+        }
+
+        // the old swapchain is retired, not destroyed: frames still in flight may be presenting its images
+        vk::SwapchainKHR oldSwapchain = m_Swapchain;
+        std::vector<vk::ImageView> oldViews = std::move(m_SwapchainImageViews);
+        m_SwapchainImageViews.clear();
+        m_SwapchainImages.clear();
 
+        createSwapchain(oldSwapchain);
+        createSwapchainImageViews();
+
+        vk::Device device = m_Device;
+        deferDeletion([device, oldSwapchain, oldViews = std::move(oldViews)]() {
+            for (const auto& view : oldViews) {
+                device.destroyImageView(view);
+            }
+            device.destroySwapchainKHR(oldSwapchain);
+        });
+
+        m_SwapchainDirty = false;
+        m_SwapchainGeneration++;
+        return true;
+    }
+
+    void App::framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+        App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+        app->m_FramebufferSize.store(glm::ivec2{width, height});
+        app->m_SwapchainDirty.store(true);
+    }
+
+    void App::createOffscreenImages() {
+        HeadlessWindowMode mode = std::get<HeadlessWindowMode>(m_Configuration.window_mode);
+
+        m_SwapchainFormat = vk::Format::eR8G8B8A8Unorm;
+        m_SwapchainExtent = vk::Extent2D{static_cast<uint32_t>(mode.size.x), static_cast<uint32_t>(mode.size.y)};
+        m_PresentMode = vk::PresentModeKHR::eImmediate;
+        m_SwapchainImageUsage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst;
+
+        for (uint32_t i = 0; i < std::max(mode.image_count, 1U); i++) {
+            vk::ImageCreateInfo ici{};
+            ici.imageType = vk::ImageType::e2D;
+            ici.format = m_SwapchainFormat;
+            ici.extent = vk::Extent3D{m_SwapchainExtent.width, m_SwapchainExtent.height, 1};
+            ici.mipLevels = 1;
+            ici.arrayLayers = 1;
+            ici.samples = vk::SampleCountFlagBits::e1;
+            ici.tiling = vk::ImageTiling::eOptimal;
+            ici.usage = m_SwapchainImageUsage | vk::ImageUsageFlagBits::eTransferSrc;
+            ici.sharingMode = vk::SharingMode::eExclusive;
+            ici.initialLayout = vk::ImageLayout::eUndefined;
+
+            AllocatedImage img = m_DeviceAllocator->createImage(ici);
+
+            m_SwapchainImages.push_back(img.image);
+            m_OffscreenImages.push_back(img);
+        }
+        spdlog::info("Created {} offscreen images ({} x {})", m_SwapchainImages.size(), m_SwapchainExtent.width, m_SwapchainExtent.height);
+    }
+
+    void App::createSwapchainImageViews() {
         for (const auto& img : m_SwapchainImages) {
             m_SwapchainImageViews.push_back(m_Device.createImageView(vk::ImageViewCreateInfo{
                 vk::ImageViewCreateFlags(), img, vk::ImageViewType::e2D, m_SwapchainFormat, vk::ComponentMapping{
@@ -482,19 +838,21 @@ namespace kat {
                             vk::ComponentSwizzle::eB,
                             vk::ComponentSwizzle::eA
                 }, vk::ImageSubresourceRange{
-                    vk::ImageAspectFlags(), 0, 1, 0, 1
+                    vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1
                 }
             }));
         }
         spdlog::info("Created {} image views for swapchain images", m_SwapchainImageViews.size());
-
-        setup();
     }
 
     bool App::isRunning() const noexcept {
         return m_Running;
     }
 
+    bool App::isHeadless() const noexcept {
+        return std::holds_alternative<HeadlessWindowMode>(m_Configuration.window_mode);
+    }
+
     void App::stop() {
         m_Running = false;
     }
@@ -502,23 +860,159 @@ namespace kat {
     void App::updateApp() {
         m_Clock.nextFrame();
 
-        update(m_Clock.getFrameTime().count());
+        if (m_SimulationFailed.load(std::memory_order_acquire)) {
+            std::rethrow_exception(m_SimulationError);
+        }
+
+        double dt = m_Clock.getFrameTime().count();
+        m_TextureStreamer->update();
+        m_Systems->run(dt);
+        if (m_FixedStep > 0.0 && !m_Configuration.fixed_timestep.threaded) {
+            runFixedSteps(dt);
+        }
+        update(dt);
 
-        if (glfwWindowShouldClose(m_Window)) {
+        if (m_Window && glfwWindowShouldClose(m_Window)) {
             stop();
         }
+
+        if (isHeadless()) {
+            size_t limit = std::get<HeadlessWindowMode>(m_Configuration.window_mode).frame_limit;
+            if (limit != 0 && m_Clock.getFrameCount() >= limit) {
+                stop();
+            }
+        }
+    }
+
+    double App::getInterpolationAlpha() const {
+        if (m_FixedStep <= 0.0) {
+            return 1.0;
+        }
+        if (!m_Configuration.fixed_timestep.threaded) {
+            return m_Accumulator / m_FixedStep;
+        }
+
+        auto sinceStep = std::chrono::steady_clock::now().time_since_epoch() - std::chrono::steady_clock::duration(m_LastStepDue.load(std::memory_order_acquire));
+        return std::clamp(std::chrono::duration<double>(sinceStep).count() / m_FixedStep, 0.0, 1.0);
+    }
+
+    uint64_t App::getSimulationStep() const noexcept {
+        return m_SimulationStep.load(std::memory_order_acquire);
+    }
+
+    AppClock &App::getClock() {
+        return m_Clock;
+    }
+
+    void App::runFixedSteps(double dt) {
+        uint32_t maxSteps = std::max(m_Configuration.fixed_timestep.max_steps, 1U);
+
+        m_Accumulator += dt;
+        for (uint32_t step = 0; step < maxSteps && m_Accumulator >= m_FixedStep; step++) {
+            fixedUpdate(m_FixedStep);
+            m_Accumulator -= m_FixedStep;
+            m_SimulationStep.fetch_add(1, std::memory_order_release);
+        }
+
+        // still behind after max_steps: drop the rest instead of carrying it into the next frame
+        if (m_Accumulator >= m_FixedStep) {
+            m_Accumulator = std::fmod(m_Accumulator, m_FixedStep);
+        }
+    }
+
+    void App::startSimulationThread() {
+        using clock = std::chrono::steady_clock;
+        auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(m_FixedStep));
+        int64_t maxSteps = std::max(m_Configuration.fixed_timestep.max_steps, 1U);
+
+        m_SimulationRunning.store(true, std::memory_order_relaxed);
+        m_SimulationThread = std::thread([this, step, maxSteps]() {
+            clock::time_point due = clock::now();
+            m_LastStepDue.store(due.time_since_epoch().count(), std::memory_order_release);
+
+            try {
+                while (m_SimulationRunning.load(std::memory_order_acquire)) {
+                    due += step;
+                    std::this_thread::sleep_until(due);
+
+                    // too far behind to catch up: skip ahead, dropping the steps in between
+                    int64_t behind = (clock::now() - due) / step;
+                    if (behind > maxSteps) {
+                        due += step * behind;
+                    }
+
+                    fixedUpdate(m_FixedStep);
+                    m_SimulationStep.fetch_add(1, std::memory_order_release);
+                    m_LastStepDue.store(due.time_since_epoch().count(), std::memory_order_release);
+                }
+            } catch (...) {
+                spdlog::error("fixedUpdate() threw, stopping the simulation thread");
+                m_SimulationError = std::current_exception();
+                m_SimulationFailed.store(true, std::memory_order_release);
+            }
+        });
+    }
+
+    void App::stopSimulationThread() {
+        m_SimulationRunning.store(false, std::memory_order_release);
+        if (m_SimulationThread.joinable()) {
+            m_SimulationThread.join();
+        }
     }
 
     void App::cleanupApp() {
+        stopSimulationThread();
+        if (m_RenderThread) {
+            m_RenderThread->stop();
+        }
+        m_Device.waitIdle();
+
         cleanup();
 
+        // an unfinished capture still writes the frames it has
+        if (m_FrameCapture) {
+            m_FrameCapture->cleanup();
+            m_FrameCapture.reset();
+        }
+
+        m_Systems.reset();
+        m_World.reset();
+
+        m_TextureStreamer->cleanup();
+        m_TextureStreamer.reset();
+
+        runDeferredDeletions(true);
+
         for (const auto& siv : m_SwapchainImageViews) {
             m_Device.destroyImageView(siv);
         }
-        m_Device.destroySwapchainKHR(m_Swapchain);
+
+        if (isHeadless()) {
+            for (auto& img : m_OffscreenImages) {
+                m_DeviceAllocator->destroyImage(img);
+            }
+        } else {
+            m_Device.destroySwapchainKHR(m_Swapchain);
+        }
+
+        m_UploadService->cleanup();
+        m_UploadService.reset();
+
+        m_PipelineCache->cleanup();
+        m_PipelineCache.reset();
+
+        m_BindlessRegistry->cleanup();
+        m_BindlessRegistry.reset();
+
+        m_Device.destroySemaphore(m_FrameTimeline);
+
+        m_DeviceAllocator->logStats();
+        m_DeviceAllocator.reset();
         m_Device.destroy();
 
-        glfwDestroyWindow(m_Window);
+        if (m_Window) {
+            glfwDestroyWindow(m_Window);
+        }
     }
 
     vk::Device App::getDevice() {
@@ -545,11 +1039,31 @@ namespace kat {
         return m_PresentFamily.value();
     }
 
-    std::vector<vk::Image> App::getSwapchainImages() {
+    vk::Queue App::getTransferQueue() {
+        return m_TransferQueue;
+    }
+
+    uint32_t App::getTransferFamily() {
+        return m_TransferFamily.value();
+    }
+
+    bool App::isTransferQueueShared() const noexcept {
+        return m_TransferQueue == m_GraphicsQueue;
+    }
+
+    std::mutex &App::getGraphicsQueueMutex() {
+        return m_GraphicsQueueMutex;
+    }
+
+    const vk::QueueFamilyProperties &App::getQueueFamilyProperties(uint32_t family) {
+        return m_QueueFamilies.at(family);
+    }
+
+    std::span<const vk::Image> App::getSwapchainImages() {
         return m_SwapchainImages;
     }
 
-    std::vector<vk::ImageView> App::getSwapchainImageViews() {
+    std::span<const vk::ImageView> App::getSwapchainImageViews() {
         return m_SwapchainImageViews;
     }
 
@@ -557,14 +1071,221 @@ namespace kat {
         return m_SwapchainFormat;
     }
 
+    vk::ImageUsageFlags App::getSwapchainImageUsage() {
+        return m_SwapchainImageUsage;
+    }
+
     vk::Extent2D App::getSwapchainExtent() {
         return m_SwapchainExtent;
     }
 
+    glm::ivec2 App::getFramebufferSize() const noexcept {
+        return m_FramebufferSize.load();
+    }
+
     vk::PresentModeKHR App::getPresentMode() {
         return m_PresentMode;
     }
 
+    vk::ImageLayout App::getFinalImageLayout() {
+        return isHeadless() ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+    }
+
+    std::optional<uint32_t> App::acquireNextImage(vk::Semaphore signalSemaphore) {
+        if (!isHeadless()) {
+            if (m_SwapchainDirty && !recreateSwapchain()) {
+                // GLFW only waits for events on the main thread, a render thread just backs off
+                if (std::this_thread::get_id() == m_MainThread) {
+                    glfwWaitEventsTimeout(0.05);
+                } else {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+                return std::nullopt;
+            }
+
+            try {
+                vk::ResultValue<uint32_t> acquired = m_Device.acquireNextImageKHR(m_Swapchain, UINT64_MAX, signalSemaphore);
+                if (acquired.result == vk::Result::eSuboptimalKHR) {
+                    // the image is still usable, recreate after presenting it
+                    m_SwapchainDirty = true;
+                }
+                return acquired.value;
+            } catch (const vk::OutOfDateKHRError&) {
+                m_SwapchainDirty = true;
+                return std::nullopt;
+            }
+        }
+
+        // there is no presentation engine to signal the semaphore, so an empty submit does it instead
+        uint32_t imgIdx = m_OffscreenImageIndex;
+        m_OffscreenImageIndex = (m_OffscreenImageIndex + 1) % static_cast<uint32_t>(m_SwapchainImages.size());
+
+        vk::SubmitInfo signalSubmit{};
+        signalSubmit.setSignalSemaphores(signalSemaphore);
+        std::lock_guard queueLock(m_GraphicsQueueMutex);
+        m_GraphicsQueue.submit(signalSubmit);
+
+        return imgIdx;
+    }
+
+    void App::presentImage(uint32_t imageIndex, vk::Semaphore waitSemaphore) {
+        if (!isHeadless()) {
+            vk::PresentInfoKHR presentInfo{};
+            presentInfo.setWaitSemaphores(waitSemaphore);
+            presentInfo.setSwapchains(m_Swapchain);
+            presentInfo.setImageIndices(imageIndex);
+
+            std::lock_guard queueLock(m_GraphicsQueueMutex);
+            try {
+                if (m_PresentQueue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR) {
+                    m_SwapchainDirty = true;
+                }
+            } catch (const vk::OutOfDateKHRError&) {
+                m_SwapchainDirty = true;
+            }
+            return;
+        }
+
+        // consume the render finished semaphore so it can be signalled again next time
+        vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+        vk::SubmitInfo waitSubmit{};
+        waitSubmit.setWaitSemaphores(waitSemaphore);
+        waitSubmit.setWaitDstStageMask(waitStage);
+        std::lock_guard queueLock(m_GraphicsQueueMutex);
+        m_GraphicsQueue.submit(waitSubmit);
+    }
+
+    uint64_t App::getSwapchainGeneration() const noexcept {
+        return m_SwapchainGeneration;
+    }
+
+    vk::Semaphore App::getFrameTimeline() {
+        return m_FrameTimeline;
+    }
+
+    uint32_t App::getFramesInFlight() const noexcept {
+        return m_FramesInFlight;
+    }
+
+    uint64_t App::getFrameNumber() const noexcept {
+        return m_FrameNumber.load();
+    }
+
+    uint64_t App::getCompletedFrame() {
+        return m_Device.getSemaphoreCounterValue(m_FrameTimeline);
+    }
+
+    void App::waitForFrame(uint64_t frame) {
+        vk::SemaphoreWaitInfo waitInfo{};
+        waitInfo.setSemaphores(m_FrameTimeline);
+        waitInfo.setValues(frame);
+        m_Device.waitSemaphores(waitInfo, UINT64_MAX);
+    }
+
+    uint64_t App::beginFrame() {
+        uint64_t frame = m_FrameNumber.fetch_add(1) + 1;
+        if (frame > m_FramesInFlight) {
+            waitForFrame(frame - m_FramesInFlight);
+        }
+
+        runDeferredDeletions(false);
+        m_BindlessRegistry->beginFrame(frame);
+        return frame;
+    }
+
+    void App::skipFrame() {
+        uint64_t frame = m_FrameNumber.load();
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.setSignalSemaphoreValues(frame);
+
+        vk::SubmitInfo signalSubmit{};
+        signalSubmit.setSignalSemaphores(m_FrameTimeline);
+        signalSubmit.setPNext(&timelineInfo);
+
+        std::lock_guard queueLock(m_GraphicsQueueMutex);
+        m_GraphicsQueue.submit(signalSubmit);
+    }
+
+    uint64_t App::getRetireFrame() const noexcept {
+        if (m_RenderThread && std::this_thread::get_id() == m_MainThread) {
+            // queued first: frames begun after this read render packets it counts, so the sum can only overshoot
+            uint64_t queued = m_RenderThread->getQueuedCount();
+            return m_FrameNumber.load() + queued + 1;
+        }
+        return m_FrameNumber.load();
+    }
+
+    void App::deferDeletion(std::function<void()> deleter) {
+        uint64_t frame = getRetireFrame();
+        std::lock_guard lock(m_DeletionMutex);
+        m_DeferredDeletions.emplace_back(frame, std::move(deleter));
+    }
+
+    void App::runDeferredDeletions(bool all) {
+        uint64_t completed = all ? UINT64_MAX : getCompletedFrame();
+        std::lock_guard lock(m_DeletionMutex);
+        // main thread deletions wait for frames ahead of the render thread's, so the queue isn't sorted
+        std::erase_if(m_DeferredDeletions, [&](std::pair<uint64_t, std::function<void()>>& deletion) {
+            if (deletion.first > completed) {
+                return false;
+            }
+            deletion.second();
+            return true;
+        });
+    }
+
+    uint32_t App::findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags properties) {
+        vk::PhysicalDeviceMemoryProperties memProps = m_Engine->getGpu().getMemoryProperties();
+        for (uint32_t i = 0; i < memProps.memoryTypeCount; i++) {
+            if ((typeBits & (1U << i)) && (memProps.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        spdlog::error("Failed to find a suitable memory type");
+        throw std::runtime_error("Failed to find a suitable memory type");
+    }
+
+    DeviceAllocator &App::getDeviceAllocator() {
+        return *m_DeviceAllocator;
+    }
+
+    UploadService &App::getUploadService() {
+        return *m_UploadService;
+    }
+
+    PipelineCache &App::getPipelineCache() {
+        return *m_PipelineCache;
+    }
+
+    BindlessRegistry &App::getBindlessRegistry() {
+        return *m_BindlessRegistry;
+    }
+
+    TextureStreamer &App::getTextureStreamer() {
+        return *m_TextureStreamer;
+    }
+
+    FrameCapture *App::getFrameCapture() {
+        return m_FrameCapture.get();
+    }
+
+    void App::setRenderThread(RenderThread *renderThread) {
+        m_RenderThread = renderThread;
+    }
+
+    World &App::getWorld() {
+        return *m_World;
+    }
+
+    SystemScheduler &App::getSystems() {
+        return *m_Systems;
+    }
+
+    bool App::isExtensionEnabled(const std::string &name) const {
+        return m_EnabledDeviceExtensions.contains(name);
+    }
+
     AppClock::time_point AppClock::getStartTime() {
         return startTime;
     }
@@ -601,6 +1322,30 @@ namespace kat {
         return frameCount;
     }
 
+    FrameStats AppClock::getFrameStats() {
+        return frameTimes.getStats();
+    }
+
+    FrameStats AppClock::getRecentFrameStats() {
+        return frameTimes.getRecentStats();
+    }
+
+    const FrameTimeHistogram &AppClock::getFrameTimeHistogram() {
+        return frameTimes;
+    }
+
+    void AppClock::setHitchBudget(duration budget) {
+        frameTimes.setHitchBudget(budget.count());
+    }
+
+    ResolutionController &AppClock::getResolutionController() {
+        return resolution;
+    }
+
+    float AppClock::getResolutionScale() {
+        return resolution.getScale();
+    }
+
     void AppClock::nextFrame() {
         time_point thisFrame = now();
         lastFrameTime = thisFrame - lastFrame;
@@ -609,11 +1354,12 @@ namespace kat {
         lastFrame = thisFrame;
         frameCount += 1;
 
+        frameTimes.record(lastFrameTime.count());
     }
 
     AppClock::AppClock() {
         startTime = now();
-
+        lastFrame = startTime;
     }
 
     FullscreenWindowMode::FullscreenWindowMode(size_t monitor_id_) : monitor_id{monitor_id_} {
@@ -0,0 +1,56 @@
+#include "kat/FrameArena.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace kat {
+
+    LinearArena::LinearArena(size_t capacity) : m_Memory(std::make_unique<std::byte[]>(capacity)), m_Capacity(capacity) {
+    }
+
+    void *LinearArena::allocate(size_t size, size_t alignment) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(m_Memory.get());
+        size_t aligned = ((base + m_Offset + alignment - 1) & ~(alignment - 1)) - base;
+
+        if (aligned + size <= m_Capacity) {
+            m_Offset = aligned + size;
+            m_HighWaterMark = std::max(m_HighWaterMark, m_Offset + m_OverflowBytes);
+            return m_Memory.get() + aligned;
+        }
+
+        // doesn't fit; serve it from its own block until the next reset grows the main one
+        auto& block = m_Overflow.emplace_back(std::make_unique<std::byte[]>(size + alignment));
+        m_OverflowBytes += size + alignment;
+        m_HighWaterMark = std::max(m_HighWaterMark, m_Offset + m_OverflowBytes);
+
+        uintptr_t blockBase = reinterpret_cast<uintptr_t>(block.get());
+        return block.get() + (((blockBase + alignment - 1) & ~(alignment - 1)) - blockBase);
+    }
+
+    void LinearArena::reset() {
+        if (!m_Overflow.empty()) {
+            size_t grown = std::max(m_Capacity * 2, m_HighWaterMark);
+            spdlog::warn("Frame arena overflowed by {} bytes, growing it from {} to {} bytes", m_OverflowBytes, m_Capacity, grown);
+
+            m_Overflow.clear();
+            m_OverflowBytes = 0;
+            m_Memory = std::make_unique<std::byte[]>(grown);
+            m_Capacity = grown;
+        }
+
+        m_Offset = 0;
+    }
+
+    size_t LinearArena::getUsed() const noexcept {
+        return m_Offset + m_OverflowBytes;
+    }
+
+    size_t LinearArena::getCapacity() const noexcept {
+        return m_Capacity;
+    }
+
+    size_t LinearArena::getHighWaterMark() const noexcept {
+        return m_HighWaterMark;
+    }
+}
@@ -0,0 +1,436 @@
+#include "kat/FrameCapture.h"
+#include "kat/MappedFile.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace kat {
+
+    namespace {
+        class ByteWriter {
+        public:
+            explicit ByteWriter(std::vector<std::byte>& out) : m_Out(out) {}
+
+            template<typename T>
+            void put(const T& value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                putBytes(std::as_bytes(std::span(&value, 1)));
+            }
+
+            // a 32 bit count, then the elements
+            template<typename T>
+            void putArray(std::span<const T> values) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                put(static_cast<uint32_t>(values.size()));
+                putBytes(std::as_bytes(values));
+            }
+
+            void putString(std::string_view text) {
+                putArray(std::span(text.data(), text.size()));
+            }
+
+            void putBytes(std::span<const std::byte> bytes) {
+                m_Out.insert(m_Out.end(), bytes.begin(), bytes.end());
+            }
+
+        protected:
+            std::vector<std::byte>& m_Out;
+        };
+
+        // Writes the record's header on construction and fills in its payload size on destruction.
+        class RecordWriter : public ByteWriter {
+        public:
+            RecordWriter(std::vector<std::byte>& out, CaptureRecord type) : ByteWriter(out) {
+                put(type);
+                m_SizeOffset = m_Out.size();
+                put(uint32_t{0});
+            }
+
+            ~RecordWriter() {
+                auto size = static_cast<uint32_t>(m_Out.size() - m_SizeOffset - sizeof(uint32_t));
+                std::memcpy(m_Out.data() + m_SizeOffset, &size, sizeof(size));
+            }
+
+            RecordWriter(const RecordWriter&) = delete;
+            RecordWriter& operator=(const RecordWriter&) = delete;
+
+        private:
+            size_t m_SizeOffset;
+        };
+
+        class ByteReader {
+        public:
+            explicit ByteReader(std::span<const std::byte> data) : m_Data(data) {}
+
+            template<typename T>
+            T get() {
+                static_assert(std::is_trivially_copyable_v<T>);
+                T value;
+                std::memcpy(&value, getBytes(sizeof(T)).data(), sizeof(T));
+                return value;
+            }
+
+            template<typename T>
+            std::vector<T> getArray() {
+                auto count = get<uint32_t>();
+                std::span<const std::byte> bytes = getBytes(static_cast<size_t>(count) * sizeof(T));
+                // the file gives no alignment guarantees, so elements are copied out rather than pointed at
+                std::vector<T> values(count);
+                std::memcpy(values.data(), bytes.data(), bytes.size());
+                return values;
+            }
+
+            std::string getString() {
+                std::vector<char> chars = getArray<char>();
+                return std::string(chars.begin(), chars.end());
+            }
+
+            std::span<const std::byte> getBytes(size_t size) {
+                if (m_Data.size() - m_Position < size) {
+                    spdlog::error("Frame capture ends in the middle of a record");
+                    throw std::runtime_error("Truncated frame capture");
+                }
+                std::span<const std::byte> bytes = m_Data.subspan(m_Position, size);
+                m_Position += size;
+                return bytes;
+            }
+
+            [[nodiscard]] bool atEnd() const {
+                return m_Position == m_Data.size();
+            }
+
+        private:
+            std::span<const std::byte> m_Data;
+            size_t m_Position = 0;
+        };
+
+        void writeSceneCreate(std::vector<std::byte>& out, uint32_t scene, const GpuSceneConfig& config) {
+            RecordWriter record(out, CaptureRecord::eSceneCreate);
+            record.put(scene);
+            record.put(config.max_instances);
+            record.put(config.max_meshes);
+            record.put(config.max_vertices);
+            record.put(config.max_indices);
+        }
+
+        void writeInstances(std::vector<std::byte>& out, uint32_t scene, bool add, uint32_t first, std::span<const GpuInstance> instances) {
+            RecordWriter record(out, CaptureRecord::eSceneInstances);
+            record.put(scene);
+            record.put(static_cast<uint8_t>(add));
+            record.put(first);
+            record.putArray(instances);
+        }
+
+        void writeView(std::vector<std::byte>& out, uint32_t scene, const SceneView& view) {
+            RecordWriter record(out, CaptureRecord::eSceneView);
+            record.put(scene);
+            record.put(view.view);
+            record.put(view.projection);
+            record.put(view.lod_distance);
+        }
+
+        CapturedCommand readCommand(CaptureRecord type, ByteReader& reader) {
+            switch (type) {
+                case CaptureRecord::eUpload: {
+                    CapturedUpload upload{};
+                    upload.image = reader.get<uint8_t>() != 0;
+                    upload.size = reader.get<uint64_t>();
+                    return upload;
+                }
+                case CaptureRecord::eSceneCreate: {
+                    CapturedSceneCreate create{};
+                    create.scene = reader.get<uint32_t>();
+                    create.config.max_instances = reader.get<uint32_t>();
+                    create.config.max_meshes = reader.get<uint32_t>();
+                    create.config.max_vertices = reader.get<uint32_t>();
+                    create.config.max_indices = reader.get<uint32_t>();
+                    return create;
+                }
+                case CaptureRecord::eSceneMesh: {
+                    CapturedMesh mesh{};
+                    mesh.scene = reader.get<uint32_t>();
+                    mesh.vertices = reader.getArray<SceneVertex>();
+                    mesh.indices = reader.getArray<uint32_t>();
+                    mesh.lods = reader.getArray<GpuMeshLod>();
+                    return mesh;
+                }
+                case CaptureRecord::eSceneInstances: {
+                    CapturedInstances instances{};
+                    instances.scene = reader.get<uint32_t>();
+                    instances.add = reader.get<uint8_t>() != 0;
+                    instances.first = reader.get<uint32_t>();
+                    instances.instances = reader.getArray<GpuInstance>();
+                    return instances;
+                }
+                default: {
+                    CapturedView view{};
+                    view.scene = reader.get<uint32_t>();
+                    view.view.view = reader.get<glm::mat4>();
+                    view.view.projection = reader.get<glm::mat4>();
+                    view.view.lod_distance = reader.get<float>();
+                    return view;
+                }
+            }
+        }
+
+        void readFrame(ByteReader& reader, CapturedFrame& frame) {
+            frame.number = reader.get<uint64_t>();
+            frame.cpuTime = reader.get<double>();
+            frame.resolutionScale = reader.get<float>();
+            frame.drawItems = reader.get<uint64_t>();
+            frame.scene = reader.get<uint32_t>();
+            auto passCount = reader.get<uint32_t>();
+            for (uint32_t i = 0; i < passCount; i++) {
+                CapturedPass& pass = frame.passes.emplace_back();
+                pass.type = static_cast<PassType>(reader.get<uint8_t>());
+                pass.extent.width = reader.get<uint32_t>();
+                pass.extent.height = reader.get<uint32_t>();
+                pass.name = reader.getString();
+            }
+        }
+    }
+
+    CaptureFile loadFrameCapture(const std::filesystem::path &path) {
+        MappedFile file(path);
+        ByteReader reader(file.getData());
+
+        if (reader.get<uint32_t>() != FrameCapture::kFileMagic) {
+            spdlog::error("{} is not a frame capture", path.string());
+            throw std::runtime_error("Not a frame capture");
+        }
+        if (auto version = reader.get<uint32_t>(); version != FrameCapture::kFileVersion) {
+            spdlog::error("{} is a version {} frame capture, expected version {}", path.string(), version, FrameCapture::kFileVersion);
+            throw std::runtime_error("Unsupported frame capture version");
+        }
+
+        CaptureFile capture;
+        CaptureHeader& header = capture.header;
+        header.format = static_cast<vk::Format>(reader.get<uint32_t>());
+        header.extent.width = reader.get<uint32_t>();
+        header.extent.height = reader.get<uint32_t>();
+        header.maxScale = reader.get<float>();
+        header.frameCount = reader.get<uint32_t>();
+        header.device = reader.getString();
+
+        CapturedFrame pending{};
+        while (!reader.atEnd()) {
+            auto type = reader.get<CaptureRecord>();
+            ByteReader record(reader.getBytes(reader.get<uint32_t>()));
+            if (type == CaptureRecord::eFrame) {
+                readFrame(record, pending);
+                capture.frames.push_back(std::move(pending));
+                pending = CapturedFrame{};
+            } else if (type >= CaptureRecord::eUpload && type <= CaptureRecord::eSceneView) {
+                pending.commands.push_back(readCommand(type, record));
+            }
+        }
+
+        if (capture.frames.size() != header.frameCount) {
+            spdlog::warn("{} holds {} frames, its header says {}", path.string(), capture.frames.size(), header.frameCount);
+        }
+        return capture;
+    }
+
+    FrameCapture::FrameCapture(App &app, const FrameCaptureConfig &config) : m_App(app), m_Config(config) {
+        m_Config.first_frame = std::max<uint64_t>(config.first_frame, 1);
+        // the window opens once the frame before it is rendered, or right away for the first frame
+        if (m_Config.first_frame == 1) {
+            open();
+        }
+        spdlog::info("Capturing {} frames from frame {} into {}", m_Config.frame_count, m_Config.first_frame, m_Config.path);
+    }
+
+    void FrameCapture::cleanup() {
+        std::lock_guard lock(m_Mutex);
+        if (m_Finished) {
+            return;
+        }
+        if (m_Frames == 0) {
+            spdlog::warn("App stopped before frame {}, no frames captured", m_Config.first_frame);
+        } else {
+            write();
+        }
+        m_Finished = true;
+    }
+
+    bool FrameCapture::isFinished() const {
+        std::lock_guard lock(m_Mutex);
+        return m_Finished;
+    }
+
+    uint32_t FrameCapture::addScene(const GpuScene *scene, const GpuSceneConfig &config) {
+        std::lock_guard lock(m_Mutex);
+        auto id = static_cast<uint32_t>(m_Scenes.size());
+        m_Scenes.push_back(SceneSnapshot{scene, config});
+        if (m_Open && !m_Finished) {
+            writeSceneCreate(m_Records, id, config);
+        }
+        return id;
+    }
+
+    void FrameCapture::addMesh(const GpuScene *scene, std::span<const SceneVertex> vertices, std::span<const uint32_t> indices, std::span<const GpuMeshLod> lods) {
+        std::lock_guard lock(m_Mutex);
+        uint32_t id = findScene(scene);
+        if (id == kNoScene || m_Finished) {
+            return;
+        }
+        // meshes only ever add up, so before the window they're kept encoded as they'll be written
+        RecordWriter record(m_Open ? m_Records : m_Scenes[id].meshes, CaptureRecord::eSceneMesh);
+        record.put(id);
+        record.putArray(vertices);
+        record.putArray(indices);
+        record.putArray(lods);
+    }
+
+    void FrameCapture::setInstances(const GpuScene *scene, bool add, uint32_t first, std::span<const GpuInstance> instances) {
+        std::lock_guard lock(m_Mutex);
+        uint32_t id = findScene(scene);
+        if (id == kNoScene || m_Finished) {
+            return;
+        }
+        if (m_Open) {
+            writeInstances(m_Records, id, add, first, instances);
+            return;
+        }
+        // before the window only the latest contents matter
+        std::vector<GpuInstance>& snapshot = m_Scenes[id].instances;
+        if (snapshot.size() < first + instances.size()) {
+            snapshot.resize(first + instances.size());
+        }
+        std::copy(instances.begin(), instances.end(), snapshot.begin() + first);
+    }
+
+    void FrameCapture::setView(const GpuScene *scene, const SceneView &view) {
+        std::lock_guard lock(m_Mutex);
+        uint32_t id = findScene(scene);
+        if (id == kNoScene || m_Finished) {
+            return;
+        }
+        if (m_Open) {
+            writeView(m_Records, id, view);
+        } else {
+            m_Scenes[id].view = view;
+        }
+    }
+
+    uint32_t FrameCapture::getSceneId(const GpuScene *scene) const {
+        std::lock_guard lock(m_Mutex);
+        return findScene(scene);
+    }
+
+    void FrameCapture::excludeBuffer(vk::Buffer buffer) {
+        std::lock_guard lock(m_Mutex);
+        m_ExcludedBuffers.push_back(buffer);
+    }
+
+    void FrameCapture::recordUpload(vk::Buffer buffer, vk::DeviceSize size) {
+        std::lock_guard lock(m_Mutex);
+        if (!m_Open || m_Finished) {
+            return;
+        }
+        if (buffer && std::find(m_ExcludedBuffers.begin(), m_ExcludedBuffers.end(), buffer) != m_ExcludedBuffers.end()) {
+            return;
+        }
+        RecordWriter record(m_Records, CaptureRecord::eUpload);
+        record.put(static_cast<uint8_t>(!buffer));
+        record.put(static_cast<uint64_t>(size));
+    }
+
+    void FrameCapture::recordFrame(const CapturedFrame &frame) {
+        std::lock_guard lock(m_Mutex);
+        if (m_Finished) {
+            return;
+        }
+        if (frame.number < m_Config.first_frame) {
+            if (frame.number + 1 >= m_Config.first_frame) {
+                open();
+            }
+            return;
+        }
+        if (!m_Open) {
+            open();
+        }
+
+        if (m_Frames == 0) {
+            m_Format = m_App.getSwapchainFormat();
+            m_Extent = m_App.getSwapchainExtent();
+            const ResolutionController& resolution = m_App.getClock().getResolutionController();
+            m_MaxScale = resolution.isEnabled() ? resolution.getConfig().max_scale : 0.0f;
+        }
+
+        RecordWriter record(m_Records, CaptureRecord::eFrame);
+        record.put(frame.number);
+        record.put(frame.cpuTime);
+        record.put(frame.resolutionScale);
+        record.put(frame.drawItems);
+        record.put(frame.scene);
+        record.put(static_cast<uint32_t>(frame.passes.size()));
+        for (const CapturedPass& pass : frame.passes) {
+            record.put(static_cast<uint8_t>(pass.type));
+            record.put(pass.extent.width);
+            record.put(pass.extent.height);
+            record.putString(pass.name);
+        }
+
+        if (++m_Frames == m_Config.frame_count) {
+            write();
+            m_Finished = true;
+        }
+    }
+
+    void FrameCapture::open() {
+        m_Open = true;
+        for (uint32_t id = 0; id < m_Scenes.size(); id++) {
+            SceneSnapshot& snapshot = m_Scenes[id];
+            writeSceneCreate(m_Records, id, snapshot.config);
+            m_Records.insert(m_Records.end(), snapshot.meshes.begin(), snapshot.meshes.end());
+            if (!snapshot.instances.empty()) {
+                writeInstances(m_Records, id, true, 0, snapshot.instances);
+            }
+            if (snapshot.view) {
+                writeView(m_Records, id, *snapshot.view);
+            }
+            snapshot.meshes = {};
+            snapshot.instances = {};
+        }
+    }
+
+    void FrameCapture::write() {
+        std::vector<std::byte> header;
+        ByteWriter writer(header);
+        writer.put(kFileMagic);
+        writer.put(kFileVersion);
+        writer.put(static_cast<uint32_t>(m_Format));
+        writer.put(m_Extent.width);
+        writer.put(m_Extent.height);
+        writer.put(m_MaxScale);
+        writer.put(m_Frames);
+        writer.putString(m_App.getEngine()->getGpuProperties().deviceName.data());
+
+        std::ofstream out{std::filesystem::path(m_Config.path), std::ios::binary | std::ios::trunc};
+        out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+        out.write(reinterpret_cast<const char*>(m_Records.data()), static_cast<std::streamsize>(m_Records.size()));
+        out.close();
+        if (!out) {
+            spdlog::error("Failed to write frame capture {}", m_Config.path);
+        } else {
+            spdlog::info("Captured {} frames into {} ({} KiB)", m_Frames, m_Config.path, (header.size() + m_Records.size()) / 1024);
+        }
+
+        m_Records = {};
+        m_ExcludedBuffers = {};
+    }
+
+    uint32_t FrameCapture::findScene(const GpuScene *scene) const {
+        // the latest scene at that address, an earlier one may have been destroyed
+        for (size_t i = m_Scenes.size(); i-- > 0;) {
+            if (m_Scenes[i].scene == scene) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        return kNoScene;
+    }
+}
@@ -0,0 +1,656 @@
+#include "kat/GpuAllocator.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <bit>
+
+namespace kat {
+
+    namespace {
+        constexpr uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        size_t kindIndex(ResourceKind kind) {
+            return kind == ResourceKind::eLinear ? 0 : 1;
+        }
+
+        size_t strategyIndex(AllocationStrategy strategy) {
+            return strategy == AllocationStrategy::eGeneral ? 0 : 1;
+        }
+
+        // resources bigger than this fraction of a block get their own vkAllocateMemory
+        constexpr vk::DeviceSize kDedicatedDivisor = 2;
+
+        // warn once this much of maxMemoryAllocationCount is in use
+        constexpr double kMemoryCountWarnRatio = 0.75;
+    }
+
+    TlsfAllocator::TlsfAllocator(uint64_t size) : m_Size(size / kGranularity * kGranularity) {
+        for (auto& heads : m_FreeHeads) {
+            heads.fill(kInvalidNode);
+        }
+
+        if (m_Size == 0) {
+            return;
+        }
+
+        uint32_t node = createNode();
+        m_Nodes[node].offset = 0;
+        m_Nodes[node].size = m_Size;
+        insertFree(node);
+    }
+
+    uint64_t TlsfAllocator::getRequiredSize(uint64_t size, uint64_t alignment) {
+        size = alignUp(std::max<uint64_t>(size, 1), kGranularity);
+        alignment = std::max(alignment, kGranularity);
+
+        // the same rounding as allocate() and findFree(); the only free range then sits in the bucket searched
+        uint64_t units = (size + (alignment - kGranularity)) / kGranularity;
+        if (units >= kSecondLevelCount) {
+            uint32_t log2 = static_cast<uint32_t>(std::bit_width(units)) - 1;
+            units += (1ULL << (log2 - kSecondLevelLog2)) - 1;
+        }
+        return units * kGranularity;
+    }
+
+    std::optional<TlsfAllocator::Allocation> TlsfAllocator::allocate(uint64_t size, uint64_t alignment) {
+        size = alignUp(std::max<uint64_t>(size, 1), kGranularity);
+        alignment = std::max(alignment, kGranularity);
+
+        // any free range this large can fit an aligned allocation
+        uint64_t request = size + (alignment - kGranularity);
+        uint32_t node = findFree(request / kGranularity);
+        if (node == kInvalidNode) {
+            return std::nullopt;
+        }
+        removeFree(node);
+
+        uint64_t padding = alignUp(m_Nodes[node].offset, alignment) - m_Nodes[node].offset;
+        if (padding > 0) {
+            // give the padding back as its own free range, its physical predecessor is never free
+            uint32_t front = createNode();
+            Node& n = m_Nodes[node];
+            Node& f = m_Nodes[front];
+            f.offset = n.offset;
+            f.size = padding;
+            f.prevPhysical = n.prevPhysical;
+            f.nextPhysical = node;
+            if (f.prevPhysical != kInvalidNode) {
+                m_Nodes[f.prevPhysical].nextPhysical = front;
+            }
+            n.prevPhysical = front;
+            n.offset += padding;
+            n.size -= padding;
+            insertFree(front);
+        }
+
+        split(node, size / kGranularity);
+
+        m_Nodes[node].free = false;
+        m_Used += m_Nodes[node].size;
+        return Allocation{m_Nodes[node].offset, node};
+    }
+
+    void TlsfAllocator::free(uint32_t node) {
+        m_Used -= m_Nodes[node].size;
+
+        uint32_t prev = m_Nodes[node].prevPhysical;
+        if (prev != kInvalidNode && m_Nodes[prev].free) {
+            removeFree(prev);
+            m_Nodes[prev].size += m_Nodes[node].size;
+            m_Nodes[prev].nextPhysical = m_Nodes[node].nextPhysical;
+            if (m_Nodes[prev].nextPhysical != kInvalidNode) {
+                m_Nodes[m_Nodes[prev].nextPhysical].prevPhysical = prev;
+            }
+            releaseNode(node);
+            node = prev;
+        }
+
+        uint32_t next = m_Nodes[node].nextPhysical;
+        if (next != kInvalidNode && m_Nodes[next].free) {
+            removeFree(next);
+            m_Nodes[node].size += m_Nodes[next].size;
+            m_Nodes[node].nextPhysical = m_Nodes[next].nextPhysical;
+            if (m_Nodes[node].nextPhysical != kInvalidNode) {
+                m_Nodes[m_Nodes[node].nextPhysical].prevPhysical = node;
+            }
+            releaseNode(next);
+        }
+
+        insertFree(node);
+    }
+
+    uint64_t TlsfAllocator::getSize() const noexcept {
+        return m_Size;
+    }
+
+    uint64_t TlsfAllocator::getUsed() const noexcept {
+        return m_Used;
+    }
+
+    uint64_t TlsfAllocator::getLargestFreeRange() const noexcept {
+        if (m_FirstLevelBitmap == 0) {
+            return 0;
+        }
+
+        uint32_t fl = 63 - std::countl_zero(m_FirstLevelBitmap);
+        uint32_t sl = 31 - std::countl_zero(m_SecondLevelBitmaps[fl]);
+
+        // ranges in the top bucket differ in size, so walk it
+        uint64_t largest = 0;
+        for (uint32_t node = m_FreeHeads[fl][sl]; node != kInvalidNode; node = m_Nodes[node].nextFree) {
+            largest = std::max(largest, m_Nodes[node].size);
+        }
+        return largest;
+    }
+
+    bool TlsfAllocator::isEmpty() const noexcept {
+        return m_Used == 0;
+    }
+
+    void TlsfAllocator::mapping(uint64_t units, uint32_t &fl, uint32_t &sl) {
+        if (units < kSecondLevelCount) {
+            fl = 0;
+            sl = static_cast<uint32_t>(units);
+            return;
+        }
+
+        uint32_t log2 = static_cast<uint32_t>(std::bit_width(units)) - 1;
+        fl = log2 - kSecondLevelLog2 + 1;
+        sl = static_cast<uint32_t>(units >> (log2 - kSecondLevelLog2)) - kSecondLevelCount;
+    }
+
+    uint32_t TlsfAllocator::createNode() {
+        if (!m_UnusedNodes.empty()) {
+            uint32_t node = m_UnusedNodes.back();
+            m_UnusedNodes.pop_back();
+            m_Nodes[node] = Node{};
+            return node;
+        }
+
+        m_Nodes.emplace_back();
+        return static_cast<uint32_t>(m_Nodes.size() - 1);
+    }
+
+    void TlsfAllocator::releaseNode(uint32_t node) {
+        m_UnusedNodes.push_back(node);
+    }
+
+    void TlsfAllocator::insertFree(uint32_t node) {
+        uint32_t fl, sl;
+        mapping(m_Nodes[node].size / kGranularity, fl, sl);
+
+        Node& n = m_Nodes[node];
+        n.free = true;
+        n.prevFree = kInvalidNode;
+        n.nextFree = m_FreeHeads[fl][sl];
+        if (n.nextFree != kInvalidNode) {
+            m_Nodes[n.nextFree].prevFree = node;
+        }
+        m_FreeHeads[fl][sl] = node;
+
+        m_FirstLevelBitmap |= 1ULL << fl;
+        m_SecondLevelBitmaps[fl] |= 1U << sl;
+    }
+
+    void TlsfAllocator::removeFree(uint32_t node) {
+        uint32_t fl, sl;
+        mapping(m_Nodes[node].size / kGranularity, fl, sl);
+
+        Node& n = m_Nodes[node];
+        if (n.prevFree != kInvalidNode) {
+            m_Nodes[n.prevFree].nextFree = n.nextFree;
+        } else {
+            m_FreeHeads[fl][sl] = n.nextFree;
+        }
+        if (n.nextFree != kInvalidNode) {
+            m_Nodes[n.nextFree].prevFree = n.prevFree;
+        }
+        n.prevFree = kInvalidNode;
+        n.nextFree = kInvalidNode;
+        n.free = false;
+
+        if (m_FreeHeads[fl][sl] == kInvalidNode) {
+            m_SecondLevelBitmaps[fl] &= ~(1U << sl);
+            if (m_SecondLevelBitmaps[fl] == 0) {
+                m_FirstLevelBitmap &= ~(1ULL << fl);
+            }
+        }
+    }
+
+    uint32_t TlsfAllocator::findFree(uint64_t units) {
+        // round up to the next bucket boundary so every range in the bucket found is large enough
+        if (units >= kSecondLevelCount) {
+            uint32_t log2 = static_cast<uint32_t>(std::bit_width(units)) - 1;
+            units += (1ULL << (log2 - kSecondLevelLog2)) - 1;
+        }
+
+        uint32_t fl, sl;
+        mapping(units, fl, sl);
+        if (fl >= kFirstLevelCount) {
+            return kInvalidNode;
+        }
+
+        uint32_t slMap = m_SecondLevelBitmaps[fl] & (~0U << sl);
+        if (slMap == 0) {
+            uint64_t flMap = fl + 1 < 64 ? m_FirstLevelBitmap & (~0ULL << (fl + 1)) : 0;
+            if (flMap == 0) {
+                return kInvalidNode;
+            }
+            fl = static_cast<uint32_t>(std::countr_zero(flMap));
+            slMap = m_SecondLevelBitmaps[fl];
+        }
+        sl = static_cast<uint32_t>(std::countr_zero(slMap));
+
+        return m_FreeHeads[fl][sl];
+    }
+
+    void TlsfAllocator::split(uint32_t node, uint64_t units) {
+        uint64_t size = units * kGranularity;
+        if (m_Nodes[node].size - size < kGranularity) {
+            return;
+        }
+
+        uint32_t back = createNode();
+        Node& n = m_Nodes[node];
+        Node& b = m_Nodes[back];
+        b.offset = n.offset + size;
+        b.size = n.size - size;
+        b.prevPhysical = node;
+        b.nextPhysical = n.nextPhysical;
+        if (b.nextPhysical != kInvalidNode) {
+            m_Nodes[b.nextPhysical].prevPhysical = back;
+        }
+        n.nextPhysical = back;
+        n.size = size;
+        insertFree(back);
+    }
+
+    DeviceAllocator::DeviceAllocator(vk::PhysicalDevice gpu, vk::Device device, vk::DeviceSize blockSize)
+        : m_Device(device), m_MemoryProperties(gpu.getMemoryProperties()), m_BlockSize(blockSize),
+          m_MaxMemoryAllocations(gpu.getProperties().limits.maxMemoryAllocationCount) {
+    }
+
+    DeviceAllocator::~DeviceAllocator() {
+        if (m_LiveAllocations != 0) {
+            spdlog::warn("Destroying the device allocator with {} live allocations", m_LiveAllocations);
+        }
+
+        for (auto& pool : m_Pools) {
+            for (auto& block : pool.blocks) {
+                m_Device.freeMemory(block->memory);
+            }
+        }
+    }
+
+    GpuAllocation *DeviceAllocator::allocate(const vk::MemoryRequirements &requirements, ResourceKind kind, const AllocationDesc &desc) {
+        std::lock_guard lock(m_Mutex);
+
+        std::optional<uint32_t> memoryType = findMemoryType(requirements.memoryTypeBits, desc);
+        if (!memoryType.has_value()) {
+            spdlog::error("Failed to find a suitable memory type");
+            throw std::runtime_error("Failed to find a suitable memory type");
+        }
+
+        // small heaps (e.g. 256MB BAR) would be eaten by a few default-sized blocks
+        vk::DeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryType.value()].heapIndex].size;
+        vk::DeviceSize blockSize = std::min(m_BlockSize, std::max<vk::DeviceSize>(heapSize / 8, TlsfAllocator::kGranularity));
+
+        Pool& pool = getPool(memoryType.value(), kind, desc.strategy);
+        GpuAllocation* allocation = newAllocation();
+        allocation->alignment = requirements.alignment;
+        allocation->movable = desc.movable;
+
+        bool allocated = false;
+        if (requirements.size > blockSize / kDedicatedDivisor) {
+            vk::DeviceSize size = desc.strategy == AllocationStrategy::eGeneral
+                                  ? TlsfAllocator::getRequiredSize(requirements.size, requirements.alignment)
+                                  : requirements.size;
+            MemoryBlock* block = createBlock(pool, memoryType.value(), size, kind, desc.strategy);
+            block->dedicated = true;
+            allocated = allocateFromBlock(*block, requirements, *allocation);
+            if (!allocated) {
+                releaseEmptyBlocks(pool, SIZE_MAX);
+            }
+        } else {
+            if (pool.lastUsedBlock < pool.blocks.size()) {
+                allocated = allocateFromBlock(*pool.blocks[pool.lastUsedBlock], requirements, *allocation);
+            }
+
+            for (size_t i = 0; i < pool.blocks.size() && !allocated; i++) {
+                if (i != pool.lastUsedBlock && !pool.blocks[i]->dedicated) {
+                    allocated = allocateFromBlock(*pool.blocks[i], requirements, *allocation);
+                    if (allocated) {
+                        pool.lastUsedBlock = i;
+                    }
+                }
+            }
+
+            if (!allocated) {
+                createBlock(pool, memoryType.value(), blockSize, kind, desc.strategy);
+                pool.lastUsedBlock = pool.blocks.size() - 1;
+                allocated = allocateFromBlock(*pool.blocks.back(), requirements, *allocation);
+            }
+        }
+
+        if (!allocated) {
+            recycle(allocation);
+            spdlog::error("Failed to allocate {} bytes of device memory", requirements.size);
+            throw std::runtime_error("Failed to allocate device memory");
+        }
+
+        attach(*allocation->block, allocation);
+        m_LiveAllocations++;
+        return allocation;
+    }
+
+    void DeviceAllocator::free(GpuAllocation *allocation) {
+        if (!allocation) {
+            return;
+        }
+
+        std::lock_guard lock(m_Mutex);
+
+        // the range a pending defragmentation reserved for it goes too
+        for (size_t i = 0; i < m_PendingMoves.size(); i++) {
+            if (m_PendingMoves[i].allocation == allocation) {
+                m_PendingDestinations[i].block->tlsf->free(m_PendingDestinations[i].node);
+                m_PendingMoves.erase(m_PendingMoves.begin() + static_cast<ptrdiff_t>(i));
+                m_PendingDestinations.erase(m_PendingDestinations.begin() + static_cast<ptrdiff_t>(i));
+                break;
+            }
+        }
+
+        MemoryBlock* block = allocation->block;
+        // a linear block only gets its range back with resetLinear()
+        if (block->strategy == AllocationStrategy::eGeneral) {
+            block->tlsf->free(allocation->node);
+        }
+        detach(allocation);
+        recycle(allocation);
+        m_LiveAllocations--;
+
+        if (block->allocations.empty()) {
+            Pool& pool = getPool(block->memoryType, block->kind, block->strategy);
+            releaseEmptyBlocks(pool, block->strategy == AllocationStrategy::eGeneral ? 1 : SIZE_MAX);
+        }
+    }
+
+    void DeviceAllocator::resetLinear() {
+        std::lock_guard lock(m_Mutex);
+
+        for (size_t i = 0; i < m_Pools.size(); i++) {
+            if (i % kStrategies != strategyIndex(AllocationStrategy::eLinear)) {
+                continue;
+            }
+
+            for (auto& block : m_Pools[i].blocks) {
+                for (GpuAllocation* allocation : block->allocations) {
+                    recycle(allocation);
+                    m_LiveAllocations--;
+                }
+                block->allocations.clear();
+                block->linearOffset = 0;
+            }
+            // keeps the shared blocks for the next frame, dedicated ones go
+            releaseEmptyBlocks(m_Pools[i], SIZE_MAX);
+        }
+    }
+
+    AllocatedBuffer DeviceAllocator::createBuffer(const vk::BufferCreateInfo &createInfo, const AllocationDesc &desc) {
+        AllocatedBuffer result{};
+        result.buffer = m_Device.createBuffer(createInfo);
+        result.allocation = allocate(m_Device.getBufferMemoryRequirements(result.buffer), ResourceKind::eLinear, desc);
+        m_Device.bindBufferMemory(result.buffer, result.allocation->memory, result.allocation->offset);
+        return result;
+    }
+
+    AllocatedImage DeviceAllocator::createImage(const vk::ImageCreateInfo &createInfo, const AllocationDesc &desc) {
+        ResourceKind kind = createInfo.tiling == vk::ImageTiling::eLinear ? ResourceKind::eLinear : ResourceKind::eOptimalImage;
+
+        AllocatedImage result{};
+        result.image = m_Device.createImage(createInfo);
+        result.allocation = allocate(m_Device.getImageMemoryRequirements(result.image), kind, desc);
+        m_Device.bindImageMemory(result.image, result.allocation->memory, result.allocation->offset);
+        return result;
+    }
+
+    void DeviceAllocator::destroyBuffer(AllocatedBuffer &buffer) {
+        m_Device.destroyBuffer(buffer.buffer);
+        free(buffer.allocation);
+        buffer = {};
+    }
+
+    void DeviceAllocator::destroyImage(AllocatedImage &image) {
+        m_Device.destroyImage(image.image);
+        free(image.allocation);
+        image = {};
+    }
+
+    std::vector<DefragmentationMove> DeviceAllocator::beginDefragmentation(size_t maxMoves) {
+        std::lock_guard lock(m_Mutex);
+
+        // starting over would leak the ranges reserved for the moves in flight
+        if (!m_PendingMoves.empty()) {
+            spdlog::error("Defragmentation begun with {} moves of the previous one pending", m_PendingMoves.size());
+            throw std::runtime_error("Nested defragmentation");
+        }
+        m_PendingDestinations.reserve(maxMoves);
+
+        for (size_t i = 0; i < m_Pools.size() && m_PendingMoves.size() < maxMoves; i++) {
+            if (i % kStrategies != strategyIndex(AllocationStrategy::eGeneral)) {
+                continue;
+            }
+
+            Pool& pool = m_Pools[i];
+            if (pool.blocks.size() < 2) {
+                continue;
+            }
+
+            // empty the least used block into the others
+            MemoryBlock* source = nullptr;
+            for (auto& block : pool.blocks) {
+                if (!block->dedicated && !block->allocations.empty() && (!source || block->tlsf->getUsed() < source->tlsf->getUsed())) {
+                    source = block.get();
+                }
+            }
+            if (!source) {
+                continue;
+            }
+
+            for (GpuAllocation* allocation : source->allocations) {
+                if (m_PendingMoves.size() >= maxMoves) {
+                    break;
+                }
+                if (!allocation->movable) {
+                    continue;
+                }
+
+                vk::MemoryRequirements requirements{allocation->size, allocation->alignment, 1U << allocation->memoryType};
+                GpuAllocation destination{};
+                for (auto& block : pool.blocks) {
+                    if (block.get() != source && !block->dedicated && allocateFromBlock(*block, requirements, destination)) {
+                        m_PendingMoves.push_back(DefragmentationMove{
+                            allocation, allocation->memory, allocation->offset, destination.memory, destination.offset, allocation->size
+                        });
+                        m_PendingDestinations.push_back(destination);
+                        break;
+                    }
+                }
+            }
+        }
+
+        return m_PendingMoves;
+    }
+
+    void DeviceAllocator::endDefragmentation() {
+        std::lock_guard lock(m_Mutex);
+
+        for (size_t i = 0; i < m_PendingMoves.size(); i++) {
+            GpuAllocation* allocation = m_PendingMoves[i].allocation;
+            const GpuAllocation& destination = m_PendingDestinations[i];
+
+            allocation->block->tlsf->free(allocation->node);
+            detach(allocation);
+
+            allocation->memory = destination.memory;
+            allocation->offset = destination.offset;
+            allocation->mapped = destination.mapped;
+            allocation->node = destination.node;
+            allocation->block = destination.block;
+            attach(*allocation->block, allocation);
+        }
+
+        if (!m_PendingMoves.empty()) {
+            spdlog::info("Defragmentation moved {} allocations", m_PendingMoves.size());
+            for (size_t i = 0; i < m_Pools.size(); i += kStrategies) {
+                releaseEmptyBlocks(m_Pools[i + strategyIndex(AllocationStrategy::eGeneral)], 1);
+            }
+        }
+
+        m_PendingMoves.clear();
+        m_PendingDestinations.clear();
+    }
+
+    GpuMemoryStats DeviceAllocator::getStats() {
+        std::lock_guard lock(m_Mutex);
+
+        GpuMemoryStats stats{};
+        stats.deviceMemoryCount = m_DeviceMemoryCount;
+        stats.allocationCount = m_LiveAllocations;
+        for (const auto& pool : m_Pools) {
+            for (const auto& block : pool.blocks) {
+                stats.reservedBytes += block->size;
+                stats.usedBytes += block->tlsf.has_value() ? block->tlsf->getUsed() : block->linearOffset;
+            }
+        }
+        return stats;
+    }
+
+    void DeviceAllocator::logStats() {
+        GpuMemoryStats stats = getStats();
+        spdlog::info("GPU memory: {} allocations in {} device memory objects (limit {}), {:.1f} / {:.1f} MiB used",
+                     stats.allocationCount, stats.deviceMemoryCount, m_MaxMemoryAllocations,
+                     static_cast<double>(stats.usedBytes) / (1024.0 * 1024.0), static_cast<double>(stats.reservedBytes) / (1024.0 * 1024.0));
+    }
+
+    DeviceAllocator::Pool &DeviceAllocator::getPool(uint32_t memoryType, ResourceKind kind, AllocationStrategy strategy) {
+        return m_Pools[(memoryType * kResourceKinds + kindIndex(kind)) * kStrategies + strategyIndex(strategy)];
+    }
+
+    std::optional<uint32_t> DeviceAllocator::findMemoryType(uint32_t typeBits, const AllocationDesc &desc) const {
+        auto find = [&](vk::MemoryPropertyFlags properties) -> std::optional<uint32_t> {
+            for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++) {
+                if ((typeBits & (1U << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                    return i;
+                }
+            }
+            return std::nullopt;
+        };
+
+        std::optional<uint32_t> memoryType = find(desc.required | desc.preferred);
+        return memoryType.has_value() ? memoryType : find(desc.required);
+    }
+
+    MemoryBlock *DeviceAllocator::createBlock(Pool &pool, uint32_t memoryType, vk::DeviceSize size, ResourceKind kind, AllocationStrategy strategy) {
+        if (m_DeviceMemoryCount >= m_MaxMemoryAllocations) {
+            spdlog::error("Reached maxMemoryAllocationCount ({})", m_MaxMemoryAllocations);
+            throw std::runtime_error("Too many device memory allocations");
+        }
+        if (m_DeviceMemoryCount + 1 == static_cast<size_t>(m_MaxMemoryAllocations * kMemoryCountWarnRatio)) {
+            spdlog::warn("{} of {} device memory allocations in use", m_DeviceMemoryCount + 1, m_MaxMemoryAllocations);
+        }
+
+        size = alignUp(size, TlsfAllocator::kGranularity);
+
+        auto block = std::make_unique<MemoryBlock>();
+        block->memory = m_Device.allocateMemory(vk::MemoryAllocateInfo{size, memoryType});
+        block->size = size;
+        block->memoryType = memoryType;
+        block->kind = kind;
+        block->strategy = strategy;
+        if (strategy == AllocationStrategy::eGeneral) {
+            block->tlsf.emplace(size);
+        }
+        if (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+            block->mapped = m_Device.mapMemory(block->memory, 0, VK_WHOLE_SIZE);
+        }
+
+        m_DeviceMemoryCount++;
+        pool.blocks.push_back(std::move(block));
+        return pool.blocks.back().get();
+    }
+
+    bool DeviceAllocator::allocateFromBlock(MemoryBlock &block, const vk::MemoryRequirements &requirements, GpuAllocation &out) {
+        vk::DeviceSize offset;
+        uint32_t node = TlsfAllocator::kInvalidNode;
+
+        if (block.strategy == AllocationStrategy::eGeneral) {
+            std::optional<TlsfAllocator::Allocation> range = block.tlsf->allocate(requirements.size, requirements.alignment);
+            if (!range.has_value()) {
+                return false;
+            }
+            offset = range->offset;
+            node = range->node;
+        } else {
+            offset = alignUp(block.linearOffset, std::max<vk::DeviceSize>(requirements.alignment, 1));
+            if (offset + requirements.size > block.size) {
+                return false;
+            }
+            block.linearOffset = offset + requirements.size;
+        }
+
+        out.memory = block.memory;
+        out.offset = offset;
+        out.size = requirements.size;
+        out.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+        out.memoryType = block.memoryType;
+        out.block = &block;
+        out.node = node;
+        return true;
+    }
+
+    void DeviceAllocator::attach(MemoryBlock &block, GpuAllocation *allocation) {
+        allocation->block = &block;
+        allocation->indexInBlock = block.allocations.size();
+        block.allocations.push_back(allocation);
+    }
+
+    void DeviceAllocator::detach(GpuAllocation *allocation) {
+        auto& allocations = allocation->block->allocations;
+        GpuAllocation* last = allocations.back();
+        allocations[allocation->indexInBlock] = last;
+        last->indexInBlock = allocation->indexInBlock;
+        allocations.pop_back();
+    }
+
+    GpuAllocation *DeviceAllocator::newAllocation() {
+        if (!m_FreeAllocations.empty()) {
+            GpuAllocation* allocation = m_FreeAllocations.back();
+            m_FreeAllocations.pop_back();
+            return allocation;
+        }
+        return &m_AllocationStorage.emplace_back();
+    }
+
+    void DeviceAllocator::recycle(GpuAllocation *allocation) {
+        *allocation = GpuAllocation{};
+        m_FreeAllocations.push_back(allocation);
+    }
+
+    void DeviceAllocator::releaseEmptyBlocks(Pool &pool, size_t keepEmpty) {
+        size_t kept = 0;
+        std::erase_if(pool.blocks, [&](const std::unique_ptr<MemoryBlock>& block) {
+            // a pending defragmentation may have reserved ranges that have no allocation attached yet
+            bool empty = block->allocations.empty() && (!block->tlsf.has_value() || block->tlsf->isEmpty());
+            if (!empty || (!block->dedicated && kept++ < keepEmpty)) {
+                return false;
+            }
+            m_Device.freeMemory(block->memory);
+            m_DeviceMemoryCount--;
+            return true;
+        });
+        pool.lastUsedBlock = 0;
+    }
+}
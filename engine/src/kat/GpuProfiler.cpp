@@ -0,0 +1,175 @@
+#include "kat/GpuProfiler.h"
+
+#include <spdlog/spdlog.h>
+#include <cstring>
+
+namespace kat {
+
+    GpuProfiler::GpuProfiler(std::shared_ptr<App> app, size_t framesInFlight) : m_App(app) {
+        uint32_t validBits = m_App->getQueueFamilyProperties(m_App->getGraphicsFamily()).timestampValidBits;
+        m_Supported = validBits != 0;
+        m_TimestampPeriod = m_App->getEngine()->getGpuProperties().limits.timestampPeriod;
+        m_TimestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t{1} << validBits) - 1;
+
+        if (!m_Supported) {
+            spdlog::warn("Graphics queue does not support timestamps, GPU profiling is disabled");
+            return;
+        }
+
+        m_Frames.resize(framesInFlight);
+        for (auto& frame : m_Frames) {
+            frame.pool = m_App->getDevice().createQueryPool(vk::QueryPoolCreateInfo{
+                vk::QueryPoolCreateFlags(), vk::QueryType::eTimestamp, kMaxScopesPerFrame * 2
+            });
+        }
+
+        m_Timings.reserve(kMaxScopesPerFrame);
+    }
+
+    void GpuProfiler::cleanup() {
+        for (auto& frame : m_Frames) {
+            m_App->getDevice().destroyQueryPool(frame.pool);
+        }
+        m_Frames.clear();
+    }
+
+    bool GpuProfiler::isSupported() const noexcept {
+        return m_Supported;
+    }
+
+    void GpuProfiler::beginFrame(vk::CommandBuffer commandBuffer, size_t frameIndex) {
+        if (!m_Supported) {
+            return;
+        }
+
+        m_CurrentFrame = frameIndex;
+        m_OpenScopeCount = 0;
+
+        FrameQueries& frame = m_Frames[frameIndex];
+        m_CollectedFrameTime.reset();
+        collect(frame);
+
+        commandBuffer.resetQueryPool(frame.pool, 0, kMaxScopesPerFrame * 2);
+    }
+
+    uint32_t GpuProfiler::beginScope(vk::CommandBuffer commandBuffer, const char* name) {
+        if (!m_Supported) {
+            return kInvalidScope;
+        }
+
+        FrameQueries& frame = m_Frames[m_CurrentFrame];
+        if (frame.scopeCount >= kMaxScopesPerFrame || m_OpenScopeCount >= kMaxScopeDepth) {
+            return kInvalidScope;
+        }
+
+        uint32_t scope = frame.scopeCount++;
+        frame.scopes[scope] = ScopeRecord{findTimings(name, m_OpenScopeCount), scope * 2, false};
+        m_OpenScopes[m_OpenScopeCount++] = scope;
+
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.pool, scope * 2);
+        return scope;
+    }
+
+    void GpuProfiler::endScope(vk::CommandBuffer commandBuffer, uint32_t scope) {
+        if (scope == kInvalidScope) {
+            return;
+        }
+
+        if (m_OpenScopeCount == 0 || m_OpenScopes[m_OpenScopeCount - 1] != scope) {
+            spdlog::error("GPU profiler scopes must be closed in the reverse order they were opened");
+            throw std::runtime_error("Mismatched GPU profiler scope");
+        }
+        m_OpenScopeCount--;
+
+        FrameQueries& frame = m_Frames[m_CurrentFrame];
+        frame.scopes[scope].closed = true;
+
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, frame.pool, scope * 2 + 1);
+    }
+
+    FrameStats GpuProfiler::getScopeStats(std::string_view name) const {
+        for (const auto& timings : m_Timings) {
+            if (name == timings->name) {
+                return timings->times.getStats();
+            }
+        }
+        return FrameStats{};
+    }
+
+    void GpuProfiler::forEachScope(const std::function<void(std::string_view, uint32_t, const FrameTimeHistogram &)> &fn) const {
+        for (const auto& timings : m_Timings) {
+            fn(timings->name, timings->depth, timings->times);
+        }
+    }
+
+    void GpuProfiler::resetStats() {
+        // pending frames would otherwise add their times at their next beginFrame()
+        for (FrameQueries& frame : m_Frames) {
+            frame.scopeCount = 0;
+        }
+        for (const auto& timings : m_Timings) {
+            timings->times.reset();
+        }
+        m_CollectedFrameTime.reset();
+    }
+
+    std::optional<double> GpuProfiler::getCollectedFrameTime() const noexcept {
+        return m_CollectedFrameTime;
+    }
+
+    void GpuProfiler::collect(FrameQueries &frame) {
+        if (frame.scopeCount == 0) {
+            return;
+        }
+
+        std::array<uint64_t, kMaxScopesPerFrame * 2> ticks{};
+        vk::Result result = m_App->getDevice().getQueryPoolResults(
+            frame.pool, 0, frame.scopeCount * 2,
+            frame.scopeCount * 2 * sizeof(uint64_t), ticks.data(), sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64
+        );
+
+        // never stall on the GPU; a frame that is not ready yet is simply dropped
+        if (result == vk::Result::eSuccess) {
+            double frameTime = 0.0;
+            for (uint32_t i = 0; i < frame.scopeCount; i++) {
+                const ScopeRecord& record = frame.scopes[i];
+                if (!record.closed) {
+                    continue;
+                }
+
+                uint64_t delta = (ticks[record.query + 1] - ticks[record.query]) & m_TimestampMask;
+                double seconds = static_cast<double>(delta) * m_TimestampPeriod * 1e-9;
+                ScopeTimings& timings = *m_Timings[record.timings];
+                timings.times.record(seconds);
+                if (timings.depth == 0) {
+                    frameTime += seconds;
+                }
+            }
+            m_CollectedFrameTime = frameTime;
+        }
+
+        frame.scopeCount = 0;
+    }
+
+    uint32_t GpuProfiler::findTimings(const char *name, uint32_t depth) {
+        for (uint32_t i = 0; i < m_Timings.size(); i++) {
+            if (m_Timings[i]->name == name || std::strcmp(m_Timings[i]->name, name) == 0) {
+                return i;
+            }
+        }
+
+        auto& timings = m_Timings.emplace_back(std::make_unique<ScopeTimings>());
+        timings->name = name;
+        timings->depth = depth;
+        return static_cast<uint32_t>(m_Timings.size() - 1);
+    }
+
+    GpuScope::GpuScope(GpuProfiler &profiler, vk::CommandBuffer commandBuffer, const char *name)
+        : m_Profiler(profiler), m_CommandBuffer(commandBuffer), m_Scope(profiler.beginScope(commandBuffer, name)) {
+    }
+
+    GpuScope::~GpuScope() {
+        m_Profiler.endScope(m_CommandBuffer, m_Scope);
+    }
+}
@@ -0,0 +1,400 @@
+#include "kat/GpuScene.h"
+#include "kat/FrameCapture.h"
+#include "kat/PipelineCache.h"
+#include "kat/SimdMath.h"
+#include "kat/UploadService.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace kat {
+
+    namespace {
+        // SPIR-V compiled from engine/shaders at build time
+        constexpr uint32_t kCullShader[] = {
+#include "cull.comp.inc"
+        };
+        constexpr uint32_t kSceneVertexShader[] = {
+#include "scene.vert.inc"
+        };
+        constexpr uint32_t kSceneFragmentShader[] = {
+#include "scene.frag.inc"
+        };
+
+        constexpr uint32_t kCullGroupSize = 64;
+
+        vk::ShaderModule createShaderModule(vk::Device device, std::span<const uint32_t> code) {
+            return device.createShaderModule(vk::ShaderModuleCreateInfo{vk::ShaderModuleCreateFlags(), code.size_bytes(), code.data()});
+        }
+    }
+
+    GpuScene::GpuScene(App &app, const GpuSceneConfig &config)
+        : m_App(app), m_Device(app.getDevice()), m_Bindless(app.getBindlessRegistry()), m_Config(config) {
+        const vk::PhysicalDeviceFeatures& features = app.getEngine()->getGpuFeatures();
+        if (!features.drawIndirectFirstInstance) {
+            spdlog::error("ERROR: GPU DOES NOT SUPPORT INDIRECT DRAWS WITH A FIRST INSTANCE");
+            throw std::runtime_error("Unsupported device feature requested");
+        }
+
+        m_Compact = app.getEngine()->getGpuFeatures12().drawIndirectCount;
+        m_MultiDraw = features.multiDrawIndirect;
+
+        uint32_t maxDrawCount = app.getEngine()->getGpuProperties().limits.maxDrawIndirectCount;
+        if (m_MultiDraw && m_Config.max_instances > maxDrawCount) {
+            spdlog::warn("GPU scene limited to {} instances by maxDrawIndirectCount", maxDrawCount);
+            m_Config.max_instances = maxDrawCount;
+        }
+
+        m_Vertices = createBuffer(sizeof(SceneVertex) * m_Config.max_vertices, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        m_Indices = createBuffer(sizeof(uint32_t) * m_Config.max_indices, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        m_Meshes = createBuffer(sizeof(GpuMesh) * m_Config.max_meshes, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        m_Instances = createBuffer(sizeof(GpuInstance) * m_Config.max_instances, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst);
+        m_Draws = createBuffer(sizeof(vk::DrawIndexedIndirectCommand) * m_Config.max_instances, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer);
+        m_Count = createBuffer(sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst);
+
+        m_MeshBinding = m_Bindless.registerBuffer(m_Meshes.buffer);
+        m_InstanceBinding = m_Bindless.registerBuffer(m_Instances.buffer);
+        m_DrawBinding = m_Bindless.registerBuffer(m_Draws.buffer);
+        m_CountBinding = m_Bindless.registerBuffer(m_Count.buffer);
+
+        AllocationDesc viewDesc{};
+        viewDesc.required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        for (uint32_t i = 0; i < app.getFramesInFlight(); i++) {
+            m_Views.push_back(createBuffer(sizeof(GpuView), vk::BufferUsageFlagBits::eStorageBuffer, viewDesc));
+            m_ViewBindings.push_back(m_Bindless.registerBuffer(m_Views.back().buffer));
+        }
+        m_InstanceStaging.resize(app.getFramesInFlight());
+
+        createCullPipeline();
+
+        // a capture follows the scene through its own records rather than the uploads they turn into
+        if (FrameCapture* capture = app.getFrameCapture()) {
+            capture->addScene(this, m_Config);
+            for (const AllocatedBuffer* buffer : {&m_Vertices, &m_Indices, &m_Meshes, &m_Instances}) {
+                capture->excludeBuffer(buffer->buffer);
+            }
+        }
+
+        spdlog::info("Created GPU scene for up to {} instances, drawn with {}", m_Config.max_instances,
+                     m_Compact ? "vkCmdDrawIndexedIndirectCount" : m_MultiDraw ? "multi draw indirect" : "single indirect draws");
+    }
+
+    void GpuScene::cleanup() {
+        m_Device.destroyPipeline(m_CullPipeline);
+        m_Device.destroyPipeline(m_DrawPipeline);
+
+        m_Bindless.release(m_MeshBinding);
+        m_Bindless.release(m_InstanceBinding);
+        m_Bindless.release(m_DrawBinding);
+        m_Bindless.release(m_CountBinding);
+        for (BindlessBuffer binding : m_ViewBindings) {
+            m_Bindless.release(binding);
+        }
+
+        DeviceAllocator& allocator = m_App.getDeviceAllocator();
+        for (AllocatedBuffer* buffer : {&m_Vertices, &m_Indices, &m_Meshes, &m_Instances, &m_Draws, &m_Count}) {
+            allocator.destroyBuffer(*buffer);
+        }
+        for (AllocatedBuffer& view : m_Views) {
+            allocator.destroyBuffer(view);
+        }
+        for (AllocatedBuffer& staging : m_InstanceStaging) {
+            if (staging.buffer) {
+                allocator.destroyBuffer(staging);
+            }
+        }
+    }
+
+    uint32_t GpuScene::addMesh(std::span<const SceneVertex> vertices, std::span<const uint32_t> indices, std::span<const GpuMeshLod> lods) {
+        if (m_MeshCount >= m_Config.max_meshes || m_VertexCount + vertices.size() > m_Config.max_vertices
+            || m_IndexCount + indices.size() > m_Config.max_indices) {
+            spdlog::error("GPU scene is full ({} meshes, {} vertices, {} indices)", m_MeshCount, m_VertexCount, m_IndexCount);
+            throw std::runtime_error("GPU scene is full");
+        }
+        if (lods.empty() || lods.size() > kMaxLods) {
+            spdlog::error("A mesh needs between 1 and {} LODs, got {}", kMaxLods, lods.size());
+            throw std::runtime_error("Invalid mesh LODs");
+        }
+
+        glm::vec3 lower{std::numeric_limits<float>::max()};
+        glm::vec3 upper{std::numeric_limits<float>::lowest()};
+        for (const SceneVertex& vertex : vertices) {
+            lower = glm::min(lower, vertex.position);
+            upper = glm::max(upper, vertex.position);
+        }
+        glm::vec3 center = (lower + upper) * 0.5f;
+        float radius = 0.0f;
+        for (const SceneVertex& vertex : vertices) {
+            radius = std::max(radius, glm::length(vertex.position - center));
+        }
+
+        GpuMesh mesh{};
+        mesh.sphere = glm::vec4{center, radius};
+        mesh.lodCount = static_cast<uint32_t>(lods.size());
+        mesh.vertexOffset = static_cast<int32_t>(m_VertexCount);
+        for (size_t i = 0; i < lods.size(); i++) {
+            mesh.lods[i] = GpuMeshLod{m_IndexCount + lods[i].firstIndex, lods[i].indexCount};
+        }
+
+        if (FrameCapture* capture = m_App.getFrameCapture()) {
+            capture->addMesh(this, vertices, indices, lods);
+        }
+
+        UploadService& uploads = m_App.getUploadService();
+        uploads.uploadBuffer(m_Vertices.buffer, sizeof(SceneVertex) * m_VertexCount, std::as_bytes(vertices));
+        uploads.uploadBuffer(m_Indices.buffer, sizeof(uint32_t) * m_IndexCount, std::as_bytes(indices));
+        uploads.uploadBuffer(m_Meshes.buffer, sizeof(GpuMesh) * m_MeshCount, std::as_bytes(std::span(&mesh, 1)));
+
+        m_VertexCount += static_cast<uint32_t>(vertices.size());
+        m_IndexCount += static_cast<uint32_t>(indices.size());
+        return m_MeshCount++;
+    }
+
+    uint32_t GpuScene::addInstances(std::span<const GpuInstance> instances) {
+        std::lock_guard lock(m_InstanceMutex);
+        if (m_InstanceData.size() + instances.size() > m_Config.max_instances) {
+            spdlog::error("GPU scene is full ({} of {} instances)", m_InstanceData.size(), m_Config.max_instances);
+            throw std::runtime_error("GPU scene is full");
+        }
+
+        uint32_t first = static_cast<uint32_t>(m_InstanceData.size());
+        m_InstanceData.resize(m_InstanceData.size() + instances.size());
+        if (FrameCapture* capture = m_App.getFrameCapture()) {
+            capture->setInstances(this, true, first, instances);
+        }
+        writeInstances(first, instances);
+        return first;
+    }
+
+    void GpuScene::updateInstances(uint32_t first, std::span<const GpuInstance> instances) {
+        std::lock_guard lock(m_InstanceMutex);
+        if (first > m_InstanceData.size() || instances.size() > m_InstanceData.size() - first) {
+            spdlog::error("Instances {} to {} are out of range ({} instances)", first, first + instances.size(), m_InstanceData.size());
+            throw std::runtime_error("Instance update out of range");
+        }
+
+        if (FrameCapture* capture = m_App.getFrameCapture()) {
+            capture->setInstances(this, false, first, instances);
+        }
+        writeInstances(first, instances);
+    }
+
+    void GpuScene::writeInstances(uint32_t first, std::span<const GpuInstance> instances) {
+        if (instances.empty()) {
+            return;
+        }
+        std::copy(instances.begin(), instances.end(), m_InstanceData.begin() + first);
+        m_DirtyBegin = std::min(m_DirtyBegin, first);
+        m_DirtyEnd = std::max(m_DirtyEnd, first + static_cast<uint32_t>(instances.size()));
+    }
+
+    void GpuScene::copyInstances(vk::CommandBuffer commandBuffer) {
+        std::lock_guard lock(m_InstanceMutex);
+        m_InstanceCount = static_cast<uint32_t>(m_InstanceData.size());
+        if (m_DirtyBegin >= m_DirtyEnd) {
+            return;
+        }
+
+        // the frame timeline guarantees the GPU is done with the previous frame that used this slot, so its
+        // staging buffer can be overwritten or replaced without deferring
+        size_t slot = m_App.getFrameNumber() % m_App.getFramesInFlight();
+        AllocatedBuffer& staging = m_InstanceStaging[slot];
+        vk::DeviceSize size = sizeof(GpuInstance) * (m_DirtyEnd - m_DirtyBegin);
+        if (!staging.buffer || staging.allocation->size < size) {
+            if (staging.buffer) {
+                m_App.getDeviceAllocator().destroyBuffer(staging);
+            }
+            AllocationDesc stagingDesc{};
+            stagingDesc.required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+            staging = createBuffer(std::bit_ceil(size), vk::BufferUsageFlagBits::eTransferSrc, stagingDesc);
+        }
+
+        std::memcpy(staging.allocation->mapped, m_InstanceData.data() + m_DirtyBegin, size);
+        commandBuffer.copyBuffer(staging.buffer, m_Instances.buffer, vk::BufferCopy{0, sizeof(GpuInstance) * m_DirtyBegin, size});
+        m_DirtyBegin = UINT32_MAX;
+        m_DirtyEnd = 0;
+    }
+
+    void GpuScene::setView(const SceneView &view) {
+        m_View = view;
+        if (FrameCapture* capture = m_App.getFrameCapture()) {
+            capture->setView(this, view);
+        }
+    }
+
+    void GpuScene::addPasses(RenderGraph &graph, GraphImage color, GraphImage depth) {
+        GraphBuffer draws = graph.importBuffer("scene_draws", sizeof(vk::DrawIndexedIndirectCommand) * m_Config.max_instances);
+        GraphBuffer count = graph.importBuffer("scene_draw_count", sizeof(uint32_t));
+        graph.bindBuffer(draws, m_Draws.buffer);
+        graph.bindBuffer(count, m_Count.buffer);
+        // importing orders the copy after the earlier frames still reading the instances on this queue
+        GraphBuffer instances = graph.importBuffer("scene_instances", sizeof(GpuInstance) * m_Config.max_instances);
+        graph.bindBuffer(instances, m_Instances.buffer);
+
+        graph.addPass("scene_update", PassType::eTransfer, [this](const PassContext& pass) {
+            copyInstances(pass.commandBuffer);
+        }).use(instances, GraphAccess::eTransferWrite);
+
+        graph.addPass("scene_reset", PassType::eTransfer, [this](const PassContext& pass) {
+            pass.commandBuffer.fillBuffer(m_Count.buffer, 0, sizeof(uint32_t), 0);
+        }).use(count, GraphAccess::eTransferWrite);
+
+        graph.addPass("scene_cull", PassType::eCompute, [this](const PassContext& pass) {
+            cull(pass.commandBuffer);
+        }).use(instances, GraphAccess::eComputeStorageRead)
+          .use(count, GraphAccess::eComputeStorageWrite).use(draws, GraphAccess::eComputeStorageWrite);
+
+        graph.addPass("scene_draw", PassType::eGraphics, [this](const PassContext& pass) {
+            draw(pass.commandBuffer, pass.renderPass, pass.extent);
+        }).colorAttachment(color, vk::AttachmentLoadOp::eLoad).depthAttachment(depth)
+          .use(instances, GraphAccess::eVertexStorageRead)
+          .use(draws, GraphAccess::eIndirectBuffer).use(count, GraphAccess::eIndirectBuffer);
+    }
+
+    uint32_t GpuScene::getInstanceCount() const noexcept {
+        std::lock_guard lock(m_InstanceMutex);
+        return static_cast<uint32_t>(m_InstanceData.size());
+    }
+
+    uint32_t GpuScene::getMeshCount() const noexcept {
+        return m_MeshCount;
+    }
+
+    BindlessBuffer GpuScene::getInstanceBuffer() const noexcept {
+        return m_InstanceBinding;
+    }
+
+    AllocatedBuffer GpuScene::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, const AllocationDesc &desc) {
+        return m_App.getDeviceAllocator().createBuffer(vk::BufferCreateInfo{
+            vk::BufferCreateFlags(), size, usage, vk::SharingMode::eExclusive
+        }, desc);
+    }
+
+    void GpuScene::createCullPipeline() {
+        vk::ShaderModule module = createShaderModule(m_Device, kCullShader);
+        m_CullPipeline = m_App.getPipelineCache().createComputePipeline(vk::ComputePipelineCreateInfo{
+            vk::PipelineCreateFlags(),
+            vk::PipelineShaderStageCreateInfo{vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, module, "main"},
+            m_Bindless.getPipelineLayout()
+        });
+        m_Device.destroyShaderModule(module);
+    }
+
+    void GpuScene::createDrawPipeline(vk::RenderPass renderPass) {
+        vk::ShaderModule vertexModule = createShaderModule(m_Device, kSceneVertexShader);
+        vk::ShaderModule fragmentModule = createShaderModule(m_Device, kSceneFragmentShader);
+        std::array<vk::PipelineShaderStageCreateInfo, 2> stages{
+            vk::PipelineShaderStageCreateInfo{vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, vertexModule, "main"},
+            vk::PipelineShaderStageCreateInfo{vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment, fragmentModule, "main"}
+        };
+
+        vk::VertexInputBindingDescription binding{0, sizeof(SceneVertex), vk::VertexInputRate::eVertex};
+        std::array<vk::VertexInputAttributeDescription, 2> attributes{
+            vk::VertexInputAttributeDescription{0, 0, vk::Format::eR32G32B32Sfloat, offsetof(SceneVertex, position)},
+            vk::VertexInputAttributeDescription{1, 0, vk::Format::eR32G32B32Sfloat, offsetof(SceneVertex, normal)}
+        };
+        vk::PipelineVertexInputStateCreateInfo vertexInput{vk::PipelineVertexInputStateCreateFlags(), binding, attributes};
+        vk::PipelineInputAssemblyStateCreateInfo inputAssembly{vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList};
+        vk::PipelineViewportStateCreateInfo viewport{vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr};
+
+        vk::PipelineRasterizationStateCreateInfo rasterization{};
+        rasterization.polygonMode = vk::PolygonMode::eFill;
+        rasterization.cullMode = vk::CullModeFlagBits::eBack;
+        rasterization.frontFace = vk::FrontFace::eCounterClockwise;
+        rasterization.lineWidth = 1.0f;
+
+        vk::PipelineMultisampleStateCreateInfo multisample{vk::PipelineMultisampleStateCreateFlags(), vk::SampleCountFlagBits::e1};
+
+        vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.depthTestEnable = true;
+        depthStencil.depthWriteEnable = true;
+        depthStencil.depthCompareOp = vk::CompareOp::eLess;
+
+        vk::PipelineColorBlendAttachmentState blendAttachment{};
+        blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG
+            | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+        vk::PipelineColorBlendStateCreateInfo colorBlend{vk::PipelineColorBlendStateCreateFlags(), false, vk::LogicOp::eCopy, blendAttachment};
+
+        std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamic{vk::PipelineDynamicStateCreateFlags(), dynamicStates};
+
+        vk::GraphicsPipelineCreateInfo createInfo{};
+        createInfo.setStages(stages);
+        createInfo.setPVertexInputState(&vertexInput);
+        createInfo.setPInputAssemblyState(&inputAssembly);
+        createInfo.setPViewportState(&viewport);
+        createInfo.setPRasterizationState(&rasterization);
+        createInfo.setPMultisampleState(&multisample);
+        createInfo.setPDepthStencilState(&depthStencil);
+        createInfo.setPColorBlendState(&colorBlend);
+        createInfo.setPDynamicState(&dynamic);
+        createInfo.setLayout(m_Bindless.getPipelineLayout());
+        createInfo.setRenderPass(renderPass);
+
+        m_DrawPipeline = m_App.getPipelineCache().createGraphicsPipeline(createInfo);
+
+        m_Device.destroyShaderModule(vertexModule);
+        m_Device.destroyShaderModule(fragmentModule);
+    }
+
+    void GpuScene::cull(vk::CommandBuffer commandBuffer) {
+        const glm::mat4 viewProjection = m_View.projection * m_View.view;
+        GpuView view{};
+        view.viewProjection = viewProjection;
+        view.planes = getFrustumPlanes(viewProjection);
+        view.camera = glm::vec4{glm::vec3(glm::inverse(m_View.view)[3]), std::max(m_View.lod_distance, 1e-3f)};
+        view.instanceCount = m_InstanceCount;
+        view.compact = m_Compact ? 1 : 0;
+
+        // the frame timeline guarantees the GPU is done with the previous frame that used this slot
+        size_t slot = m_App.getFrameNumber() % m_App.getFramesInFlight();
+        std::memcpy(m_Views[slot].allocation->mapped, &view, sizeof(view));
+
+        if (m_InstanceCount == 0) {
+            return;
+        }
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_CullPipeline);
+        m_Bindless.bind(commandBuffer, vk::PipelineBindPoint::eCompute);
+        m_Bindless.pushConstants(commandBuffer, getConstants());
+        commandBuffer.dispatch((m_InstanceCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+    }
+
+    void GpuScene::draw(vk::CommandBuffer commandBuffer, vk::RenderPass renderPass, vk::Extent2D extent) {
+        if (m_InstanceCount == 0) {
+            return;
+        }
+        if (!m_DrawPipeline) {
+            // every render pass the graph builds for this pass is compatible, so one pipeline does
+            createDrawPipeline(renderPass);
+        }
+
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_DrawPipeline);
+        m_Bindless.bind(commandBuffer, vk::PipelineBindPoint::eGraphics);
+        m_Bindless.pushConstants(commandBuffer, getConstants());
+        commandBuffer.setViewport(0, vk::Viewport{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f});
+        commandBuffer.setScissor(0, vk::Rect2D{vk::Offset2D{0, 0}, extent});
+        commandBuffer.bindVertexBuffers(0, m_Vertices.buffer, vk::DeviceSize{0});
+        commandBuffer.bindIndexBuffer(m_Indices.buffer, 0, vk::IndexType::eUint32);
+
+        constexpr uint32_t stride = sizeof(vk::DrawIndexedIndirectCommand);
+        if (m_Compact) {
+            commandBuffer.drawIndexedIndirectCount(m_Draws.buffer, 0, m_Count.buffer, 0, m_InstanceCount, stride);
+        } else if (m_MultiDraw) {
+            commandBuffer.drawIndexedIndirect(m_Draws.buffer, 0, m_InstanceCount, stride);
+        } else {
+            for (uint32_t i = 0; i < m_InstanceCount; i++) {
+                commandBuffer.drawIndexedIndirect(m_Draws.buffer, vk::DeviceSize{i} * stride, 1, stride);
+            }
+        }
+    }
+
+    GpuScene::SceneConstants GpuScene::getConstants() {
+        size_t slot = m_App.getFrameNumber() % m_App.getFramesInFlight();
+        return SceneConstants{m_ViewBindings[slot].index, m_InstanceBinding.index, m_MeshBinding.index, m_DrawBinding.index, m_CountBinding.index};
+    }
+}
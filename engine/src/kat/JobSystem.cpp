@@ -0,0 +1,410 @@
+#include "kat/JobSystem.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace kat {
+
+    namespace {
+        thread_local const JobSystem* t_JobSystem = nullptr;
+        thread_local uint32_t t_WorkerIndex = JobSystem::kNotAWorker;
+
+        constexpr uint32_t kSpinCount = 64;
+
+        void runTask(void* data, size_t, size_t) {
+            std::unique_ptr<std::function<void()>> task(static_cast<std::function<void()>*>(data));
+            (*task)();
+        }
+
+        void runRange(void* data, size_t begin, size_t end) {
+            (*static_cast<FunctionRef<void(size_t, size_t)>*>(data))(begin, end);
+        }
+
+        // frees what a job that will never run owns
+        void discard(const Job& job) {
+            if (job.function == &runTask) {
+                delete static_cast<std::function<void()>*>(job.data);
+            }
+        }
+    }
+
+    bool JobCounter::isDone() const noexcept {
+        return m_Value.load(std::memory_order_acquire) == 0;
+    }
+
+    uint32_t JobCounter::getValue() const noexcept {
+        return m_Value.load(std::memory_order_acquire);
+    }
+
+    bool WorkStealingDeque::push(Job *job) {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(kCapacity)) {
+            return false;
+        }
+
+        m_Items[bottom & kMask].store(job, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Job *WorkStealingDeque::pop() {
+        int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+        m_Bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_Top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = m_Items[bottom & kMask].load(std::memory_order_acquire);
+        if (top == bottom) {
+            // last item, race any thief for it
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+
+    Job *WorkStealingDeque::steal() {
+        int64_t top = m_Top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        Job* job = m_Items[top & kMask].load(std::memory_order_acquire);
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+    JobSystem::JobSystem(uint32_t workerThreads) {
+        if (workerThreads == 0) {
+            workerThreads = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+        }
+
+        for (uint32_t i = 0; i <= workerThreads; i++) {
+            m_Workers.push_back(std::make_unique<Worker>());
+        }
+
+        t_JobSystem = this;
+        t_WorkerIndex = 0;
+
+        for (uint32_t i = 1; i <= workerThreads; i++) {
+            m_Threads.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+
+        spdlog::info("Started job system with {} workers", m_Workers.size());
+    }
+
+    JobSystem::~JobSystem() {
+        m_Stop.store(true, std::memory_order_seq_cst);
+        m_WorkSignal.fetch_add(1, std::memory_order_seq_cst);
+        m_WorkSignal.notify_all();
+
+        for (auto& thread : m_Threads) {
+            thread.join();
+        }
+
+        // nothing runs jobs any more, whatever is left in the queues was never started
+        size_t discarded = 0;
+        for (auto& worker : m_Workers) {
+            while (Job* job = worker->deque.pop()) {
+                discard(*job);
+                if (job->heapAllocated) {
+                    delete job;
+                }
+                discarded++;
+            }
+        }
+        for (Job* job : m_SharedQueue) {
+            discard(*job);
+            delete job;
+            discarded++;
+        }
+        for (const auto& [dependency, job] : m_Deferred) {
+            discard(job);
+            discarded++;
+        }
+        if (discarded != 0) {
+            spdlog::warn("Job system stopped with {} jobs that never ran", discarded);
+        }
+
+        if (t_JobSystem == this) {
+            t_JobSystem = nullptr;
+            t_WorkerIndex = kNotAWorker;
+        }
+    }
+
+    void JobSystem::schedule(const Job &job) {
+        if (job.counter) {
+            job.counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+        }
+        push(job);
+    }
+
+    void JobSystem::schedule(std::function<void()> task, JobCounter *counter) {
+        schedule(Job{&runTask, new std::function<void()>(std::move(task)), 0, 0, counter});
+    }
+
+    void JobSystem::scheduleAfter(JobCounter &dependency, std::function<void()> task, JobCounter *counter) {
+        Job job{&runTask, new std::function<void()>(std::move(task)), 0, 0, counter};
+        if (counter) {
+            counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        {
+            std::lock_guard lock(m_DeferredMutex);
+            m_Deferred.emplace_back(&dependency, job);
+            m_DeferredCount.fetch_add(1, std::memory_order_release);
+        }
+
+        // the dependency may already be done, in which case nothing else would release it
+        releaseDeferred();
+    }
+
+    void JobSystem::parallelFor(size_t begin, size_t end, size_t grain, FunctionRef<void(size_t, size_t)> fn) {
+        if (begin >= end) {
+            return;
+        }
+
+        size_t count = end - begin;
+        if (grain == 0) {
+            grain = std::max<size_t>(1, count / (getWorkerCount() * 4));
+        }
+
+        if (count <= grain) {
+            fn(begin, end);
+            return;
+        }
+
+        JobCounter counter;
+        for (size_t chunk = begin + grain; chunk < end; chunk += grain) {
+            schedule(Job{&runRange, &fn, chunk, std::min(end, chunk + grain), &counter});
+        }
+
+        try {
+            fn(begin, begin + grain);
+        } catch (...) {
+            // the scheduled chunks still reference fn and the counter
+            wait(counter);
+            throw;
+        }
+        wait(counter);
+    }
+
+    void JobSystem::wait(JobCounter &counter) {
+        uint32_t worker = currentWorker();
+
+        while (!counter.isDone()) {
+            if (!runOne(worker)) {
+                std::this_thread::yield();
+            }
+        }
+
+        if (counter.m_Failed.test(std::memory_order_acquire)) {
+            std::exception_ptr error = counter.m_Error;
+            counter.m_Error = nullptr;
+            counter.m_Failed.clear(std::memory_order_relaxed);
+            std::rethrow_exception(error);
+        }
+    }
+
+    uint32_t JobSystem::getWorkerCount() const noexcept {
+        return static_cast<uint32_t>(m_Workers.size());
+    }
+
+    uint32_t JobSystem::getCurrentWorkerIndex() noexcept {
+        return t_WorkerIndex;
+    }
+
+    uint32_t JobSystem::currentWorker() const noexcept {
+        return t_JobSystem == this ? t_WorkerIndex : kNotAWorker;
+    }
+
+    void JobSystem::push(const Job &job) {
+        uint32_t worker = currentWorker();
+
+        if (worker != kNotAWorker) {
+            Worker& w = *m_Workers[worker];
+            size_t index = w.nextJob % w.jobs.size();
+            Job* slot;
+            if (!w.occupied[index].load(std::memory_order_acquire)) {
+                // jobs are taken from both ends of the deque, so the ring slot may still hold an older job
+                w.nextJob++;
+                slot = &w.jobs[index];
+                *slot = job;
+                slot->heapAllocated = false;
+                w.occupied[index].store(true, std::memory_order_relaxed);
+            } else {
+                slot = new Job(job);
+                slot->heapAllocated = true;
+            }
+
+            if (!w.deque.push(slot)) {
+                // deque is full, don't queue any deeper
+                if (slot->heapAllocated) {
+                    delete slot;
+                } else {
+                    w.occupied[index].store(false, std::memory_order_relaxed);
+                }
+                execute(job);
+                return;
+            }
+        } else {
+            Job* heapJob = new Job(job);
+            heapJob->heapAllocated = true;
+
+            std::lock_guard lock(m_SharedMutex);
+            m_SharedQueue.push_back(heapJob);
+            m_SharedCount.fetch_add(1, std::memory_order_release);
+        }
+
+        m_WorkSignal.fetch_add(1, std::memory_order_seq_cst);
+        if (m_Sleeping.load(std::memory_order_seq_cst) != 0) {
+            m_WorkSignal.notify_one();
+        }
+    }
+
+    bool JobSystem::runOne(uint32_t worker) {
+        Job job;
+        if (!takeJob(worker, job)) {
+            return false;
+        }
+        execute(job);
+        return true;
+    }
+
+    bool JobSystem::takeJob(uint32_t worker, Job &out) {
+        Job* job = nullptr;
+        uint32_t owner = worker;
+
+        if (worker != kNotAWorker) {
+            job = m_Workers[worker]->deque.pop();
+        }
+
+        if (!job && m_SharedCount.load(std::memory_order_acquire) != 0) {
+            std::lock_guard lock(m_SharedMutex);
+            if (!m_SharedQueue.empty()) {
+                job = m_SharedQueue.front();
+                m_SharedQueue.pop_front();
+                m_SharedCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (!job) {
+            uint32_t count = getWorkerCount();
+            uint32_t start = worker == kNotAWorker ? 0 : worker + 1;
+            for (uint32_t i = 0; i < count && !job; i++) {
+                uint32_t victim = (start + i) % count;
+                if (victim != worker) {
+                    job = m_Workers[victim]->deque.steal();
+                    owner = victim;
+                }
+            }
+        }
+
+        if (!job) {
+            if (m_DeferredCount.load(std::memory_order_acquire) != 0) {
+                releaseDeferred();
+            }
+            return false;
+        }
+
+        // copy out right away so the owner's ring slot can be reused
+        out = *job;
+        if (job->heapAllocated) {
+            delete job;
+        } else {
+            Worker& w = *m_Workers[owner];
+            w.occupied[job - w.jobs.data()].store(false, std::memory_order_release);
+        }
+        return true;
+    }
+
+    void JobSystem::execute(const Job &job) {
+        try {
+            job.function(job.data, job.begin, job.end);
+        } catch (const std::exception& e) {
+            fail(job, e.what());
+        } catch (...) {
+            fail(job, "unknown exception");
+        }
+
+        if (job.counter) {
+            // this must be the last access, a waiter may destroy the counter as soon as it reaches zero
+            job.counter->m_Value.fetch_sub(1, std::memory_order_acq_rel);
+        }
+
+        if (m_DeferredCount.load(std::memory_order_acquire) != 0) {
+            releaseDeferred();
+        }
+    }
+
+    void JobSystem::fail(const Job &job, const char *what) {
+        if (!job.counter) {
+            // nothing waits on the job, rethrowing would only terminate the worker's thread
+            spdlog::error("Dropped exception in a job without a counter: {}", what);
+            return;
+        }
+        if (!job.counter->m_Failed.test_and_set(std::memory_order_acq_rel)) {
+            job.counter->m_Error = std::current_exception();
+        }
+    }
+
+    void JobSystem::releaseDeferred() {
+        std::vector<Job> ready;
+        {
+            std::lock_guard lock(m_DeferredMutex);
+            auto it = std::partition(m_Deferred.begin(), m_Deferred.end(), [](const auto& deferred) {
+                return !deferred.first->isDone();
+            });
+            for (auto ready_it = it; ready_it != m_Deferred.end(); ++ready_it) {
+                ready.push_back(ready_it->second);
+            }
+            m_Deferred.erase(it, m_Deferred.end());
+            m_DeferredCount.store(m_Deferred.size(), std::memory_order_release);
+        }
+
+        for (const auto& job : ready) {
+            push(job);
+        }
+    }
+
+    void JobSystem::workerLoop(uint32_t worker) {
+        t_JobSystem = this;
+        t_WorkerIndex = worker;
+
+        while (!m_Stop.load(std::memory_order_acquire)) {
+            if (runOne(worker)) {
+                continue;
+            }
+
+            bool found = false;
+            for (uint32_t i = 0; i < kSpinCount && !found; i++) {
+                std::this_thread::yield();
+                found = runOne(worker);
+            }
+            if (found) {
+                continue;
+            }
+
+            // register as sleeping before sampling the signal, so a push either sees us or changes the signal
+            m_Sleeping.fetch_add(1, std::memory_order_seq_cst);
+            uint32_t signal = m_WorkSignal.load(std::memory_order_seq_cst);
+            if (!m_Stop.load(std::memory_order_acquire) && !runOne(worker)) {
+                m_WorkSignal.wait(signal, std::memory_order_seq_cst);
+            }
+            m_Sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        }
+    }
+}
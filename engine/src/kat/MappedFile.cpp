@@ -0,0 +1,139 @@
+#include "kat/MappedFile.h"
+
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kat {
+
+    MappedFile::MappedFile(const std::filesystem::path &path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            spdlog::error("Failed to open {}", path.string());
+            throw std::runtime_error("Failed to open file");
+        }
+        m_File = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            close();
+            spdlog::error("Failed to get the size of {}", path.string());
+            throw std::runtime_error("Failed to get file size");
+        }
+        m_Size = static_cast<size_t>(size.QuadPart);
+        if (m_Size == 0) {
+            m_Open = true;
+            return;
+        }
+
+        m_Mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_Mapping) {
+            m_Data = static_cast<const std::byte*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            spdlog::error("Failed to open {}", path.string());
+            throw std::runtime_error("Failed to open file");
+        }
+
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            spdlog::error("Failed to get the size of {}", path.string());
+            throw std::runtime_error("Failed to get file size");
+        }
+        m_Size = static_cast<size_t>(info.st_size);
+        if (m_Size == 0) {
+            ::close(fd);
+            m_Open = true;
+            return;
+        }
+
+        // the mapping keeps its own reference to the file
+        void* data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data != MAP_FAILED) {
+            m_Data = static_cast<const std::byte*>(data);
+            ::madvise(data, m_Size, MADV_SEQUENTIAL);
+        }
+#endif
+
+        if (!m_Data) {
+            close();
+            spdlog::error("Failed to map {}", path.string());
+            throw std::runtime_error("Failed to map file");
+        }
+        m_Open = true;
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+        : m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0)),
+          m_Open(std::exchange(other.m_Open, false))
+#ifdef _WIN32
+        , m_File(std::exchange(other.m_File, nullptr)), m_Mapping(std::exchange(other.m_Mapping, nullptr))
+#endif
+    {
+    }
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            close();
+            m_Data = std::exchange(other.m_Data, nullptr);
+            m_Size = std::exchange(other.m_Size, 0);
+            m_Open = std::exchange(other.m_Open, false);
+#ifdef _WIN32
+            m_File = std::exchange(other.m_File, nullptr);
+            m_Mapping = std::exchange(other.m_Mapping, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    std::span<const std::byte> MappedFile::getData() const noexcept {
+        return {m_Data, m_Data ? m_Size : 0};
+    }
+
+    bool MappedFile::isOpen() const noexcept {
+        return m_Open;
+    }
+
+    void MappedFile::close() noexcept {
+#ifdef _WIN32
+        if (m_Data) {
+            UnmapViewOfFile(m_Data);
+        }
+        if (m_Mapping) {
+            CloseHandle(m_Mapping);
+        }
+        if (m_File) {
+            CloseHandle(m_File);
+        }
+        m_File = nullptr;
+        m_Mapping = nullptr;
+#else
+        if (m_Data) {
+            ::munmap(const_cast<std::byte*>(m_Data), m_Size);
+        }
+#endif
+        m_Data = nullptr;
+        m_Size = 0;
+        m_Open = false;
+    }
+}
@@ -0,0 +1,203 @@
+#include "kat/MipChain.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define KAT_SSE2 1
+#endif
+
+namespace kat {
+
+    namespace {
+        void averagePixel(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* out) {
+            for (uint32_t c = 0; c < 4; c++) {
+                uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+                out[c] = static_cast<uint8_t>((sum + 2) / 4);
+            }
+        }
+
+        float srgbToLinear(float value) {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        // linear [0, 1] split evenly for the encode table, fine enough that a bucket spans at most a couple of codes
+        constexpr uint32_t kEncodeBuckets = 4096;
+
+        struct SrgbTables {
+            std::array<float, 256> toLinear;
+            // linear value halfway between each code and the next in encoded space, so encoding rounds like decoding
+            std::array<float, 255> thresholds;
+            // code of the start of each bucket, the encode steps from there to the exact one
+            std::array<uint8_t, kEncodeBuckets> encode;
+        };
+
+        const SrgbTables& getSrgbTables() {
+            static const SrgbTables tables = [] {
+                SrgbTables t{};
+                for (uint32_t i = 0; i < 256; i++) {
+                    t.toLinear[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+                }
+                for (uint32_t i = 0; i < 255; i++) {
+                    t.thresholds[i] = srgbToLinear((static_cast<float>(i) + 0.5f) / 255.0f);
+                }
+                for (uint32_t i = 0; i < kEncodeBuckets; i++) {
+                    float start = static_cast<float>(i) / static_cast<float>(kEncodeBuckets);
+                    t.encode[i] = static_cast<uint8_t>(std::upper_bound(t.thresholds.begin(), t.thresholds.end(), start) - t.thresholds.begin());
+                }
+                return t;
+            }();
+            return tables;
+        }
+
+        // the number of thresholds at or below `linear`, as a binary search over them would give
+        uint8_t linearToSrgb(float linear, const SrgbTables& tables) {
+            float scaled = std::clamp(linear * static_cast<float>(kEncodeBuckets), 0.0f, static_cast<float>(kEncodeBuckets - 1));
+            uint32_t code = tables.encode[static_cast<uint32_t>(scaled)];
+            // the scaled value can round into the next bucket, so step either way
+            while (code > 0 && tables.thresholds[code - 1] > linear) {
+                code--;
+            }
+            while (code < 255 && tables.thresholds[code] <= linear) {
+                code++;
+            }
+            return static_cast<uint8_t>(code);
+        }
+
+        uint8_t averageAlpha(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1) {
+            uint32_t alpha = row0[x0 * 4 + 3] + row0[x1 * 4 + 3] + row1[x0 * 4 + 3] + row1[x1 * 4 + 3];
+            return static_cast<uint8_t>((alpha + 2) / 4);
+        }
+
+#ifdef KAT_SSE2
+        __m128 decodeSrgb(const uint8_t* pixel, const float* toLinear) {
+            return _mm_setr_ps(toLinear[pixel[0]], toLinear[pixel[1]], toLinear[pixel[2]], 0.0f);
+        }
+
+        // colour averaged in linear space, one channel per lane added in the same order as the scalar version so the
+        // results match it exactly; alpha as stored
+        void averagePixelSrgb(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* out, const SrgbTables& tables) {
+            const float* toLinear = tables.toLinear.data();
+            __m128 sum = _mm_add_ps(decodeSrgb(row0 + x0 * 4, toLinear), decodeSrgb(row0 + x1 * 4, toLinear));
+            sum = _mm_add_ps(sum, decodeSrgb(row1 + x0 * 4, toLinear));
+            sum = _mm_add_ps(sum, decodeSrgb(row1 + x1 * 4, toLinear));
+
+            alignas(16) float linear[4];
+            _mm_store_ps(linear, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+            for (uint32_t c = 0; c < 3; c++) {
+                out[c] = linearToSrgb(linear[c], tables);
+            }
+            out[3] = averageAlpha(row0, row1, x0, x1);
+        }
+#else
+        // colour averaged in linear space, alpha as stored
+        void averagePixelSrgb(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* out, const SrgbTables& tables) {
+            for (uint32_t c = 0; c < 3; c++) {
+                float linear = (tables.toLinear[row0[x0 * 4 + c]] + tables.toLinear[row0[x1 * 4 + c]]
+                                + tables.toLinear[row1[x0 * 4 + c]] + tables.toLinear[row1[x1 * 4 + c]]) * 0.25f;
+                out[c] = linearToSrgb(linear, tables);
+            }
+            out[3] = averageAlpha(row0, row1, x0, x1);
+        }
+#endif
+    }
+
+    uint32_t getMipCount(uint32_t width, uint32_t height) {
+        return std::bit_width(std::max({width, height, 1U}));
+    }
+
+    void downsampleRgba8(const uint8_t *src, uint32_t width, uint32_t height, bool srgb, uint8_t *dst) {
+        uint32_t dstWidth = std::max(width / 2, 1U);
+        uint32_t dstHeight = std::max(height / 2, 1U);
+        const SrgbTables* tables = srgb ? &getSrgbTables() : nullptr;
+
+        for (uint32_t y = 0; y < dstHeight; y++) {
+            const uint8_t* row0 = src + static_cast<size_t>(std::min(y * 2, height - 1)) * width * 4;
+            const uint8_t* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * 4;
+            uint8_t* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+            if (tables) {
+                for (uint32_t x = 0; x < dstWidth; x++) {
+                    averagePixelSrgb(row0, row1, std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1), out + x * 4, *tables);
+                }
+                continue;
+            }
+
+            uint32_t x = 0;
+#ifdef KAT_SSE2
+            // two output pixels from four input pixels of each row per iteration, summed exactly in 16 bits
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i bias = _mm_set1_epi16(2);
+            for (; x + 2 <= dstWidth && x * 2 + 4 <= width; x += 2) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+
+                // pixels 0 and 1 of both rows, then pixels 2 and 3
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+                high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+
+                __m128i sum = _mm_unpacklo_epi64(low, high);
+                sum = _mm_srli_epi16(_mm_add_epi16(sum, bias), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(sum, zero));
+            }
+#endif
+            for (; x < dstWidth; x++) {
+                averagePixel(row0, row1, std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1), out + x * 4);
+            }
+        }
+    }
+
+    MipChain buildMipChain(std::span<const std::byte> rgba, uint32_t width, uint32_t height, bool srgb, uint32_t maxSize) {
+        MipChain chain;
+
+        uint32_t levelWidth = width;
+        uint32_t levelHeight = height;
+        size_t total = 0;
+        for (uint32_t i = 0; i < getMipCount(width, height); i++) {
+            if (levelWidth <= maxSize && levelHeight <= maxSize) {
+                size_t size = static_cast<size_t>(levelWidth) * levelHeight * 4;
+                chain.levels.push_back(MipLevel{levelWidth, levelHeight, total, size});
+                total += size;
+            }
+            levelWidth = std::max(levelWidth / 2, 1U);
+            levelHeight = std::max(levelHeight / 2, 1U);
+        }
+        chain.data.resize(total);
+
+        const auto* src = reinterpret_cast<const uint8_t*>(rgba.data());
+        size_t next = 0;
+        if (width <= maxSize && height <= maxSize) {
+            std::memcpy(chain.data.data(), src, chain.levels[0].size);
+            next = 1;
+        }
+
+        // levels too large for maxSize are still filtered through, in scratch buffers
+        std::array<std::vector<uint8_t>, 2> scratch;
+        levelWidth = width;
+        levelHeight = height;
+        for (uint32_t i = 1; i < getMipCount(width, height); i++) {
+            uint32_t dstWidth = std::max(levelWidth / 2, 1U);
+            uint32_t dstHeight = std::max(levelHeight / 2, 1U);
+
+            uint8_t* dst;
+            if (dstWidth <= maxSize && dstHeight <= maxSize) {
+                dst = reinterpret_cast<uint8_t*>(chain.data.data() + chain.levels[next++].offset);
+            } else {
+                scratch[i % 2].resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+                dst = scratch[i % 2].data();
+            }
+
+            downsampleRgba8(src, levelWidth, levelHeight, srgb, dst);
+            src = dst;
+            levelWidth = dstWidth;
+            levelHeight = dstHeight;
+        }
+        return chain;
+    }
+}
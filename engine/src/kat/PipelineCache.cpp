@@ -0,0 +1,198 @@
+#include "kat/PipelineCache.h"
+
+#include <spdlog/spdlog.h>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace kat {
+
+    namespace {
+        uint64_t fnv1a(std::span<const uint8_t> data) {
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            for (uint8_t byte : data) {
+                hash = (hash ^ byte) * 0x100000001b3ULL;
+            }
+            return hash;
+        }
+    }
+
+    PipelineCache::PipelineCache(App &app, std::filesystem::path path)
+        : m_App(app), m_Device(app.getDevice()), m_Path(std::move(path)),
+          m_CreationFeedback(app.isExtensionEnabled(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME)) {
+        std::vector<uint8_t> data = load();
+        m_Cache = m_Device.createPipelineCache(vk::PipelineCacheCreateInfo{
+            vk::PipelineCacheCreateFlags(), data.size(), data.data()
+        });
+    }
+
+    void PipelineCache::cleanup() {
+        save();
+
+        PipelineCacheStats stats = getStats();
+        spdlog::info("Pipeline cache: {} pipelines in {:.1f} ms; {} hits, {} misses, {} unreported",
+                     stats.pipelines, stats.compileSeconds * 1000.0, stats.hits, stats.misses, stats.unreported);
+
+        m_Device.destroyPipelineCache(m_Cache);
+    }
+
+    void PipelineCache::save() {
+        if (m_Path.empty()) {
+            return;
+        }
+
+        std::vector<uint8_t> data = m_Device.getPipelineCacheData(m_Cache);
+        FileHeader header{kFileMagic, kFileVersion, data.size(), fnv1a(data)};
+
+        // write next to it first, so a crash mid-write can't leave a truncated cache behind
+        std::filesystem::path tempPath = m_Path;
+        tempPath += ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file) {
+                spdlog::warn("Failed to write pipeline cache to {}", tempPath.string());
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, m_Path, error);
+        if (error) {
+            spdlog::warn("Failed to replace pipeline cache {}: {}", m_Path.string(), error.message());
+            return;
+        }
+        spdlog::info("Saved {} bytes of pipeline cache to {}", data.size(), m_Path.string());
+    }
+
+    vk::Pipeline PipelineCache::createGraphicsPipeline(const vk::GraphicsPipelineCreateInfo &createInfo) {
+        return create(createInfo, createInfo.stageCount);
+    }
+
+    vk::Pipeline PipelineCache::createComputePipeline(const vk::ComputePipelineCreateInfo &createInfo) {
+        return create(createInfo, 1);
+    }
+
+    void PipelineCache::createGraphicsPipelines(std::span<const vk::GraphicsPipelineCreateInfo> createInfos, std::span<vk::Pipeline> out) {
+        m_App.getJobSystem().parallelFor(0, createInfos.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                out[i] = create(createInfos[i], createInfos[i].stageCount);
+            }
+        });
+    }
+
+    void PipelineCache::createComputePipelines(std::span<const vk::ComputePipelineCreateInfo> createInfos, std::span<vk::Pipeline> out) {
+        m_App.getJobSystem().parallelFor(0, createInfos.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                out[i] = create(createInfos[i], 1);
+            }
+        });
+    }
+
+    PipelineCacheStats PipelineCache::getStats() const {
+        PipelineCacheStats stats{};
+        stats.pipelines = m_Pipelines.load(std::memory_order_relaxed);
+        stats.hits = m_Hits.load(std::memory_order_relaxed);
+        stats.misses = m_Misses.load(std::memory_order_relaxed);
+        stats.unreported = m_Unreported.load(std::memory_order_relaxed);
+        stats.compileSeconds = static_cast<double>(m_CompileNanoseconds.load(std::memory_order_relaxed)) / 1e9;
+        return stats;
+    }
+
+    vk::PipelineCache PipelineCache::getCache() {
+        return m_Cache;
+    }
+
+    std::vector<uint8_t> PipelineCache::load() {
+        if (m_Path.empty() || !std::filesystem::exists(m_Path)) {
+            return {};
+        }
+
+        std::ifstream file(m_Path, std::ios::binary);
+        FileHeader header{};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file || header.magic != kFileMagic || header.version != kFileVersion) {
+            spdlog::warn("Ignoring pipeline cache {}: not a pipeline cache file", m_Path.string());
+            return {};
+        }
+
+        // check the size before allocating it, a corrupt header could ask for anything
+        std::error_code error;
+        uintmax_t fileSize = std::filesystem::file_size(m_Path, error);
+        if (error || header.dataSize > fileSize - sizeof(header)) {
+            spdlog::warn("Ignoring pipeline cache {}: truncated or corrupt", m_Path.string());
+            return {};
+        }
+
+        std::vector<uint8_t> data(header.dataSize);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file || fnv1a(data) != header.checksum) {
+            spdlog::warn("Ignoring pipeline cache {}: truncated or corrupt", m_Path.string());
+            return {};
+        }
+
+        if (!isCompatible(data)) {
+            spdlog::info("Ignoring pipeline cache {}: created by a different GPU or driver", m_Path.string());
+            return {};
+        }
+
+        spdlog::info("Loaded {} bytes of pipeline cache from {}", data.size(), m_Path.string());
+        return data;
+    }
+
+    bool PipelineCache::isCompatible(std::span<const uint8_t> data) const {
+        VkPipelineCacheHeaderVersionOne header{};
+        if (data.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+
+        const vk::PhysicalDeviceProperties& properties = m_App.getEngine()->getGpuProperties();
+        return header.headerSize >= sizeof(header)
+            && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && header.vendorID == properties.vendorID
+            && header.deviceID == properties.deviceID
+            && std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+    }
+
+    template<typename CreateInfo>
+    vk::Pipeline PipelineCache::create(const CreateInfo &createInfo, uint32_t stageCount) {
+        CreateInfo info = createInfo;
+
+        vk::PipelineCreationFeedbackEXT pipelineFeedback{};
+        std::array<vk::PipelineCreationFeedbackEXT, kMaxFeedbackStages> stageFeedback{};
+        vk::PipelineCreationFeedbackCreateInfoEXT feedbackInfo{};
+        bool feedback = m_CreationFeedback && stageCount <= kMaxFeedbackStages;
+        if (feedback) {
+            feedbackInfo.pPipelineCreationFeedback = &pipelineFeedback;
+            feedbackInfo.pipelineStageCreationFeedbackCount = stageCount;
+            feedbackInfo.pPipelineStageCreationFeedbacks = stageFeedback.data();
+            feedbackInfo.pNext = info.pNext;
+            info.pNext = &feedbackInfo;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        vk::Pipeline pipeline;
+        if constexpr (std::is_same_v<CreateInfo, vk::GraphicsPipelineCreateInfo>) {
+            pipeline = m_Device.createGraphicsPipeline(m_Cache, info).value;
+        } else {
+            pipeline = m_Device.createComputePipeline(m_Cache, info).value;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        m_Pipelines.fetch_add(1, std::memory_order_relaxed);
+        m_CompileNanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+        if (!feedback || !(pipelineFeedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eValid)) {
+            m_Unreported.fetch_add(1, std::memory_order_relaxed);
+        } else if (pipelineFeedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eApplicationPipelineCacheHit) {
+            m_Hits.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_Misses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return pipeline;
+    }
+}
@@ -0,0 +1,789 @@
+#include "kat/RenderGraph.h"
+#include "kat/GpuProfiler.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace kat {
+
+    namespace {
+        constexpr vk::AccessFlags kWriteAccess = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eColorAttachmentWrite
+            | vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eTransferWrite;
+
+        bool isDepthFormat(vk::Format format) {
+            switch (format) {
+                case vk::Format::eD16Unorm:
+                case vk::Format::eX8D24UnormPack32:
+                case vk::Format::eD32Sfloat:
+                case vk::Format::eD16UnormS8Uint:
+                case vk::Format::eD24UnormS8Uint:
+                case vk::Format::eD32SfloatS8Uint:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        bool hasStencil(vk::Format format) {
+            return format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+        }
+
+        vk::ImageAspectFlags getAspect(vk::Format format) {
+            if (!isDepthFormat(format)) {
+                return vk::ImageAspectFlagBits::eColor;
+            }
+            return hasStencil(format) ? vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil : vk::ImageAspectFlagBits::eDepth;
+        }
+
+        vk::ImageUsageFlags getImageUsage(GraphAccess access) {
+            switch (access) {
+                case GraphAccess::eColorAttachment: return vk::ImageUsageFlagBits::eColorAttachment;
+                case GraphAccess::eDepthAttachment:
+                case GraphAccess::eDepthRead: return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+                case GraphAccess::eFragmentSampled:
+                case GraphAccess::eComputeSampled: return vk::ImageUsageFlagBits::eSampled;
+                case GraphAccess::eComputeStorageRead:
+                case GraphAccess::eComputeStorageWrite: return vk::ImageUsageFlagBits::eStorage;
+                case GraphAccess::eTransferRead: return vk::ImageUsageFlagBits::eTransferSrc;
+                case GraphAccess::eTransferWrite: return vk::ImageUsageFlagBits::eTransferDst;
+                default: return {};
+            }
+        }
+
+        vk::BufferUsageFlags getBufferUsage(GraphAccess access) {
+            switch (access) {
+                case GraphAccess::eFragmentSampled:
+                case GraphAccess::eComputeSampled:
+                case GraphAccess::eComputeStorageRead:
+                case GraphAccess::eComputeStorageWrite:
+                case GraphAccess::eVertexStorageRead: return vk::BufferUsageFlagBits::eStorageBuffer;
+                case GraphAccess::eTransferRead: return vk::BufferUsageFlagBits::eTransferSrc;
+                case GraphAccess::eTransferWrite: return vk::BufferUsageFlagBits::eTransferDst;
+                case GraphAccess::eVertexBuffer: return vk::BufferUsageFlagBits::eVertexBuffer;
+                case GraphAccess::eIndexBuffer: return vk::BufferUsageFlagBits::eIndexBuffer;
+                case GraphAccess::eIndirectBuffer: return vk::BufferUsageFlagBits::eIndirectBuffer;
+                case GraphAccess::eUniformBuffer: return vk::BufferUsageFlagBits::eUniformBuffer;
+                default: return {};
+            }
+        }
+    }
+
+    PassBuilder &PassBuilder::use(GraphImage image, GraphAccess access) {
+        m_Graph.addUse(m_Pass, image.index, access, access == GraphAccess::eComputeStorageWrite);
+        return *this;
+    }
+
+    PassBuilder &PassBuilder::use(GraphBuffer buffer, GraphAccess access) {
+        m_Graph.addUse(m_Pass, buffer.index, access, access == GraphAccess::eComputeStorageWrite);
+        return *this;
+    }
+
+    PassBuilder &PassBuilder::colorAttachment(GraphImage image, vk::AttachmentLoadOp load, vk::ClearValue clear) {
+        m_Graph.addUse(m_Pass, image.index, GraphAccess::eColorAttachment, load == vk::AttachmentLoadOp::eLoad);
+        m_Graph.m_Passes[m_Pass].attachments.push_back(RenderGraph::Attachment{image.index, load, false});
+        m_Graph.m_Passes[m_Pass].clearValues.push_back(clear);
+        return *this;
+    }
+
+    PassBuilder &PassBuilder::depthAttachment(GraphImage image, vk::AttachmentLoadOp load, vk::ClearValue clear) {
+        m_Graph.addUse(m_Pass, image.index, GraphAccess::eDepthAttachment, load == vk::AttachmentLoadOp::eLoad);
+        m_Graph.m_Passes[m_Pass].attachments.push_back(RenderGraph::Attachment{image.index, load, true});
+        m_Graph.m_Passes[m_Pass].clearValues.push_back(clear);
+        return *this;
+    }
+
+    PassBuilder &PassBuilder::secondaryCommandBuffers() {
+        m_Graph.m_Passes[m_Pass].secondary = true;
+        return *this;
+    }
+
+    PassBuilder &PassBuilder::sideEffect() {
+        m_Graph.m_Passes[m_Pass].sideEffect = true;
+        return *this;
+    }
+
+    RenderGraph::RenderGraph(App &app) : m_App(app), m_Device(app.getDevice()) {
+    }
+
+    void RenderGraph::cleanup() {
+        destroyCompiled(false);
+        m_Resources.clear();
+        m_Passes.clear();
+    }
+
+    void RenderGraph::reset() {
+        if (m_Compiled) {
+            destroyCompiled(true);
+        }
+        m_Resources.clear();
+        m_Passes.clear();
+    }
+
+    GraphImage RenderGraph::createImage(const char *name, const GraphImageDesc &desc) {
+        Resource resource{name, true, false, desc};
+        resource.renderArea = desc.extent;
+        return GraphImage{addResource(resource)};
+    }
+
+    GraphBuffer RenderGraph::createBuffer(const char *name, vk::DeviceSize size) {
+        Resource resource{name, false, false};
+        resource.size = size;
+        return GraphBuffer{addResource(resource)};
+    }
+
+    GraphImage RenderGraph::importImage(const char *name, const GraphImageDesc &desc, vk::ImageLayout initialLayout, vk::ImageLayout finalLayout) {
+        Resource resource{name, true, true, desc};
+        resource.renderArea = desc.extent;
+        resource.initialLayout = initialLayout;
+        resource.finalLayout = finalLayout;
+        return GraphImage{addResource(resource)};
+    }
+
+    GraphBuffer RenderGraph::importBuffer(const char *name, vk::DeviceSize size) {
+        Resource resource{name, false, true};
+        resource.size = size;
+        return GraphBuffer{addResource(resource)};
+    }
+
+    PassBuilder RenderGraph::addPass(const char *name, PassType type, PassFunction execute) {
+        if (m_Compiled) {
+            spdlog::error("Pass {} added to a render graph that was already compiled", name);
+            throw std::runtime_error("Render graph is already compiled");
+        }
+
+        Pass pass{name, type, std::move(execute)};
+        m_Passes.push_back(std::move(pass));
+        return PassBuilder(*this, static_cast<uint32_t>(m_Passes.size() - 1));
+    }
+
+    void RenderGraph::compile() {
+        if (m_Compiled) {
+            destroyCompiled(true);
+        }
+
+        cull();
+        computeLifetimes();
+        createTransients();
+        computeBarriers();
+        createRenderPasses();
+        m_Compiled = true;
+
+        spdlog::debug("Compiled render graph: {} of {} passes live, {} KiB of transient memory in {} slots",
+                      getLivePassCount(), m_Passes.size(), getTransientMemorySize() / 1024, m_Slots.size());
+    }
+
+    void RenderGraph::bindImage(GraphImage image, vk::Image handle, vk::ImageView view) {
+        m_Resources[image.index].imageHandle = handle;
+        m_Resources[image.index].view = view;
+    }
+
+    void RenderGraph::bindBuffer(GraphBuffer buffer, vk::Buffer handle) {
+        m_Resources[buffer.index].bufferHandle = handle;
+    }
+
+    void RenderGraph::setRenderArea(GraphImage image, vk::Extent2D area) {
+        Resource& resource = m_Resources[image.index];
+        if (area.width == 0 || area.height == 0 || area.width > resource.desc.extent.width || area.height > resource.desc.extent.height) {
+            spdlog::error("Render area {}x{} does not fit image {} ({}x{})", area.width, area.height, resource.name, resource.desc.extent.width, resource.desc.extent.height);
+            throw std::runtime_error("Invalid render area");
+        }
+        resource.renderArea = area;
+    }
+
+    vk::Extent2D RenderGraph::getRenderArea(GraphImage image) const {
+        return m_Resources[image.index].renderArea;
+    }
+
+    void RenderGraph::execute(vk::CommandBuffer commandBuffer, GpuProfiler *profiler) {
+        if (!m_Compiled) {
+            spdlog::error("Render graph executed before it was compiled");
+            throw std::runtime_error("Render graph is not compiled");
+        }
+
+        for (Pass& pass : m_Passes) {
+            if (!pass.live) {
+                continue;
+            }
+
+            recordBarriers(commandBuffer, pass.barriers);
+            uint32_t scope = profiler ? profiler->beginScope(commandBuffer, pass.name) : GpuProfiler::kInvalidScope;
+
+            vk::Framebuffer framebuffer;
+            vk::Extent2D extent = pass.extent;
+            if (pass.renderPass) {
+                framebuffer = getFramebuffer(pass);
+                extent = m_Resources[pass.attachments.front().resource].renderArea;
+                commandBuffer.beginRenderPass(vk::RenderPassBeginInfo{
+                    pass.renderPass, framebuffer, vk::Rect2D{vk::Offset2D{0, 0}, extent}, pass.clearValues
+                }, pass.secondary ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+            }
+
+            pass.execute(PassContext{commandBuffer, pass.renderPass, framebuffer, extent, *this});
+
+            if (pass.renderPass) {
+                commandBuffer.endRenderPass();
+            }
+            if (profiler) {
+                profiler->endScope(commandBuffer, scope);
+            }
+        }
+
+        recordBarriers(commandBuffer, m_FinalBarriers);
+    }
+
+    vk::Image RenderGraph::getImage(GraphImage image) const {
+        return m_Resources[image.index].imageHandle;
+    }
+
+    vk::ImageView RenderGraph::getImageView(GraphImage image) const {
+        return m_Resources[image.index].view;
+    }
+
+    vk::Buffer RenderGraph::getBuffer(GraphBuffer buffer) const {
+        return m_Resources[buffer.index].bufferHandle;
+    }
+
+    vk::RenderPass RenderGraph::getRenderPass(const char *pass) const {
+        for (const Pass& p : m_Passes) {
+            if (std::strcmp(p.name, pass) == 0) {
+                return p.renderPass;
+            }
+        }
+        return nullptr;
+    }
+
+    size_t RenderGraph::getLivePassCount() const {
+        return static_cast<size_t>(std::count_if(m_Passes.begin(), m_Passes.end(), [](const Pass& pass) { return pass.live; }));
+    }
+
+    void RenderGraph::forEachLivePass(const std::function<void(const char *, PassType, vk::Extent2D)> &fn) const {
+        for (const Pass& pass : m_Passes) {
+            if (pass.live) {
+                fn(pass.name, pass.type, pass.renderPass ? m_Resources[pass.attachments.front().resource].renderArea : pass.extent);
+            }
+        }
+    }
+
+    vk::DeviceSize RenderGraph::getTransientMemorySize() const {
+        vk::DeviceSize size = 0;
+        for (const MemorySlot& slot : m_Slots) {
+            size += slot.requirements.size;
+        }
+        return size;
+    }
+
+    RenderGraph::AccessInfo RenderGraph::describe(GraphAccess access) {
+        using Stage = vk::PipelineStageFlagBits;
+        using Access = vk::AccessFlagBits;
+        using Layout = vk::ImageLayout;
+
+        switch (access) {
+            case GraphAccess::eColorAttachment:
+                return {Stage::eColorAttachmentOutput, Access::eColorAttachmentRead | Access::eColorAttachmentWrite, Layout::eColorAttachmentOptimal, true};
+            case GraphAccess::eDepthAttachment:
+                return {Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite, Layout::eDepthStencilAttachmentOptimal, true};
+            case GraphAccess::eDepthRead:
+                return {Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Access::eDepthStencilAttachmentRead, Layout::eDepthStencilReadOnlyOptimal, false};
+            case GraphAccess::eFragmentSampled:
+                return {Stage::eFragmentShader, Access::eShaderRead, Layout::eShaderReadOnlyOptimal, false};
+            case GraphAccess::eComputeSampled:
+                return {Stage::eComputeShader, Access::eShaderRead, Layout::eShaderReadOnlyOptimal, false};
+            case GraphAccess::eComputeStorageRead:
+                return {Stage::eComputeShader, Access::eShaderRead, Layout::eGeneral, false};
+            case GraphAccess::eComputeStorageWrite:
+                return {Stage::eComputeShader, Access::eShaderRead | Access::eShaderWrite, Layout::eGeneral, true};
+            case GraphAccess::eVertexStorageRead:
+                return {Stage::eVertexShader, Access::eShaderRead, Layout::eGeneral, false};
+            case GraphAccess::eTransferRead:
+                return {Stage::eTransfer, Access::eTransferRead, Layout::eTransferSrcOptimal, false};
+            case GraphAccess::eTransferWrite:
+                return {Stage::eTransfer, Access::eTransferWrite, Layout::eTransferDstOptimal, true};
+            case GraphAccess::eVertexBuffer:
+                return {Stage::eVertexInput, Access::eVertexAttributeRead, Layout::eUndefined, false};
+            case GraphAccess::eIndexBuffer:
+                return {Stage::eVertexInput, Access::eIndexRead, Layout::eUndefined, false};
+            case GraphAccess::eIndirectBuffer:
+                return {Stage::eDrawIndirect, Access::eIndirectCommandRead, Layout::eUndefined, false};
+            case GraphAccess::eUniformBuffer:
+                return {Stage::eVertexShader | Stage::eFragmentShader | Stage::eComputeShader, Access::eUniformRead, Layout::eUndefined, false};
+        }
+        return {};
+    }
+
+    uint32_t RenderGraph::addResource(Resource resource) {
+        if (m_Compiled) {
+            spdlog::error("Resource {} added to a render graph that was already compiled", resource.name);
+            throw std::runtime_error("Render graph is already compiled");
+        }
+
+        m_Resources.push_back(resource);
+        return static_cast<uint32_t>(m_Resources.size() - 1);
+    }
+
+    void RenderGraph::addUse(uint32_t pass, uint32_t resource, GraphAccess access, bool reads) {
+        Resource& res = m_Resources.at(resource);
+        res.imageUsage |= getImageUsage(access);
+        res.bufferUsage |= getBufferUsage(access);
+        m_Passes[pass].uses.push_back(Use{resource, access, reads});
+    }
+
+    void RenderGraph::cull() {
+        // walk backwards: a pass lives if it writes something a live pass after it (or the outside world) reads
+        std::vector<bool> needed(m_Resources.size(), false);
+        for (size_t i = m_Passes.size(); i-- > 0;) {
+            Pass& pass = m_Passes[i];
+            pass.live = pass.sideEffect;
+            for (const Use& use : pass.uses) {
+                if (describe(use.access).write && (m_Resources[use.resource].imported || needed[use.resource])) {
+                    pass.live = true;
+                }
+            }
+            if (!pass.live) {
+                continue;
+            }
+
+            // a plain overwrite makes whatever came before it irrelevant
+            for (const Use& use : pass.uses) {
+                if (describe(use.access).write && !use.reads) {
+                    needed[use.resource] = false;
+                }
+            }
+            for (const Use& use : pass.uses) {
+                if (!describe(use.access).write || use.reads) {
+                    needed[use.resource] = true;
+                }
+            }
+        }
+    }
+
+    void RenderGraph::computeLifetimes() {
+        for (uint32_t p = 0; p < m_Passes.size(); p++) {
+            if (!m_Passes[p].live) {
+                continue;
+            }
+            for (const Use& use : m_Passes[p].uses) {
+                Resource& resource = m_Resources[use.resource];
+                resource.firstPass = std::min(resource.firstPass, p);
+                resource.lastPass = std::max(resource.lastPass, p);
+            }
+        }
+    }
+
+    void RenderGraph::createTransients() {
+        std::vector<vk::MemoryRequirements> requirements(m_Resources.size());
+        std::vector<uint32_t> transients;
+
+        for (uint32_t r = 0; r < m_Resources.size(); r++) {
+            Resource& resource = m_Resources[r];
+            if (resource.imported || resource.firstPass == UINT32_MAX) {
+                continue;
+            }
+
+            if (resource.image) {
+                vk::ImageCreateInfo ici{};
+                ici.imageType = vk::ImageType::e2D;
+                ici.format = resource.desc.format;
+                ici.extent = vk::Extent3D{resource.desc.extent.width, resource.desc.extent.height, 1};
+                ici.mipLevels = 1;
+                ici.arrayLayers = 1;
+                ici.samples = resource.desc.samples;
+                ici.tiling = vk::ImageTiling::eOptimal;
+                ici.usage = resource.imageUsage;
+                ici.sharingMode = vk::SharingMode::eExclusive;
+                ici.initialLayout = vk::ImageLayout::eUndefined;
+                resource.imageHandle = m_Device.createImage(ici);
+                requirements[r] = m_Device.getImageMemoryRequirements(resource.imageHandle);
+            } else {
+                resource.bufferHandle = m_Device.createBuffer(vk::BufferCreateInfo{
+                    vk::BufferCreateFlags(), resource.size, resource.bufferUsage, vk::SharingMode::eExclusive
+                });
+                requirements[r] = m_Device.getBufferMemoryRequirements(resource.bufferHandle);
+            }
+            transients.push_back(r);
+        }
+
+        // largest first, so small resources fill in around the big ones
+        std::stable_sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) {
+            return requirements[a].size > requirements[b].size;
+        });
+
+        for (uint32_t r : transients) {
+            Resource& resource = m_Resources[r];
+            const vk::MemoryRequirements& reqs = requirements[r];
+
+            for (uint32_t s = 0; s < m_Slots.size() && resource.slot == UINT32_MAX; s++) {
+                MemorySlot& slot = m_Slots[s];
+                // images and buffers stay apart for bufferImageGranularity, like the allocator's pools
+                if (slot.image != resource.image || !(slot.requirements.memoryTypeBits & reqs.memoryTypeBits)) {
+                    continue;
+                }
+                bool overlaps = std::any_of(slot.occupants.begin(), slot.occupants.end(), [&](uint32_t o) {
+                    return m_Resources[o].firstPass <= resource.lastPass && resource.firstPass <= m_Resources[o].lastPass;
+                });
+                if (overlaps) {
+                    continue;
+                }
+
+                slot.requirements.size = std::max(slot.requirements.size, reqs.size);
+                slot.requirements.alignment = std::max(slot.requirements.alignment, reqs.alignment);
+                slot.requirements.memoryTypeBits &= reqs.memoryTypeBits;
+                slot.occupants.push_back(r);
+                resource.slot = s;
+            }
+
+            if (resource.slot == UINT32_MAX) {
+                resource.slot = static_cast<uint32_t>(m_Slots.size());
+                m_Slots.push_back(MemorySlot{resource.image, reqs, {r}});
+            }
+        }
+
+        DeviceAllocator& allocator = m_App.getDeviceAllocator();
+        for (MemorySlot& slot : m_Slots) {
+            std::sort(slot.occupants.begin(), slot.occupants.end(), [&](uint32_t a, uint32_t b) {
+                return m_Resources[a].firstPass < m_Resources[b].firstPass;
+            });
+            slot.allocation = allocator.allocate(slot.requirements, slot.image ? ResourceKind::eOptimalImage : ResourceKind::eLinear);
+
+            for (uint32_t r : slot.occupants) {
+                Resource& resource = m_Resources[r];
+                if (!resource.image) {
+                    m_Device.bindBufferMemory(resource.bufferHandle, slot.allocation->memory, slot.allocation->offset);
+                    continue;
+                }
+
+                m_Device.bindImageMemory(resource.imageHandle, slot.allocation->memory, slot.allocation->offset);
+                // views only ever see the depth aspect, which is what sampling a depth buffer needs
+                vk::ImageAspectFlags aspect = isDepthFormat(resource.desc.format) ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
+                resource.view = m_Device.createImageView(vk::ImageViewCreateInfo{
+                    vk::ImageViewCreateFlags(), resource.imageHandle, vk::ImageViewType::e2D, resource.desc.format,
+                    vk::ComponentMapping{}, vk::ImageSubresourceRange{aspect, 0, 1, 0, 1}
+                });
+            }
+        }
+    }
+
+    void RenderGraph::computeBarriers() {
+        // Applies `info` to `state`, adding a barrier to `batch` when the previous accesses require one.
+        auto transition = [&](ResourceState& state, uint32_t resource, const AccessInfo& info, BarrierBatch* batch) {
+            bool image = m_Resources[resource].image;
+            bool layoutChange = image && info.layout != state.layout;
+
+            vk::PipelineStageFlags srcStages;
+            bool needed;
+            if (info.write || layoutChange) {
+                // write-after-read only needs the readers to have finished, they've seen the last write already
+                srcStages = state.readStages | state.writeStages;
+                needed = true;
+            } else {
+                srcStages = state.writeStages;
+                needed = state.writeStages && ((state.readStages & info.stages) != info.stages || (state.readAccess & info.access) != info.access);
+            }
+
+            if (needed && batch) {
+                batch->srcStages |= srcStages;
+                batch->dstStages |= info.stages;
+                batch->barriers.push_back(Barrier{resource, state.writeAccess, info.access, state.layout, image ? info.layout : vk::ImageLayout::eUndefined});
+            }
+
+            if (info.write) {
+                state.writeStages = info.stages;
+                state.writeAccess = info.access & kWriteAccess;
+                state.readStages = {};
+                state.readAccess = {};
+            } else if (needed && layoutChange) {
+                state.readStages = info.stages;
+                state.readAccess = info.access;
+            } else {
+                state.readStages |= info.stages;
+                state.readAccess |= info.access;
+            }
+            if (image) {
+                state.layout = info.layout;
+            }
+        };
+
+        auto walk = [&](std::vector<ResourceState>& states, const std::vector<ResourceState>* previousFrame) {
+            for (uint32_t p = 0; p < m_Passes.size(); p++) {
+                Pass& pass = m_Passes[p];
+                if (!pass.live) {
+                    continue;
+                }
+
+                BarrierBatch* batch = previousFrame ? &pass.barriers : nullptr;
+                for (const Use& use : pass.uses) {
+                    AccessInfo info = describe(use.access);
+                    ResourceState& state = states[use.resource];
+                    if (state.used) {
+                        transition(state, use.resource, info, batch);
+                        continue;
+                    }
+
+                    // first use this frame: order against whatever touched the resource's memory last, and never
+                    // keep its contents when it's transient
+                    const Resource& resource = m_Resources[use.resource];
+                    vk::PipelineStageFlags srcStages;
+                    vk::AccessFlags srcAccess;
+                    vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+                    if (resource.imported) {
+                        srcStages = vk::PipelineStageFlagBits::eAllCommands;
+                        srcAccess = vk::AccessFlagBits::eMemoryWrite;
+                        oldLayout = resource.initialLayout;
+                    } else if (previousFrame) {
+                        // the slot's previous occupant; the first one follows the last one of the frame before
+                        const std::vector<uint32_t>& occupants = m_Slots[resource.slot].occupants;
+                        auto it = std::find(occupants.begin(), occupants.end(), use.resource);
+                        const ResourceState& previous = (*previousFrame)[it == occupants.begin() ? occupants.back() : *(it - 1)];
+                        srcStages = previous.readStages | previous.writeStages;
+                        srcAccess = previous.writeAccess;
+                    }
+
+                    if (batch) {
+                        batch->srcStages |= srcStages;
+                        batch->dstStages |= info.stages;
+                        batch->barriers.push_back(Barrier{use.resource, srcAccess, info.access, oldLayout, resource.image ? info.layout : vk::ImageLayout::eUndefined});
+                    }
+
+                    state = ResourceState{};
+                    state.used = true;
+                    state.layout = resource.image ? info.layout : vk::ImageLayout::eUndefined;
+                    if (info.write) {
+                        state.writeStages = info.stages;
+                        state.writeAccess = info.access & kWriteAccess;
+                    } else {
+                        // other readers still have to wait on what came before
+                        state.writeStages = srcStages;
+                        state.writeAccess = srcAccess;
+                        state.readStages = info.stages;
+                        state.readAccess = info.access;
+                    }
+                }
+            }
+        };
+
+        // the end state of one frame feeds the first uses of the next
+        std::vector<ResourceState> endStates(m_Resources.size());
+        walk(endStates, nullptr);
+
+        std::vector<ResourceState> states(m_Resources.size());
+        walk(states, &endStates);
+
+        for (uint32_t r = 0; r < m_Resources.size(); r++) {
+            const Resource& resource = m_Resources[r];
+            ResourceState& state = states[r];
+            if (!resource.imported || !resource.image || !state.used || resource.finalLayout == vk::ImageLayout::eUndefined
+                || resource.finalLayout == state.layout) {
+                continue;
+            }
+            m_FinalBarriers.srcStages |= state.readStages | state.writeStages;
+            m_FinalBarriers.dstStages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+            m_FinalBarriers.barriers.push_back(Barrier{r, state.writeAccess, vk::AccessFlags(), state.layout, resource.finalLayout});
+        }
+
+        size_t maxBarriers = m_FinalBarriers.barriers.size();
+        for (const Pass& pass : m_Passes) {
+            maxBarriers = std::max(maxBarriers, pass.barriers.barriers.size());
+        }
+        m_ImageBarriers.reserve(maxBarriers);
+        m_BufferBarriers.reserve(maxBarriers);
+    }
+
+    void RenderGraph::createRenderPasses() {
+        for (uint32_t p = 0; p < m_Passes.size(); p++) {
+            Pass& pass = m_Passes[p];
+            if (!pass.live || pass.type != PassType::eGraphics || pass.attachments.empty()) {
+                continue;
+            }
+
+            std::vector<vk::AttachmentDescription> descriptions;
+            std::vector<vk::AttachmentReference> colorRefs;
+            std::optional<vk::AttachmentReference> depthRef;
+            bool transientOnly = true;
+
+            for (uint32_t a = 0; a < pass.attachments.size(); a++) {
+                const Attachment& attachment = pass.attachments[a];
+                const Resource& resource = m_Resources[attachment.resource];
+                transientOnly = transientOnly && !resource.imported;
+
+                // the graph's barriers do the layout transitions, the render pass keeps the attachment layout
+                vk::ImageLayout layout = describe(attachment.depth ? GraphAccess::eDepthAttachment : GraphAccess::eColorAttachment).layout;
+                vk::AttachmentStoreOp store = needsStore(attachment.resource, p) ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+                bool stencil = hasStencil(resource.desc.format);
+                descriptions.emplace_back(
+                    vk::AttachmentDescriptionFlags(),
+                    resource.desc.format, resource.desc.samples,
+                    attachment.load, store,
+                    stencil ? attachment.load : vk::AttachmentLoadOp::eDontCare,
+                    stencil ? store : vk::AttachmentStoreOp::eDontCare,
+                    layout, layout
+                );
+
+                if (attachment.depth) {
+                    depthRef = vk::AttachmentReference{a, layout};
+                } else {
+                    colorRefs.emplace_back(a, layout);
+                }
+            }
+
+            vk::SubpassDescription subpass{
+                vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics,
+                {}, colorRefs, {}, depthRef ? &depthRef.value() : nullptr, {}
+            };
+            pass.renderPass = m_Device.createRenderPass(vk::RenderPassCreateInfo{
+                vk::RenderPassCreateFlags(), descriptions, subpass
+            });
+            pass.extent = m_Resources[pass.attachments.front().resource].desc.extent;
+
+            if (transientOnly) {
+                getFramebuffer(pass);
+            }
+        }
+
+        m_Views.reserve(std::accumulate(m_Passes.begin(), m_Passes.end(), size_t{0}, [](size_t n, const Pass& pass) {
+            return std::max(n, pass.attachments.size());
+        }));
+    }
+
+    bool RenderGraph::needsStore(uint32_t resource, uint32_t pass) const {
+        if (m_Resources[resource].imported) {
+            return true;
+        }
+        for (uint32_t p = pass + 1; p < m_Passes.size(); p++) {
+            if (!m_Passes[p].live) {
+                continue;
+            }
+            for (const Use& use : m_Passes[p].uses) {
+                if (use.resource == resource) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    vk::Framebuffer RenderGraph::getFramebuffer(Pass &pass) {
+        m_Views.clear();
+        for (const Attachment& attachment : pass.attachments) {
+            m_Views.push_back(m_Resources[attachment.resource].view);
+        }
+
+        for (const FramebufferEntry& entry : pass.framebuffers) {
+            if (entry.views == m_Views) {
+                return entry.framebuffer;
+            }
+        }
+
+        // first frame with this combination of imported views (one per swapchain image, typically)
+        vk::Framebuffer framebuffer = m_Device.createFramebuffer(vk::FramebufferCreateInfo{
+            vk::FramebufferCreateFlags(), pass.renderPass, m_Views, pass.extent.width, pass.extent.height, 1
+        });
+        pass.framebuffers.push_back(FramebufferEntry{m_Views, framebuffer});
+        return framebuffer;
+    }
+
+    void RenderGraph::recordBarriers(vk::CommandBuffer commandBuffer, const BarrierBatch &batch) {
+        if (batch.barriers.empty()) {
+            return;
+        }
+
+        m_ImageBarriers.clear();
+        m_BufferBarriers.clear();
+        for (const Barrier& barrier : batch.barriers) {
+            const Resource& resource = m_Resources[barrier.resource];
+            if (resource.image) {
+                m_ImageBarriers.emplace_back(
+                    barrier.srcAccess, barrier.dstAccess, barrier.oldLayout, barrier.newLayout,
+                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, resource.imageHandle,
+                    vk::ImageSubresourceRange{getAspect(resource.desc.format), 0, 1, 0, 1}
+                );
+            } else {
+                m_BufferBarriers.emplace_back(
+                    barrier.srcAccess, barrier.dstAccess, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                    resource.bufferHandle, 0, VK_WHOLE_SIZE
+                );
+            }
+        }
+
+        vk::PipelineStageFlags srcStages = batch.srcStages ? batch.srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+        commandBuffer.pipelineBarrier(srcStages, batch.dstStages, {}, nullptr, m_BufferBarriers, m_ImageBarriers);
+    }
+
+    void RenderGraph::destroyCompiled(bool deferred) {
+        std::vector<vk::Framebuffer> framebuffers;
+        std::vector<vk::RenderPass> renderPasses;
+        std::vector<vk::ImageView> views;
+        std::vector<vk::Image> images;
+        std::vector<vk::Buffer> buffers;
+        std::vector<GpuAllocation*> allocations;
+
+        for (Pass& pass : m_Passes) {
+            for (const FramebufferEntry& entry : pass.framebuffers) {
+                framebuffers.push_back(entry.framebuffer);
+            }
+            if (pass.renderPass) {
+                renderPasses.push_back(pass.renderPass);
+            }
+            pass.framebuffers.clear();
+            pass.renderPass = nullptr;
+            pass.barriers = BarrierBatch{};
+            pass.live = false;
+        }
+
+        for (Resource& resource : m_Resources) {
+            if (!resource.imported) {
+                if (resource.view) {
+                    views.push_back(resource.view);
+                }
+                if (resource.imageHandle) {
+                    images.push_back(resource.imageHandle);
+                }
+                if (resource.bufferHandle) {
+                    buffers.push_back(resource.bufferHandle);
+                }
+                resource.view = nullptr;
+                resource.imageHandle = nullptr;
+                resource.bufferHandle = nullptr;
+            }
+            resource.firstPass = UINT32_MAX;
+            resource.lastPass = 0;
+            resource.slot = UINT32_MAX;
+        }
+
+        for (const MemorySlot& slot : m_Slots) {
+            allocations.push_back(slot.allocation);
+        }
+        m_Slots.clear();
+        m_FinalBarriers = BarrierBatch{};
+        m_Compiled = false;
+
+        auto destroy = [device = m_Device, allocator = &m_App.getDeviceAllocator(), framebuffers = std::move(framebuffers),
+                        renderPasses = std::move(renderPasses), views = std::move(views), images = std::move(images),
+                        buffers = std::move(buffers), allocations = std::move(allocations)]() {
+            for (auto fb : framebuffers) {
+                device.destroyFramebuffer(fb);
+            }
+            for (auto renderPass : renderPasses) {
+                device.destroyRenderPass(renderPass);
+            }
+            for (auto view : views) {
+                device.destroyImageView(view);
+            }
+            for (auto image : images) {
+                device.destroyImage(image);
+            }
+            for (auto buffer : buffers) {
+                device.destroyBuffer(buffer);
+            }
+            for (auto allocation : allocations) {
+                allocator->free(allocation);
+            }
+        };
+
+        if (deferred) {
+            m_App.deferDeletion(std::move(destroy));
+        } else {
+            destroy();
+        }
+    }
+}
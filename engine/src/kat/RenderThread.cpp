@@ -0,0 +1,110 @@
+#include "kat/RenderThread.h"
+
+#include <spdlog/spdlog.h>
+
+namespace kat {
+
+    RenderThread::RenderThread(App &app, Renderer &renderer) : m_App(app), m_Renderer(renderer) {
+        m_Thread = std::thread([this]() {
+            run();
+        });
+        m_App.setRenderThread(this);
+    }
+
+    RenderThread::~RenderThread() {
+        stop();
+        m_App.setRenderThread(nullptr);
+    }
+
+    FramePacket &RenderThread::beginPacket() {
+        if (m_Failed.load(std::memory_order_acquire)) {
+            std::rethrow_exception(m_Error);
+        }
+
+        FramePacket& packet = acquireSlot().packet;
+        // clear() keeps the capacity of the vectors for the next frame
+        packet.time = 0.0;
+        packet.dt = 0.0;
+        packet.interpolationAlpha = 1.0;
+        packet.view.reset();
+        packet.itemCount = 0;
+        packet.record = nullptr;
+        packet.commands.clear();
+        return packet;
+    }
+
+    void RenderThread::submit() {
+        submitSlot();
+    }
+
+    void RenderThread::stop() {
+        if (!m_Thread.joinable()) {
+            return;
+        }
+
+        acquireSlot().quit = true;
+        submitSlot();
+        m_Thread.join();
+    }
+
+    uint32_t RenderThread::getQueuedCount() const noexcept {
+        return static_cast<uint32_t>(m_Submitted.load(std::memory_order_acquire) - m_Rendered.load(std::memory_order_acquire));
+    }
+
+    RenderThread::Slot &RenderThread::acquireSlot() {
+        uint64_t submitted = m_Submitted.load(std::memory_order_relaxed);
+        for (uint64_t rendered = m_Rendered.load(std::memory_order_acquire); submitted - rendered >= kPacketCount;
+             rendered = m_Rendered.load(std::memory_order_acquire)) {
+            m_Rendered.wait(rendered, std::memory_order_acquire);
+        }
+
+        Slot& slot = m_Slots[submitted % kPacketCount];
+        slot.quit = false;
+        return slot;
+    }
+
+    void RenderThread::submitSlot() {
+        uint64_t submitted = m_Submitted.load(std::memory_order_relaxed);
+        m_Slots[submitted % kPacketCount].packet.sequence = submitted + 1;
+
+        m_Submitted.store(submitted + 1, std::memory_order_release);
+        m_Submitted.notify_one();
+    }
+
+    void RenderThread::run() {
+        for (uint64_t rendered = 0;; rendered++) {
+            m_Submitted.wait(rendered, std::memory_order_acquire);
+
+            Slot& slot = m_Slots[rendered % kPacketCount];
+            if (slot.quit) {
+                break;
+            }
+
+            // after a failure packets are only drained, so the main thread never blocks on a dead renderer
+            if (!m_Failed.load(std::memory_order_relaxed)) {
+                try {
+                    FramePacket& packet = slot.packet;
+                    for (auto& command : packet.commands) {
+                        command(m_Renderer);
+                    }
+                    if (packet.view && m_Renderer.getScene()) {
+                        m_Renderer.getScene()->setView(*packet.view);
+                    }
+
+                    if (packet.record) {
+                        m_Renderer.render(packet.itemCount, packet.record);
+                    } else {
+                        m_Renderer.render();
+                    }
+                } catch (...) {
+                    spdlog::error("Rendering frame packet {} failed, stopping the render thread", slot.packet.sequence);
+                    m_Error = std::current_exception();
+                    m_Failed.store(true, std::memory_order_release);
+                }
+            }
+
+            m_Rendered.store(rendered + 1, std::memory_order_release);
+            m_Rendered.notify_one();
+        }
+    }
+}
@@ -1,68 +1,106 @@
 #include "kat/Renderer.h"
+#include "kat/AllocationCounter.h"
+#include "kat/BindlessRegistry.h"
+#include "kat/FrameCapture.h"
+#include "kat/UploadService.h"
+
+#include <spdlog/spdlog.h>
+#include <chrono>
 
 namespace kat {
 
-    Renderer::Renderer(std::shared_ptr<App> app) : m_App(app) {
-        for (size_t i = 0 ; i < kMaxFramesInFlight; i++) {
-            m_InFlightFences.push_back(app->getDevice().createFence(vk::FenceCreateInfo{vk::FenceCreateFlagBits::eSignaled}));
+    Renderer::Renderer(std::shared_ptr<App> app)
+        : m_App(app), m_FramesInFlight(app->getFramesInFlight()),
+          m_Graph(*app), m_GpuProfiler(app, app->getFramesInFlight()), m_CommandRecorder(app, app->getFramesInFlight()) {
+        for (size_t i = 0 ; i < m_FramesInFlight; i++) {
             m_ImageAvailableSemaphores.push_back(app->getDevice().createSemaphore(vk::SemaphoreCreateInfo{}));
             m_RenderFinishedSemaphores.push_back(app->getDevice().createSemaphore(vk::SemaphoreCreateInfo{}));
+            m_FrameArenas.emplace_back();
         }
 
-        m_ImagesInFlight.resize(m_App->getSwapchainImages().size());
-
         m_RenderCommandPool = m_App->getDevice().createCommandPool(vk::CommandPoolCreateInfo{
             vk::CommandPoolCreateFlagBits::eResetCommandBuffer, m_App->getGraphicsFamily()
             });
 
         m_RenderCommandBuffers = m_App->getDevice().allocateCommandBuffers(vk::CommandBufferAllocateInfo{
-            m_RenderCommandPool, vk::CommandBufferLevel::ePrimary, static_cast<uint32_t>(m_App->getSwapchainImages().size())
+            m_RenderCommandPool, vk::CommandBufferLevel::ePrimary, m_FramesInFlight
             });
 
+        buildGraph();
+    }
 
-        vk::AttachmentDescription colorAttachment{
-            vk::AttachmentDescriptionFlags(),
-            m_App->getSwapchainFormat(),
-            vk::SampleCountFlagBits::e1,
-            vk::AttachmentLoadOp::eClear,
-            vk::AttachmentStoreOp::eStore,
-            vk::AttachmentLoadOp::eDontCare,
-            vk::AttachmentStoreOp::eDontCare,
-            vk::ImageLayout::eUndefined,
-            vk::ImageLayout::ePresentSrcKHR
-        };
-
-        vk::AttachmentReference colorAttachmentRef{0, vk::ImageLayout::eColorAttachmentOptimal};
-        vk::SubpassDescription subpassDesc{
-            vk::SubpassDescriptionFlags(),
-            vk::PipelineBindPoint::eGraphics,
-            {}, colorAttachmentRef, {}, nullptr, {}
-        };
+    void Renderer::buildGraph() {
+        // frames in flight may still be using the previous graph's objects, reset() defers their destruction
+        m_Graph.reset();
 
-        vk::SubpassDependency subpassDep{
-            VK_SUBPASS_EXTERNAL, 0,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput,
-            vk::PipelineStageFlagBits::eColorAttachmentOutput,
-            {}, vk::AccessFlagBits::eColorAttachmentWrite, {}
-        };
+        vk::Extent2D swapchainExtent = m_App->getSwapchainExtent();
+        GraphImageDesc backbufferDesc{m_App->getSwapchainFormat(), swapchainExtent};
+        m_Backbuffer = m_Graph.importImage("backbuffer", backbufferDesc, vk::ImageLayout::eUndefined, m_App->getFinalImageLayout());
 
-        vk::RenderPassCreateInfo rpci{
-            vk::RenderPassCreateFlags(),
-            colorAttachment,
-            subpassDesc,
-            subpassDep
-        };
+        ResolutionController& resolution = m_App->getClock().getResolutionController();
+        if (resolution.isEnabled() && !supportsUpscale()) {
+            spdlog::warn("Swapchain images ({}) can't be blitted to, dynamic resolution is disabled", vk::to_string(m_App->getSwapchainFormat()));
+            resolution.disable();
+        }
 
-        m_RenderPass = m_App->getDevice().createRenderPass(rpci);
+        // with dynamic resolution the frame renders into the top left of a target sized for the maximum scale, the
+        // same format as the swapchain so pipelines made for the main pass still fit, and is stretched over the
+        // backbuffer at the end
+        m_Upscaling = resolution.isEnabled();
+        vk::Extent2D targetExtent = resolution.getMaxExtent(swapchainExtent);
+        m_SceneColor = m_Upscaling ? m_Graph.createImage("scene_color", GraphImageDesc{m_App->getSwapchainFormat(), targetExtent}) : m_Backbuffer;
+
+        m_Graph.addPass("main_pass", PassType::eGraphics, [this](const PassContext& pass) {
+            if (m_PendingItemCount == 0 || !m_PendingRecordFn) {
+                return;
+            }
+            // bindings don't carry over into secondaries, so every chunk binds the bindless set and draws only
+            // push their indices
+            BindlessRegistry& bindless = m_App->getBindlessRegistry();
+            auto recordChunk = [&](const RecordContext& chunk) {
+                bindless.bind(chunk.commandBuffer, vk::PipelineBindPoint::eGraphics);
+                m_PendingRecordFn(chunk);
+            };
+            vk::CommandBufferInheritanceInfo* inheritance = getFrameArena().create<vk::CommandBufferInheritanceInfo>(pass.renderPass, 0, pass.framebuffer);
+            std::span<const vk::CommandBuffer> secondaries = m_CommandRecorder.record(*inheritance, m_PendingItemCount, recordChunk);
+            pass.commandBuffer.executeCommands(static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        }).colorAttachment(m_SceneColor, vk::AttachmentLoadOp::eClear, m_ClearValue).secondaryCommandBuffers();
+
+        if (m_Scene) {
+            GraphImage depth = m_Graph.createImage("scene_depth", GraphImageDesc{kSceneDepthFormat, targetExtent});
+            m_Scene->addPasses(m_Graph, m_SceneColor, depth);
+        }
 
-        for (auto iview : m_App->getSwapchainImageViews()) {
-            m_Framebuffers.push_back(m_App->getDevice().createFramebuffer(vk::FramebufferCreateInfo{
-                vk::FramebufferCreateFlags(),
-                m_RenderPass,
-                iview,
-                m_App->getSwapchainExtent().width, m_App->getSwapchainExtent().height, 1
-                }));
+        if (m_Upscaling) {
+            m_Graph.addPass("upscale", PassType::eTransfer, [this](const PassContext& pass) {
+                upscale(pass.commandBuffer);
+            }).use(m_SceneColor, GraphAccess::eTransferRead).use(m_Backbuffer, GraphAccess::eTransferWrite);
         }
+
+        m_Graph.compile();
+        m_SwapchainGeneration = m_App->getSwapchainGeneration();
+    }
+
+    bool Renderer::supportsUpscale() {
+        vk::FormatFeatureFlags required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+        vk::FormatProperties properties = m_App->getEngine()->getGpu().getFormatProperties(m_App->getSwapchainFormat());
+        return (properties.optimalTilingFeatures & required) == required && (m_App->getSwapchainImageUsage() & vk::ImageUsageFlagBits::eTransferDst);
+    }
+
+    void Renderer::upscale(vk::CommandBuffer commandBuffer) {
+        vk::Extent2D target = m_App->getSwapchainExtent();
+        vk::ImageSubresourceLayers layers{vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+        // the filter reaches half a texel past the rendered area on the far edges, which still holds a recent
+        // frame's pixels there, so no border is cleared for it
+        vk::ImageBlit region{
+            layers, {vk::Offset3D{0, 0, 0}, vk::Offset3D{static_cast<int32_t>(m_RenderExtent.width), static_cast<int32_t>(m_RenderExtent.height), 1}},
+            layers, {vk::Offset3D{0, 0, 0}, vk::Offset3D{static_cast<int32_t>(target.width), static_cast<int32_t>(target.height), 1}}
+        };
+        commandBuffer.blitImage(
+            m_Graph.getImage(m_SceneColor), vk::ImageLayout::eTransferSrcOptimal,
+            m_Graph.getImage(m_Backbuffer), vk::ImageLayout::eTransferDstOptimal,
+            region, vk::Filter::eLinear
+        );
     }
 
     Renderer::~Renderer() {
@@ -70,71 +108,190 @@ namespace kat {
     }
 
     void Renderer::cleanup() {
-        for (size_t i = 0; i < kMaxFramesInFlight; i++) {
-            m_App->getDevice().destroyFence(m_InFlightFences[i]);
+        for (size_t i = 0; i < m_FramesInFlight; i++) {
             m_App->getDevice().destroySemaphore(m_ImageAvailableSemaphores[i]);
             m_App->getDevice().destroySemaphore(m_RenderFinishedSemaphores[i]);
         }
 
-        for (auto fb : m_Framebuffers) {
-            m_App->getDevice().destroyFramebuffer(fb);
-        }
+        m_Graph.cleanup();
+
+        m_GpuProfiler.cleanup();
+        m_CommandRecorder.cleanup();
 
-        m_App->getDevice().destroyRenderPass(m_RenderPass);
         m_App->getDevice().freeCommandBuffers(m_RenderCommandPool, m_RenderCommandBuffers);
         m_App->getDevice().destroyCommandPool(m_RenderCommandPool);
     }
 
     void Renderer::render() {
-        m_App->getDevice().waitForFences(m_InFlightFences[m_CurrentFrame], true, UINT64_MAX);
+        render(0, {});
+    }
 
-        uint32_t imgIdx = m_App->getDevice().acquireNextImageKHR(m_App->getSwapchain(), UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame]);
-        if (m_ImagesInFlight[imgIdx]) {
-            m_App->getDevice().waitForFences(m_ImagesInFlight[imgIdx], true, UINT64_MAX);
+    void Renderer::render(size_t itemCount, RecordFunction recordFn) {
+        auto start = std::chrono::steady_clock::now();
+        size_t allocationsBefore = debug::getThreadAllocationCount();
+
+        // waits until the GPU is done with the frame that last used this slot
+        uint64_t frameNumber = m_App->beginFrame();
+        m_CurrentFrame = frameNumber % m_FramesInFlight;
+
+        LinearArena& arena = m_FrameArenas[m_CurrentFrame];
+        arena.reset();
+        m_Recording = true;
+        m_CommandRecorder.beginFrame(m_CurrentFrame);
+
+        std::optional<uint32_t> acquired = m_App->acquireNextImage(m_ImageAvailableSemaphores[m_CurrentFrame]);
+        if (!acquired.has_value()) {
+            // nothing to present to this frame, but its timeline value still has to be reached
+            m_Recording = false;
+            m_App->skipFrame();
+            return;
         }
-        m_ImagesInFlight[imgIdx] = m_InFlightFences[m_CurrentFrame];
+        uint32_t imgIdx = acquired.value();
 
-        // do the renderings here
+        if (m_SwapchainGeneration != m_App->getSwapchainGeneration()) {
+            buildGraph();
+        }
 
-        std::vector<vk::Semaphore> waitSemaphores = { m_ImageAvailableSemaphores[m_CurrentFrame] };
-        std::vector<vk::Semaphore> signalSemaphores = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-        std::vector<vk::PipelineStageFlags> waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+        // do the renderings here
 
-        vk::CommandBuffer commandBuffer = m_RenderCommandBuffers[m_CurrentFrame];
+        // everything uploaded since the last frame goes out as one batch
+        UploadService& uploads = m_App->getUploadService();
+        uploads.flush();
 
-        vk::SubmitInfo renderSubmit{};
-        renderSubmit.setCommandBuffers(commandBuffer);
-        renderSubmit.setWaitSemaphores(waitSemaphores);
-        renderSubmit.setWaitDstStageMask(waitStages);
-        renderSubmit.setSignalSemaphores(signalSemaphores);
+        vk::CommandBuffer* commandBuffers = arena.create<vk::CommandBuffer>(m_RenderCommandBuffers[m_CurrentFrame]);
+        vk::CommandBuffer commandBuffer = *commandBuffers;
 
         // record new commands
 
         commandBuffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-        commandBuffer.beginRenderPass(vk::RenderPassBeginInfo{
-            m_RenderPass, m_Framebuffers[imgIdx], vk::Rect2D{
-                vk::Offset2D{0, 0}, m_App->getSwapchainExtent()
-            }, m_ClearValue }, vk::SubpassContents::eInline);
-        commandBuffer.endRenderPass();
+        m_GpuProfiler.beginFrame(commandBuffer, m_CurrentFrame);
+
+        // the frame just read back picks this frame's resolution
+        ResolutionController& resolution = m_App->getClock().getResolutionController();
+        if (std::optional<double> gpuTime = m_GpuProfiler.getCollectedFrameTime()) {
+            resolution.update(*gpuTime);
+        }
+        m_RenderExtent = resolution.getScaledExtent(m_App->getSwapchainExtent());
+        if (m_Upscaling) {
+            m_Graph.setRenderArea(m_SceneColor, m_RenderExtent);
+        }
+
+        uint32_t frameScope = m_GpuProfiler.beginScope(commandBuffer, "frame");
+
+        UploadToken uploadToken = uploads.recordAcquireBarriers(commandBuffer);
+        bool waitForUploads = !uploads.isComplete(uploadToken);
+
+        m_PendingItemCount = itemCount;
+        m_PendingRecordFn = recordFn;
+        m_Graph.bindImage(m_Backbuffer, m_App->getSwapchainImages()[imgIdx], m_App->getSwapchainImageViews()[imgIdx]);
+        m_Graph.execute(commandBuffer, &m_GpuProfiler);
+        m_PendingRecordFn = {};
+
+        m_GpuProfiler.endScope(commandBuffer, frameScope);
         commandBuffer.end();
 
+        size_t waitCount = waitForUploads ? 2 : 1;
+        std::span<vk::Semaphore> waitSemaphores = arena.allocateArray<vk::Semaphore>(waitCount);
+        std::span<vk::PipelineStageFlags> waitStages = arena.allocateArray<vk::PipelineStageFlags>(waitCount);
+        std::span<uint64_t> waitValues = arena.allocateArray<uint64_t>(waitCount);
+        std::span<vk::Semaphore> signalSemaphores = arena.allocateArray<vk::Semaphore>(2);
+        std::span<uint64_t> signalValues = arena.allocateArray<uint64_t>(2);
+        waitSemaphores[0] = m_ImageAvailableSemaphores[m_CurrentFrame];
+        waitStages[0] = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        waitValues[0] = 0;
+        if (waitForUploads) {
+            waitSemaphores[1] = uploads.getTimelineSemaphore();
+            waitStages[1] = vk::PipelineStageFlagBits::eAllCommands;
+            waitValues[1] = uploadToken;
+        }
+        signalSemaphores[0] = m_RenderFinishedSemaphores[m_CurrentFrame];
+        signalValues[0] = 0;
+        signalSemaphores[1] = m_App->getFrameTimeline();
+        signalValues[1] = frameNumber;
+
+        // the values of binary semaphores are ignored
+        vk::TimelineSemaphoreSubmitInfo* timelineSubmit = arena.create<vk::TimelineSemaphoreSubmitInfo>();
+        timelineSubmit->setWaitSemaphoreValueCount(static_cast<uint32_t>(waitValues.size())).setPWaitSemaphoreValues(waitValues.data());
+        timelineSubmit->setSignalSemaphoreValueCount(static_cast<uint32_t>(signalValues.size())).setPSignalSemaphoreValues(signalValues.data());
+
+        vk::SubmitInfo* renderSubmit = arena.create<vk::SubmitInfo>();
+        renderSubmit->setCommandBufferCount(1).setPCommandBuffers(commandBuffers);
+        renderSubmit->setWaitSemaphoreCount(static_cast<uint32_t>(waitSemaphores.size())).setPWaitSemaphores(waitSemaphores.data());
+        renderSubmit->setPWaitDstStageMask(waitStages.data());
+        renderSubmit->setSignalSemaphoreCount(static_cast<uint32_t>(signalSemaphores.size())).setPSignalSemaphores(signalSemaphores.data());
+        renderSubmit->setPNext(timelineSubmit);
+
         // submit queue
-        m_App->getDevice().resetFences(m_InFlightFences[m_CurrentFrame]);
-        m_App->getGraphicsQueue().submit(renderSubmit, m_InFlightFences[m_CurrentFrame]);
+        {
+            std::lock_guard queueLock(m_App->getGraphicsQueueMutex());
+            m_App->getGraphicsQueue().submit(*renderSubmit);
+        }
 
         // done rendering
 
         // present image
-        auto swapchain = m_App->getSwapchain();
+        m_App->presentImage(imgIdx, m_RenderFinishedSemaphores[m_CurrentFrame]);
+        m_Recording = false;
+
+        if constexpr (debug::kAllocationCountingEnabled) {
+            size_t allocations = debug::getThreadAllocationCount() - allocationsBefore;
+            if (++m_RenderedFrames > kAllocationCheckWarmupFrames && allocations != 0 && !m_ReportedFrameAllocations) {
+                spdlog::warn("Renderer::render made {} heap allocations in steady state (frame {})", allocations, m_RenderedFrames);
+                m_ReportedFrameAllocations = true;
+            }
+        }
+
+        // after the allocation check, capturing allocates
+        FrameCapture* capture = m_App->getFrameCapture();
+        if (capture && !capture->isFinished()) {
+            captureFrame(*capture, frameNumber, itemCount, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+    }
+
+    void Renderer::captureFrame(FrameCapture &capture, uint64_t frameNumber, size_t itemCount, double cpuTime) {
+        CapturedFrame frame{};
+        frame.number = frameNumber;
+        frame.cpuTime = cpuTime;
+        frame.resolutionScale = m_App->getClock().getResolutionController().getScale();
+        frame.drawItems = itemCount;
+        frame.scene = m_Scene ? capture.getSceneId(m_Scene) : FrameCapture::kNoScene;
+        m_Graph.forEachLivePass([&](const char* name, PassType type, vk::Extent2D extent) {
+            frame.passes.push_back(CapturedPass{name, type, extent});
+        });
+        capture.recordFrame(frame);
+    }
+
+    GpuProfiler &Renderer::getGpuProfiler() {
+        return m_GpuProfiler;
+    }
+
+    vk::RenderPass Renderer::getRenderPass() {
+        return m_Graph.getRenderPass("main_pass");
+    }
+
+    RenderGraph &Renderer::getRenderGraph() {
+        return m_Graph;
+    }
+
+    vk::Extent2D Renderer::getRenderExtent() const noexcept {
+        return m_RenderExtent;
+    }
 
-        vk::PresentInfoKHR presentInfo{};
-        presentInfo.setWaitSemaphores(signalSemaphores);
-        presentInfo.setSwapchains(swapchain);
-        presentInfo.setImageIndices(imgIdx);
+    void Renderer::setScene(GpuScene *scene) {
+        m_Scene = scene;
+        buildGraph();
+    }
 
-        m_App->getPresentQueue().presentKHR(presentInfo);
+    GpuScene *Renderer::getScene() const noexcept {
+        return m_Scene;
+    }
 
-        m_CurrentFrame = (m_CurrentFrame + 1) % kMaxFramesInFlight;
+    LinearArena &Renderer::getFrameArena() {
+        if (!m_Recording) {
+            spdlog::error("The frame arena is only valid while Renderer::render records a frame");
+            throw std::runtime_error("Frame arena used outside render()");
+        }
+        return m_FrameArenas[m_CurrentFrame];
     }
 
 }
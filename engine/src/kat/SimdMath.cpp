@@ -0,0 +1,283 @@
+#include "SimdMathKernels.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(KAT_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace kat {
+
+    namespace {
+        SimdLevel detectSimdLevel() noexcept {
+#if defined(KAT_SIMD_X86) && defined(_MSC_VER)
+            std::array<int, 4> info{};
+            __cpuid(info.data(), 0);
+            int maxLeaf = info[0];
+            __cpuid(info.data(), 1);
+            bool sse41 = info[2] & (1 << 19);
+            bool fma = info[2] & (1 << 12);
+            // the OS has to save the upper halves of the YMM registers too
+            bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+            bool avx2 = false;
+            if (maxLeaf >= 7) {
+                __cpuidex(info.data(), 7, 0);
+                avx2 = info[1] & (1 << 5);
+            }
+            if (avx && avx2 && fma) {
+                return SimdLevel::eAvx2;
+            }
+            return sse41 ? SimdLevel::eSse4 : SimdLevel::eScalar;
+#elif defined(KAT_SIMD_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+                return SimdLevel::eAvx2;
+            }
+            return __builtin_cpu_supports("sse4.1") ? SimdLevel::eSse4 : SimdLevel::eScalar;
+#else
+            return SimdLevel::eScalar;
+#endif
+        }
+
+        // The reference implementations: plain glm, one element at a time from `begin` on.
+
+        void multiplyMatricesScalar(const glm::mat4* parents, const glm::mat4* locals, glm::mat4* out, size_t begin, size_t count) {
+            for (size_t i = begin; i < count; i++) {
+                out[i] = parents[i] * locals[i];
+            }
+        }
+
+        void transformSpheresScalar(const glm::mat4* transforms, const SphereArray& local, SphereArray& world, size_t begin) {
+            for (size_t i = begin; i < local.size(); i++) {
+                const glm::mat4& m = transforms[i];
+                glm::vec3 center = glm::vec3(m * glm::vec4(local.x[i], local.y[i], local.z[i], 1.0f));
+                float scale = std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])), glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))});
+                world.set(i, glm::vec4(center, local.radius[i] * std::sqrt(scale)));
+            }
+        }
+
+        void transformAabbsScalar(const glm::mat4* transforms, const AabbArray& local, AabbArray& world, size_t begin) {
+            for (size_t i = begin; i < local.size(); i++) {
+                const glm::mat4& m = transforms[i];
+                glm::vec3 center = glm::vec3(m * glm::vec4(local.centerX[i], local.centerY[i], local.centerZ[i], 1.0f));
+                glm::vec3 extent = glm::abs(glm::mat3(m)) * glm::vec3(local.extentX[i], local.extentY[i], local.extentZ[i]);
+                world.centerX[i] = center.x;
+                world.centerY[i] = center.y;
+                world.centerZ[i] = center.z;
+                world.extentX[i] = extent.x;
+                world.extentY[i] = extent.y;
+                world.extentZ[i] = extent.z;
+            }
+        }
+
+        // `begin` is a multiple of kSimdGroupSize
+        template<typename Visible>
+        void cullScalar(size_t begin, size_t count, uint8_t* visible, Visible&& isVisible) {
+            for (size_t group = begin; group < count; group += kSimdGroupSize) {
+                uint8_t mask = 0;
+                for (size_t lane = 0; lane < kSimdGroupSize && group + lane < count; lane++) {
+                    if (isVisible(group + lane)) {
+                        mask |= static_cast<uint8_t>(1U << lane);
+                    }
+                }
+                visible[group / kSimdGroupSize] = mask;
+            }
+        }
+
+        static_assert(sizeof(glm::mat4) == 16 * sizeof(float) && sizeof(glm::vec4) == 4 * sizeof(float));
+
+        const float* getFloats(std::span<const glm::mat4> matrices) {
+            return reinterpret_cast<const float*>(matrices.data());
+        }
+
+        SphereStreams<const float> getStreams(const SphereArray& spheres) {
+            return {spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.radius.data(), spheres.size()};
+        }
+
+        SphereStreams<float> getStreams(SphereArray& spheres) {
+            return {spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.radius.data(), spheres.size()};
+        }
+
+        AabbStreams<const float> getStreams(const AabbArray& aabbs) {
+            return {aabbs.centerX.data(), aabbs.centerY.data(), aabbs.centerZ.data(), aabbs.extentX.data(), aabbs.extentY.data(), aabbs.extentZ.data(), aabbs.size()};
+        }
+
+        AabbStreams<float> getStreams(AabbArray& aabbs) {
+            return {aabbs.centerX.data(), aabbs.centerY.data(), aabbs.centerZ.data(), aabbs.extentX.data(), aabbs.extentY.data(), aabbs.extentZ.data(), aabbs.size()};
+        }
+
+        std::atomic<SimdLevel> s_Level{getSupportedSimdLevel()};
+
+        const SimdKernels* getKernels() noexcept {
+            switch (s_Level.load(std::memory_order_relaxed)) {
+                case SimdLevel::eAvx2:
+                    return getAvx2Kernels();
+                case SimdLevel::eSse4:
+                    return getSse4Kernels();
+                default:
+                    return nullptr;
+            }
+        }
+
+        void checkSize(size_t expected, size_t size, const char* what) {
+            if (size != expected) {
+                spdlog::error("ERROR: {} HAS {} ELEMENTS, EXPECTED {}", what, size, expected);
+                throw std::runtime_error("Mismatched batch sizes");
+            }
+        }
+    }
+
+    SimdLevel getSupportedSimdLevel() noexcept {
+        static const SimdLevel level = detectSimdLevel();
+        return level;
+    }
+
+    SimdLevel getSimdLevel() noexcept {
+        return s_Level.load(std::memory_order_relaxed);
+    }
+
+    void setSimdLevel(SimdLevel level) noexcept {
+        s_Level.store(std::min(level, getSupportedSimdLevel()), std::memory_order_relaxed);
+    }
+
+    std::string_view getSimdLevelName(SimdLevel level) noexcept {
+        switch (level) {
+            case SimdLevel::eAvx2:
+                return "avx2";
+            case SimdLevel::eSse4:
+                return "sse4";
+            default:
+                return "scalar";
+        }
+    }
+
+    void SphereArray::resize(size_t count) {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        radius.resize(count);
+    }
+
+    void SphereArray::set(size_t index, glm::vec4 sphere) {
+        x[index] = sphere.x;
+        y[index] = sphere.y;
+        z[index] = sphere.z;
+        radius[index] = sphere.w;
+    }
+
+    glm::vec4 SphereArray::get(size_t index) const {
+        return glm::vec4{x[index], y[index], z[index], radius[index]};
+    }
+
+    void AabbArray::resize(size_t count) {
+        centerX.resize(count);
+        centerY.resize(count);
+        centerZ.resize(count);
+        extentX.resize(count);
+        extentY.resize(count);
+        extentZ.resize(count);
+    }
+
+    void AabbArray::set(size_t index, glm::vec3 min, glm::vec3 max) {
+        glm::vec3 center = (min + max) * 0.5f;
+        glm::vec3 extent = (max - min) * 0.5f;
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        extentX[index] = extent.x;
+        extentY[index] = extent.y;
+        extentZ[index] = extent.z;
+    }
+
+    glm::vec3 AabbArray::getMin(size_t index) const {
+        return glm::vec3{centerX[index] - extentX[index], centerY[index] - extentY[index], centerZ[index] - extentZ[index]};
+    }
+
+    glm::vec3 AabbArray::getMax(size_t index) const {
+        return glm::vec3{centerX[index] + extentX[index], centerY[index] + extentY[index], centerZ[index] + extentZ[index]};
+    }
+
+    FrustumPlanes getFrustumPlanes(const glm::mat4 &viewProjection) {
+        const glm::mat4 rows = glm::transpose(viewProjection);
+        auto normalizePlane = [](glm::vec4 plane) {
+            return plane / glm::length(glm::vec3(plane));
+        };
+        return {
+            normalizePlane(rows[3] + rows[0]),
+            normalizePlane(rows[3] - rows[0]),
+            normalizePlane(rows[3] + rows[1]),
+            normalizePlane(rows[3] - rows[1]),
+            // Vulkan depth range, 0 to 1
+            normalizePlane(rows[2]),
+            normalizePlane(rows[3] - rows[2])
+        };
+    }
+
+    void multiplyMatrices(std::span<const glm::mat4> parents, std::span<const glm::mat4> locals, std::span<glm::mat4> out) {
+        checkSize(parents.size(), locals.size(), "LOCAL MATRICES");
+        checkSize(parents.size(), out.size(), "OUTPUT MATRICES");
+
+        size_t done = 0;
+        if (const SimdKernels* kernels = getKernels()) {
+            done = kernels->multiplyMatrices(getFloats(parents), getFloats(locals), reinterpret_cast<float*>(out.data()), out.size());
+        }
+        multiplyMatricesScalar(parents.data(), locals.data(), out.data(), done, out.size());
+    }
+
+    void transformSpheres(std::span<const glm::mat4> transforms, const SphereArray &local, SphereArray &world) {
+        checkSize(local.size(), transforms.size(), "SPHERE TRANSFORMS");
+        world.resize(local.size());
+
+        size_t done = 0;
+        if (const SimdKernels* kernels = getKernels()) {
+            done = kernels->transformSpheres(getFloats(transforms), getStreams(local), getStreams(world));
+        }
+        transformSpheresScalar(transforms.data(), local, world, done);
+    }
+
+    void transformAabbs(std::span<const glm::mat4> transforms, const AabbArray &local, AabbArray &world) {
+        checkSize(local.size(), transforms.size(), "AABB TRANSFORMS");
+        world.resize(local.size());
+
+        size_t done = 0;
+        if (const SimdKernels* kernels = getKernels()) {
+            done = kernels->transformAabbs(getFloats(transforms), getStreams(local), getStreams(world));
+        }
+        transformAabbsScalar(transforms.data(), local, world, done);
+    }
+
+    void cullSpheres(const FrustumPlanes &planes, const SphereArray &spheres, std::span<uint8_t> visible) {
+        checkSize(getSimdGroupCount(spheres.size()), visible.size(), "SPHERE VISIBILITY MASKS");
+
+        size_t done = 0;
+        if (const SimdKernels* kernels = getKernels()) {
+            done = kernels->cullSpheres(&planes[0].x, getStreams(spheres), visible.data());
+        }
+        cullScalar(done, spheres.size(), visible.data(), [&](size_t i) {
+            glm::vec3 center{spheres.x[i], spheres.y[i], spheres.z[i]};
+            return std::all_of(planes.begin(), planes.end(), [&](const glm::vec4& plane) {
+                return glm::dot(glm::vec3(plane), center) + plane.w >= -spheres.radius[i];
+            });
+        });
+    }
+
+    void cullAabbs(const FrustumPlanes &planes, const AabbArray &aabbs, std::span<uint8_t> visible) {
+        checkSize(getSimdGroupCount(aabbs.size()), visible.size(), "AABB VISIBILITY MASKS");
+
+        size_t done = 0;
+        if (const SimdKernels* kernels = getKernels()) {
+            done = kernels->cullAabbs(&planes[0].x, getStreams(aabbs), visible.data());
+        }
+        cullScalar(done, aabbs.size(), visible.data(), [&](size_t i) {
+            glm::vec3 center{aabbs.centerX[i], aabbs.centerY[i], aabbs.centerZ[i]};
+            glm::vec3 extent{aabbs.extentX[i], aabbs.extentY[i], aabbs.extentZ[i]};
+            return std::all_of(planes.begin(), planes.end(), [&](const glm::vec4& plane) {
+                return glm::dot(glm::vec3(plane), center) + plane.w >= -glm::dot(glm::abs(glm::vec3(plane)), extent);
+            });
+        });
+    }
+}
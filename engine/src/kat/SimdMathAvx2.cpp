@@ -0,0 +1,200 @@
+#include "SimdMathKernels.h"
+
+#ifdef KAT_SIMD_X86
+#include <immintrin.h>
+
+namespace kat {
+
+    namespace {
+        // elements[c][r] holds column c, row r of eight consecutive matrices, one per lane
+        using Elements = __m256[4][4];
+
+        void loadMatrices(const float* matrices, Elements& elements) {
+            for (int c = 0; c < 4; c++) {
+                // matrix k in the low half and k + 4 in the high half, then a 4x4 transpose within each half
+                __m256 m[4];
+                for (int k = 0; k < 4; k++) {
+                    m[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(matrices + k * 16 + c * 4)), _mm_loadu_ps(matrices + (k + 4) * 16 + c * 4), 1);
+                }
+                __m256 t0 = _mm256_unpacklo_ps(m[0], m[1]);
+                __m256 t1 = _mm256_unpacklo_ps(m[2], m[3]);
+                __m256 t2 = _mm256_unpackhi_ps(m[0], m[1]);
+                __m256 t3 = _mm256_unpackhi_ps(m[2], m[3]);
+                elements[c][0] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+                elements[c][1] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+                elements[c][2] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+                elements[c][3] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+            }
+        }
+
+        __m256 transformPoint(const Elements& m, int row, __m256 x, __m256 y, __m256 z) {
+            __m256 result = _mm256_fmadd_ps(m[0][row], x, m[3][row]);
+            result = _mm256_fmadd_ps(m[1][row], y, result);
+            return _mm256_fmadd_ps(m[2][row], z, result);
+        }
+
+        __m256 lengthSquared(const Elements& m, int column) {
+            __m256 result = _mm256_mul_ps(m[column][0], m[column][0]);
+            result = _mm256_fmadd_ps(m[column][1], m[column][1], result);
+            return _mm256_fmadd_ps(m[column][2], m[column][2], result);
+        }
+
+        __m256 abs(__m256 value) {
+            return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value);
+        }
+
+        size_t multiplyMatrices(const float* parents, const float* locals, float* out, size_t count) {
+            for (size_t i = 0; i < count * 16; i += 16) {
+                // each parent column in both halves, so one register holds two result columns
+                __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parents + i));
+                __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parents + i + 4));
+                __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parents + i + 8));
+                __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(parents + i + 12));
+
+                // every column is read before anything is stored, so `out` may alias the inputs
+                __m256 columns[2];
+                for (int c = 0; c < 2; c++) {
+                    __m256 b = _mm256_loadu_ps(locals + i + c * 8);
+                    __m256 result = _mm256_mul_ps(a0, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+                    result = _mm256_fmadd_ps(a1, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)), result);
+                    result = _mm256_fmadd_ps(a2, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)), result);
+                    columns[c] = _mm256_fmadd_ps(a3, _mm256_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)), result);
+                }
+                _mm256_storeu_ps(out + i, columns[0]);
+                _mm256_storeu_ps(out + i + 8, columns[1]);
+            }
+            return count;
+        }
+
+        size_t transformSpheres(const float* transforms, SphereStreams<const float> local, SphereStreams<float> world) {
+            size_t i = 0;
+            for (; i + 8 <= local.count; i += 8) {
+                Elements m;
+                loadMatrices(transforms + i * 16, m);
+
+                __m256 x = _mm256_loadu_ps(local.x + i);
+                __m256 y = _mm256_loadu_ps(local.y + i);
+                __m256 z = _mm256_loadu_ps(local.z + i);
+                __m256 scale = _mm256_max_ps(lengthSquared(m, 0), _mm256_max_ps(lengthSquared(m, 1), lengthSquared(m, 2)));
+
+                _mm256_storeu_ps(world.x + i, transformPoint(m, 0, x, y, z));
+                _mm256_storeu_ps(world.y + i, transformPoint(m, 1, x, y, z));
+                _mm256_storeu_ps(world.z + i, transformPoint(m, 2, x, y, z));
+                _mm256_storeu_ps(world.radius + i, _mm256_mul_ps(_mm256_loadu_ps(local.radius + i), _mm256_sqrt_ps(scale)));
+            }
+            return i;
+        }
+
+        size_t transformAabbs(const float* transforms, AabbStreams<const float> local, AabbStreams<float> world) {
+            size_t i = 0;
+            for (; i + 8 <= local.count; i += 8) {
+                Elements m;
+                loadMatrices(transforms + i * 16, m);
+
+                __m256 x = _mm256_loadu_ps(local.centerX + i);
+                __m256 y = _mm256_loadu_ps(local.centerY + i);
+                __m256 z = _mm256_loadu_ps(local.centerZ + i);
+                __m256 ex = _mm256_loadu_ps(local.extentX + i);
+                __m256 ey = _mm256_loadu_ps(local.extentY + i);
+                __m256 ez = _mm256_loadu_ps(local.extentZ + i);
+
+                _mm256_storeu_ps(world.centerX + i, transformPoint(m, 0, x, y, z));
+                _mm256_storeu_ps(world.centerY + i, transformPoint(m, 1, x, y, z));
+                _mm256_storeu_ps(world.centerZ + i, transformPoint(m, 2, x, y, z));
+
+                float* extents[3] = {world.extentX + i, world.extentY + i, world.extentZ + i};
+                for (int row = 0; row < 3; row++) {
+                    __m256 extent = _mm256_mul_ps(abs(m[0][row]), ex);
+                    extent = _mm256_fmadd_ps(abs(m[1][row]), ey, extent);
+                    extent = _mm256_fmadd_ps(abs(m[2][row]), ez, extent);
+                    _mm256_storeu_ps(extents[row], extent);
+                }
+            }
+            return i;
+        }
+
+        // the planes' components broadcast to every lane, with the normals' absolute values for boxes
+        struct Planes {
+            __m256 x[6], y[6], z[6], w[6];
+            __m256 absX[6], absY[6], absZ[6];
+
+            explicit Planes(const float* planes) {
+                for (int p = 0; p < 6; p++) {
+                    x[p] = _mm256_set1_ps(planes[p * 4]);
+                    y[p] = _mm256_set1_ps(planes[p * 4 + 1]);
+                    z[p] = _mm256_set1_ps(planes[p * 4 + 2]);
+                    w[p] = _mm256_set1_ps(planes[p * 4 + 3]);
+                    absX[p] = abs(x[p]);
+                    absY[p] = abs(y[p]);
+                    absZ[p] = abs(z[p]);
+                }
+            }
+
+            __m256 getDistance(int p, __m256 px, __m256 py, __m256 pz) const {
+                __m256 distance = _mm256_fmadd_ps(x[p], px, w[p]);
+                distance = _mm256_fmadd_ps(y[p], py, distance);
+                return _mm256_fmadd_ps(z[p], pz, distance);
+            }
+        };
+
+        size_t cullSpheres(const float* frustum, SphereStreams<const float> spheres, uint8_t* visible) {
+            const Planes planes(frustum);
+            size_t i = 0;
+            for (; i + kSimdGroupSize <= spheres.count; i += kSimdGroupSize) {
+                __m256 x = _mm256_loadu_ps(spheres.x + i);
+                __m256 y = _mm256_loadu_ps(spheres.y + i);
+                __m256 z = _mm256_loadu_ps(spheres.z + i);
+                __m256 radius = _mm256_loadu_ps(spheres.radius + i);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int p = 0; p < 6; p++) {
+                    __m256 distance = _mm256_add_ps(planes.getDistance(p, x, y, z), radius);
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+                }
+                visible[i / kSimdGroupSize] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+            }
+            return i;
+        }
+
+        size_t cullAabbs(const float* frustum, AabbStreams<const float> aabbs, uint8_t* visible) {
+            const Planes planes(frustum);
+            size_t i = 0;
+            for (; i + kSimdGroupSize <= aabbs.count; i += kSimdGroupSize) {
+                __m256 x = _mm256_loadu_ps(aabbs.centerX + i);
+                __m256 y = _mm256_loadu_ps(aabbs.centerY + i);
+                __m256 z = _mm256_loadu_ps(aabbs.centerZ + i);
+                __m256 ex = _mm256_loadu_ps(aabbs.extentX + i);
+                __m256 ey = _mm256_loadu_ps(aabbs.extentY + i);
+                __m256 ez = _mm256_loadu_ps(aabbs.extentZ + i);
+
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int p = 0; p < 6; p++) {
+                    // the box's extent along the plane normal
+                    __m256 reach = _mm256_mul_ps(planes.absX[p], ex);
+                    reach = _mm256_fmadd_ps(planes.absY[p], ey, reach);
+                    reach = _mm256_fmadd_ps(planes.absZ[p], ez, reach);
+                    __m256 distance = _mm256_add_ps(planes.getDistance(p, x, y, z), reach);
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+                }
+                visible[i / kSimdGroupSize] = static_cast<uint8_t>(_mm256_movemask_ps(inside));
+            }
+            return i;
+        }
+
+        constexpr SimdKernels kKernels{multiplyMatrices, transformSpheres, transformAabbs, cullSpheres, cullAabbs};
+    }
+
+    const SimdKernels* getAvx2Kernels() noexcept {
+        return &kKernels;
+    }
+}
+
+#else
+
+namespace kat {
+    const SimdKernels* getAvx2Kernels() noexcept {
+        return nullptr;
+    }
+}
+
+#endif
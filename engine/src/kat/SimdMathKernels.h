@@ -0,0 +1,48 @@
+#pragma once
+
+#include "kat/SimdMath.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KAT_SIMD_X86 1
+#endif
+
+namespace kat {
+
+    // The kernels are compiled with their instruction set enabled, so they must not call inline functions (glm,
+    // std::vector, ...) the rest of the engine also instantiates: the linker may keep the AVX2 copy for everyone.
+    // Their inputs are plain arrays instead. Matrices are 16 column-major floats each, planes 4 floats each.
+
+    template<typename Float>
+    struct SphereStreams {
+        Float* x;
+        Float* y;
+        Float* z;
+        Float* radius;
+        size_t count;
+    };
+
+    template<typename Float>
+    struct AabbStreams {
+        Float* centerX;
+        Float* centerY;
+        Float* centerZ;
+        Float* extentX;
+        Float* extentY;
+        Float* extentZ;
+        size_t count;
+    };
+
+    // One instruction set's kernels. Each works through as much of its input as its lanes allow and returns where
+    // it stopped, the scalar kernels do the rest. The culling kernels always stop on a group boundary.
+    struct SimdKernels {
+        size_t (*multiplyMatrices)(const float* parents, const float* locals, float* out, size_t count);
+        size_t (*transformSpheres)(const float* transforms, SphereStreams<const float> local, SphereStreams<float> world);
+        size_t (*transformAabbs)(const float* transforms, AabbStreams<const float> local, AabbStreams<float> world);
+        size_t (*cullSpheres)(const float* planes, SphereStreams<const float> spheres, uint8_t* visible);
+        size_t (*cullAabbs)(const float* planes, AabbStreams<const float> aabbs, uint8_t* visible);
+    };
+
+    // null when the engine isn't built for x86
+    const SimdKernels* getSse4Kernels() noexcept;
+    const SimdKernels* getAvx2Kernels() noexcept;
+}
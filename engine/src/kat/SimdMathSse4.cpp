@@ -0,0 +1,208 @@
+#include "SimdMathKernels.h"
+
+#ifdef KAT_SIMD_X86
+#include <smmintrin.h>
+
+namespace kat {
+
+    namespace {
+        // elements[c][r] holds column c, row r of four consecutive matrices, one per lane
+        using Elements = __m128[4][4];
+
+        void loadMatrices(const float* matrices, Elements& elements) {
+            for (int c = 0; c < 4; c++) {
+                __m128 m0 = _mm_loadu_ps(matrices + c * 4);
+                __m128 m1 = _mm_loadu_ps(matrices + 16 + c * 4);
+                __m128 m2 = _mm_loadu_ps(matrices + 32 + c * 4);
+                __m128 m3 = _mm_loadu_ps(matrices + 48 + c * 4);
+                _MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+                elements[c][0] = m0;
+                elements[c][1] = m1;
+                elements[c][2] = m2;
+                elements[c][3] = m3;
+            }
+        }
+
+        __m128 transformPoint(const Elements& m, int row, __m128 x, __m128 y, __m128 z) {
+            __m128 result = _mm_add_ps(_mm_mul_ps(m[0][row], x), m[3][row]);
+            result = _mm_add_ps(result, _mm_mul_ps(m[1][row], y));
+            return _mm_add_ps(result, _mm_mul_ps(m[2][row], z));
+        }
+
+        __m128 lengthSquared(const Elements& m, int column) {
+            __m128 result = _mm_mul_ps(m[column][0], m[column][0]);
+            result = _mm_add_ps(result, _mm_mul_ps(m[column][1], m[column][1]));
+            return _mm_add_ps(result, _mm_mul_ps(m[column][2], m[column][2]));
+        }
+
+        __m128 abs(__m128 value) {
+            return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+        }
+
+        size_t multiplyMatrices(const float* parents, const float* locals, float* out, size_t count) {
+            for (size_t i = 0; i < count * 16; i += 16) {
+                __m128 a0 = _mm_loadu_ps(parents + i);
+                __m128 a1 = _mm_loadu_ps(parents + i + 4);
+                __m128 a2 = _mm_loadu_ps(parents + i + 8);
+                __m128 a3 = _mm_loadu_ps(parents + i + 12);
+
+                // every column is read before anything is stored, so `out` may alias the inputs
+                __m128 columns[4];
+                for (int c = 0; c < 4; c++) {
+                    __m128 b = _mm_loadu_ps(locals + i + c * 4);
+                    __m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+                    result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+                    result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+                    columns[c] = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+                }
+                for (int c = 0; c < 4; c++) {
+                    _mm_storeu_ps(out + i + c * 4, columns[c]);
+                }
+            }
+            return count;
+        }
+
+        size_t transformSpheres(const float* transforms, SphereStreams<const float> local, SphereStreams<float> world) {
+            size_t i = 0;
+            for (; i + 4 <= local.count; i += 4) {
+                Elements m;
+                loadMatrices(transforms + i * 16, m);
+
+                __m128 x = _mm_loadu_ps(local.x + i);
+                __m128 y = _mm_loadu_ps(local.y + i);
+                __m128 z = _mm_loadu_ps(local.z + i);
+                __m128 scale = _mm_max_ps(lengthSquared(m, 0), _mm_max_ps(lengthSquared(m, 1), lengthSquared(m, 2)));
+
+                _mm_storeu_ps(world.x + i, transformPoint(m, 0, x, y, z));
+                _mm_storeu_ps(world.y + i, transformPoint(m, 1, x, y, z));
+                _mm_storeu_ps(world.z + i, transformPoint(m, 2, x, y, z));
+                _mm_storeu_ps(world.radius + i, _mm_mul_ps(_mm_loadu_ps(local.radius + i), _mm_sqrt_ps(scale)));
+            }
+            return i;
+        }
+
+        size_t transformAabbs(const float* transforms, AabbStreams<const float> local, AabbStreams<float> world) {
+            size_t i = 0;
+            for (; i + 4 <= local.count; i += 4) {
+                Elements m;
+                loadMatrices(transforms + i * 16, m);
+
+                __m128 x = _mm_loadu_ps(local.centerX + i);
+                __m128 y = _mm_loadu_ps(local.centerY + i);
+                __m128 z = _mm_loadu_ps(local.centerZ + i);
+                __m128 ex = _mm_loadu_ps(local.extentX + i);
+                __m128 ey = _mm_loadu_ps(local.extentY + i);
+                __m128 ez = _mm_loadu_ps(local.extentZ + i);
+
+                _mm_storeu_ps(world.centerX + i, transformPoint(m, 0, x, y, z));
+                _mm_storeu_ps(world.centerY + i, transformPoint(m, 1, x, y, z));
+                _mm_storeu_ps(world.centerZ + i, transformPoint(m, 2, x, y, z));
+
+                float* extents[3] = {world.extentX + i, world.extentY + i, world.extentZ + i};
+                for (int row = 0; row < 3; row++) {
+                    __m128 extent = _mm_mul_ps(abs(m[0][row]), ex);
+                    extent = _mm_add_ps(extent, _mm_mul_ps(abs(m[1][row]), ey));
+                    extent = _mm_add_ps(extent, _mm_mul_ps(abs(m[2][row]), ez));
+                    _mm_storeu_ps(extents[row], extent);
+                }
+            }
+            return i;
+        }
+
+        // the planes' components broadcast to every lane, with the normals' absolute values for boxes
+        struct Planes {
+            __m128 x[6], y[6], z[6], w[6];
+            __m128 absX[6], absY[6], absZ[6];
+
+            explicit Planes(const float* planes) {
+                for (int p = 0; p < 6; p++) {
+                    x[p] = _mm_set1_ps(planes[p * 4]);
+                    y[p] = _mm_set1_ps(planes[p * 4 + 1]);
+                    z[p] = _mm_set1_ps(planes[p * 4 + 2]);
+                    w[p] = _mm_set1_ps(planes[p * 4 + 3]);
+                    absX[p] = abs(x[p]);
+                    absY[p] = abs(y[p]);
+                    absZ[p] = abs(z[p]);
+                }
+            }
+
+            __m128 getDistance(int p, __m128 px, __m128 py, __m128 pz) const {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(x[p], px), w[p]);
+                distance = _mm_add_ps(distance, _mm_mul_ps(y[p], py));
+                return _mm_add_ps(distance, _mm_mul_ps(z[p], pz));
+            }
+        };
+
+        // four lanes of sphere visibility
+        int cullSpheres(const Planes& planes, SphereStreams<const float> spheres, size_t i) {
+            __m128 x = _mm_loadu_ps(spheres.x + i);
+            __m128 y = _mm_loadu_ps(spheres.y + i);
+            __m128 z = _mm_loadu_ps(spheres.z + i);
+            __m128 radius = _mm_loadu_ps(spheres.radius + i);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++) {
+                __m128 distance = _mm_add_ps(planes.getDistance(p, x, y, z), radius);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+            }
+            return _mm_movemask_ps(inside);
+        }
+
+        // four lanes of box visibility
+        int cullAabbs(const Planes& planes, AabbStreams<const float> aabbs, size_t i) {
+            __m128 x = _mm_loadu_ps(aabbs.centerX + i);
+            __m128 y = _mm_loadu_ps(aabbs.centerY + i);
+            __m128 z = _mm_loadu_ps(aabbs.centerZ + i);
+            __m128 ex = _mm_loadu_ps(aabbs.extentX + i);
+            __m128 ey = _mm_loadu_ps(aabbs.extentY + i);
+            __m128 ez = _mm_loadu_ps(aabbs.extentZ + i);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++) {
+                // the box's extent along the plane normal
+                __m128 reach = _mm_mul_ps(planes.absX[p], ex);
+                reach = _mm_add_ps(reach, _mm_mul_ps(planes.absY[p], ey));
+                reach = _mm_add_ps(reach, _mm_mul_ps(planes.absZ[p], ez));
+                __m128 distance = _mm_add_ps(planes.getDistance(p, x, y, z), reach);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+            }
+            return _mm_movemask_ps(inside);
+        }
+
+        size_t cullSpheres(const float* frustum, SphereStreams<const float> spheres, uint8_t* visible) {
+            const Planes planes(frustum);
+            size_t i = 0;
+            for (; i + kSimdGroupSize <= spheres.count; i += kSimdGroupSize) {
+                int mask = cullSpheres(planes, spheres, i) | cullSpheres(planes, spheres, i + 4) << 4;
+                visible[i / kSimdGroupSize] = static_cast<uint8_t>(mask);
+            }
+            return i;
+        }
+
+        size_t cullAabbs(const float* frustum, AabbStreams<const float> aabbs, uint8_t* visible) {
+            const Planes planes(frustum);
+            size_t i = 0;
+            for (; i + kSimdGroupSize <= aabbs.count; i += kSimdGroupSize) {
+                int mask = cullAabbs(planes, aabbs, i) | cullAabbs(planes, aabbs, i + 4) << 4;
+                visible[i / kSimdGroupSize] = static_cast<uint8_t>(mask);
+            }
+            return i;
+        }
+
+        constexpr SimdKernels kKernels{multiplyMatrices, transformSpheres, transformAabbs, cullSpheres, cullAabbs};
+    }
+
+    const SimdKernels* getSse4Kernels() noexcept {
+        return &kKernels;
+    }
+}
+
+#else
+
+namespace kat {
+    const SimdKernels* getSse4Kernels() noexcept {
+        return nullptr;
+    }
+}
+
+#endif
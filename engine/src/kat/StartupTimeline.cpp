@@ -0,0 +1,83 @@
+#include "kat/StartupTimeline.h"
+#include "kat/JobSystem.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace kat {
+
+    StartupTimeline::Scope::Scope(StartupTimeline &timeline, std::string name)
+        : m_Timeline(timeline), m_Name(std::move(name)), m_Start(clock::now()) {
+    }
+
+    StartupTimeline::Scope::~Scope() {
+        m_Timeline.record(std::move(m_Name), m_Start, clock::now());
+    }
+
+    StartupTimeline::StartupTimeline() : m_Start(clock::now()), m_End(m_Start) {
+    }
+
+    StartupTimeline::Scope StartupTimeline::stage(std::string name) {
+        return Scope(*this, std::move(name));
+    }
+
+    void StartupTimeline::record(std::string name, clock::time_point start, clock::time_point end) {
+        StartupStage stage{
+            std::move(name),
+            std::chrono::duration<double>(start - m_Start).count(),
+            std::chrono::duration<double>(end - start).count(),
+            JobSystem::getCurrentWorkerIndex()
+        };
+
+        std::lock_guard lock(m_Mutex);
+        m_Stages.push_back(std::move(stage));
+    }
+
+    void StartupTimeline::finish() {
+        std::lock_guard lock(m_Mutex);
+        m_End = clock::now();
+    }
+
+    std::vector<StartupStage> StartupTimeline::getStages() const {
+        std::vector<StartupStage> stages;
+        {
+            std::lock_guard lock(m_Mutex);
+            stages = m_Stages;
+        }
+        std::stable_sort(stages.begin(), stages.end(), [](const StartupStage& a, const StartupStage& b) {
+            return a.start < b.start;
+        });
+        return stages;
+    }
+
+    double StartupTimeline::getTotal() const {
+        std::lock_guard lock(m_Mutex);
+        return std::chrono::duration<double>(m_End - m_Start).count();
+    }
+
+    void StartupTimeline::report() const {
+        std::vector<StartupStage> stages = getStages();
+        double total = getTotal();
+
+        size_t nameWidth = 0;
+        for (const StartupStage& stage : stages) {
+            nameWidth = std::max(nameWidth, stage.name.size());
+        }
+
+        spdlog::info("Startup took {:.1f} ms:", total * 1000.0);
+        for (const StartupStage& stage : stages) {
+            std::string bar(kBarWidth, ' ');
+            if (total > 0.0) {
+                auto first = static_cast<size_t>(stage.start / total * kBarWidth);
+                auto last = static_cast<size_t>((stage.start + stage.duration) / total * kBarWidth);
+                first = std::min(first, kBarWidth - 1);
+                last = std::clamp(last, first + 1, kBarWidth);
+                std::fill(bar.begin() + static_cast<ptrdiff_t>(first), bar.begin() + static_cast<ptrdiff_t>(last), '#');
+            }
+
+            std::string thread = stage.worker == JobSystem::kNotAWorker ? "-" : std::to_string(stage.worker);
+            spdlog::info("  {:<{}} |{}| {:7.1f} ms +{:7.1f} ms  worker {}", stage.name, nameWidth, bar,
+                         stage.start * 1000.0, stage.duration * 1000.0, thread);
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#include "kat/Stats.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace kat {
+
+    void FrameTimeHistogram::record(double seconds) {
+        uint64_t micros = static_cast<uint64_t>(std::max(seconds, 0.0) * 1e6);
+
+        // single writer, so plain load/store pairs are enough and avoid locked instructions
+        auto& bucket = m_Buckets[bucketIndex(micros)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        uint64_t count = m_Count.load(std::memory_order_relaxed);
+        m_Recent[count % kRecentCount].store(static_cast<uint32_t>(std::min<uint64_t>(micros, UINT32_MAX)), std::memory_order_relaxed);
+
+        m_TotalMicros.store(m_TotalMicros.load(std::memory_order_relaxed) + micros, std::memory_order_relaxed);
+        if (micros > m_MaxMicros.load(std::memory_order_relaxed)) {
+            m_MaxMicros.store(micros, std::memory_order_relaxed);
+        }
+        if (micros > m_HitchBudgetMicros.load(std::memory_order_relaxed)) {
+            m_Hitches.store(m_Hitches.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        m_Count.store(count + 1, std::memory_order_release);
+    }
+
+    void FrameTimeHistogram::reset() {
+        for (auto& bucket : m_Buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        m_TotalMicros.store(0, std::memory_order_relaxed);
+        m_MaxMicros.store(0, std::memory_order_relaxed);
+        m_Hitches.store(0, std::memory_order_relaxed);
+        m_Count.store(0, std::memory_order_release);
+    }
+
+    void FrameTimeHistogram::setHitchBudget(double seconds) {
+        m_HitchBudgetMicros.store(static_cast<uint64_t>(std::max(seconds, 0.0) * 1e6), std::memory_order_relaxed);
+    }
+
+    double FrameTimeHistogram::getHitchBudget() const {
+        return static_cast<double>(m_HitchBudgetMicros.load(std::memory_order_relaxed)) * 1e-6;
+    }
+
+    FrameStats FrameTimeHistogram::getStats() const {
+        FrameStats stats{};
+        uint64_t count = m_Count.load(std::memory_order_acquire);
+        if (count == 0) {
+            return stats;
+        }
+
+        stats.count = count;
+        stats.mean = static_cast<double>(m_TotalMicros.load(std::memory_order_relaxed)) * 1e-6 / static_cast<double>(count);
+        stats.max = static_cast<double>(m_MaxMicros.load(std::memory_order_relaxed)) * 1e-6;
+        stats.hitches = m_Hitches.load(std::memory_order_relaxed);
+
+        const std::array<double, 3> percentiles{0.50, 0.95, 0.99};
+        std::array<double*, 3> outputs{&stats.p50, &stats.p95, &stats.p99};
+
+        size_t next = 0;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount && next < percentiles.size(); i++) {
+            seen += m_Buckets[i].load(std::memory_order_relaxed);
+            while (next < percentiles.size() && static_cast<double>(seen) >= std::ceil(percentiles[next] * static_cast<double>(count))) {
+                *outputs[next] = std::min(static_cast<double>(bucketValue(i)) * 1e-6, stats.max);
+                next++;
+            }
+        }
+        // buckets may lag m_Count by one sample under a concurrent record()
+        for (; next < percentiles.size(); next++) {
+            *outputs[next] = stats.max;
+        }
+
+        return stats;
+    }
+
+    FrameStats FrameTimeHistogram::getRecentStats() const {
+        FrameStats stats{};
+        uint64_t count = std::min<uint64_t>(m_Count.load(std::memory_order_acquire), kRecentCount);
+        if (count == 0) {
+            return stats;
+        }
+
+        std::array<uint32_t, kRecentCount> samples{};
+        uint64_t budget = m_HitchBudgetMicros.load(std::memory_order_relaxed);
+        uint64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = m_Recent[i].load(std::memory_order_relaxed);
+            total += samples[i];
+            if (samples[i] > budget) {
+                stats.hitches++;
+            }
+        }
+        std::sort(samples.begin(), samples.begin() + static_cast<ptrdiff_t>(count));
+
+        auto percentile = [&](double p) {
+            size_t idx = static_cast<size_t>(std::ceil(p * static_cast<double>(count)));
+            return static_cast<double>(samples[std::clamp<size_t>(idx, 1, count) - 1]) * 1e-6;
+        };
+
+        stats.count = count;
+        stats.mean = static_cast<double>(total) * 1e-6 / static_cast<double>(count);
+        stats.p50 = percentile(0.50);
+        stats.p95 = percentile(0.95);
+        stats.p99 = percentile(0.99);
+        stats.max = static_cast<double>(samples[count - 1]) * 1e-6;
+        return stats;
+    }
+
+    size_t FrameTimeHistogram::bucketIndex(uint64_t micros) {
+        if (micros < kSubBucketCount) {
+            return micros;
+        }
+
+        // keep the top kSubBucketBits + 1 bits of the value; the shift picks the exponent bucket
+        uint32_t shift = static_cast<uint32_t>(std::bit_width(micros)) - (kSubBucketBits + 1);
+        if (shift >= kMaxExponent) {
+            return kBucketCount - 1;
+        }
+        return (shift + 1) * kSubBucketCount + ((micros >> shift) - kSubBucketCount);
+    }
+
+    uint64_t FrameTimeHistogram::bucketValue(size_t index) {
+        if (index < kSubBucketCount) {
+            return index;
+        }
+
+        uint64_t shift = index / kSubBucketCount - 1;
+        uint64_t mantissa = index % kSubBucketCount + kSubBucketCount;
+        // midpoint of [mantissa << shift, (mantissa + 1) << shift)
+        return (mantissa << shift) + ((uint64_t{1} << shift) >> 1);
+    }
+}
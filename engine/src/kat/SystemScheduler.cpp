@@ -0,0 +1,150 @@
+#include "kat/SystemScheduler.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace kat {
+
+    SystemContext::SystemContext(World &world, EntityCommands &commands, JobSystem &jobs, double dt, const char *name,
+                                 const ComponentMask &reads, const ComponentMask &writes, bool exclusive)
+        : world(world), commands(commands), jobs(jobs), dt(dt), m_Name(name), m_Reads(reads), m_Writes(writes),
+          m_Exclusive(exclusive) {
+    }
+
+    void SystemContext::checkAccess(const ComponentMask &used, const ComponentMask &written) const {
+        if (m_Exclusive) {
+            return;
+        }
+
+        ComponentMask undeclared = (used & ~(m_Reads | m_Writes)) | (written & ~m_Writes);
+        if (undeclared.any()) {
+            for (ComponentId id = 0; id < kMaxComponents; id++) {
+                if (undeclared.test(id)) {
+                    spdlog::error("System {} accesses component {} without declaring it", m_Name, getComponentInfo(id).name);
+                }
+            }
+            throw std::runtime_error("System accesses undeclared components");
+        }
+    }
+
+    SystemBuilder &SystemBuilder::exclusive() {
+        *m_Exclusive = true;
+        return *this;
+    }
+
+    SystemBuilder::SystemBuilder(ComponentMask *reads, ComponentMask *writes, bool *exclusive)
+        : m_Reads(reads), m_Writes(writes), m_Exclusive(exclusive) {
+    }
+
+    SystemScheduler::SystemScheduler(World &world, JobSystem &jobs) : m_World(world), m_Jobs(jobs) {
+    }
+
+    SystemBuilder SystemScheduler::addSystem(const char *name, SystemFunction function) {
+        m_Systems.push_back(System{name, std::move(function), {}, {}, false, EntityCommands(m_World)});
+        m_Dirty = true;
+
+        System& system = m_Systems.back();
+        return SystemBuilder(&system.reads, &system.writes, &system.exclusive);
+    }
+
+    void SystemScheduler::run(double dt) {
+        if (m_Dirty) {
+            buildWaves();
+        }
+
+        m_Dt = dt;
+        for (size_t wave = 0; wave + 1 < m_WaveStarts.size(); wave++) {
+            uint32_t begin = m_WaveStarts[wave];
+            uint32_t end = m_WaveStarts[wave + 1];
+
+            if (end - begin == 1) {
+                if (m_Systems[m_WaveOrder[begin]].exclusive) {
+                    applyCommands();
+                }
+                runSystem(m_WaveOrder[begin]);
+                continue;
+            }
+
+            JobCounter counter;
+            for (uint32_t i = begin + 1; i < end; i++) {
+                m_Jobs.schedule(Job{&SystemScheduler::runJob, this, m_WaveOrder[i], 0, &counter});
+            }
+            try {
+                runSystem(m_WaveOrder[begin]);
+            } catch (...) {
+                // the other systems of the wave still reference the counter
+                m_Jobs.wait(counter);
+                throw;
+            }
+            m_Jobs.wait(counter);
+        }
+
+        applyCommands();
+    }
+
+    size_t SystemScheduler::getSystemCount() const noexcept {
+        return m_Systems.size();
+    }
+
+    size_t SystemScheduler::getWaveCount() {
+        if (m_Dirty) {
+            buildWaves();
+        }
+        return m_WaveStarts.empty() ? 0 : m_WaveStarts.size() - 1;
+    }
+
+    bool SystemScheduler::conflicts(const System &a, const System &b) {
+        return a.exclusive || b.exclusive
+               || (a.writes & (b.reads | b.writes)).any()
+               || (b.writes & a.reads).any();
+    }
+
+    void SystemScheduler::runJob(void *data, size_t begin, size_t) {
+        static_cast<SystemScheduler*>(data)->runSystem(begin);
+    }
+
+    void SystemScheduler::buildWaves() {
+        // a system runs one wave after the latest earlier system it conflicts with
+        std::vector<uint32_t> waves(m_Systems.size(), 0);
+        uint32_t waveCount = 0;
+        for (size_t i = 0; i < m_Systems.size(); i++) {
+            for (size_t j = 0; j < i; j++) {
+                if (conflicts(m_Systems[i], m_Systems[j])) {
+                    waves[i] = std::max(waves[i], waves[j] + 1);
+                }
+            }
+            waveCount = std::max(waveCount, waves[i] + 1);
+        }
+
+        m_WaveOrder.clear();
+        m_WaveStarts.clear();
+        for (uint32_t wave = 0; wave < waveCount; wave++) {
+            m_WaveStarts.push_back(static_cast<uint32_t>(m_WaveOrder.size()));
+            for (uint32_t i = 0; i < m_Systems.size(); i++) {
+                if (waves[i] == wave) {
+                    m_WaveOrder.push_back(i);
+                }
+            }
+        }
+        m_WaveStarts.push_back(static_cast<uint32_t>(m_WaveOrder.size()));
+
+        spdlog::info("Scheduled {} systems in {} waves", m_Systems.size(), waveCount);
+        m_Dirty = false;
+    }
+
+    void SystemScheduler::runSystem(size_t index) {
+        System& system = m_Systems[index];
+        SystemContext context(m_World, system.commands, m_Jobs, m_Dt, system.name, system.reads, system.writes, system.exclusive);
+        system.function(context);
+    }
+
+    void SystemScheduler::applyCommands() {
+        for (System& system : m_Systems) {
+            if (!system.commands.isEmpty()) {
+                system.commands.apply();
+            }
+        }
+        m_World.flushReserved();
+    }
+}
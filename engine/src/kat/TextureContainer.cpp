@@ -0,0 +1,155 @@
+#include "kat/TextureContainer.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace kat {
+
+    uint32_t getTextureFormatBlockSize(TextureFormat format) {
+        switch (format) {
+            case TextureFormat::eRGBA8:
+                return 4;
+            case TextureFormat::eBC1:
+            case TextureFormat::eBC4:
+                return 8;
+            case TextureFormat::eBC3:
+            case TextureFormat::eBC5:
+            case TextureFormat::eBC7:
+                return 16;
+        }
+        return 0;
+    }
+
+    bool isBlockCompressed(TextureFormat format) {
+        return format != TextureFormat::eRGBA8;
+    }
+
+    uint64_t getTextureLevelSize(TextureFormat format, uint32_t width, uint32_t height) {
+        if (!isBlockCompressed(format)) {
+            return static_cast<uint64_t>(width) * height * getTextureFormatBlockSize(format);
+        }
+        return static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * getTextureFormatBlockSize(format);
+    }
+
+    vk::Format toVkFormat(TextureFormat format, bool srgb) {
+        switch (format) {
+            case TextureFormat::eRGBA8:
+                return srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+            case TextureFormat::eBC1:
+                return srgb ? vk::Format::eBc1RgbSrgbBlock : vk::Format::eBc1RgbUnormBlock;
+            case TextureFormat::eBC3:
+                return srgb ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+            case TextureFormat::eBC4:
+                return vk::Format::eBc4UnormBlock;
+            case TextureFormat::eBC5:
+                return vk::Format::eBc5UnormBlock;
+            case TextureFormat::eBC7:
+                return srgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+        }
+        return vk::Format::eUndefined;
+    }
+
+    const char *toString(TextureFormat format) {
+        switch (format) {
+            case TextureFormat::eRGBA8:
+                return "RGBA8";
+            case TextureFormat::eBC1:
+                return "BC1";
+            case TextureFormat::eBC3:
+                return "BC3";
+            case TextureFormat::eBC4:
+                return "BC4";
+            case TextureFormat::eBC5:
+                return "BC5";
+            case TextureFormat::eBC7:
+                return "BC7";
+        }
+        return "unknown";
+    }
+
+    TextureContainer::TextureContainer(const std::filesystem::path &path) : m_File(path) {
+        std::span<const std::byte> data = m_File.getData();
+
+        auto invalid = [&](const char* reason) {
+            spdlog::error("{} is not a valid texture container: {}", path.string(), reason);
+            return std::runtime_error("Invalid texture container");
+        };
+
+        if (data.size() < sizeof(TextureFileHeader)) {
+            throw invalid("truncated header");
+        }
+        m_Header = reinterpret_cast<const TextureFileHeader*>(data.data());
+        if (m_Header->magic != kTextureFileMagic) {
+            throw invalid("bad magic");
+        }
+        if (m_Header->version != kTextureFileVersion) {
+            throw invalid("unsupported version");
+        }
+        if (m_Header->mipCount == 0 || m_Header->variantCount == 0 || m_Header->mipCount > 32) {
+            throw invalid("no mips or variants");
+        }
+        if (m_Header->width == 0 || m_Header->height == 0) {
+            throw invalid("empty image");
+        }
+
+        uint64_t tableEnd = sizeof(TextureFileHeader) + sizeof(TextureFileVariant) * static_cast<uint64_t>(m_Header->variantCount)
+                            + sizeof(TextureFileMip) * static_cast<uint64_t>(m_Header->variantCount) * m_Header->mipCount;
+        if (tableEnd > data.size()) {
+            throw invalid("truncated tables");
+        }
+
+        m_Variants = {reinterpret_cast<const TextureFileVariant*>(data.data() + sizeof(TextureFileHeader)), m_Header->variantCount};
+        m_Mips = {reinterpret_cast<const TextureFileMip*>(m_Variants.data() + m_Variants.size()),
+                  static_cast<size_t>(m_Header->variantCount) * m_Header->mipCount};
+
+        for (uint32_t v = 0; v < m_Header->variantCount; v++) {
+            if (getTextureFormatBlockSize(m_Variants[v].format) == 0) {
+                throw invalid("unknown format");
+            }
+            std::span<const TextureFileMip> mips = getMips(v);
+            for (uint32_t level = 0; level < mips.size(); level++) {
+                const TextureFileMip& mip = mips[level];
+                // a full chain from the header's extent, which readers size the image by
+                if (mip.width != std::max(1U, m_Header->width >> level) || mip.height != std::max(1U, m_Header->height >> level)) {
+                    throw invalid("mip extent doesn't match its level");
+                }
+                if (mip.offset % kTextureFileAlignment != 0 || mip.offset < tableEnd || mip.offset > data.size()
+                    || mip.size > data.size() - mip.offset || mip.size != getTextureLevelSize(m_Variants[v].format, mip.width, mip.height)) {
+                    throw invalid("mip out of bounds");
+                }
+            }
+        }
+    }
+
+    const TextureFileHeader &TextureContainer::getHeader() const noexcept {
+        return *m_Header;
+    }
+
+    std::span<const TextureFileVariant> TextureContainer::getVariants() const noexcept {
+        return m_Variants;
+    }
+
+    std::span<const TextureFileMip> TextureContainer::getMips(uint32_t variant) const {
+        return m_Mips.subspan(static_cast<size_t>(variant) * m_Header->mipCount, m_Header->mipCount);
+    }
+
+    std::span<const std::byte> TextureContainer::getMipData(uint32_t variant, uint32_t level) const {
+        const TextureFileMip& mip = getMips(variant)[level];
+        return m_File.getData().subspan(mip.offset, mip.size);
+    }
+
+    bool TextureContainer::isSrgb() const noexcept {
+        return (m_Header->flags & kTextureFileSrgb) != 0;
+    }
+
+    std::optional<uint32_t> TextureContainer::selectVariant(vk::PhysicalDevice gpu) const {
+        for (uint32_t v = 0; v < m_Variants.size(); v++) {
+            vk::FormatProperties properties = gpu.getFormatProperties(toVkFormat(m_Variants[v].format, isSrgb()));
+            if (properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage) {
+                return v;
+            }
+        }
+        return std::nullopt;
+    }
+}
@@ -0,0 +1,342 @@
+#include "kat/TextureStreamer.h"
+#include "kat/MappedFile.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <array>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#include <stb_image.h>
+
+namespace kat {
+
+    TextureStreamer::TextureStreamer(App &app, const TextureStreamerConfig &config)
+        : m_App(app), m_Device(app.getDevice()), m_Config(config) {
+        m_MaxDecodes = config.max_concurrent_decodes != 0 ? config.max_concurrent_decodes : app.getJobSystem().getWorkerCount();
+
+        m_Placeholder = app.getDeviceAllocator().createImage(vk::ImageCreateInfo{
+            vk::ImageCreateFlags(), vk::ImageType::e2D, vk::Format::eR8G8B8A8Unorm, vk::Extent3D{1, 1, 1}, 1, 1,
+            vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst
+        });
+        const std::array<uint8_t, 4> white{255, 255, 255, 255};
+        app.getUploadService().uploadImage(ImageUpload{m_Placeholder.image, {vk::ImageAspectFlagBits::eColor, 0, 0, 1}, {0, 0, 0}, vk::Extent3D{1, 1, 1}},
+                                           std::as_bytes(std::span(white)));
+
+        m_PlaceholderView = m_Device.createImageView(vk::ImageViewCreateInfo{
+            vk::ImageViewCreateFlags(), m_Placeholder.image, vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Unorm, {},
+            vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}
+        });
+        m_PlaceholderBinding = app.getBindlessRegistry().registerImage(m_PlaceholderView);
+
+        bool anisotropy = app.getEngine()->getGpuFeatures().samplerAnisotropy;
+        m_Sampler = m_Device.createSampler(vk::SamplerCreateInfo{
+            vk::SamplerCreateFlags(), vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear,
+            vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat,
+            0.0f, anisotropy, anisotropy ? std::min(16.0f, app.getEngine()->getGpuProperties().limits.maxSamplerAnisotropy) : 1.0f,
+            false, vk::CompareOp::eNever, 0.0f, VK_LOD_CLAMP_NONE
+        });
+        m_SamplerBinding = app.getBindlessRegistry().registerSampler(m_Sampler);
+    }
+
+    void TextureStreamer::cleanup() {
+        m_App.getJobSystem().wait(m_Decodes);
+
+        // batches not yet submitted may still copy into the images
+        UploadService& uploads = m_App.getUploadService();
+        uploads.wait(uploads.flush());
+
+        for (auto& texture : m_Textures) {
+            destroyTexture(*texture);
+        }
+        m_Textures.clear();
+
+        BindlessRegistry& bindless = m_App.getBindlessRegistry();
+        bindless.release(m_SamplerBinding);
+        bindless.release(m_PlaceholderBinding);
+        m_Device.destroySampler(m_Sampler);
+        m_Device.destroyImageView(m_PlaceholderView);
+        m_App.getDeviceAllocator().destroyImage(m_Placeholder);
+    }
+
+    TextureHandle TextureStreamer::load(const std::filesystem::path &path, float priority, bool srgb) {
+        auto texture = std::make_unique<Texture>();
+        texture->path = path;
+        texture->priority = priority;
+        texture->srgb = srgb;
+
+        std::lock_guard lock(m_Mutex);
+        auto index = static_cast<uint32_t>(m_Textures.size());
+        m_Textures.push_back(std::move(texture));
+        m_Queued.push_back(index);
+        return TextureHandle{index};
+    }
+
+    void TextureStreamer::setPriority(TextureHandle texture, float priority) {
+        std::lock_guard lock(m_Mutex);
+        m_Textures[texture.index]->priority = priority;
+    }
+
+    void TextureStreamer::update() {
+        {
+            std::lock_guard lock(m_Mutex);
+            for (uint32_t index : m_Decoded) {
+                m_Streaming.push_back(index);
+            }
+            m_Decoded.clear();
+        }
+
+        publishMips();
+        startDecodes();
+        uploadMips();
+    }
+
+    BindlessImage TextureStreamer::getImage(TextureHandle texture) const {
+        BindlessImage binding = m_Textures[texture.index]->binding;
+        return binding.index != kInvalidBindlessIndex ? binding : m_PlaceholderBinding;
+    }
+
+    TextureState TextureStreamer::getState(TextureHandle texture) const {
+        std::lock_guard lock(m_Mutex);
+        return m_Textures[texture.index]->state;
+    }
+
+    BindlessSampler TextureStreamer::getSampler() const noexcept {
+        return m_SamplerBinding;
+    }
+
+    size_t TextureStreamer::getPendingCount() const {
+        std::lock_guard lock(m_Mutex);
+        return m_Queued.size() + m_RunningDecodes + m_Decoded.size() + m_Streaming.size();
+    }
+
+    bool TextureStreamer::decode(Texture &texture) const {
+        if (texture.path.extension() == ".ktex") {
+            return openContainer(texture);
+        }
+
+        try {
+            MappedFile file(texture.path);
+            std::span<const std::byte> data = file.getData();
+
+            int width = 0;
+            int height = 0;
+            int channels = 0;
+            stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(data.data()), static_cast<int>(data.size()),
+                                                    &width, &height, &channels, 4);
+            if (!pixels) {
+                spdlog::error("Failed to decode {}: {}", texture.path.string(), stbi_failure_reason());
+                return false;
+            }
+
+            std::span<const std::byte> rgba(reinterpret_cast<const std::byte*>(pixels), static_cast<size_t>(width) * height * 4);
+            texture.mips = buildMipChain(rgba, static_cast<uint32_t>(width), static_cast<uint32_t>(height), texture.srgb, m_Config.max_resolution);
+            texture.format = texture.srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+            stbi_image_free(pixels);
+            return true;
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to load {}: {}", texture.path.string(), e.what());
+            return false;
+        }
+    }
+
+    bool TextureStreamer::openContainer(Texture &texture) const {
+        try {
+            auto container = std::make_unique<TextureContainer>(texture.path);
+            std::optional<uint32_t> variant = container->selectVariant(m_App.getEngine()->getGpu());
+            if (!variant) {
+                spdlog::error("{} has no format this GPU can sample, cook it with --fallback", texture.path.string());
+                return false;
+            }
+
+            std::span<const TextureFileMip> mips = container->getMips(*variant);
+            uint32_t base = 0;
+            while (base + 1 < mips.size() && std::max(mips[base].width, mips[base].height) > m_Config.max_resolution) {
+                base++;
+            }
+
+            texture.mips = MipChain{};
+            for (size_t mip = base; mip < mips.size(); mip++) {
+                texture.mips.levels.push_back(MipLevel{mips[mip].width, mips[mip].height, mips[mip].offset, mips[mip].size});
+            }
+            texture.format = toVkFormat(container->getVariants()[*variant].format, container->isSrgb());
+            texture.srgb = container->isSrgb();
+            texture.variant = *variant;
+            texture.baseMip = base;
+            texture.container = std::move(container);
+            return true;
+        } catch (const std::exception& e) {
+            spdlog::error("Failed to load {}: {}", texture.path.string(), e.what());
+            return false;
+        }
+    }
+
+    std::span<const std::byte> TextureStreamer::getLevelData(const Texture &texture, uint32_t mip) {
+        if (texture.container) {
+            return texture.container->getMipData(texture.variant, texture.baseMip + mip);
+        }
+        return texture.mips.getLevel(mip);
+    }
+
+    void TextureStreamer::startDecodes() {
+        std::lock_guard lock(m_Mutex);
+
+        // decoded mip chains waiting for upload bound the memory held by the streamer
+        while (!m_Queued.empty() && m_RunningDecodes < m_MaxDecodes && m_Decoded.size() + m_Streaming.size() < m_MaxDecodes * 4) {
+            auto next = std::max_element(m_Queued.begin(), m_Queued.end(), [&](uint32_t a, uint32_t b) {
+                return m_Textures[a]->priority < m_Textures[b]->priority;
+            });
+            uint32_t index = *next;
+            *next = m_Queued.back();
+            m_Queued.pop_back();
+
+            Texture* texture = m_Textures[index].get();
+            texture->state = TextureState::eDecoding;
+            m_RunningDecodes++;
+
+            m_App.getJobSystem().schedule([this, texture, index]() {
+                bool decoded = decode(*texture);
+
+                std::lock_guard jobLock(m_Mutex);
+                m_RunningDecodes--;
+                texture->state = decoded ? TextureState::eStreaming : TextureState::eFailed;
+                if (decoded) {
+                    m_Decoded.push_back(index);
+                }
+            }, &m_Decodes);
+        }
+    }
+
+    void TextureStreamer::uploadMips() {
+        if (m_Streaming.empty()) {
+            return;
+        }
+
+        std::sort(m_Streaming.begin(), m_Streaming.end(), [&](uint32_t a, uint32_t b) {
+            return m_Textures[a]->priority > m_Textures[b]->priority;
+        });
+
+        UploadService& uploads = m_App.getUploadService();
+        vk::DeviceSize budget = m_Config.upload_budget;
+        bool uploaded = false;
+
+        // one step per texture per round, so every texture gets its coarse mips before any gets its fine ones
+        for (bool progress = true; progress;) {
+            progress = false;
+            for (uint32_t index : m_Streaming) {
+                Texture& texture = *m_Textures[index];
+                if (texture.uploadedMip == 0 && texture.image.image) {
+                    continue;
+                }
+                if (!texture.image.image) {
+                    createImage(texture);
+                }
+
+                // the first step takes the whole mip tail
+                uint32_t first = texture.uploadedMip - 1;
+                vk::DeviceSize size = texture.mips.levels[first].size;
+                if (texture.uploadedMip == texture.mips.levels.size()) {
+                    while (first > 0 && size + texture.mips.levels[first - 1].size <= kMipTailSize) {
+                        first--;
+                        size += texture.mips.levels[first].size;
+                    }
+                }
+
+                // a mip larger than the whole budget still goes, alone
+                if (size > budget && uploaded) {
+                    return;
+                }
+
+                UploadToken token = 0;
+                for (uint32_t mip = texture.uploadedMip; mip-- > first;) {
+                    const MipLevel& level = texture.mips.levels[mip];
+                    token = uploads.uploadImage(ImageUpload{
+                        texture.image.image, {vk::ImageAspectFlagBits::eColor, mip, 0, 1}, {0, 0, 0}, vk::Extent3D{level.width, level.height, 1}
+                    }, getLevelData(texture, mip));
+                }
+
+                texture.uploadedMip = first;
+                texture.pendingMips.emplace_back(first, token);
+                budget -= std::min(budget, size);
+                uploaded = true;
+                progress = true;
+            }
+        }
+    }
+
+    void TextureStreamer::publishMips() {
+        UploadService& uploads = m_App.getUploadService();
+        BindlessRegistry& bindless = m_App.getBindlessRegistry();
+
+        for (size_t i = 0; i < m_Streaming.size();) {
+            Texture& texture = *m_Textures[m_Streaming[i]];
+
+            uint32_t visible = texture.visibleMip;
+            size_t completed = 0;
+            while (completed < texture.pendingMips.size() && uploads.isComplete(texture.pendingMips[completed].second)) {
+                visible = texture.pendingMips[completed].first;
+                completed++;
+            }
+            texture.pendingMips.erase(texture.pendingMips.begin(), texture.pendingMips.begin() + static_cast<ptrdiff_t>(completed));
+
+            if (visible != texture.visibleMip) {
+                auto levelCount = static_cast<uint32_t>(texture.mips.levels.size());
+                vk::ImageView view = m_Device.createImageView(vk::ImageViewCreateInfo{
+                    vk::ImageViewCreateFlags(), texture.image.image, vk::ImageViewType::e2D, texture.format, {},
+                    vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, visible, levelCount - visible, 0, 1}
+                });
+
+                // frames in flight, and those a render thread has yet to record, may still sample the previous view;
+                // release and deferDeletion() wait for the last of them
+                bindless.release(texture.binding);
+                if (texture.view) {
+                    m_App.deferDeletion([device = m_Device, old = texture.view]() {
+                        device.destroyImageView(old);
+                    });
+                }
+
+                texture.view = view;
+                texture.binding = bindless.registerImage(view);
+                texture.visibleMip = visible;
+            }
+
+            if (texture.visibleMip == 0) {
+                {
+                    std::lock_guard lock(m_Mutex);
+                    texture.state = TextureState::eResident;
+                }
+                texture.mips = MipChain{};
+                texture.container.reset();
+                m_Streaming[i] = m_Streaming.back();
+                m_Streaming.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    void TextureStreamer::createImage(Texture &texture) {
+        auto levelCount = static_cast<uint32_t>(texture.mips.levels.size());
+        const MipLevel& top = texture.mips.levels[0];
+
+        texture.image = m_App.getDeviceAllocator().createImage(vk::ImageCreateInfo{
+            vk::ImageCreateFlags(), vk::ImageType::e2D, texture.format,
+            vk::Extent3D{top.width, top.height, 1}, levelCount, 1,
+            vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+            vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst
+        });
+        texture.uploadedMip = levelCount;
+        texture.visibleMip = levelCount;
+    }
+
+    void TextureStreamer::destroyTexture(Texture &texture) {
+        m_App.getBindlessRegistry().release(texture.binding);
+        if (texture.view) {
+            m_Device.destroyImageView(texture.view);
+        }
+        if (texture.image.image) {
+            m_App.getDeviceAllocator().destroyImage(texture.image);
+        }
+    }
+}
@@ -0,0 +1,289 @@
+#include "kat/UploadService.h"
+#include "kat/FrameCapture.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstring>
+
+namespace kat {
+
+    namespace {
+        constexpr vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    UploadService::UploadService(App &app, vk::DeviceSize stagingSize)
+        : m_App(app), m_Device(app.getDevice()), m_OwnershipTransfer(app.getTransferFamily() != app.getGraphicsFamily()) {
+        vk::PhysicalDeviceLimits limits = app.getEngine()->getGpuProperties().limits;
+        m_CopyAlignment = std::max(kStagingAlignment, limits.optimalBufferCopyOffsetAlignment);
+        m_StagingSize = alignUp(stagingSize, 256);
+
+        AllocationDesc stagingDesc{};
+        stagingDesc.required = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+        m_Staging = app.getDeviceAllocator().createBuffer(vk::BufferCreateInfo{
+            vk::BufferCreateFlags(), m_StagingSize, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive
+        }, stagingDesc);
+        m_StagingMemory = static_cast<std::byte*>(m_Staging.allocation->mapped);
+
+        vk::SemaphoreTypeCreateInfo timelineInfo{vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.setPNext(&timelineInfo);
+        m_Timeline = m_Device.createSemaphore(semaphoreInfo);
+
+        m_CommandPool = m_Device.createCommandPool(vk::CommandPoolCreateInfo{
+            vk::CommandPoolCreateFlagBits::eResetCommandBuffer, app.getTransferFamily()
+        });
+
+        spdlog::info("Created upload service with a {} MiB staging ring", m_StagingSize / (1024 * 1024));
+    }
+
+    void UploadService::cleanup() {
+        std::lock_guard lock(m_Mutex);
+
+        if (m_Current.has_value()) {
+            submitBatch();
+        }
+        if (m_LastSubmitted != 0) {
+            vk::SemaphoreWaitInfo waitInfo{};
+            waitInfo.setSemaphores(m_Timeline);
+            waitInfo.setValues(m_LastSubmitted);
+            m_Device.waitSemaphores(waitInfo, UINT64_MAX);
+        }
+
+        m_Device.destroyCommandPool(m_CommandPool);
+        m_Device.destroySemaphore(m_Timeline);
+        m_App.getDeviceAllocator().destroyBuffer(m_Staging);
+    }
+
+    UploadToken UploadService::uploadBuffer(vk::Buffer buffer, vk::DeviceSize offset, std::span<const std::byte> data) {
+        if (data.empty()) {
+            return 0;
+        }
+        if (FrameCapture* capture = m_App.getFrameCapture()) {
+            capture->recordUpload(buffer, data.size());
+        }
+
+        std::lock_guard lock(m_Mutex);
+
+        // large uploads go in pieces so they never need the whole ring
+        vk::DeviceSize maxChunk = m_StagingSize / 4;
+        for (vk::DeviceSize copied = 0; copied < data.size();) {
+            vk::DeviceSize chunk = std::min<vk::DeviceSize>(maxChunk, data.size() - copied);
+            vk::DeviceSize stagingOffset = reserveStaging(chunk, kStagingAlignment);
+            std::memcpy(m_StagingMemory + stagingOffset, data.data() + copied, chunk);
+
+            currentCommandBuffer().copyBuffer(m_Staging.buffer, buffer, vk::BufferCopy{stagingOffset, offset + copied, chunk});
+            copied += chunk;
+        }
+
+        if (m_OwnershipTransfer) {
+            m_BufferReleases.emplace_back(
+                vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(),
+                m_App.getTransferFamily(), m_App.getGraphicsFamily(),
+                buffer, offset, data.size()
+            );
+        }
+
+        return m_Current->token;
+    }
+
+    UploadToken UploadService::uploadImage(const ImageUpload &upload, std::span<const std::byte> data) {
+        if (upload.currentLayout == vk::ImageLayout::eUndefined && (upload.offset.x != 0 || upload.offset.y != 0 || upload.offset.z != 0)) {
+            spdlog::error("Upload at offset ({}, {}, {}) would discard the rest of mip {}, pass the image's current layout",
+                          upload.offset.x, upload.offset.y, upload.offset.z, upload.subresource.mipLevel);
+            throw std::runtime_error("Partial image upload from an undefined layout");
+        }
+        if (FrameCapture* capture = m_App.getFrameCapture()) {
+            capture->recordUpload(nullptr, data.size());
+        }
+
+        std::lock_guard lock(m_Mutex);
+
+        vk::DeviceSize stagingOffset = reserveStaging(data.size(), m_CopyAlignment);
+        std::memcpy(m_StagingMemory + stagingOffset, data.data(), data.size());
+
+        vk::ImageSubresourceRange range{
+            upload.subresource.aspectMask, upload.subresource.mipLevel, 1, upload.subresource.baseArrayLayer, upload.subresource.layerCount
+        };
+
+        // coming from eUndefined drops the old texels, which only a full upload may do
+        vk::CommandBuffer commandBuffer = currentCommandBuffer();
+        vk::ImageMemoryBarrier toTransfer{
+            vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite,
+            upload.currentLayout, vk::ImageLayout::eTransferDstOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+            upload.image, range
+        };
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, toTransfer);
+
+        commandBuffer.copyBufferToImage(m_Staging.buffer, upload.image, vk::ImageLayout::eTransferDstOptimal, vk::BufferImageCopy{
+            stagingOffset, 0, 0, upload.subresource, upload.offset, upload.extent
+        });
+
+        // the layout transition doubles as the release when the families differ; the timeline semaphore takes care
+        // of visibility either way
+        m_ImageReleases.emplace_back(
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(),
+            vk::ImageLayout::eTransferDstOptimal, upload.finalLayout,
+            m_OwnershipTransfer ? m_App.getTransferFamily() : VK_QUEUE_FAMILY_IGNORED,
+            m_OwnershipTransfer ? m_App.getGraphicsFamily() : VK_QUEUE_FAMILY_IGNORED,
+            upload.image, range
+        );
+
+        return m_Current->token;
+    }
+
+    UploadToken UploadService::flush() {
+        std::lock_guard lock(m_Mutex);
+
+        if (m_Current.has_value()) {
+            submitBatch();
+        }
+        retireCompleted();
+        return m_LastSubmitted;
+    }
+
+    bool UploadService::isComplete(UploadToken token) {
+        return m_Device.getSemaphoreCounterValue(m_Timeline) >= token;
+    }
+
+    void UploadService::wait(UploadToken token) {
+        {
+            // waiting on a batch that was never submitted would never return
+            std::lock_guard lock(m_Mutex);
+            if (m_Current.has_value() && token >= m_Current->token) {
+                submitBatch();
+            }
+        }
+
+        vk::SemaphoreWaitInfo waitInfo{};
+        waitInfo.setSemaphores(m_Timeline);
+        waitInfo.setValues(token);
+        m_Device.waitSemaphores(waitInfo, UINT64_MAX);
+    }
+
+    UploadToken UploadService::recordAcquireBarriers(vk::CommandBuffer commandBuffer) {
+        std::lock_guard lock(m_Mutex);
+
+        if (!m_BufferAcquires.empty() || !m_ImageAcquires.empty()) {
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eAllCommands, {}, nullptr, m_BufferAcquires, m_ImageAcquires);
+            m_BufferAcquires.clear();
+            m_ImageAcquires.clear();
+        }
+
+        return m_LastSubmitted;
+    }
+
+    vk::Semaphore UploadService::getTimelineSemaphore() {
+        return m_Timeline;
+    }
+
+    vk::DeviceSize UploadService::reserveStaging(vk::DeviceSize size, vk::DeviceSize alignment) {
+        for (;;) {
+            vk::DeviceSize head = alignUp(m_StagingHead, alignment);
+            if (head % m_StagingSize + size > m_StagingSize) {
+                // doesn't fit before the end of the ring, wrap around
+                head += m_StagingSize - head % m_StagingSize;
+            }
+
+            if (head + size - m_StagingTail <= m_StagingSize) {
+                m_StagingHead = head + size;
+                currentCommandBuffer();
+                m_Current->stagingEnd = m_StagingHead;
+                return head % m_StagingSize;
+            }
+
+            bool idle = !m_Current.has_value() && m_InFlight.empty();
+            if (idle) {
+                spdlog::error("Upload of {} bytes doesn't fit into the {} byte staging ring", size, m_StagingSize);
+                throw std::runtime_error("Upload larger than the staging ring");
+            }
+
+            // the ring is full: submit what's pending and wait for the oldest batch to free its range
+            if (m_Current.has_value()) {
+                submitBatch();
+            }
+
+            vk::SemaphoreWaitInfo waitInfo{};
+            waitInfo.setSemaphores(m_Timeline);
+            waitInfo.setValues(m_InFlight.front().token);
+            m_Device.waitSemaphores(waitInfo, UINT64_MAX);
+            retireCompleted();
+        }
+    }
+
+    vk::CommandBuffer UploadService::currentCommandBuffer() {
+        if (!m_Current.has_value()) {
+            vk::CommandBuffer commandBuffer;
+            if (m_FreeCommandBuffers.empty()) {
+                commandBuffer = m_Device.allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+                    m_CommandPool, vk::CommandBufferLevel::ePrimary, 1
+                })[0];
+            } else {
+                commandBuffer = m_FreeCommandBuffers.back();
+                m_FreeCommandBuffers.pop_back();
+            }
+
+            commandBuffer.begin(vk::CommandBufferBeginInfo{vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+            m_Current = Batch{commandBuffer, m_LastSubmitted + 1, m_StagingHead};
+        }
+
+        return m_Current->commandBuffer;
+    }
+
+    void UploadService::submitBatch() {
+        Batch batch = m_Current.value();
+        m_Current.reset();
+
+        if (!m_BufferReleases.empty() || !m_ImageReleases.empty()) {
+            batch.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, m_BufferReleases, m_ImageReleases);
+        }
+        batch.commandBuffer.end();
+
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.setSignalSemaphoreValues(batch.token);
+
+        vk::SubmitInfo submit{};
+        submit.setCommandBuffers(batch.commandBuffer);
+        submit.setSignalSemaphores(m_Timeline);
+        submit.setPNext(&timelineInfo);
+
+        {
+            std::unique_lock queueLock(m_App.getGraphicsQueueMutex(), std::defer_lock);
+            if (m_App.isTransferQueueShared()) {
+                queueLock.lock();
+            }
+            m_App.getTransferQueue().submit(submit);
+        }
+
+        if (m_OwnershipTransfer) {
+            for (auto barrier : m_BufferReleases) {
+                barrier.setSrcAccessMask(vk::AccessFlags()).setDstAccessMask(vk::AccessFlagBits::eMemoryRead);
+                m_BufferAcquires.push_back(barrier);
+            }
+            for (auto barrier : m_ImageReleases) {
+                barrier.setSrcAccessMask(vk::AccessFlags()).setDstAccessMask(vk::AccessFlagBits::eMemoryRead);
+                m_ImageAcquires.push_back(barrier);
+            }
+        }
+        m_BufferReleases.clear();
+        m_ImageReleases.clear();
+
+        m_LastSubmitted = batch.token;
+        m_InFlight.push_back(batch);
+    }
+
+    void UploadService::retireCompleted() {
+        uint64_t completed = m_Device.getSemaphoreCounterValue(m_Timeline);
+        while (!m_InFlight.empty() && m_InFlight.front().token <= completed) {
+            m_StagingTail = m_InFlight.front().stagingEnd;
+            m_FreeCommandBuffers.push_back(m_InFlight.front().commandBuffer);
+            m_InFlight.pop_front();
+        }
+
+        if (m_InFlight.empty() && !m_Current.has_value()) {
+            m_StagingTail = m_StagingHead;
+        }
+    }
+}
@@ -0,0 +1,352 @@
+#include "kat/World.h"
+
+#include <spdlog/spdlog.h>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+namespace kat {
+
+    namespace {
+        std::mutex g_ComponentMutex;
+        std::array<ComponentInfo, kMaxComponents> g_Components{};
+        uint32_t g_ComponentCount = 0;
+
+        size_t alignUp(size_t value, size_t alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    ComponentId detail::registerComponent(uint32_t size, const char *name) {
+        std::lock_guard lock(g_ComponentMutex);
+        if (g_ComponentCount == kMaxComponents) {
+            spdlog::error("Too many component types, {} is one over the limit of {}", name, kMaxComponents);
+            throw std::runtime_error("Too many component types");
+        }
+
+        g_Components[g_ComponentCount] = ComponentInfo{size, name};
+        return g_ComponentCount++;
+    }
+
+    const ComponentInfo &getComponentInfo(ComponentId id) {
+        return g_Components[id];
+    }
+
+    Archetype::Archetype(const ComponentMask &mask) : m_Mask(mask) {
+        size_t rowSize = sizeof(Entity);
+        for (ComponentId id = 0; id < kMaxComponents; id++) {
+            if (mask.test(id)) {
+                m_Components.push_back(id);
+                rowSize += getComponentInfo(id).size;
+            }
+        }
+
+        // every column starts on its own cache line, so shrink until the padding fits as well
+        auto layout = [&](uint32_t capacity) {
+            size_t offset = sizeof(Entity) * capacity;
+            for (ComponentId id : m_Components) {
+                offset = alignUp(offset, kCacheLineSize);
+                m_Offsets[id] = static_cast<uint32_t>(offset);
+                offset += static_cast<size_t>(getComponentInfo(id).size) * capacity;
+            }
+            return offset;
+        };
+
+        m_Capacity = static_cast<uint32_t>(kChunkSize / rowSize);
+        while (m_Capacity > 0 && layout(m_Capacity) > kChunkSize) {
+            m_Capacity--;
+        }
+
+        if (m_Capacity == 0) {
+            spdlog::error("Components of an archetype take {} bytes per entity, more than a {} byte chunk holds", rowSize, kChunkSize);
+            throw std::runtime_error("Archetype too large for a chunk");
+        }
+    }
+
+    Archetype::~Archetype() {
+        for (Chunk& chunk : m_Chunks) {
+            ::operator delete(chunk.data, std::align_val_t{kCacheLineSize});
+        }
+    }
+
+    uint32_t Archetype::allocateRow(Entity entity) {
+        if (m_Count == m_Chunks.size() * m_Capacity) {
+            m_Chunks.push_back(Chunk{static_cast<std::byte*>(::operator new(kChunkSize, std::align_val_t{kCacheLineSize})), 0});
+        }
+
+        auto row = static_cast<uint32_t>(m_Count++);
+        Chunk& chunk = m_Chunks[row / m_Capacity];
+        getEntities(chunk)[chunk.count++] = entity;
+        return row;
+    }
+
+    Entity Archetype::removeRow(uint32_t row) {
+        auto last = static_cast<uint32_t>(m_Count - 1);
+        Chunk& lastChunk = m_Chunks[last / m_Capacity];
+        Entity moved = kNullEntity;
+
+        if (row != last) {
+            Chunk& chunk = m_Chunks[row / m_Capacity];
+            for (ComponentId id : m_Components) {
+                std::memcpy(getComponent(row, id), getComponent(last, id), getComponentInfo(id).size);
+            }
+            moved = getEntities(lastChunk)[last % m_Capacity];
+            getEntities(chunk)[row % m_Capacity] = moved;
+        }
+
+        m_Count--;
+        if (--lastChunk.count == 0) {
+            ::operator delete(lastChunk.data, std::align_val_t{kCacheLineSize});
+            m_Chunks.pop_back();
+        }
+        return moved;
+    }
+
+    std::byte *Archetype::getComponent(uint32_t row, ComponentId id) {
+        return getColumn(m_Chunks[row / m_Capacity], id) + static_cast<size_t>(getComponentInfo(id).size) * (row % m_Capacity);
+    }
+
+    World::World() {
+        m_EmptyArchetype = getArchetype(ComponentMask{});
+    }
+
+    World::~World() = default;
+
+    Entity World::create() {
+        Entity entity = reserve();
+        flushReserved();
+        return entity;
+    }
+
+    void World::destroy(Entity entity) {
+        flushReserved();
+        EntityRecord& record = getRecord(entity);
+
+        Entity moved = record.archetype->removeRow(record.row);
+        if (moved != kNullEntity) {
+            m_Records[moved.index].row = record.row;
+        }
+
+        record.archetype = nullptr;
+        record.generation++;
+        m_FreeIndices.push_back(entity.index);
+        m_FreeCursor.store(static_cast<int64_t>(m_FreeIndices.size()), std::memory_order_relaxed);
+        m_EntityCount--;
+    }
+
+    bool World::isAlive(Entity entity) const noexcept {
+        return entity.index < m_Records.size() && m_Records[entity.index].archetype
+               && m_Records[entity.index].generation == entity.generation;
+    }
+
+    Entity World::reserve() {
+        int64_t cursor = m_FreeCursor.fetch_sub(1, std::memory_order_relaxed) - 1;
+        if (cursor >= 0) {
+            uint32_t index = m_FreeIndices[cursor];
+            return Entity{index, m_Records[index].generation};
+        }
+        return Entity{static_cast<uint32_t>(m_Records.size() + static_cast<size_t>(-cursor - 1)), 0};
+    }
+
+    void World::flushReserved() {
+        int64_t cursor = m_FreeCursor.load(std::memory_order_relaxed);
+        if (cursor == static_cast<int64_t>(m_FreeIndices.size())) {
+            return;
+        }
+
+        // reservations took free indices from the back first, then fresh ones in order
+        size_t firstReused = static_cast<size_t>(std::max<int64_t>(cursor, 0));
+        for (size_t i = m_FreeIndices.size(); i > firstReused; i--) {
+            uint32_t index = m_FreeIndices[i - 1];
+            place(Entity{index, m_Records[index].generation});
+        }
+        m_FreeIndices.resize(firstReused);
+
+        if (cursor < 0) {
+            size_t first = m_Records.size();
+            m_Records.resize(first + static_cast<size_t>(-cursor));
+            for (size_t index = first; index < m_Records.size(); index++) {
+                place(Entity{static_cast<uint32_t>(index), 0});
+            }
+        }
+
+        m_FreeCursor.store(static_cast<int64_t>(m_FreeIndices.size()), std::memory_order_relaxed);
+    }
+
+    void World::addRaw(Entity entity, ComponentId id, const void *data) {
+        flushReserved();
+        EntityRecord& record = getRecord(entity);
+        if (!record.archetype->getMask().test(id)) {
+            moveEntity(entity, record, getAddTarget(record.archetype, id));
+        }
+        std::memcpy(record.archetype->getComponent(record.row, id), data, getComponentInfo(id).size);
+    }
+
+    void World::removeRaw(Entity entity, ComponentId id) {
+        flushReserved();
+        EntityRecord& record = getRecord(entity);
+        if (record.archetype->getMask().test(id)) {
+            moveEntity(entity, record, getRemoveTarget(record.archetype, id));
+        }
+    }
+
+    void *World::getRaw(Entity entity, ComponentId id) {
+        if (!isAlive(entity)) {
+            return nullptr;
+        }
+
+        EntityRecord& record = m_Records[entity.index];
+        if (!record.archetype->getMask().test(id)) {
+            return nullptr;
+        }
+        return record.archetype->getComponent(record.row, id);
+    }
+
+    size_t World::getEntityCount() const noexcept {
+        return m_EntityCount;
+    }
+
+    size_t World::getArchetypeCount() const noexcept {
+        return m_Archetypes.size();
+    }
+
+    World::EntityRecord &World::getRecord(Entity entity) {
+        if (!isAlive(entity)) {
+            spdlog::error("Entity {}:{} is not alive", entity.index, entity.generation);
+            throw std::runtime_error("Entity is not alive");
+        }
+        return m_Records[entity.index];
+    }
+
+    Archetype *World::getArchetype(const ComponentMask &mask) {
+        auto it = m_ArchetypeMap.find(mask);
+        if (it != m_ArchetypeMap.end()) {
+            return it->second.get();
+        }
+
+        auto archetype = std::make_unique<Archetype>(mask);
+        Archetype* result = archetype.get();
+        m_ArchetypeMap.emplace(mask, std::move(archetype));
+        m_Archetypes.push_back(result);
+        return result;
+    }
+
+    Archetype *World::getAddTarget(Archetype *archetype, ComponentId id) {
+        auto it = archetype->m_AddEdges.find(id);
+        if (it != archetype->m_AddEdges.end()) {
+            return it->second;
+        }
+
+        Archetype* target = getArchetype(ComponentMask(archetype->getMask()).set(id));
+        archetype->m_AddEdges.emplace(id, target);
+        target->m_RemoveEdges.emplace(id, archetype);
+        return target;
+    }
+
+    Archetype *World::getRemoveTarget(Archetype *archetype, ComponentId id) {
+        auto it = archetype->m_RemoveEdges.find(id);
+        if (it != archetype->m_RemoveEdges.end()) {
+            return it->second;
+        }
+
+        Archetype* target = getArchetype(ComponentMask(archetype->getMask()).reset(id));
+        archetype->m_RemoveEdges.emplace(id, target);
+        target->m_AddEdges.emplace(id, archetype);
+        return target;
+    }
+
+    void World::moveEntity(Entity entity, EntityRecord &record, Archetype *target) {
+        Archetype* source = record.archetype;
+        uint32_t row = target->allocateRow(entity);
+
+        for (ComponentId id : target->getComponents()) {
+            if (source->getMask().test(id)) {
+                std::memcpy(target->getComponent(row, id), source->getComponent(record.row, id), getComponentInfo(id).size);
+            }
+        }
+
+        Entity moved = source->removeRow(record.row);
+        if (moved != kNullEntity) {
+            m_Records[moved.index].row = record.row;
+        }
+
+        record.archetype = target;
+        record.row = row;
+    }
+
+    void World::place(Entity entity) {
+        EntityRecord& record = m_Records[entity.index];
+        record.archetype = m_EmptyArchetype;
+        record.row = m_EmptyArchetype->allocateRow(entity);
+        m_EntityCount++;
+    }
+
+    void World::insertRaw(Entity entity, std::span<const ComponentId> ids, std::span<const void *const> data) {
+        EntityRecord& record = getRecord(entity);
+
+        ComponentMask mask = record.archetype->getMask();
+        for (ComponentId id : ids) {
+            mask.set(id);
+        }
+        if (mask != record.archetype->getMask()) {
+            moveEntity(entity, record, getArchetype(mask));
+        }
+
+        for (size_t i = 0; i < ids.size(); i++) {
+            std::memcpy(record.archetype->getComponent(record.row, ids[i]), data[i], getComponentInfo(ids[i]).size);
+        }
+    }
+
+    EntityCommands::EntityCommands(World &world) : m_World(&world) {
+    }
+
+    Entity EntityCommands::create() {
+        return m_World->reserve();
+    }
+
+    void EntityCommands::destroy(Entity entity) {
+        push(Op::eDestroy, entity, 0, nullptr, 0);
+    }
+
+    void EntityCommands::apply() {
+        m_World->flushReserved();
+
+        size_t offset = 0;
+        while (offset < m_Data.size()) {
+            Header header;
+            std::memcpy(&header, m_Data.data() + offset, sizeof(Header));
+            offset += sizeof(Header);
+
+            if (m_World->isAlive(header.entity)) {
+                switch (header.op) {
+                    case Op::eAdd:
+                        m_World->addRaw(header.entity, header.component, m_Data.data() + offset);
+                        break;
+                    case Op::eRemove:
+                        m_World->removeRaw(header.entity, header.component);
+                        break;
+                    case Op::eDestroy:
+                        m_World->destroy(header.entity);
+                        break;
+                }
+            }
+            offset += header.size;
+        }
+
+        m_Data.clear();
+    }
+
+    bool EntityCommands::isEmpty() const noexcept {
+        return m_Data.empty();
+    }
+
+    void EntityCommands::push(Op op, Entity entity, ComponentId component, const void *data, uint32_t size) {
+        Header header{op, component, entity, size};
+        size_t offset = m_Data.size();
+        m_Data.resize(offset + sizeof(Header) + size);
+        std::memcpy(m_Data.data() + offset, &header, sizeof(Header));
+        if (size > 0) {
+            std::memcpy(m_Data.data() + offset + sizeof(Header), data, size);
+        }
+    }
+}
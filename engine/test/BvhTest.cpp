@@ -0,0 +1,205 @@
+#include "kat/Bvh.h"
+#include "kat/JobSystem.h"
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+// Checks every Bvh query against a brute force pass over the same boxes after adds, moves, removes and rebuilds,
+// with enough objects for subtrees to be built in parallel. Exits with 1 on a failure.
+
+namespace {
+
+    using namespace kat;
+
+    // the same conservative test the frustum query makes, against the box's center and half extent
+    bool overlapsFrustum(const FrustumPlanes& planes, const Aabb& bounds) {
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+        for (const glm::vec4& plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -glm::dot(glm::abs(glm::vec3(plane)), extent)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::optional<float> intersectBox(const Ray& ray, const Aabb& bounds) {
+        glm::vec3 inverse = 1.0f / ray.direction;
+        glm::vec3 t0 = (bounds.min - ray.origin) * inverse;
+        glm::vec3 t1 = (bounds.max - ray.origin) * inverse;
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far = glm::max(t0, t1);
+        float enter = std::max({near.x, near.y, near.z, 0.0f});
+        float exit = std::min({far.x, far.y, far.z, ray.maxDistance});
+        if (enter > exit) {
+            return std::nullopt;
+        }
+        return enter;
+    }
+
+    class Checker {
+    public:
+        explicit Checker(JobSystem& jobs) : m_Bvh(jobs) {}
+
+        void add(const Aabb& bounds) {
+            auto item = static_cast<uint32_t>(m_Boxes.size());
+            m_Boxes.push_back(bounds);
+            m_Proxies.push_back(m_Bvh.add(bounds, item));
+        }
+
+        void remove(uint32_t item) {
+            m_Bvh.remove(m_Proxies[item]);
+            m_Proxies[item] = kNullProxy;
+        }
+
+        void move(uint32_t item, glm::vec3 offset) {
+            m_Boxes[item] = Aabb{m_Boxes[item].min + offset, m_Boxes[item].max + offset};
+            m_Bvh.setBounds(m_Proxies[item], m_Boxes[item]);
+        }
+
+        [[nodiscard]] bool isAlive(uint32_t item) const {
+            return m_Proxies[item] != kNullProxy;
+        }
+
+        [[nodiscard]] uint32_t getItemCount() const {
+            return static_cast<uint32_t>(m_Boxes.size());
+        }
+
+        Bvh& getBvh() {
+            return m_Bvh;
+        }
+
+        // returns the number of queries that disagree with brute force
+        int check(const char* stage) {
+            int failures = 0;
+
+            glm::mat4 viewProjection(0.0f);
+            viewProjection[0][0] = 1.0f;
+            viewProjection[1][1] = -1.0f;
+            viewProjection[2][2] = 200.0f / (0.1f - 200.0f);
+            viewProjection[2][3] = -1.0f;
+            viewProjection[3][2] = 0.1f * 200.0f / (0.1f - 200.0f);
+            FrustumPlanes planes = getFrustumPlanes(viewProjection);
+            std::vector<uint32_t> found;
+            m_Bvh.queryFrustum(planes, found);
+            failures += compare(stage, "frustum", found, [&](const Aabb& bounds) { return overlapsFrustum(planes, bounds); });
+
+            Aabb query{glm::vec3{-20.0f, -20.0f, -20.0f}, glm::vec3{25.0f, 10.0f, 30.0f}};
+            found.clear();
+            m_Bvh.queryAabb(query, found);
+            failures += compare(stage, "box", found, [&](const Aabb& bounds) { return query.overlaps(bounds); });
+
+            Ray ray{glm::vec3{-120.0f, 3.0f, 5.0f}, glm::normalize(glm::vec3{1.0f, 0.05f, -0.02f}), 500.0f};
+            found.clear();
+            m_Bvh.queryRay(ray, found);
+            failures += compare(stage, "ray", found, [&](const Aabb& bounds) { return intersectBox(ray, bounds).has_value(); });
+
+            std::optional<float> closest;
+            for (uint32_t i = 0; i < getItemCount(); i++) {
+                std::optional<float> distance = isAlive(i) ? intersectBox(ray, m_Boxes[i]) : std::nullopt;
+                if (distance && (!closest || *distance < *closest)) {
+                    closest = distance;
+                }
+            }
+            std::optional<RayHit> hit = m_Bvh.raycast(ray, [&](uint32_t item) { return intersectBox(ray, m_Boxes[item]); });
+            if (hit.has_value() != closest.has_value() || (hit && hit->distance != *closest)) {
+                spdlog::error("{}: raycast hit at {}, brute force at {}", stage, hit ? hit->distance : -1.0f, closest.value_or(-1.0f));
+                failures++;
+            }
+
+            return failures;
+        }
+
+    private:
+        template<typename Predicate>
+        int compare(const char* stage, const char* query, std::vector<uint32_t>& found, Predicate overlaps) {
+            std::vector<uint32_t> expected;
+            for (uint32_t i = 0; i < getItemCount(); i++) {
+                if (isAlive(i) && overlaps(m_Boxes[i])) {
+                    expected.push_back(i);
+                }
+            }
+            // duplicates have to show up as a mismatch too, so the found items aren't deduplicated
+            std::sort(found.begin(), found.end());
+            if (found != expected) {
+                spdlog::error("{}: {} query found {} objects, brute force {}", stage, query, found.size(), expected.size());
+                return 1;
+            }
+            return 0;
+        }
+
+        Bvh m_Bvh;
+        std::vector<Aabb> m_Boxes;
+        std::vector<BvhProxy> m_Proxies;
+    };
+}
+
+int main() {
+    JobSystem jobs(3);
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+    auto randomBox = [&] {
+        glm::vec3 center{position(rng), position(rng), position(rng)};
+        glm::vec3 extent{size(rng), size(rng), size(rng)};
+        return Aabb{center - extent, center + extent};
+    };
+
+    constexpr uint32_t kObjects = 20000;
+    Checker checker(jobs);
+    for (uint32_t i = 0; i < kObjects; i++) {
+        checker.add(randomBox());
+    }
+    checker.getBvh().commit();
+    int failures = checker.check("built");
+
+    // few enough moves to refit
+    for (int i = 0; i < 100; i++) {
+        checker.move(rng() % kObjects, glm::vec3{position(rng), position(rng), position(rng)} * 0.1f);
+    }
+    checker.getBvh().commit();
+    failures += checker.check("refitted");
+
+    // far enough to loosen the tree into a rebuild
+    for (int round = 0; round < 5; round++) {
+        for (uint32_t i = 0; i < kObjects; i++) {
+            checker.move(i, glm::vec3{position(rng), position(rng), position(rng)} * 0.5f);
+        }
+        checker.getBvh().commit();
+    }
+    failures += checker.check("scattered");
+
+    for (int i = 0; i < 1000; i++) {
+        uint32_t item = rng() % kObjects;
+        if (checker.isAlive(item)) {
+            checker.remove(item);
+        }
+    }
+    checker.getBvh().commit();
+    failures += checker.check("removed");
+
+    // reuses the removed proxies, and moves objects in the same commit
+    for (int i = 0; i < 500; i++) {
+        checker.add(randomBox());
+    }
+    for (int i = 0; i < 500; i++) {
+        uint32_t item = rng() % checker.getItemCount();
+        if (checker.isAlive(item)) {
+            checker.move(item, glm::vec3{position(rng), 0.0f, position(rng)} * 0.1f);
+        }
+    }
+    checker.getBvh().commit();
+    failures += checker.check("re-added");
+
+    checker.getBvh().rebuild();
+    failures += checker.check("rebuilt");
+
+    if (failures != 0) {
+        spdlog::error("{} BVH queries disagree with brute force", failures);
+        return EXIT_FAILURE;
+    }
+    spdlog::info("BVH queries match brute force over {} objects", checker.getItemCount());
+    return EXIT_SUCCESS;
+}